@@ -1,6 +1,7 @@
 #pragma once
 
 #include <array>
+#include <cstddef>
 #include <cstdint>
 #include <optional>
 #include <string>
@@ -20,4 +21,18 @@ std::vector<std::string> GetTokenList(std::uint16_t opcode, std::uint16_t expans
 std::string Do(std::uint16_t opcode, std::uint16_t expansion = 0,
                std::optional<ArArpSettings> ar_arp = std::nullopt);
 
+// Allocation-free variants, formatting from per-opcode templates built on first use.
+// Like snprintf, they write at most size - 1 characters plus a terminating null and return the
+// length of the full text.
+std::size_t Do(char* out, std::size_t size, std::uint16_t opcode, std::uint16_t expansion = 0,
+               const ArArpSettings* ar_arp = nullptr);
+
+// Disassembles the program words [words, words + count), loaded at `address`, one
+// "AAAAA: text" line per instruction. Only whole lines are written; returns the number of words
+// consumed, so a caller with a small buffer can flush and continue from there. An expansion
+// word missing at the end of the range stops it as well.
+std::size_t DoRange(char* out, std::size_t size, std::size_t& written, const std::uint16_t* words,
+                    std::size_t count, std::uint32_t address,
+                    const ArArpSettings* ar_arp = nullptr);
+
 } // namespace Teakra::Disassembler
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+namespace Teakra {
+
+struct DmaStats {
+    // transfers started, per DMA channel
+    std::array<std::uint64_t, 8> transfers{};
+    // 16-bit words moved, indexed by source / destination space (0 = data, 1 = MMIO, 7 = AHBM)
+    std::array<std::uint64_t, 8> words_from_space{};
+    std::array<std::uint64_t, 8> words_to_space{};
+    // cycles between transfer start and the completion interrupt, per DMA channel
+    std::array<std::uint64_t, 8> transfer_cycles{};
+};
+
+struct AhbmStats {
+    // bursts issued, indexed by burst size (x1, x4, x8)
+    std::array<std::uint64_t, 3> read_bursts{};
+    std::array<std::uint64_t, 3> write_bursts{};
+    // external memory callback invocations, indexed by access width (8, 16, 32 bit)
+    std::array<std::uint64_t, 3> external_reads{};
+    std::array<std::uint64_t, 3> external_writes{};
+};
+
+// bucket 0 counts zero-cycle latencies, bucket i counts latencies in [2^(i-1), 2^i)
+struct LatencyHistogram {
+    std::array<std::uint64_t, 32> buckets{};
+    std::uint64_t count = 0;
+    std::uint64_t total_cycles = 0;
+    std::uint64_t max_cycles = 0;
+};
+
+enum class InterruptSource : std::size_t {
+    Timer0,
+    Timer1,
+    Apbp,
+    Btdmp,
+    Dma,
+    Vectored, // any source dispatched through the vectored interrupt
+    Count,
+};
+
+struct InterruptStats {
+    // DSP cycles from ICU trigger to the processor jumping to the handler
+    std::array<LatencyHistogram, static_cast<std::size_t>(InterruptSource::Count)> latency{};
+};
+
+// Host code generation tier of the JIT, picked from CPUID. Each tier includes the ones before;
+// Bmi2 also requires LZCNT, and Avx512 the F, BW and VL subsets.
+enum class JitCpuTier : std::uint8_t {
+    Baseline, // x86-64
+    Bmi2,
+    Avx2,
+    Avx512,
+};
+
+struct JitStats {
+    std::uint64_t blocks_compiled = 0;
+    std::uint64_t instructions_compiled = 0;
+    std::uint64_t host_bytes = 0;
+    std::uint64_t compile_ns = 0;
+    // lockstep verification: blocks checked, sampled blocks that could not be checked (MMIO
+    // accesses, bank exchanges) and checked blocks that diverged from the interpreter
+    std::uint64_t lockstep_samples = 0;
+    std::uint64_t lockstep_skipped = 0;
+    std::uint64_t lockstep_divergences = 0;
+    // blocks run on the interpreter because the JIT can't compile one of their instructions
+    std::uint64_t interpreted_blocks = 0;
+    // hot code relayout: passes run, blocks recompiled into the hot region and their code size
+    std::uint64_t relayouts = 0;
+    std::uint64_t relayout_blocks = 0;
+    std::uint64_t relayout_bytes = 0;
+    JitCpuTier cpu_tier = JitCpuTier::Baseline;
+};
+
+struct Stats {
+    // DSP cycles elapsed, including idle cycles that were skipped
+    std::uint64_t cycles = 0;
+    DmaStats dma;
+    AhbmStats ahbm;
+    InterruptStats interrupts;
+    JitStats jit;
+};
+
+// element-wise difference, for turning two snapshots into a per-frame delta
+Stats operator-(const Stats& lhs, const Stats& rhs);
+
+} // namespace Teakra
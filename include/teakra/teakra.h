@@ -4,6 +4,9 @@
 #include <cstdint>
 #include <functional>
 #include <memory>
+#include <span>
+#include <string>
+#include "teakra/stats.h"
 
 namespace Teakra {
 
@@ -18,6 +21,71 @@ struct AHBMCallback {
     std::function<void(std::uint32_t address, std::uint32_t value)> write32;
 };
 
+enum class WatchpointType : std::uint8_t {
+    Read = 1,
+    Write = 2,
+    ReadWrite = Read | Write,
+};
+
+// pc is the address of the accessing instruction, on both backends. Callbacks may add and
+// remove watchpoints; the ones matching an access are all called as of its start.
+using WatchpointCallback = std::function<void(std::uint32_t pc, std::uint16_t address,
+                                              std::uint16_t value, bool is_write)>;
+
+// Sampled verification of JIT blocks against a shadow interpreter, for catching miscompiles in
+// the field. Each sample costs a few microseconds, so large intervals keep the overhead small.
+struct LockstepConfig {
+    // verify one out of every `interval` executed blocks; 0 turns verification off
+    std::uint32_t interval = 0;
+    // draw the gap between samples at random around `interval` instead of a fixed stride
+    bool randomize = false;
+    // continue on the interpreter from the shadow's state after the first divergence
+    bool fallback_to_interpreter = false;
+    // receives the report, including the disassembly of the block; dropped when unset, leaving
+    // only JitStats::lockstep_divergences
+    std::function<void(const std::string& report)> divergence_handler;
+};
+
+// Periodic recompilation of the most executed JIT blocks into a contiguous hot region, in the
+// order they were first run, so the hot loop of a firmware shares i-cache lines and iTLB pages.
+struct HotRelayoutConfig {
+    // block dispatches between relayouts; 0 turns relayout off
+    std::uint32_t interval = 0;
+    // number of blocks moved into the hot region each time
+    std::uint32_t blocks = 256;
+};
+
+// Outcome of Teakra::LoadDsp1
+struct Dsp1LoadResult {
+    enum class Status : std::uint8_t {
+        Ok,
+        Malformed,    // truncated image, bad magic or segment count, or a segment outside the image
+        OutOfRange,   // a segment doesn't fit the memory it targets
+        HashMismatch, // a segment's SHA-256 differs from the one in the header
+    };
+    Status status = Status::Malformed;
+    // 64-bit hash of the whole image, for keying caches of compiled or analyzed code
+    std::uint64_t hash = 0;
+    // the component sends a word on each of the three pipes once it has started
+    bool recv_data_on_start = false;
+};
+
+// Outcome of Teakra::RunBatch
+struct BatchStats {
+    // instructions stepped over all instances, and the ones that reused the fetch and decode
+    // of another instance at the same pc
+    std::uint64_t steps = 0;
+    std::uint64_t shared_steps = 0;
+};
+
+// DSP events that complete a frame, publishing the snapshot regions (Teakra::AddSnapshotRegion)
+struct FramePublishConfig {
+    // the DSP setting any of these semaphore bits
+    std::uint16_t semaphore_bits = 0;
+    // the DSP sending on any of these APBP data channels, bit i for channel i (0-2)
+    std::uint8_t recv_data_channels = 0;
+};
+
 class Processor;
 
 class Teakra {
@@ -31,6 +99,13 @@ public:
     std::array<std::uint8_t, 0x80000>& GetDspMemory();
     const std::array<std::uint8_t, 0x80000>& GetDspMemory() const;
 
+    // copies the segments of a DSP1 component into program and data memory, reading the image
+    // in place. Segment hashes are optionally checked first, in parallel (0 threads = all
+    // cores). Nothing is written unless the result is Ok. Compiled code is not invalidated,
+    // so components are meant to be loaded right after Reset.
+    Dsp1LoadResult LoadDsp1(std::span<const std::uint8_t> image, bool verify_hashes = false,
+                            unsigned threads = 0);
+
     // APBP Data
     bool SendDataIsEmpty(std::uint8_t index) const;
     void SendData(std::uint8_t index, std::uint16_t value);
@@ -51,11 +126,31 @@ public:
     void ProgramWrite(std::uint32_t address, std::uint16_t value);
     std::uint16_t DataRead(std::uint16_t address, bool bypass_mmio = false);
     void DataWrite(std::uint16_t address, std::uint16_t value, bool bypass_mmio = false);
+    // bulk DataRead / DataWrite over consecutive addresses, for moving shared structures
+    void DataReadWords(std::uint16_t address, std::span<std::uint16_t> out,
+                       bool bypass_mmio = false);
+    void DataWriteWords(std::uint16_t address, std::span<const std::uint16_t> in,
+                        bool bypass_mmio = false);
     std::uint16_t DataReadA32(std::uint32_t address) const;
     void DataWriteA32(std::uint32_t address, std::uint16_t value);
     std::uint16_t MMIORead(std::uint16_t address);
     void MMIOWrite(std::uint16_t address, std::uint16_t value);
 
+    // frame-consistent copies of DSP-written structures. A region of data memory (without MIU
+    // paging, as laid out in GetDspMemory) is copied whenever the DSP completes a frame, and
+    // ReadSnapshot returns the latest copy without stopping the DSP, along with its frame number
+    // (0 before the first frame). Only the first out.size() words are read. AddSnapshotRegion
+    // returns 0 for an empty region or one running past the end of data memory.
+    void SetFramePublishConfig(const FramePublishConfig& config);
+    std::uint32_t AddSnapshotRegion(std::uint16_t address, std::uint16_t words);
+    void RemoveSnapshotRegion(std::uint32_t id);
+    std::uint64_t ReadSnapshot(std::uint32_t id, std::span<std::uint16_t> out) const;
+
+    // data watchpoints over [begin, end] in the DSP data address space
+    std::uint32_t AddWatchpoint(std::uint16_t begin, std::uint16_t end, WatchpointType type,
+                                WatchpointCallback callback);
+    void RemoveWatchpoint(std::uint32_t id);
+
     // DSP_PADR is only 16-bit, so this is where the DMA interface gets the
     // upper 16-bits from
     std::uint16_t DMAChan0GetSrcHigh();
@@ -72,11 +167,33 @@ public:
 
     // core
     std::uint32_t Run(std::uint32_t cycle);
+    // experimental: runs each instance for the given cycles, stepping interpreter instances
+    // together an instruction at a time so that instances of the same firmware at the same pc
+    // share one decode. Callbacks of different instances interleave. JIT instances just Run.
+    static BatchStats RunBatch(std::span<Teakra* const> instances, std::uint32_t cycles);
 
     void SetAHBMCallback(const AHBMCallback& callback);
 
     void SetAudioCallback(std::function<void(std::array<std::int16_t, 2>)> callback);
 
+    // telemetry; the delta variant returns the change since its previous call (e.g. per frame)
+    Stats GetStats() const;
+    Stats GetStatsDelta();
+
+    // guest call-graph profiling
+    void SetCallProfilingEnabled(bool enabled);
+    void ResetCallProfile();
+    // callgrind-compatible dump; open frames are counted up to now and stay open
+    std::string ExportCallProfile();
+
+    // JIT lockstep verification, no effect on the interpreter
+    void SetLockstepConfig(const LockstepConfig& config);
+    // JIT hot code relayout, no effect on the interpreter
+    void SetHotRelayoutConfig(const HotRelayoutConfig& config);
+    // highest host code generation tier the JIT may use; AVX2 and AVX-512 are opt-in, and
+    // the host's own support always caps it (see Stats::jit.cpu_tier)
+    void SetJitMaxCpuTier(JitCpuTier tier);
+
 private:
     struct Impl;
     std::unique_ptr<Impl> impl_jit;
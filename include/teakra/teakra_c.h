@@ -1,5 +1,6 @@
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
 
@@ -46,11 +47,22 @@ uint16_t Teakra_ProgramRead(TeakraContext* context, uint32_t address);
 void Teakra_ProgramWrite(TeakraContext* context, uint32_t address, uint16_t value);
 uint16_t Teakra_DataRead(TeakraContext* context, uint16_t address, bool bypass_mmio);
 void Teakra_DataWrite(TeakraContext* context, uint16_t address, uint16_t value, bool bypass_mmio);
+void Teakra_DataReadWords(TeakraContext* context, uint16_t address, uint16_t* out, size_t count,
+                          bool bypass_mmio);
+void Teakra_DataWriteWords(TeakraContext* context, uint16_t address, const uint16_t* in,
+                           size_t count, bool bypass_mmio);
 uint16_t Teakra_DataReadA32(TeakraContext* context, uint32_t address);
 void Teakra_DataWriteA32(TeakraContext* context, uint32_t address, uint16_t value);
 uint16_t Teakra_MMIORead(TeakraContext* context, uint16_t address);
 void Teakra_MMIOWrite(TeakraContext* context, uint16_t address, uint16_t value);
 
+void Teakra_SetFramePublishConfig(TeakraContext* context, uint16_t semaphore_bits,
+                                  uint8_t recv_data_channels);
+uint32_t Teakra_AddSnapshotRegion(TeakraContext* context, uint16_t address, uint16_t words);
+void Teakra_RemoveSnapshotRegion(TeakraContext* context, uint32_t id);
+uint64_t Teakra_ReadSnapshot(const TeakraContext* context, uint32_t id, uint16_t* out,
+                             size_t count);
+
 uint16_t Teakra_DMAChan0GetSrcHigh(TeakraContext* context);
 uint16_t Teakra_DMAChan0GetDstHigh(TeakraContext* context);
 
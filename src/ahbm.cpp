@@ -38,6 +38,7 @@ u32 Ahbm::Read32(u16 channel, u32 address) {
     if (channels[channel].burst_queue.empty()) {
         u32 current = address;
         unsigned size = channels[channel].GetBurstSize();
+        ++stats.read_bursts[channels[channel].BurstIndex()];
         for (unsigned i = 0; i < size; ++i) {
             u32 value = 0;
             switch (channels[channel].unit_size) {
@@ -65,6 +66,9 @@ u32 Ahbm::Read32(u16 channel, u32 address) {
                             static_cast<u16>(channels[channel].unit_size));
                 break;
             }
+            if (channels[channel].unit_size <= UnitSize::U32) {
+                ++stats.external_reads[static_cast<u16>(channels[channel].unit_size)];
+            }
             channels[channel].burst_queue.push(value);
         }
     }
@@ -95,6 +99,7 @@ void Ahbm::WriteInternal(u16 channel, u32 address, u32 value) {
     channels[channel].burst_queue.push(value);
     if (channels[channel].burst_queue.size() >= channels[channel].GetBurstSize()) {
         u32 current = channels[channel].write_burst_start;
+        ++stats.write_bursts[channels[channel].BurstIndex()];
         while (!channels[channel].burst_queue.empty()) {
             u32 value32 = channels[channel].burst_queue.front();
             channels[channel].burst_queue.pop();
@@ -103,6 +108,7 @@ void Ahbm::WriteInternal(u16 channel, u32 address, u32 value) {
                 // this weird behaviour is hwtested
                 u8 value8 = ((current & 1) == 1) ? (u8)(value32 >> 8) : (u8)value32;
                 write_external8(current, value8);
+                ++stats.external_writes[0];
                 current += 1;
                 break;
             }
@@ -111,8 +117,10 @@ void Ahbm::WriteInternal(u16 channel, u32 address, u32 value) {
                 u32 c1 = c0 + 1;
                 if (c0 >= current) {
                     write_external16(c0, (u16)value32);
+                    ++stats.external_writes[1];
                 } else {
                     write_external8(c1, (u8)(value32 >> 8));
+                    ++stats.external_writes[0];
                 }
                 current += 2;
                 break;
@@ -125,13 +133,17 @@ void Ahbm::WriteInternal(u16 channel, u32 address, u32 value) {
 
                 if (c0 >= current && c1 >= current && c2 >= current) {
                     write_external32(c0, value32);
+                    ++stats.external_writes[2];
                 } else if (c2 >= current) {
                     if (c1 >= current) {
                         write_external8(c1, (u8)(value32 >> 8));
+                        ++stats.external_writes[0];
                     }
                     write_external16(c2, (u16)(value32 >> 16));
+                    ++stats.external_writes[1];
                 } else {
                     write_external8(c3, (u8)(value32 >> 24));
+                    ++stats.external_writes[0];
                 }
 
                 current += 4;
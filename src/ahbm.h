@@ -4,6 +4,7 @@
 #include <utility>
 #include <queue>
 #include "common_types.h"
+#include "teakra/stats.h"
 
 namespace Teakra {
 
@@ -76,7 +77,12 @@ public:
         write_external32 = std::move(write32);
     }
 
+    const AhbmStats& GetStats() const {
+        return stats;
+    }
+
 private:
+    AhbmStats stats;
     u16 busy_flag = 0;
     struct Channel {
         UnitSize unit_size = UnitSize::U8;
@@ -87,6 +93,10 @@ private:
         std::queue<u32> burst_queue;
         u32 write_burst_start = 0;
         unsigned GetBurstSize();
+        std::size_t BurstIndex() const {
+            const u16 index = static_cast<u16>(burst_size);
+            return index < 3 ? index : 0;
+        }
     };
     std::array<Channel, 3> channels;
 
@@ -56,11 +56,13 @@ private:
 class Apbp::Impl {
 public:
     std::array<DataChannel, 3> data_channels;
+    std::function<void(unsigned channel)> data_observer;
     u16 semaphore = 0;
     u16 semaphore_mask = 0;
     bool semaphore_master_signal = false;
     mutable std::recursive_mutex semaphore_mutex;
     std::function<void()> semaphore_handler;
+    std::function<void(u16 bits)> semaphore_observer;
 
     void Reset() {
         for (auto& c : data_channels)
@@ -79,6 +81,9 @@ void Apbp::Reset() {
 }
 
 void Apbp::SendData(unsigned channel, u16 data) {
+    if (impl->data_observer) {
+        impl->data_observer(channel);
+    }
     impl->data_channels[channel].Send(data);
 }
 
@@ -106,8 +111,15 @@ void Apbp::SetDataHandler(unsigned channel, std::function<void()> handler) {
     impl->data_channels[channel].handler = std::move(handler);
 }
 
+void Apbp::SetDataObserver(std::function<void(unsigned channel)> observer) {
+    impl->data_observer = std::move(observer);
+}
+
 void Apbp::SetSemaphore(u16 bits) {
     std::lock_guard lock(impl->semaphore_mutex);
+    if (impl->semaphore_observer) {
+        impl->semaphore_observer(bits);
+    }
     impl->semaphore |= bits;
     bool new_signal = (impl->semaphore & ~impl->semaphore_mask) != 0;
     if (new_signal && impl->semaphore_handler) {
@@ -142,6 +154,11 @@ void Apbp::SetSemaphoreHandler(std::function<void()> handler) {
     impl->semaphore_handler = std::move(handler);
 }
 
+void Apbp::SetSemaphoreObserver(std::function<void(u16 bits)> observer) {
+    std::lock_guard lock(impl->semaphore_mutex);
+    impl->semaphore_observer = std::move(observer);
+}
+
 bool Apbp::IsSemaphoreSignaled() const {
     std::lock_guard lock(impl->semaphore_mutex);
     return impl->semaphore_master_signal;
@@ -19,6 +19,8 @@ public:
     u16 GetDisableInterrupt(unsigned channel) const;
     void SetDisableInterrupt(unsigned channel, u16 v);
     void SetDataHandler(unsigned channel, std::function<void()> handler);
+    // Called on every SendData, whether or not the channel interrupt is disabled
+    void SetDataObserver(std::function<void(unsigned channel)> observer);
 
     void SetSemaphore(u16 bits);
     void ClearSemaphore(u16 bits);
@@ -26,6 +28,8 @@ public:
     void MaskSemaphore(u16 bits);
     u16 GetSemaphoreMask() const;
     void SetSemaphoreHandler(std::function<void()> handler);
+    // Called on every SetSemaphore with the bits set, whatever the mask
+    void SetSemaphoreObserver(std::function<void(u16 bits)> observer);
 
     bool IsSemaphoreSignaled() const;
 
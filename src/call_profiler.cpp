@@ -0,0 +1,105 @@
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include "call_profiler.h"
+
+namespace Teakra {
+
+void CallProfiler::Enter(u32 function, u64 offset) {
+    const u64 now = Now(offset);
+    if (stack.empty()) {
+        stack.push_back({RootFunction, now, 0});
+        functions.try_emplace(RootFunction);
+    }
+    if (stack.size() >= MaxDepth) {
+        return;
+    }
+    stack.push_back({function, now, 0});
+    ++functions[function].calls;
+}
+
+void CallProfiler::Leave(u64 offset) {
+    // Returns without a matching call (the root frame) are ignored
+    if (stack.size() < 2) {
+        return;
+    }
+    Pop(Now(offset));
+}
+
+void CallProfiler::Pop(u64 now) {
+    const Frame frame = stack.back();
+    stack.pop_back();
+
+    const u64 inclusive = now - frame.enter;
+    // Recursive functions count their inclusive cycles once per active frame
+    auto& stats = functions[frame.function];
+    stats.inclusive += inclusive;
+    stats.exclusive += inclusive - std::min(inclusive, frame.child);
+
+    if (!stack.empty()) {
+        Frame& parent = stack.back();
+        parent.child += inclusive;
+        auto& edge = edges[{parent.function, frame.function}];
+        ++edge.calls;
+        edge.inclusive += inclusive;
+    }
+}
+
+CallProfiler CallProfiler::Closed(u64 offset) const {
+    CallProfiler closed = *this;
+    const u64 now = Now(offset);
+    while (!closed.stack.empty()) {
+        closed.Pop(now);
+    }
+    return closed;
+}
+
+void CallProfiler::Reset() {
+    stack.clear();
+    functions.clear();
+    edges.clear();
+}
+
+static std::string FunctionName(u32 function) {
+    char name[16];
+    if (function == CallProfiler::RootFunction) {
+        return "root";
+    }
+    std::snprintf(name, sizeof(name), "0x%05X", function);
+    return name;
+}
+
+std::string CallProfiler::ExportCallgrind() const {
+    std::string out = "version: 1\ncreator: teakra\npositions: instr\nevents: Cycles\n\n";
+    char line[64];
+
+    std::vector<u32> sorted;
+    sorted.reserve(functions.size());
+    for (const auto& [function, stats] : functions) {
+        sorted.push_back(function);
+    }
+    std::sort(sorted.begin(), sorted.end());
+
+    for (u32 function : sorted) {
+        const auto& stats = functions.at(function);
+        out += "fn=" + FunctionName(function) + "\n";
+        std::snprintf(line, sizeof(line), "0x%05X %" PRIu64 "\n",
+                      function == RootFunction ? 0 : function, stats.exclusive);
+        out += line;
+        auto it = edges.lower_bound({function, 0});
+        for (; it != edges.end() && it->first.first == function; ++it) {
+            const u32 callee = it->first.second;
+            out += "cfn=" + FunctionName(callee) + "\n";
+            std::snprintf(line, sizeof(line), "calls=%" PRIu64 " 0x%05X\n", it->second.calls,
+                          callee);
+            out += line;
+            std::snprintf(line, sizeof(line), "0x%05X %" PRIu64 "\n",
+                          function == RootFunction ? 0 : function, it->second.inclusive);
+            out += line;
+        }
+        out += "\n";
+    }
+    return out;
+}
+
+} // namespace Teakra
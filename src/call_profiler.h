@@ -0,0 +1,76 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "common_types.h"
+#include "core_timing.h"
+
+namespace Teakra {
+
+/**
+ * Shadow call stack driven by call/ret and interrupt entry/exit, accumulating inclusive and
+ * exclusive cycles per guest function and per caller->callee edge.
+ * Timestamps come from CoreTiming; the JIT only ticks at block exit, so it passes the offset of
+ * the instruction within the block being executed.
+ */
+class CallProfiler {
+public:
+    /// Function address used for code running outside of any recorded call
+    static constexpr u32 RootFunction = 0xFFFFFFFF;
+    /// Deeper stacks are treated as unbalanced firmware control flow and are not recorded
+    static constexpr std::size_t MaxDepth = 1024;
+
+    struct FunctionStats {
+        u64 calls = 0;
+        u64 inclusive = 0;
+        u64 exclusive = 0;
+    };
+
+    struct EdgeStats {
+        u64 calls = 0;
+        u64 inclusive = 0;
+    };
+
+    explicit CallProfiler(CoreTiming& core_timing) : core_timing(core_timing) {}
+
+    void Enter(u32 function, u64 offset = 0);
+    void Leave(u64 offset = 0);
+    void Reset();
+
+    /// Returns a copy with all open frames closed as if they returned now, so that their cycles
+    /// show up in its statistics. The shadow call stack of this profiler is left alone.
+    CallProfiler Closed(u64 offset = 0) const;
+
+    const std::unordered_map<u32, FunctionStats>& GetFunctions() const {
+        return functions;
+    }
+    const std::map<std::pair<u32, u32>, EdgeStats>& GetEdges() const {
+        return edges;
+    }
+
+    /// Writes the profile in the callgrind text format, with one event (DSP cycles)
+    std::string ExportCallgrind() const;
+
+private:
+    struct Frame {
+        u32 function;
+        u64 enter;
+        u64 child;
+    };
+
+    u64 Now(u64 offset) const {
+        return core_timing.GetTicks() + offset;
+    }
+
+    void Pop(u64 now);
+
+    CoreTiming& core_timing;
+    std::vector<Frame> stack;
+    std::unordered_map<u32, FunctionStats> functions;
+    std::map<std::pair<u32, u32>, EdgeStats> edges;
+};
+
+} // namespace Teakra
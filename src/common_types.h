@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <cstdint>
 
 using u8 = std::uint8_t;
@@ -47,3 +48,12 @@ inline constexpr u16 BitReverse(u16 value) {
     }
     return result;
 }
+
+// BitReverse of every u16, for bit-reversed addressing on the hot paths of both backends
+inline const std::array<u16, 0x10000> BitReverseTable = [] {
+    std::array<u16, 0x10000> table{};
+    for (u32 i = 0; i < table.size(); ++i) {
+        table[i] = static_cast<u16>((table[i >> 1] >> 1) | ((i & 1) << 15));
+    }
+    return table;
+}();
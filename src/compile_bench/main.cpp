@@ -0,0 +1,59 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <teakra/teakra.h>
+#include "../common_types.h"
+
+// Runs a DSP1 firmware on the JIT and reports how fast guest code gets compiled.
+// Blocks are compiled on first execution, so this measures the code the firmware actually uses.
+
+static constexpr u32 Slice = 16384;
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::printf("Usage: %s <firmware.cdc> [cycles]\n", argv[0]);
+        return -1;
+    }
+    const u64 cycles = argc > 2 ? std::strtoull(argv[2], nullptr, 0) : 100'000'000;
+
+    FILE* file = std::fopen(argv[1], "rb");
+    if (!file) {
+        std::printf("Cannot open %s\n", argv[1]);
+        return -1;
+    }
+    std::fseek(file, 0, SEEK_END);
+    std::vector<u8> raw(std::ftell(file));
+    std::fseek(file, 0, SEEK_SET);
+    if (std::fread(raw.data(), 1, raw.size(), file) != raw.size()) {
+        std::fclose(file);
+        return -1;
+    }
+    std::fclose(file);
+
+    Teakra::Teakra teakra(true);
+    teakra.SetAHBMCallback({
+        [](u32) -> u8 { return 0; }, [](u32, u8) {},
+        [](u32) -> u16 { return 0; }, [](u32, u16) {},
+        [](u32) -> u32 { return 0; }, [](u32, u32) {},
+    });
+    if (teakra.LoadDsp1(raw).status != Teakra::Dsp1LoadResult::Status::Ok) {
+        std::printf("%s is not a DSP1 firmware\n", argv[1]);
+        return -1;
+    }
+
+    for (u64 ran = 0; ran < cycles; ran += Slice) {
+        teakra.Run(Slice);
+    }
+
+    const auto jit = teakra.GetStats().jit;
+    const double instructions = static_cast<double>(std::max<u64>(jit.instructions_compiled, 1));
+    std::printf("blocks=%llu instructions=%llu host_bytes=%llu compile_ns=%llu\n",
+                (unsigned long long)jit.blocks_compiled,
+                (unsigned long long)jit.instructions_compiled,
+                (unsigned long long)jit.host_bytes, (unsigned long long)jit.compile_ns);
+    std::printf("ns_per_instruction=%.2f bytes_per_instruction=%.2f\n",
+                jit.compile_ns / instructions, jit.host_bytes / instructions);
+    return 0;
+}
@@ -13,6 +13,7 @@ public:
           timer{timer_}, btdmp{btdmp_} {}
 
     void Tick(u64 ticks = 1) {
+        total_ticks += ticks;
         timer[0].Tick(ticks);
         timer[1].Tick(ticks);
         btdmp[0].Tick(ticks);
@@ -25,6 +26,7 @@ public:
         timer[1].Skip(ticks);
         btdmp[0].Skip(ticks);
         btdmp[1].Skip(ticks);
+        total_ticks += ticks;
         return ticks;
     }
 
@@ -37,7 +39,13 @@ public:
         return ticks;
     }
 
+    /// Number of DSP cycles elapsed since construction, including skipped ones
+    u64 GetTicks() const {
+        return total_ticks;
+    }
+
 private:
+    u64 total_ticks = 0;
     std::array<Timer, 2>& timer;
     std::array<Btdmp, 2>& btdmp;
 };
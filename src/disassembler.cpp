@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <cstdio>
 #include <iomanip>
 #include <sstream>
 #include <type_traits>
@@ -10,6 +12,23 @@
 
 namespace Teakra::Disassembler {
 
+// Bytes below 0x10 in a format template are holes, filled in when formatting. The ar/arp holes
+// are followed by the register index and the address hole by the upper half of the address.
+enum Hole : char {
+    HoleArRn = 1,
+    HoleArStep,
+    HoleArpRni,
+    HoleArpStepi,
+    HoleArpRnj,
+    HoleArpStepj,
+    HoleImm16,
+    HoleAddress,
+};
+
+constexpr std::array<const char*, 8> StepNames{{"++0", "++1", "--1", "++s", "++2", "--2", "++2*",
+                                                "--2*"}};
+constexpr std::array<const char*, 4> OffsetNames{{"+0", "+1", "-1", "-1*"}};
+
 template <typename T>
 std::string ToHex(T i) {
     u64 v = i;
@@ -1637,9 +1656,21 @@ public:
         this->ar_arp = ar_arp;
     }
 
+    // Emits holes instead of the ar/arp dependent operands, for building format templates
+    void SetPlaceholders(bool placeholders) {
+        this->placeholders = placeholders;
+    }
+
 private:
+    std::string Placeholder(Hole hole, unsigned index) const {
+        return {static_cast<char>(hole), static_cast<char>(index)};
+    }
+
     template <typename ArRn>
     std::string DsmArRn(ArRn a) {
+        if (placeholders) {
+            return Placeholder(HoleArRn, a.Index());
+        }
         if (ar_arp) {
             return "%r" +
                    std::to_string((ar_arp->ar[a.Index() / 2] >> (13 - 3 * (a.Index() % 2))) & 7);
@@ -1648,29 +1679,14 @@ private:
     }
 
     std::string ConvertArStepAndOffset(u16 v) {
-        static const std::array<std::string, 8> step_names{{
-            "++0",
-            "++1",
-            "--1",
-            "++s",
-            "++2",
-            "--2",
-            "++2*",
-            "--2*",
-        }};
-
-        static const std::array<std::string, 4> offset_names{{
-            "+0",
-            "+1",
-            "-1",
-            "-1*",
-        }};
-
-        return offset_names[v >> 3] + step_names[v & 7];
+        return std::string(OffsetNames[v >> 3]) + StepNames[v & 7];
     }
 
     template <typename ArStep>
     std::string DsmArStep(ArStep a) {
+        if (placeholders) {
+            return Placeholder(HoleArStep, a.Index());
+        }
         if (ar_arp) {
             u16 s = (ar_arp->ar[a.Index() / 2] >> (5 - 5 * (a.Index() % 2))) & 31;
             return ConvertArStepAndOffset(s);
@@ -1680,6 +1696,9 @@ private:
 
     template <typename ArpRn>
     std::string DsmArpRni(ArpRn a) {
+        if (placeholders) {
+            return Placeholder(HoleArpRni, a.Index());
+        }
         if (ar_arp) {
             return "%r" + std::to_string((ar_arp->arp[a.Index()] >> 10) & 3);
         }
@@ -1688,6 +1707,9 @@ private:
 
     template <typename ArpStep>
     std::string DsmArpStepi(ArpStep a) {
+        if (placeholders) {
+            return Placeholder(HoleArpStepi, a.Index());
+        }
         if (ar_arp) {
             u16 s = ar_arp->arp[a.Index()] & 31;
             return ConvertArStepAndOffset(s);
@@ -1697,6 +1719,9 @@ private:
 
     template <typename ArpRn>
     std::string DsmArpRnj(ArpRn a) {
+        if (placeholders) {
+            return Placeholder(HoleArpRnj, a.Index());
+        }
         if (ar_arp) {
             return "%r" + std::to_string(((ar_arp->arp[a.Index()] >> 13) & 3) + 4);
         }
@@ -1705,6 +1730,9 @@ private:
 
     template <typename ArpStep>
     std::string DsmArpStepj(ArpStep a) {
+        if (placeholders) {
+            return Placeholder(HoleArpStepj, a.Index());
+        }
         if (ar_arp) {
             u16 s = (ar_arp->arp[a.Index()] >> 5) & 31;
             return ConvertArStepAndOffset(s);
@@ -1733,6 +1761,7 @@ private:
     }
 
     std::optional<ArArpSettings> ar_arp;
+    bool placeholders = false;
 };
 
 bool NeedExpansion(std::uint16_t opcode) {
@@ -1749,15 +1778,232 @@ std::vector<std::string> GetTokenList(std::uint16_t opcode, std::uint16_t expans
     return v;
 }
 
-std::string Do(std::uint16_t opcode, std::uint16_t expansion, std::optional<ArArpSettings> ar_arp) {
-    auto v = GetTokenList(opcode, expansion, ar_arp);
-    std::string last = v.back();
+namespace {
+
+std::string Join(const std::vector<std::string>& tokens) {
     std::string result;
-    v.pop_back();
-    for (const auto& s : v) {
-        result += s + "    ";
+    for (std::size_t i = 0; i < tokens.size(); ++i) {
+        result += i == 0 ? tokens[i] : "    " + tokens[i];
+    }
+    return result;
+}
+
+// Replaces the hex literal holding `sentinel` with an expansion hole
+bool MakeExpansionHole(std::string& text, u16 sentinel) {
+    char digits[5];
+    std::snprintf(digits, sizeof(digits), "%04x", sentinel);
+    const std::size_t end = text.find(digits);
+    if (end == std::string::npos || text.find(digits, end + 1) != std::string::npos) {
+        return false;
+    }
+    const std::size_t begin = text.rfind("0x", end);
+    if (begin == std::string::npos) {
+        return false;
+    }
+    const std::size_t high_digits = end - begin - 2;
+    std::string hole;
+    if (high_digits == 0) {
+        hole = {HoleImm16};
+    } else if (high_digits == 4) {
+        const u16 high = static_cast<u16>(std::stoul(text.substr(begin + 2, 4), nullptr, 16));
+        hole = {HoleAddress, static_cast<char>(high & 0xFF), static_cast<char>(high >> 8)};
+    } else {
+        return false;
+    }
+    text.replace(begin, end + 4 - begin, hole);
+    return true;
+}
+
+struct FormatTable {
+    // Templates of all opcodes back to back; opcode i spans [offsets[i], offsets[i + 1])
+    std::vector<char> text;
+    std::vector<u32> offsets;
+    std::vector<bool> expanded;
+
+    FormatTable() : offsets(0x10001), expanded(0x10000) {
+        // The expansion word only ever shows up as one hex literal. It is located by
+        // disassembling with a sentinel, and checked against a second one.
+        constexpr u16 Sentinel = 0xA5C3;
+        constexpr u16 CheckSentinel = 0x5A3C;
+        const auto decoders = GetDecoderTable<Disassembler>();
+        Disassembler dsm;
+        dsm.SetPlaceholders(true);
+        for (u32 opcode = 0; opcode < 0x10000; ++opcode) {
+            const auto& decoder = decoders[opcode];
+            offsets[opcode] = static_cast<u32>(text.size());
+            expanded[opcode] = decoder.NeedExpansion();
+            std::string format = Join(decoder.call(dsm, opcode, Sentinel));
+            if (expanded[opcode]) {
+                std::string check = Join(decoder.call(dsm, opcode, CheckSentinel));
+                const bool ok = MakeExpansionHole(format, Sentinel) &&
+                                MakeExpansionHole(check, CheckSentinel) && format == check;
+                ASSERT(ok);
+            }
+            text.insert(text.end(), format.begin(), format.end());
+        }
+        offsets[0x10000] = static_cast<u32>(text.size());
+    }
+};
+
+const FormatTable& GetFormatTable() {
+    static const FormatTable table;
+    return table;
+}
+
+class Writer {
+public:
+    Writer(char* out, std::size_t size) : out(out), size(size) {}
+
+    void Put(char c) {
+        if (length + 1 < size) {
+            out[length] = c;
+        }
+        ++length;
+    }
+
+    void Put(const char* s) {
+        while (*s) {
+            Put(*s++);
+        }
+    }
+
+    void PutHex(u32 value, int digits, const char* charset = "0123456789abcdef") {
+        for (int i = digits - 1; i >= 0; --i) {
+            Put(charset[(value >> (i * 4)) & 0xF]);
+        }
+    }
+
+    std::size_t Length() const {
+        return length;
+    }
+
+    std::size_t Finish() {
+        if (size != 0) {
+            out[std::min(length, size - 1)] = '\0';
+        }
+        return length;
+    }
+
+private:
+    char* out;
+    std::size_t size;
+    std::size_t length = 0;
+};
+
+void Format(Writer& w, u16 opcode, u16 expansion, const ArArpSettings* ar_arp) {
+    const auto& table = GetFormatTable();
+    const char* text = table.text.data();
+    for (u32 i = table.offsets[opcode]; i < table.offsets[opcode + 1]; ++i) {
+        const char c = text[i];
+        // Mirrors the ar/arp operand helpers of the Disassembler class
+        switch (c) {
+        case HoleArRn:
+        case HoleArpRni:
+        case HoleArpRnj: {
+            const unsigned index = text[++i];
+            if (!ar_arp) {
+                w.Put(c == HoleArRn ? "arrn" : c == HoleArpRni ? "arprni" : "arprnj");
+                w.Put(static_cast<char>('0' + index));
+                break;
+            }
+            unsigned reg;
+            if (c == HoleArRn) {
+                reg = (ar_arp->ar[index / 2] >> (13 - 3 * (index % 2))) & 7;
+            } else if (c == HoleArpRni) {
+                reg = (ar_arp->arp[index] >> 10) & 3;
+            } else {
+                reg = ((ar_arp->arp[index] >> 13) & 3) + 4;
+            }
+            w.Put("%r");
+            w.Put(static_cast<char>('0' + reg));
+            break;
+        }
+        case HoleArStep:
+        case HoleArpStepi:
+        case HoleArpStepj: {
+            const unsigned index = text[++i];
+            if (!ar_arp) {
+                w.Put(c == HoleArStep ? "+ars" : c == HoleArpStepi ? "+arpsi" : "+arpsj");
+                w.Put(static_cast<char>('0' + index));
+                break;
+            }
+            u16 step;
+            if (c == HoleArStep) {
+                step = (ar_arp->ar[index / 2] >> (5 - 5 * (index % 2))) & 31;
+            } else if (c == HoleArpStepi) {
+                step = ar_arp->arp[index] & 31;
+            } else {
+                step = (ar_arp->arp[index] >> 5) & 31;
+            }
+            w.Put(OffsetNames[step >> 3]);
+            w.Put(StepNames[step & 7]);
+            break;
+        }
+        case HoleImm16:
+            w.Put("0x");
+            w.PutHex(expansion, 4);
+            break;
+        case HoleAddress: {
+            const u32 high = static_cast<u8>(text[i + 1]) | (static_cast<u8>(text[i + 2]) << 8);
+            i += 2;
+            w.Put("0x");
+            w.PutHex((high << 16) | expansion, 8);
+            break;
+        }
+        default:
+            w.Put(c);
+            break;
+        }
+    }
+}
+
+} // Anonymous namespace
+
+std::string Do(std::uint16_t opcode, std::uint16_t expansion, std::optional<ArArpSettings> ar_arp) {
+    const ArArpSettings* settings = ar_arp ? &*ar_arp : nullptr;
+    char buffer[128];
+    const std::size_t length = Do(buffer, sizeof(buffer), opcode, expansion, settings);
+    if (length < sizeof(buffer)) {
+        return std::string(buffer, length);
+    }
+    std::string result(length, '\0');
+    Do(result.data(), length + 1, opcode, expansion, settings);
+    return result;
+}
+
+std::size_t Do(char* out, std::size_t size, std::uint16_t opcode, std::uint16_t expansion,
+               const ArArpSettings* ar_arp) {
+    Writer w(out, size);
+    Format(w, opcode, expansion, ar_arp);
+    return w.Finish();
+}
+
+std::size_t DoRange(char* out, std::size_t size, std::size_t& written, const std::uint16_t* words,
+                    std::size_t count, std::uint32_t address, const ArArpSettings* ar_arp) {
+    const auto& table = GetFormatTable();
+    written = 0;
+    std::size_t pos = 0;
+    while (pos < count) {
+        const u16 opcode = words[pos];
+        const bool expanded = table.expanded[opcode];
+        if (expanded && pos + 1 == count) {
+            break;
+        }
+        Writer w(out + written, size - written);
+        w.PutHex(address + static_cast<u32>(pos), 5, "0123456789ABCDEF");
+        w.Put(": ");
+        Format(w, opcode, expanded ? words[pos + 1] : 0, ar_arp);
+        w.Put('\n');
+        if (w.Length() >= size - written) {
+            break;
+        }
+        written += w.Length();
+        pos += expanded ? 2 : 1;
+    }
+    if (size != 0) {
+        out[written] = '\0';
     }
-    return result + last;
+    return pos;
 }
 
 } // namespace Teakra::Disassembler
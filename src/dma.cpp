@@ -13,13 +13,22 @@ void Dma::Reset() {
 }
 
 void Dma::DoDma(u16 channel) {
-    channels[channel].Start();
+    Channel& ch = channels[channel];
+    ch.Start();
 
-    channels[channel].ahbm_channel = ahbm.GetChannelForDma(channel);
+    ch.ahbm_channel = ahbm.GetChannelForDma(channel);
 
     // TODO: actually Tick this according to global Tick;
-    while (channels[channel].running)
-        channels[channel].Tick(*this);
+    u64 cycles = 0, words = 0;
+    while (ch.running) {
+        words += ch.Tick(*this);
+        ++cycles;
+    }
+
+    ++stats.transfers[channel];
+    stats.words_from_space[ch.src_space & 7] += words;
+    stats.words_to_space[ch.dst_space & 7] += words;
+    stats.transfer_cycles[channel] += cycles;
 
     interrupt_handler();
 }
@@ -33,8 +42,9 @@ void Dma::Channel::Start() {
     counter2 = 0;
 }
 
-void Dma::Channel::Tick(Dma& parent) {
+u32 Dma::Channel::Tick(Dma& parent) {
     static constexpr u32 DataMemoryOffset = 0x20000;
+    u32 words = 1;
     if (dword_mode) {
         u32 value = 0;
         switch (src_space) {
@@ -76,6 +86,7 @@ void Dma::Channel::Tick(Dma& parent) {
         }
 
         counter0 += 2;
+        words = 2;
     } else {
         u16 value = 0;
         switch (src_space) {
@@ -119,7 +130,7 @@ void Dma::Channel::Tick(Dma& parent) {
             counter2 += 1;
             if (counter2 >= size2) {
                 running = 0;
-                return;
+                return words;
             } else {
                 current_src += src_step2;
                 current_dst += dst_step2;
@@ -132,6 +143,7 @@ void Dma::Channel::Tick(Dma& parent) {
         current_src += src_step0;
         current_dst += dst_step0;
     }
+    return words;
 }
 
 } // namespace Teakra
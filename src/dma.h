@@ -3,6 +3,7 @@
 #include <functional>
 #include <utility>
 #include "common_types.h"
+#include "teakra/stats.h"
 
 namespace Teakra {
 
@@ -165,7 +166,13 @@ public:
         interrupt_handler = std::move(handler);
     }
 
+    const DmaStats& GetStats() const {
+        return stats;
+    }
+
 private:
+    DmaStats stats;
+
     std::function<void()> interrupt_handler;
 
     u16 enable_channel = 0;
@@ -189,7 +196,8 @@ private:
         u16 ahbm_channel = 0;
 
         void Start();
-        void Tick(Dma& parent);
+        // returns the number of 16-bit words moved
+        u32 Tick(Dma& parent);
     };
 
     std::array<Channel, 8> channels;
@@ -0,0 +1,164 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "dsp1.h"
+#include "hash.h"
+#include "memory_interface.h"
+#include "sha256.h"
+#include "shared_memory.h"
+#include "swap.h"
+
+namespace Teakra {
+
+namespace {
+
+constexpr std::size_t DspMemoryBytes = 0x80000;
+constexpr std::size_t DataMemoryBytesOffset = MemoryInterfaceUnit::DataMemoryOffset * 2;
+
+enum class SegmentType : u8 {
+    ProgramA = 0,
+    ProgramB = 1,
+    Data = 2,
+};
+
+// Fields are little-endian in the image, whatever the host
+struct Header {
+    std::array<u8, 0x100> signature;
+    std::array<u8, 0x4> magic;
+    u32_le binary_size;
+    u16_le memory_layout;
+    u8 pad[3];
+    SegmentType special_segment_type;
+    u8 num_segments;
+    u8 flags; // bit 0: recv_data_on_start, bit 1: load_special_segment
+    u32_le special_segment_address;
+    u32_le special_segment_size;
+    u64_le zero;
+    struct Segment {
+        u32_le offset;
+        u32_le address;
+        u32_le size;
+        u8 pad[3];
+        SegmentType memory_type;
+        std::array<u8, 0x20> sha256;
+    };
+    std::array<Segment, 10> segments;
+};
+static_assert(sizeof(Header) == 0x300);
+
+// Byte offset of a segment in DSP memory, or DspMemoryBytes if it doesn't fit its memory
+std::size_t SegmentDestination(const Dsp1Segment& segment) {
+    const bool program = segment.memory == Dsp1Segment::Memory::Program;
+    const std::size_t begin = program ? 0 : DataMemoryBytesOffset;
+    const std::size_t end = program ? DataMemoryBytesOffset : DspMemoryBytes;
+    const std::size_t destination = begin + std::size_t{segment.address} * 2;
+    if (destination > end || segment.data.size() > end - destination) {
+        return DspMemoryBytes;
+    }
+    return destination;
+}
+
+} // Anonymous namespace
+
+Dsp1LoadResult::Status ParseDsp1(std::span<const u8> image, Dsp1Image& out) {
+    if (image.size() < sizeof(Header)) {
+        return Dsp1LoadResult::Status::Malformed;
+    }
+    // Only the header is copied out, for alignment; segments are read from the image itself
+    Header header;
+    std::memcpy(&header, image.data(), sizeof(header));
+    if (std::memcmp(header.magic.data(), "DSP1", 4) != 0 ||
+        header.num_segments > header.segments.size()) {
+        return Dsp1LoadResult::Status::Malformed;
+    }
+
+    Dsp1Image parsed;
+    parsed.num_segments = header.num_segments;
+    parsed.recv_data_on_start = (header.flags & 1) != 0;
+    for (std::size_t i = 0; i < parsed.num_segments; ++i) {
+        const auto& entry = header.segments[i];
+        const u32 offset = entry.offset;
+        const u32 size = entry.size;
+        if (offset > image.size() || size > image.size() - offset) {
+            return Dsp1LoadResult::Status::Malformed;
+        }
+        auto& segment = parsed.segment_table[i];
+        switch (entry.memory_type) {
+        case SegmentType::ProgramA:
+        case SegmentType::ProgramB:
+            segment.memory = Dsp1Segment::Memory::Program;
+            break;
+        case SegmentType::Data:
+            segment.memory = Dsp1Segment::Memory::Data;
+            break;
+        default:
+            return Dsp1LoadResult::Status::OutOfRange;
+        }
+        segment.address = entry.address;
+        segment.data = image.subspan(offset, size);
+        segment.sha256 = entry.sha256;
+        if (SegmentDestination(segment) == DspMemoryBytes) {
+            return Dsp1LoadResult::Status::OutOfRange;
+        }
+    }
+    out = parsed;
+    return Dsp1LoadResult::Status::Ok;
+}
+
+Dsp1LoadResult LoadDsp1(SharedMemory& shared_memory, std::span<const u8> image,
+                        bool verify_hashes, unsigned threads) {
+    Dsp1LoadResult result;
+    Dsp1Image parsed;
+    result.status = ParseDsp1(image, parsed);
+    if (result.status != Dsp1LoadResult::Status::Ok) {
+        return result;
+    }
+    const auto segments = parsed.Segments();
+
+    if (verify_hashes) {
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        std::atomic<std::size_t> next_index{0};
+        std::atomic<bool> mismatch{false};
+        auto worker = [&] {
+            for (std::size_t i = next_index++; i < segments.size(); i = next_index++) {
+                std::array<u8, SHA256_BLOCK_SIZE> digest;
+                SHA256_CTX ctx;
+                sha256_init(&ctx);
+                sha256_update(&ctx, segments[i].data.data(), segments[i].data.size());
+                sha256_final(&ctx, digest.data());
+                if (digest != segments[i].sha256) {
+                    mismatch = true;
+                }
+            }
+        };
+        std::vector<std::thread> pool;
+        for (std::size_t i = 1; i < std::min<std::size_t>(threads, segments.size()); ++i) {
+            pool.emplace_back(worker);
+        }
+        worker();
+        for (auto& thread : pool) {
+            thread.join();
+        }
+        if (mismatch) {
+            result.status = Dsp1LoadResult::Status::HashMismatch;
+            return result;
+        }
+    }
+
+    for (const auto& segment : segments) {
+        std::memcpy(shared_memory.raw + SegmentDestination(segment), segment.data.data(),
+                    segment.data.size());
+    }
+
+    result.status = Dsp1LoadResult::Status::Ok;
+    result.hash = Common::ComputeHash64(image.data(), image.size());
+    result.recv_data_on_start = parsed.recv_data_on_start;
+    return result;
+}
+
+} // namespace Teakra
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <array>
+#include <span>
+#include "common_types.h"
+#include "teakra/teakra.h"
+
+namespace Teakra {
+
+struct SharedMemory;
+
+/// One segment of a DSP1 image, viewing the image it was parsed from
+struct Dsp1Segment {
+    enum class Memory : u8 {
+        Program,
+        Data,
+    };
+    Memory memory;
+    u32 address; // word address in its memory
+    std::span<const u8> data;
+    std::array<u8, 0x20> sha256;
+};
+
+/// The header of a DSP1 image
+struct Dsp1Image {
+    std::array<Dsp1Segment, 10> segment_table;
+    std::size_t num_segments = 0;
+    bool recv_data_on_start = false;
+
+    std::span<const Dsp1Segment> Segments() const {
+        return std::span(segment_table).first(num_segments);
+    }
+};
+
+/// Checks the header of a DSP1 image and that every segment lies within the image and fits the
+/// memory it targets. Segments are not hashed.
+Dsp1LoadResult::Status ParseDsp1(std::span<const u8> image, Dsp1Image& out);
+
+/// Checks a DSP1 image and copies its segments into DSP memory, see Teakra::LoadDsp1
+Dsp1LoadResult LoadDsp1(SharedMemory& shared_memory, std::span<const u8> image,
+                        bool verify_hashes, unsigned threads);
+
+} // namespace Teakra
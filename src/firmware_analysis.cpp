@@ -0,0 +1,640 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <thread>
+#include <unordered_set>
+#include "decoder.h"
+#include "firmware_analysis.h"
+#include "operand.h"
+
+namespace Teakra {
+
+namespace {
+
+constexpr u32 ProgramMask = 0x3FFFF;
+
+// Only control flow instructions are looked at, all others fall through
+class FlowDecoder {
+public:
+    using instruction_return_type = InstructionFlow;
+
+    explicit FlowDecoder(u32 next) : next(next) {}
+
+    InstructionFlow undefined(u16 opcode) {
+        return {InstructionFlow::Stop};
+    }
+
+    InstructionFlow trap() {
+        return {InstructionFlow::IndirectCall};
+    }
+
+    InstructionFlow br(Address18_16 addr_low, Address18_2 addr_high, Cond cond) {
+        return Flow(InstructionFlow::Branch, cond, Address32(addr_low, addr_high));
+    }
+    InstructionFlow brr(RelAddr7 addr, Cond cond) {
+        return Flow(InstructionFlow::Branch, cond, next + addr.Relative32());
+    }
+
+    InstructionFlow call(Address18_16 addr_low, Address18_2 addr_high, Cond cond) {
+        return Flow(InstructionFlow::Call, cond, Address32(addr_low, addr_high));
+    }
+    InstructionFlow callr(RelAddr7 addr, Cond cond) {
+        return Flow(InstructionFlow::Call, cond, next + addr.Relative32());
+    }
+    InstructionFlow calla(Axl a) {
+        return {InstructionFlow::IndirectCall};
+    }
+    InstructionFlow calla(Ax a) {
+        return {InstructionFlow::IndirectCall};
+    }
+    InstructionFlow mov_pc(Ax a) {
+        return {InstructionFlow::IndirectBranch};
+    }
+    InstructionFlow mov_pc(Bx a) {
+        return {InstructionFlow::IndirectBranch};
+    }
+
+    InstructionFlow ret(Cond c) {
+        return Flow(InstructionFlow::Return, c, 0);
+    }
+    InstructionFlow retd() {
+        return {InstructionFlow::Return};
+    }
+    InstructionFlow rets(Imm8 a) {
+        return {InstructionFlow::Return};
+    }
+    InstructionFlow reti(Cond c) {
+        return Flow(InstructionFlow::InterruptReturn, c, 0);
+    }
+    InstructionFlow retic(Cond c) {
+        return Flow(InstructionFlow::InterruptReturn, c, 0);
+    }
+    InstructionFlow retid() {
+        return {InstructionFlow::InterruptReturn};
+    }
+    InstructionFlow retidc() {
+        return {InstructionFlow::InterruptReturn};
+    }
+
+    InstructionFlow rep(Imm8 a) {
+        return {InstructionFlow::Repeat};
+    }
+    InstructionFlow rep(Register a) {
+        return {InstructionFlow::Repeat};
+    }
+    InstructionFlow rep_r6() {
+        return {InstructionFlow::Repeat};
+    }
+
+    InstructionFlow bkrep(Imm8 a, Address16 addr) {
+        return BlockRepeat(addr.Address32() | (next & 0x30000));
+    }
+    InstructionFlow bkrep(Register a, Address18_16 addr_low, Address18_2 addr_high) {
+        return BlockRepeat(Address32(addr_low, addr_high));
+    }
+    InstructionFlow bkrep_r6(Address18_16 addr_low, Address18_2 addr_high) {
+        return BlockRepeat(Address32(addr_low, addr_high));
+    }
+
+#define FALLTHROUGH(name)                                                                          \
+    template <typename... Operands>                                                                \
+    InstructionFlow name(Operands...) {                                                            \
+        return {};                                                                                 \
+    }
+
+    // clang-format off
+    FALLTHROUGH(nop) FALLTHROUGH(norm) FALLTHROUGH(swap) FALLTHROUGH(alm) FALLTHROUGH(alm_r6)
+    FALLTHROUGH(alu) FALLTHROUGH(or_) FALLTHROUGH(alb) FALLTHROUGH(alb_r6) FALLTHROUGH(add)
+    FALLTHROUGH(add_p1) FALLTHROUGH(sub) FALLTHROUGH(sub_p1) FALLTHROUGH(app) FALLTHROUGH(add_add)
+    FALLTHROUGH(add_sub) FALLTHROUGH(sub_add) FALLTHROUGH(sub_sub) FALLTHROUGH(add_sub_sv)
+    FALLTHROUGH(sub_add_sv) FALLTHROUGH(sub_add_i_mov_j_sv) FALLTHROUGH(sub_add_j_mov_i_sv)
+    FALLTHROUGH(add_sub_i_mov_j) FALLTHROUGH(add_sub_j_mov_i) FALLTHROUGH(mul) FALLTHROUGH(mul_y0)
+    FALLTHROUGH(mul_y0_r6) FALLTHROUGH(mpyi) FALLTHROUGH(msu) FALLTHROUGH(msusu)
+    FALLTHROUGH(mac_x1to0) FALLTHROUGH(mac1) FALLTHROUGH(moda4) FALLTHROUGH(moda3)
+    FALLTHROUGH(pacr1) FALLTHROUGH(clr) FALLTHROUGH(clrr) FALLTHROUGH(bkreprst)
+    FALLTHROUGH(bkreprst_memsp) FALLTHROUGH(bkrepsto) FALLTHROUGH(bkrepsto_memsp) FALLTHROUGH(banke)
+    FALLTHROUGH(bankr) FALLTHROUGH(bitrev) FALLTHROUGH(bitrev_dbrv) FALLTHROUGH(bitrev_ebrv)
+    FALLTHROUGH(break_) FALLTHROUGH(cntx_s) FALLTHROUGH(cntx_r) FALLTHROUGH(load_ps)
+    FALLTHROUGH(load_stepi) FALLTHROUGH(load_stepj) FALLTHROUGH(load_page) FALLTHROUGH(load_modi)
+    FALLTHROUGH(load_modj) FALLTHROUGH(load_movpd) FALLTHROUGH(load_ps01) FALLTHROUGH(push)
+    FALLTHROUGH(push_prpage) FALLTHROUGH(push_r6) FALLTHROUGH(push_repc) FALLTHROUGH(push_x0)
+    FALLTHROUGH(push_x1) FALLTHROUGH(push_y1) FALLTHROUGH(pusha) FALLTHROUGH(pop)
+    FALLTHROUGH(pop_prpage) FALLTHROUGH(pop_r6) FALLTHROUGH(pop_repc) FALLTHROUGH(pop_x0)
+    FALLTHROUGH(pop_x1) FALLTHROUGH(pop_y1) FALLTHROUGH(popa) FALLTHROUGH(shfc) FALLTHROUGH(shfi)
+    FALLTHROUGH(tst4b) FALLTHROUGH(tstb) FALLTHROUGH(tstb_r6) FALLTHROUGH(and_) FALLTHROUGH(dint)
+    FALLTHROUGH(eint) FALLTHROUGH(exp) FALLTHROUGH(exp_r6) FALLTHROUGH(modr) FALLTHROUGH(modr_dmod)
+    FALLTHROUGH(modr_i2) FALLTHROUGH(modr_i2_dmod) FALLTHROUGH(modr_d2) FALLTHROUGH(modr_d2_dmod)
+    FALLTHROUGH(modr_eemod) FALLTHROUGH(modr_edmod) FALLTHROUGH(modr_demod)
+    FALLTHROUGH(modr_ddmod) FALLTHROUGH(mov) FALLTHROUGH(mov_dvm) FALLTHROUGH(mov_x0)
+    FALLTHROUGH(mov_x1) FALLTHROUGH(mov_y1) FALLTHROUGH(mov_eu) FALLTHROUGH(mov_sv)
+    FALLTHROUGH(mov_dvm_to) FALLTHROUGH(mov_icr_to) FALLTHROUGH(mov_icr) FALLTHROUGH(mov_ext0)
+    FALLTHROUGH(mov_ext1) FALLTHROUGH(mov_ext2) FALLTHROUGH(mov_ext3) FALLTHROUGH(mov_memsp_to)
+    FALLTHROUGH(mov_mixp_to) FALLTHROUGH(mov_mixp) FALLTHROUGH(mov_repc_to) FALLTHROUGH(mov_sv_to)
+    FALLTHROUGH(mov_x0_to) FALLTHROUGH(mov_x1_to) FALLTHROUGH(mov_y1_to) FALLTHROUGH(mov_r6)
+    FALLTHROUGH(mov_repc) FALLTHROUGH(mov_stepi0) FALLTHROUGH(mov_stepj0) FALLTHROUGH(mov_prpage)
+    FALLTHROUGH(movd) FALLTHROUGH(movp) FALLTHROUGH(movpdw) FALLTHROUGH(mov_a0h_stepi0)
+    FALLTHROUGH(mov_a0h_stepj0) FALLTHROUGH(mov_stepi0_a0h) FALLTHROUGH(mov_stepj0_a0h)
+    FALLTHROUGH(mov_prpage_to) FALLTHROUGH(mov_mixp_r6) FALLTHROUGH(mov_p0h_to)
+    FALLTHROUGH(mov_p0h_r6) FALLTHROUGH(mov_p0) FALLTHROUGH(mov_p1_to) FALLTHROUGH(mov2)
+    FALLTHROUGH(mov2s) FALLTHROUGH(mova) FALLTHROUGH(mov_r6_to) FALLTHROUGH(mov_r6_mixp)
+    FALLTHROUGH(mov_memsp_r6) FALLTHROUGH(movs) FALLTHROUGH(movs_r6_to) FALLTHROUGH(movsi)
+    FALLTHROUGH(mov2_axh_m_y0_m) FALLTHROUGH(mov2_ax_mij) FALLTHROUGH(mov2_ax_mji)
+    FALLTHROUGH(mov2_mij_ax) FALLTHROUGH(mov2_mji_ax) FALLTHROUGH(mov2_abh_m)
+    FALLTHROUGH(exchange_iaj) FALLTHROUGH(exchange_riaj) FALLTHROUGH(exchange_jai)
+    FALLTHROUGH(exchange_rjai) FALLTHROUGH(movr) FALLTHROUGH(movr_r6_to) FALLTHROUGH(lim)
+    FALLTHROUGH(vtrclr0) FALLTHROUGH(vtrclr1) FALLTHROUGH(vtrclr) FALLTHROUGH(vtrmov0)
+    FALLTHROUGH(vtrmov1) FALLTHROUGH(vtrmov) FALLTHROUGH(vtrshr) FALLTHROUGH(clrp0)
+    FALLTHROUGH(clrp1) FALLTHROUGH(clrp) FALLTHROUGH(max_ge) FALLTHROUGH(max_gt)
+    FALLTHROUGH(min_le) FALLTHROUGH(min_lt) FALLTHROUGH(max_ge_r0) FALLTHROUGH(max_gt_r0)
+    FALLTHROUGH(min_le_r0) FALLTHROUGH(min_lt_r0) FALLTHROUGH(divs) FALLTHROUGH(sqr_sqr_add3)
+    FALLTHROUGH(sqr_mpysu_add3a) FALLTHROUGH(cmp) FALLTHROUGH(cmp_b0_b1) FALLTHROUGH(cmp_b1_b0)
+    FALLTHROUGH(cmp_p1_to) FALLTHROUGH(max2_vtr) FALLTHROUGH(min2_vtr) FALLTHROUGH(max2_vtr_movl)
+    FALLTHROUGH(max2_vtr_movh) FALLTHROUGH(min2_vtr_movl) FALLTHROUGH(min2_vtr_movh)
+    FALLTHROUGH(max2_vtr_movij) FALLTHROUGH(max2_vtr_movji) FALLTHROUGH(min2_vtr_movij)
+    FALLTHROUGH(min2_vtr_movji) FALLTHROUGH(mov_sv_app) FALLTHROUGH(cbs) FALLTHROUGH(mma)
+    FALLTHROUGH(mma_mx_xy) FALLTHROUGH(mma_xy_mx) FALLTHROUGH(mma_my_my) FALLTHROUGH(mma_mov)
+    FALLTHROUGH(addhp)
+    // clang-format on
+
+#undef FALLTHROUGH
+
+private:
+    static InstructionFlow Flow(InstructionFlow::Kind kind, Cond cond, u32 target) {
+        InstructionFlow flow;
+        flow.kind = kind;
+        flow.conditional = cond.GetName() != CondValue::True;
+        flow.target = target & ProgramMask;
+        return flow;
+    }
+
+    static InstructionFlow BlockRepeat(u32 end) {
+        InstructionFlow flow;
+        flow.kind = InstructionFlow::BlockRepeat;
+        flow.target = end & ProgramMask;
+        return flow;
+    }
+
+    u32 next; // address of the next instruction, which relative addresses are based on
+};
+
+template <typename F>
+void ParallelFor(std::size_t count, unsigned threads, F&& f) {
+    std::atomic<std::size_t> next_index{0};
+    auto worker = [&] {
+        for (std::size_t i = next_index++; i < count; i = next_index++) {
+            f(i);
+        }
+    };
+    std::vector<std::thread> pool;
+    for (std::size_t i = 1; i < std::min<std::size_t>(threads, count); ++i) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : pool) {
+        thread.join();
+    }
+}
+
+enum Mark : u8 {
+    Reached = 1, // an instruction starts here
+    Leader = 2,  // a block starts here
+};
+
+struct SegmentState {
+    u32 address;
+    u32 size;
+    std::vector<InstructionFlow> flows; // decoded at every word
+    std::vector<u8> marks;
+
+    std::vector<u32> pending;  // entries and targets to traverse from in the next round
+    std::vector<u32> outgoing; // targets outside of this segment found in this round
+
+    std::vector<FirmwareMap::Block> blocks;
+    std::vector<FirmwareMap::Loop> loops;
+    std::vector<u32> idle_loops;
+    std::vector<FirmwareMap::Indirect> indirect;
+    std::vector<std::pair<u32, u32>> calls; // call site, target
+
+    bool Contains(u32 address) const {
+        return address - this->address < size;
+    }
+};
+
+void Decode(SegmentState& state, const ProgramSegment& segment) {
+    state.flows.resize(state.size);
+    for (u32 i = 0; i < state.size; ++i) {
+        const u16 opcode = segment.words[i];
+        const u16 expansion = i + 1 < state.size ? segment.words[i + 1] : 0;
+        InstructionFlow& flow = state.flows[i] =
+            GetInstructionFlow(state.address + i, opcode, expansion);
+        if (i + flow.length > state.size) {
+            flow = {InstructionFlow::Stop};
+        }
+    }
+}
+
+void Traverse(SegmentState& state) {
+    std::vector<u32> stack;
+    const auto target = [&](u32 address) {
+        if (state.Contains(address)) {
+            state.marks[address - state.address] |= Leader;
+            stack.push_back(address);
+        } else {
+            state.outgoing.push_back(address);
+        }
+    };
+    const auto leader = [&](u32 address) {
+        if (state.Contains(address)) {
+            state.marks[address - state.address] |= Leader;
+        }
+    };
+
+    for (u32 address : state.pending) {
+        target(address);
+    }
+    state.pending.clear();
+
+    while (!stack.empty()) {
+        u32 address = stack.back();
+        stack.pop_back();
+        while (true) {
+            if (!state.Contains(address)) {
+                // Falling through into another segment
+                target(address);
+                break;
+            }
+            const u32 offset = address - state.address;
+            if (state.marks[offset] & Reached) {
+                break;
+            }
+            state.marks[offset] |= Reached;
+
+            const InstructionFlow& flow = state.flows[offset];
+            const u32 next = (address + flow.length) & ProgramMask;
+            bool falls_through = true;
+            switch (flow.kind) {
+            case InstructionFlow::Next:
+                break;
+            case InstructionFlow::Branch:
+                if (flow.target == address) {
+                    state.idle_loops.push_back(address);
+                }
+                target(flow.target);
+                falls_through = flow.conditional;
+                break;
+            case InstructionFlow::Call:
+                state.calls.emplace_back(address, flow.target);
+                target(flow.target);
+                break;
+            case InstructionFlow::IndirectBranch:
+            case InstructionFlow::IndirectCall:
+                state.indirect.push_back({address, flow.kind == InstructionFlow::IndirectCall});
+                falls_through = flow.kind == InstructionFlow::IndirectCall;
+                break;
+            case InstructionFlow::Return:
+            case InstructionFlow::InterruptReturn:
+                falls_through = flow.conditional;
+                break;
+            case InstructionFlow::Repeat:
+                // The repeated instruction gets a block of its own
+                if (state.Contains(next)) {
+                    const u32 body_end = next + state.flows[next - state.address].length - 1;
+                    state.loops.push_back({address, next, body_end & ProgramMask, false});
+                    leader(body_end + 1);
+                }
+                break;
+            case InstructionFlow::BlockRepeat:
+                state.loops.push_back({address, next, flow.target, true});
+                // The loop exit is only reached through the last iteration
+                target((flow.target + 1) & ProgramMask);
+                break;
+            case InstructionFlow::Stop:
+                falls_through = false;
+                break;
+            }
+            if (!falls_through) {
+                break;
+            }
+            if (flow.kind != InstructionFlow::Next) {
+                leader(next);
+            }
+            address = next;
+        }
+    }
+}
+
+void BuildBlocks(SegmentState& state) {
+    u32 offset = 0;
+    while (offset < state.size) {
+        if (!(state.marks[offset] & Reached)) {
+            ++offset;
+            continue;
+        }
+        FirmwareMap::Block block{state.address + offset, 0, 0, {}};
+        while (true) {
+            const InstructionFlow& flow = state.flows[offset];
+            ++block.instructions;
+            const u32 next_offset = offset + flow.length;
+            const u32 next = (state.address + next_offset) & ProgramMask;
+            bool falls_through = true;
+            switch (flow.kind) {
+            case InstructionFlow::Branch:
+                block.successors.push_back(flow.target);
+                falls_through = flow.conditional;
+                break;
+            case InstructionFlow::IndirectBranch:
+            case InstructionFlow::Stop:
+                falls_through = false;
+                break;
+            case InstructionFlow::Return:
+            case InstructionFlow::InterruptReturn:
+                falls_through = flow.conditional;
+                break;
+            default:
+                break;
+            }
+            offset = next_offset;
+            if (flow.kind == InstructionFlow::Next && offset < state.size &&
+                (state.marks[offset] & (Reached | Leader)) == Reached) {
+                continue;
+            }
+            if (falls_through) {
+                block.successors.push_back(next);
+            }
+            block.end = state.address + next_offset;
+            break;
+        }
+        state.blocks.push_back(std::move(block));
+    }
+}
+
+void AppendEscaped(std::string& out, const std::string& text) {
+    out += '"';
+    for (const char c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if ((unsigned char)c < 0x20) {
+            char escape[8];
+            std::snprintf(escape, sizeof(escape), "\\u%04x", (unsigned char)c);
+            out += escape;
+        } else {
+            out += c;
+        }
+    }
+    out += '"';
+}
+
+void AppendList(std::string& out, const std::vector<u32>& values) {
+    out += '[';
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        out += (i == 0 ? "" : ",") + std::to_string(values[i]);
+    }
+    out += ']';
+}
+
+} // Anonymous namespace
+
+InstructionFlow GetInstructionFlow(u32 address, u16 opcode, u16 expansion) {
+    static const auto table = GetDecoderTable<FlowDecoder>();
+    const auto& matcher = table[opcode];
+    const u8 length = matcher.NeedExpansion() ? 2 : 1;
+    FlowDecoder decoder((address + length) & ProgramMask);
+    InstructionFlow flow = matcher.call(decoder, opcode, expansion);
+    flow.length = length;
+    return flow;
+}
+
+std::vector<FirmwareMap::Entry> DefaultFirmwareEntries() {
+    return {{0x0000, "reset"}, {0x0006, "int0"}, {0x000E, "int1"}, {0x0016, "int2"}};
+}
+
+FirmwareMap AnalyzeFirmware(const std::vector<ProgramSegment>& segments,
+                            const std::vector<FirmwareMap::Entry>& entries, unsigned threads) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    std::vector<const ProgramSegment*> sorted;
+    for (const auto& segment : segments) {
+        if (!segment.words.empty()) {
+            sorted.push_back(&segment);
+        }
+    }
+    std::stable_sort(sorted.begin(), sorted.end(),
+                     [](const auto* a, const auto* b) { return a->address < b->address; });
+
+    std::vector<SegmentState> states(sorted.size());
+    ParallelFor(sorted.size(), threads, [&](std::size_t i) {
+        SegmentState& state = states[i];
+        state.address = sorted[i]->address;
+        state.size = (u32)std::min<std::size_t>(sorted[i]->words.size(), ProgramMask + 1);
+        state.marks.resize(state.size);
+        Decode(state, *sorted[i]);
+    });
+
+    FirmwareMap map;
+    for (const auto& state : states) {
+        map.segments.push_back({state.address, state.size});
+    }
+
+    // Where segments overlap, the one with the lower address owns the words
+    const auto route = [&](u32 address) {
+        for (auto& state : states) {
+            if (state.Contains(address)) {
+                state.pending.push_back(address);
+                return;
+            }
+        }
+        map.external.push_back(address);
+    };
+
+    map.entries = entries;
+    std::sort(map.entries.begin(), map.entries.end(),
+              [](const auto& a, const auto& b) { return a.address < b.address; });
+    for (const auto& entry : map.entries) {
+        route(entry.address);
+    }
+
+    // Each round traverses all segments in parallel, up to the targets in other segments,
+    // which are then handed over for the next round.
+    while (std::any_of(states.begin(), states.end(),
+                       [](const auto& state) { return !state.pending.empty(); })) {
+        ParallelFor(states.size(), threads, [&](std::size_t i) { Traverse(states[i]); });
+        for (auto& state : states) {
+            for (u32 address : state.outgoing) {
+                route(address);
+            }
+            state.outgoing.clear();
+        }
+    }
+
+    ParallelFor(states.size(), threads, [&](std::size_t i) { BuildBlocks(states[i]); });
+
+    std::vector<std::pair<u32, u32>> calls;
+    for (auto& state : states) {
+        std::move(state.blocks.begin(), state.blocks.end(), std::back_inserter(map.blocks));
+        map.loops.insert(map.loops.end(), state.loops.begin(), state.loops.end());
+        map.idle_loops.insert(map.idle_loops.end(), state.idle_loops.begin(),
+                              state.idle_loops.end());
+        map.indirect.insert(map.indirect.end(), state.indirect.begin(), state.indirect.end());
+        calls.insert(calls.end(), state.calls.begin(), state.calls.end());
+    }
+    std::sort(map.blocks.begin(), map.blocks.end(),
+              [](const auto& a, const auto& b) { return a.start < b.start; });
+    std::sort(map.loops.begin(), map.loops.end(),
+              [](const auto& a, const auto& b) { return a.instruction < b.instruction; });
+    std::sort(map.idle_loops.begin(), map.idle_loops.end());
+    std::sort(map.indirect.begin(), map.indirect.end(),
+              [](const auto& a, const auto& b) { return a.address < b.address; });
+    std::sort(calls.begin(), calls.end());
+    std::sort(map.external.begin(), map.external.end());
+    map.external.erase(std::unique(map.external.begin(), map.external.end()), map.external.end());
+
+    const auto find_block = [&](u32 address) -> FirmwareMap::Block* {
+        auto it = std::upper_bound(map.blocks.begin(), map.blocks.end(), address,
+                                   [](u32 a, const auto& block) { return a < block.start; });
+        if (it == map.blocks.begin() || address >= (--it)->end) {
+            return nullptr;
+        }
+        return &*it;
+    };
+
+    // Back edges of the loops
+    for (const auto& loop : map.loops) {
+        FirmwareMap::Block* block = find_block(loop.end);
+        if (block && block->end == loop.end + 1 &&
+            std::find(block->successors.begin(), block->successors.end(), loop.start) ==
+                block->successors.end()) {
+            block->successors.push_back(loop.start);
+        }
+    }
+
+    // Functions start at the entries and at direct call targets
+    std::vector<u32> function_entries;
+    for (const auto& entry : map.entries) {
+        function_entries.push_back(entry.address);
+    }
+    for (const auto& [site, callee] : calls) {
+        function_entries.push_back(callee);
+    }
+    std::sort(function_entries.begin(), function_entries.end());
+    function_entries.erase(std::unique(function_entries.begin(), function_entries.end()),
+                           function_entries.end());
+    for (u32 entry : function_entries) {
+        const FirmwareMap::Block* block = find_block(entry);
+        if (!block || block->start != entry) {
+            continue;
+        }
+        FirmwareMap::Function function{entry, {}, {}, {}, 0};
+        for (const auto& e : map.entries) {
+            if (e.address == entry && function.name.empty()) {
+                function.name = e.name;
+            }
+        }
+        function.call_sites = (u32)std::count_if(
+            calls.begin(), calls.end(), [entry](const auto& call) { return call.second == entry; });
+        map.functions.push_back(std::move(function));
+    }
+
+    const auto is_function_entry = [&](u32 address) {
+        return std::binary_search(function_entries.begin(), function_entries.end(), address);
+    };
+    ParallelFor(map.functions.size(), threads, [&](std::size_t i) {
+        FirmwareMap::Function& function = map.functions[i];
+        std::vector<u32> stack{function.entry};
+        std::unordered_set<u32> visited;
+        while (!stack.empty()) {
+            const u32 start = stack.back();
+            stack.pop_back();
+            const FirmwareMap::Block* block = find_block(start);
+            if (!block || block->start != start || !visited.insert(start).second) {
+                continue;
+            }
+            function.blocks.push_back(start);
+            auto call = std::lower_bound(calls.begin(), calls.end(), std::make_pair(start, 0u));
+            for (; call != calls.end() && call->first < block->end; ++call) {
+                function.callees.push_back(call->second);
+            }
+            for (u32 successor : block->successors) {
+                if (!is_function_entry(successor) || successor == function.entry) {
+                    stack.push_back(successor);
+                }
+            }
+        }
+        std::sort(function.blocks.begin(), function.blocks.end());
+        std::sort(function.callees.begin(), function.callees.end());
+        function.callees.erase(std::unique(function.callees.begin(), function.callees.end()),
+                               function.callees.end());
+    });
+
+    return map;
+}
+
+std::string FirmwareMap::ExportJson() const {
+    std::string out = "{\n";
+    char line[128];
+
+    out += "\"segments\": [";
+    for (std::size_t i = 0; i < segments.size(); ++i) {
+        std::snprintf(line, sizeof(line), "%s\n  {\"address\": %u, \"size\": %u}",
+                      i == 0 ? "" : ",", segments[i].address, segments[i].size);
+        out += line;
+    }
+    out += "\n],\n\"entries\": [";
+    for (std::size_t i = 0; i < entries.size(); ++i) {
+        std::snprintf(line, sizeof(line), "%s\n  {\"address\": %u, \"name\": ", i == 0 ? "" : ",",
+                      entries[i].address);
+        out += line;
+        AppendEscaped(out, entries[i].name);
+        out += '}';
+    }
+    out += "\n],\n\"functions\": [";
+    for (std::size_t i = 0; i < functions.size(); ++i) {
+        const Function& function = functions[i];
+        std::snprintf(line, sizeof(line), "%s\n  {\"entry\": %u, \"name\": ", i == 0 ? "" : ",",
+                      function.entry);
+        out += line;
+        AppendEscaped(out, function.name);
+        std::snprintf(line, sizeof(line), ", \"call_sites\": %u, \"blocks\": ",
+                      function.call_sites);
+        out += line;
+        AppendList(out, function.blocks);
+        out += ", \"callees\": ";
+        AppendList(out, function.callees);
+        out += '}';
+    }
+    out += "\n],\n\"blocks\": [";
+    for (std::size_t i = 0; i < blocks.size(); ++i) {
+        const Block& block = blocks[i];
+        std::snprintf(line, sizeof(line),
+                      "%s\n  {\"start\": %u, \"end\": %u, \"instructions\": %u, \"successors\": ",
+                      i == 0 ? "" : ",", block.start, block.end, block.instructions);
+        out += line;
+        AppendList(out, block.successors);
+        out += '}';
+    }
+    out += "\n],\n\"loops\": [";
+    for (std::size_t i = 0; i < loops.size(); ++i) {
+        std::snprintf(line, sizeof(line),
+                      "%s\n  {\"instruction\": %u, \"start\": %u, \"end\": %u, \"kind\": \"%s\"}",
+                      i == 0 ? "" : ",", loops[i].instruction, loops[i].start, loops[i].end,
+                      loops[i].block ? "bkrep" : "rep");
+        out += line;
+    }
+    out += "\n],\n\"idle_loops\": ";
+    AppendList(out, idle_loops);
+    out += ",\n\"indirect\": [";
+    for (std::size_t i = 0; i < indirect.size(); ++i) {
+        std::snprintf(line, sizeof(line), "%s\n  {\"address\": %u, \"kind\": \"%s\"}",
+                      i == 0 ? "" : ",", indirect[i].address,
+                      indirect[i].call ? "call" : "branch");
+        out += line;
+    }
+    out += "\n],\n\"external\": ";
+    AppendList(out, external);
+    out += "\n}\n";
+    return out;
+}
+
+} // namespace Teakra
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "common_types.h"
+
+namespace Teakra {
+
+/// Program words loaded at a word address
+struct ProgramSegment {
+    u32 address;
+    std::vector<u16> words;
+};
+
+/// Effect of one instruction on control flow
+struct InstructionFlow {
+    enum Kind : u8 {
+        Next,            // falls through to the next instruction
+        Branch,          // br, brr
+        Call,            // call, callr
+        IndirectBranch,  // mov_pc
+        IndirectCall,    // calla, trap
+        Return,          // ret, retd, rets
+        InterruptReturn, // reti, retic, retid, retidc
+        Repeat,          // rep, repeating the next instruction
+        BlockRepeat,     // bkrep, repeating from the next instruction to target inclusive
+        Stop,            // undefined opcode, or an expansion word past the end of the program
+    };
+
+    Kind kind = Next;
+    bool conditional = false;
+    u8 length = 1;
+    u32 target = 0; // branch or call target, or the last word of a block repeat
+};
+
+InstructionFlow GetInstructionFlow(u32 address, u16 opcode, u16 expansion);
+
+/**
+ * Control flow recovered from the reachable code of a firmware. All addresses are program word
+ * addresses, and every list is sorted by address.
+ */
+struct FirmwareMap {
+    struct Segment {
+        u32 address;
+        u32 size;
+    };
+
+    struct Entry {
+        u32 address;
+        std::string name;
+    };
+
+    struct Block {
+        u32 start;
+        u32 end; // one past the last word
+        u32 instructions;
+        std::vector<u32> successors; // block starts, not including call targets
+    };
+
+    struct Function {
+        u32 entry;
+        std::string name;
+        std::vector<u32> blocks;  // blocks reachable from the entry without calls, and without
+                                  // branching into another function
+        std::vector<u32> callees; // direct call targets
+        u32 call_sites;           // number of direct calls to this function
+    };
+
+    struct Loop {
+        u32 instruction; // the rep or bkrep
+        u32 start;
+        u32 end; // last word of the body
+        bool block;
+    };
+
+    struct Indirect {
+        u32 address;
+        bool call;
+    };
+
+    std::vector<Segment> segments;
+    std::vector<Entry> entries;
+    std::vector<Block> blocks;
+    std::vector<Function> functions;
+    std::vector<Loop> loops;
+    std::vector<u32> idle_loops; // branches to themselves, which the emulator skips ahead on
+    std::vector<Indirect> indirect;
+    std::vector<u32> external; // branch and call targets outside of all segments
+
+    std::string ExportJson() const;
+};
+
+/// The reset vector and the vectors of the three core interrupts
+std::vector<FirmwareMap::Entry> DefaultFirmwareEntries();
+
+/// Follows control flow from the entries through the segments. Segments are decoded and
+/// traversed in parallel (0 threads = all cores); the result doesn't depend on the thread count.
+FirmwareMap AnalyzeFirmware(const std::vector<ProgramSegment>& segments,
+                            const std::vector<FirmwareMap::Entry>& entries, unsigned threads = 0);
+
+} // namespace Teakra
@@ -0,0 +1,106 @@
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "../common_types.h"
+#include "../dsp1.h"
+#include "../firmware_analysis.h"
+#include "../coff_reader/coff.h"
+
+namespace {
+
+std::vector<u16> ToWords(const u8* data, std::size_t size) {
+    std::vector<u16> words(size / 2);
+    for (std::size_t i = 0; i < words.size(); ++i) {
+        words[i] = data[i * 2] | (data[i * 2 + 1] << 8);
+    }
+    return words;
+}
+
+bool LoadDsp1(const std::vector<u8>& raw, std::vector<Teakra::ProgramSegment>& segments) {
+    Teakra::Dsp1Image image;
+    if (Teakra::ParseDsp1(raw, image) != Teakra::Dsp1LoadResult::Status::Ok) {
+        return false;
+    }
+    for (const auto& segment : image.Segments()) {
+        if (segment.memory == Teakra::Dsp1Segment::Memory::Program) {
+            segments.push_back(
+                {segment.address, ToWords(segment.data.data(), segment.data.size())});
+        }
+    }
+    return true;
+}
+
+void LoadCoff(std::FILE* file, std::vector<Teakra::ProgramSegment>& segments,
+              std::vector<Teakra::FirmwareMap::Entry>& entries) {
+    Coff coff(file);
+    for (const auto& section : coff.sections) {
+        if ((section.flags & SFlag::RegionMask) == SFlag::Prog) {
+            segments.push_back(
+                {section.prog_addr, ToWords(section.data.data(), section.data.size())});
+        }
+    }
+    // External and static symbols of function type
+    for (const auto& symbol : coff.symbols) {
+        if (symbol.region == Coff::SymbolEx::Prog && (symbol.storage == 2 || symbol.storage == 3) &&
+            (symbol.type & 0x30) == 0x20) {
+            entries.push_back({symbol.value, symbol.name});
+        }
+    }
+}
+
+} // Anonymous namespace
+
+int main(int argc, char** argv) {
+    // firmware_analyzer <dsp1 or coff> <map.json> [threads] [entry...]
+    if (argc < 3) {
+        std::fprintf(stderr, "Usage: %s <firmware> <map.json> [threads] [entry...]\n", argv[0]);
+        return -1;
+    }
+
+    std::FILE* file = std::fopen(argv[1], "rb");
+    if (!file) {
+        std::fprintf(stderr, "Failed to open %s\n", argv[1]);
+        return -1;
+    }
+    std::vector<u8> raw;
+    u8 buffer[0x1000];
+    std::size_t read;
+    while ((read = std::fread(buffer, 1, sizeof(buffer), file)) != 0) {
+        raw.insert(raw.end(), buffer, buffer + read);
+    }
+
+    std::vector<Teakra::ProgramSegment> segments;
+    std::vector<Teakra::FirmwareMap::Entry> entries = Teakra::DefaultFirmwareEntries();
+    if (!LoadDsp1(raw, segments)) {
+        try {
+            LoadCoff(file, segments, entries);
+        } catch (const char* error) {
+            std::fprintf(stderr, "Neither DSP1 nor COFF: %s\n", error);
+            std::fclose(file);
+            return -1;
+        }
+    }
+    std::fclose(file);
+
+    const unsigned threads = argc > 3 ? (unsigned)std::strtoul(argv[3], nullptr, 0) : 0;
+    for (int i = 4; i < argc; ++i) {
+        entries.push_back({(u32)std::strtoul(argv[i], nullptr, 0), argv[i]});
+    }
+
+    const Teakra::FirmwareMap map = Teakra::AnalyzeFirmware(segments, entries, threads);
+
+    std::FILE* out = std::fopen(argv[2], "wt");
+    if (!out) {
+        std::fprintf(stderr, "Failed to open %s\n", argv[2]);
+        return -1;
+    }
+    const std::string json = map.ExportJson();
+    std::fwrite(json.data(), 1, json.size(), out);
+    std::fclose(out);
+
+    std::printf("%zu segments, %zu functions, %zu blocks, %zu loops, %zu idle loops, %zu indirect\n",
+                map.segments.size(), map.functions.size(), map.blocks.size(), map.loops.size(),
+                map.idle_loops.size(), map.indirect.size());
+    return 0;
+}
@@ -0,0 +1,93 @@
+#include <algorithm>
+#include "apbp.h"
+#include "frame_snapshot.h"
+#include "memory_interface.h"
+#include "shared_memory.h"
+
+namespace Teakra {
+
+u32 FrameSnapshots::AddRegion(u16 address, u16 words) {
+    if (words == 0 || address + words > 0x10000) {
+        return 0;
+    }
+    auto region = std::make_shared<Region>();
+    region->address = address;
+    region->buffers[0].resize(words);
+    region->buffers[1].resize(words);
+    std::lock_guard lock(mutex);
+    region->id = next_id++;
+    regions.push_back(std::move(region));
+    return regions.back()->id;
+}
+
+void FrameSnapshots::RemoveRegion(u32 id) {
+    std::lock_guard lock(mutex);
+    std::erase_if(regions, [id](const auto& region) { return region->id == id; });
+}
+
+void FrameSnapshots::Publish() {
+    std::lock_guard lock(mutex);
+    ++frame;
+    for (const auto& region : regions) {
+        // Readers of the previous frame use the other buffer. The fence keeps this buffer's
+        // writes from being seen before the frame that stopped readers from using it.
+        std::atomic_thread_fence(std::memory_order_release);
+        const u32 base = MemoryInterfaceUnit::DataMemoryOffset + region->address;
+        auto& buffer = region->buffers[frame & 1];
+        for (std::size_t i = 0; i < buffer.size(); ++i) {
+            std::atomic_ref(buffer[i]).store(shared_memory.ReadWord(base + static_cast<u32>(i)),
+                                             std::memory_order_relaxed);
+        }
+        region->frame.store(frame, std::memory_order_release);
+    }
+}
+
+u64 FrameSnapshots::Read(u32 id, std::span<u16> out) const {
+    std::shared_ptr<Region> region;
+    {
+        std::lock_guard lock(mutex);
+        const auto it = std::find_if(regions.begin(), regions.end(),
+                                     [id](const auto& region) { return region->id == id; });
+        if (it == regions.end()) {
+            return 0;
+        }
+        region = *it;
+    }
+
+    const std::size_t count = std::min(out.size(), region->buffers[0].size());
+    while (true) {
+        const u64 before = region->frame.load(std::memory_order_acquire);
+        if (before == 0) {
+            return 0;
+        }
+        auto& buffer = region->buffers[before & 1];
+        for (std::size_t i = 0; i < count; ++i) {
+            out[i] = std::atomic_ref(buffer[i]).load(std::memory_order_relaxed);
+        }
+        // The buffer is only rewritten two frames later, after publishing the next one
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (region->frame.load(std::memory_order_relaxed) == before) {
+            return before;
+        }
+    }
+}
+
+FramePublisher::FramePublisher(FrameSnapshots& snapshots, Apbp& apbp_from_dsp) {
+    apbp_from_dsp.SetSemaphoreObserver([this, &snapshots](u16 bits) {
+        if (bits & semaphore_bits) {
+            snapshots.Publish();
+        }
+    });
+    apbp_from_dsp.SetDataObserver([this, &snapshots](unsigned channel) {
+        if ((recv_data_channels >> channel) & 1) {
+            snapshots.Publish();
+        }
+    });
+}
+
+void FramePublisher::SetConfig(const FramePublishConfig& config) {
+    semaphore_bits = config.semaphore_bits;
+    recv_data_channels = config.recv_data_channels;
+}
+
+} // namespace Teakra
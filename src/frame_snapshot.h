@@ -0,0 +1,71 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <vector>
+#include "common_types.h"
+#include "teakra/teakra.h"
+
+namespace Teakra {
+
+class Apbp;
+struct SharedMemory;
+
+/**
+ * Copies of DSP data memory regions taken at frame boundaries, for the host to read without
+ * stopping the DSP. Publish runs on the DSP thread and fills the back buffer of each region;
+ * readers copy the front buffer and retry if another frame was published meanwhile, in the
+ * manner of a seqlock. Publish never waits on readers. Buffer words are only accessed through
+ * relaxed atomics, as a reader may copy a buffer while Publish rewrites it.
+ */
+class FrameSnapshots {
+public:
+    explicit FrameSnapshots(SharedMemory& shared_memory) : shared_memory(shared_memory) {}
+
+    // Returns the id of the new region, or 0 if it is empty or runs past the end of data memory
+    u32 AddRegion(u16 address, u16 words);
+    void RemoveRegion(u32 id);
+
+    // Copies every region out of DSP memory as the next frame
+    void Publish();
+
+    // Copies the first out.size() words of the region as of the latest frame, returning the
+    // frame number, or 0 if no frame was published since the region was added
+    u64 Read(u32 id, std::span<u16> out) const;
+
+private:
+    struct Region {
+        u32 id;
+        u16 address;
+        std::array<std::vector<u16>, 2> buffers; // frame n lives in buffers[n & 1]
+        std::atomic<u64> frame{0};
+    };
+
+    SharedMemory& shared_memory;
+    mutable std::mutex mutex; // guards regions, not their buffers
+    std::vector<std::shared_ptr<Region>> regions;
+    u32 next_id = 1;
+    u64 frame = 0;
+};
+
+/**
+ * Publishes a frame of the snapshots when the DSP completes one, as told by the configured
+ * semaphore bits and APBP data channels. Both are observed on the DSP side of APBP, so they
+ * count whatever the semaphore mask and channel interrupt settings. The config may be changed
+ * from another thread.
+ */
+class FramePublisher {
+public:
+    FramePublisher(FrameSnapshots& snapshots, Apbp& apbp_from_dsp);
+
+    void SetConfig(const FramePublishConfig& config);
+
+private:
+    std::atomic<u16> semaphore_bits{0};
+    std::atomic<u8> recv_data_channels{0};
+};
+
+} // namespace Teakra
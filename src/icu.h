@@ -17,8 +17,13 @@ public:
         return (u16)request.to_ulong();
     }
     void Acknowledge(u16 irq_bits) {
-        std::lock_guard lock(mutex);
-        request &= ~IrqBits(irq_bits);
+        {
+            std::lock_guard lock(mutex);
+            request &= ~IrqBits(irq_bits);
+        }
+        if (on_acknowledge) {
+            on_acknowledge(irq_bits);
+        }
     }
     u16 GetAcknowledge() {
         return 0;
@@ -72,6 +77,20 @@ public:
         on_interrupt = std::move(interrupt);
         on_vectored_interrupt = std::move(vectored_interrupt);
     }
+    // Called after every Acknowledge with the bits written, outside of the ICU lock
+    void SetAcknowledgeObserver(std::function<void(u16 irq_bits)> observer) {
+        on_acknowledge = std::move(observer);
+    }
+
+    // IRQs that reach an interrupt line or the vectored interrupt when triggered
+    u16 GetRouted() const {
+        std::lock_guard lock(mutex);
+        IrqBits routed = vectored_enabled;
+        for (const auto& line : enabled) {
+            routed |= line;
+        }
+        return (u16)routed.to_ulong();
+    }
 
     std::array<u16, 16> vector_low, vector_high;
     std::array<u16, 16> vector_context_switch;
@@ -79,6 +98,7 @@ public:
 private:
     std::function<void(u32)> on_interrupt;
     std::function<void(u32, bool)> on_vectored_interrupt;
+    std::function<void(u16)> on_acknowledge;
 
     IrqBits request;
     std::array<IrqBits, 3> enabled;
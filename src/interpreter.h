@@ -7,6 +7,7 @@
 #include <unordered_map>
 #include <unordered_set>
 #include "bit.h"
+#include "call_profiler.h"
 #include "core_timing.h"
 #include "crash.h"
 #include "decoder.h"
@@ -52,102 +53,142 @@ public:
     }
 
     void SetPC(u32 new_pc) {
-        ASSERT(new_pc < 0x40000);
+        if (new_pc >= 0x40000) {
+            throw UnimplementedException(); // outside of program memory
+        }
         regs.pc = new_pc;
         compiling = false;
     }
 
     void undefined(u16 opcode) {
-        UNREACHABLE();
+        throw UnimplementedException();
     }
 
     bool compiling = false;
 
     u32 Run(u64 cycles) {
-        idle = false;
+        BeginRun();
         for (u64 i = 0; i < cycles; ++i) {
-            if (idle) {
-                u64 skipped = core_timing.Skip(cycles - i - 1);
-                i += skipped;
-
-                // Skip additional tick so to let components fire interrupts
-                if (i < cycles - 1) {
-                    ++i;
-                    core_timing.Tick();
-                }
-            }
+            SkipIdle(i, cycles);
+            PollInterrupts();
+            u16 opcode, expand_value;
+            const auto& decoder = Fetch(opcode, expand_value);
+            Execute(decoder, opcode, expand_value);
+            core_timing.Tick();
+        }
+        return 0;
+    }
 
-            for (std::size_t i = 0; i < 3; ++i) {
-                if (interrupt_pending[i].exchange(false)) {
-                    regs.ip[i] = 1;
-                }
-            }
+    // The steps of one Run iteration, also driven directly by SpmdInterpreter to share the
+    // fetch and decode between instances at the same pc
 
-            if (vinterrupt_pending.exchange(false)) {
-                regs.ipv = 1;
+    // Registers may have been changed from outside since the previous run
+    void BeginRun() {
+        idle = false;
+        RefreshStepping();
+    }
+
+    // Skips ahead while idle, advancing the cycle index i of a run of the given length
+    void SkipIdle(u64& i, u64 cycles) {
+        if (idle) {
+            u64 skipped = core_timing.Skip(cycles - i - 1);
+            i += skipped;
+
+            // Skip additional tick so to let components fire interrupts
+            if (i < cycles - 1) {
+                ++i;
+                core_timing.Tick();
             }
+        }
+    }
 
-            u16 opcode = mem.ProgramRead((regs.pc++) | (regs.prpage << 18));
-            auto& decoder = decoders[opcode];
-            u16 expand_value = 0;
-            if (decoder.NeedExpansion()) {
-                expand_value = mem.ProgramRead((regs.pc++) | (regs.prpage << 18));
+    void PollInterrupts() {
+        for (std::size_t i = 0; i < 3; ++i) {
+            if (interrupt_pending[i].exchange(false)) {
+                regs.ip[i] = 1;
             }
+        }
 
-            if (regs.rep) {
-                if (regs.repc == 0) {
-                    regs.rep = false;
-                } else {
-                    --regs.repc;
-                    --regs.pc;
-                }
+        if (vinterrupt_pending.exchange(false)) {
+            regs.ipv = 1;
+        }
+    }
+
+    const Matcher<Interpreter>& Fetch(u16& opcode, u16& expand_value) {
+        inst_pc = regs.pc;
+        opcode = mem.ProgramRead((regs.pc++) | (regs.prpage << 18));
+        const auto& decoder = decoders[opcode];
+        expand_value = 0;
+        if (decoder.NeedExpansion()) {
+            expand_value = mem.ProgramRead((regs.pc++) | (regs.prpage << 18));
+        }
+        return decoder;
+    }
+
+    // Runs an instruction already fetched at pc, with pc advanced past it
+    void Execute(const Matcher<Interpreter>& decoder, u16 opcode, u16 expand_value) {
+        if (regs.rep) {
+            if (regs.repc == 0) {
+                regs.rep = false;
+            } else {
+                --regs.repc;
+                --regs.pc;
             }
+        }
 
-            if (regs.lp && regs.bkrep_stack[regs.bcn - 1].end + 1 == regs.pc) {
-                if (regs.bkrep_stack[regs.bcn - 1].lc == 0) {
-                    --regs.bcn;
-                    regs.lp = regs.bcn != 0;
-                } else {
-                    --regs.bkrep_stack[regs.bcn - 1].lc;
-                    regs.pc = regs.bkrep_stack[regs.bcn - 1].start;
-                }
+        if (regs.lp && regs.bkrep_stack[regs.bcn - 1].end + 1 == regs.pc) {
+            if (regs.bkrep_stack[regs.bcn - 1].lc == 0) {
+                --regs.bcn;
+                regs.lp = regs.bcn != 0;
+            } else {
+                --regs.bkrep_stack[regs.bcn - 1].lc;
+                regs.pc = regs.bkrep_stack[regs.bcn - 1].start;
             }
+        }
 
-            decoder.call(*this, opcode, expand_value);
+        decoder.call(*this, opcode, expand_value);
 
-            // I am not sure if a single-instruction loop is interruptable and how it is handled,
-            // so just disable interrupt for it for now.
-            if (regs.ie && !regs.rep) {
-                bool interrupt_handled = false;
-                for (u32 i = 0; i < regs.im.size(); ++i) {
-                    if (regs.im[i] && regs.ip[i]) {
-                        regs.ip[i] = 0;
-                        regs.ie = 0;
-                        PushPC();
-                        regs.pc = 0x0006 + i * 8;
-                        idle = false;
-                        interrupt_handled = true;
-                        if (regs.ic[i]) {
-                            ContextStore();
-                        }
-                        break;
-                    }
-                }
-                if (!interrupt_handled && regs.imv && regs.ipv) {
-                    regs.ipv = 0;
+        // I am not sure if a single-instruction loop is interruptable and how it is handled,
+        // so just disable interrupt for it for now.
+        if (regs.ie && !regs.rep) {
+            bool interrupt_handled = false;
+            for (u32 i = 0; i < regs.im.size(); ++i) {
+                if (regs.im[i] && regs.ip[i]) {
+                    regs.ip[i] = 0;
                     regs.ie = 0;
                     PushPC();
-                    regs.pc = vinterrupt_address;
+                    regs.pc = 0x0006 + i * 8;
                     idle = false;
-                    if (vinterrupt_context_switch) {
+                    if (profiler) {
+                        profiler->Enter(regs.pc);
+                    }
+                    if (interrupt_service_handler) {
+                        interrupt_service_handler(i, 0);
+                    }
+                    interrupt_handled = true;
+                    if (regs.ic[i]) {
                         ContextStore();
                     }
+                    break;
+                }
+            }
+            if (!interrupt_handled && regs.imv && regs.ipv) {
+                regs.ipv = 0;
+                regs.ie = 0;
+                PushPC();
+                regs.pc = vinterrupt_address;
+                idle = false;
+                if (profiler) {
+                    profiler->Enter(regs.pc);
+                }
+                if (interrupt_service_handler) {
+                    interrupt_service_handler(3, 0);
+                }
+                if (vinterrupt_context_switch) {
+                    ContextStore();
                 }
             }
-
-            core_timing.Tick();
         }
-        return 0;
     }
 
     void RunWithJit(u64 cycles) {
@@ -213,6 +254,12 @@ public:
                     PushPC();
                     regs.pc = 0x0006 + i * 8;
                     idle = false;
+                    if (profiler) {
+                        profiler->Enter(regs.pc);
+                    }
+                    if (interrupt_service_handler) {
+                        interrupt_service_handler(i, 0);
+                    }
                     interrupt_handled = true;
                     if (regs.ic[i]) {
                         ContextStore();
@@ -226,6 +273,12 @@ public:
                 PushPC();
                 regs.pc = vinterrupt_address;
                 idle = false;
+                if (profiler) {
+                    profiler->Enter(regs.pc);
+                }
+                if (interrupt_service_handler) {
+                    interrupt_service_handler(3, 0);
+                }
                 if (vinterrupt_context_switch) {
                     ContextStore();
                 }
@@ -344,7 +397,7 @@ public:
             s1 = RegName::b1;
             break;
         default:
-            UNREACHABLE();
+            throw UnimplementedException(); // reserved swap type
         }
         u = GetAcc(s0);
         v = GetAcc(s1);
@@ -1057,7 +1110,9 @@ public:
     }
 
     void BlockRepeat(u16 lc, u32 address) {
-        ASSERT(regs.bcn <= 3);
+        if (regs.bcn > 3) {
+            throw UnimplementedException(); // nested too deep, unknown effect
+        }
         regs.bkrep_stack[regs.bcn].start = regs.pc;
         regs.bkrep_stack[regs.bcn].end = address;
         regs.bkrep_stack[regs.bcn].lc = lc;
@@ -1083,7 +1138,9 @@ public:
 
     void RestoreBlockRepeat(u16& address_reg) {
         if (regs.lp) {
-            ASSERT(regs.bcn <= 3);
+            if (regs.bcn > 3) {
+                throw UnimplementedException(); // nested too deep, unknown effect
+            }
             std::copy_backward(regs.bkrep_stack.begin(), regs.bkrep_stack.begin() + regs.bcn,
                                regs.bkrep_stack.begin() + regs.bcn + 1);
             ++regs.bcn;
@@ -1091,7 +1148,9 @@ public:
         u32 flag = mem.DataRead(address_reg++);
         u16 valid = flag >> 15;
         if (regs.lp) {
-            ASSERT(valid);
+            if (!valid) {
+                throw UnimplementedException(); // restoring an empty frame into a loop
+            }
         } else {
             if (valid)
                 regs.lp = regs.bcn = 1;
@@ -1154,6 +1213,9 @@ public:
             if (regs.stp16)
                 std::swap(regs.stepj0, regs.stepj0b);
         }
+        if (flags.Cfgi() || flags.Cfgj()) {
+            RefreshStepping();
+        }
     }
     void bankr() {
         regs.SwapAllArArp();
@@ -1171,17 +1233,19 @@ public:
 
     void bitrev(Rn a) {
         u32 unit = a.Index();
-        regs.r[unit] = BitReverse(regs.r[unit]);
+        regs.r[unit] = BitReverseTable[regs.r[unit]];
     }
     void bitrev_dbrv(Rn a) {
         u32 unit = a.Index();
-        regs.r[unit] = BitReverse(regs.r[unit]);
+        regs.r[unit] = BitReverseTable[regs.r[unit]];
         regs.br[unit] = 0;
+        RefreshStepping();
     }
     void bitrev_ebrv(Rn a) {
         u32 unit = a.Index();
-        regs.r[unit] = BitReverse(regs.r[unit]);
+        regs.r[unit] = BitReverseTable[regs.r[unit]];
         regs.br[unit] = 1;
+        RefreshStepping();
     }
 
     void br(Address18_16 addr_low, Address18_2 addr_high, Cond cond) {
@@ -1201,30 +1265,47 @@ public:
     }
 
     void break_() {
-        ASSERT(regs.lp);
+        if (!regs.lp) {
+            throw UnimplementedException(); // outside of a loop, unknown effect
+        }
         --regs.bcn;
         regs.lp = regs.bcn != 0;
         // Note: unlike one would expect, the "break" instruction doesn't jump out of the block
     }
 
+    void ProfileEnter() {
+        if (profiler) {
+            profiler->Enter(regs.pc);
+        }
+    }
+    void ProfileLeave() {
+        if (profiler) {
+            profiler->Leave();
+        }
+    }
+
     void call(Address18_16 addr_low, Address18_2 addr_high, Cond cond) {
         if (regs.ConditionPass(cond)) {
             PushPC();
             SetPC(Address32(addr_low, addr_high));
+            ProfileEnter();
         }
     }
     void calla(Axl a) {
         PushPC();
         SetPC(RegToBus16(a.GetName())); // use pcmhi?
+        ProfileEnter();
     }
     void calla(Ax a) {
         PushPC();
         SetPC(GetAcc(a.GetName()) & 0x3FFFF); // no saturation ?
+        ProfileEnter();
     }
     void callr(RelAddr7 addr, Cond cond) {
         if (regs.ConditionPass(cond)) {
             PushPC();
             regs.pc += addr.Relative32();
+            ProfileEnter();
         }
         compiling = false;
     }
@@ -1232,6 +1313,7 @@ public:
     void ContextStore() {
         regs.ShadowStore();
         regs.ShadowSwap();
+        RefreshStepping();
         if (!regs.crep) {
             regs.repcs = regs.repc;
         }
@@ -1249,6 +1331,7 @@ public:
     void ContextRestore() {
         regs.ShadowRestore();
         regs.ShadowSwap();
+        RefreshStepping();
         if (!regs.crep) {
             regs.repc = regs.repcs;
         }
@@ -1270,6 +1353,7 @@ public:
     void ret(Cond c) {
         if (regs.ConditionPass(c)) {
             PopPC();
+            ProfileLeave();
         }
     }
     void retd() {
@@ -1279,6 +1363,7 @@ public:
         if (regs.ConditionPass(c)) {
             PopPC();
             regs.ie = 1;
+            ProfileLeave();
         }
     }
     void retic(Cond c) {
@@ -1286,17 +1371,19 @@ public:
             PopPC();
             regs.ie = 1;
             ContextRestore();
+            ProfileLeave();
         }
     }
     void retid() {
-        UNREACHABLE();
+        throw UnimplementedException();
     }
     void retidc() {
-        UNREACHABLE();
+        throw UnimplementedException();
     }
     void rets(Imm8 a) {
         PopPC();
         regs.sp += a.Unsigned16();
+        ProfileLeave();
     }
 
     void load_ps(Imm2 a) {
@@ -1305,18 +1392,22 @@ public:
     void load_stepi(Imm7s a) {
         // Although this is signed, we still only store the lower 7 bits
         regs.stepi = a.Signed16() & 0x7F;
+        RefreshStepping();
     }
     void load_stepj(Imm7s a) {
         regs.stepj = a.Signed16() & 0x7F;
+        RefreshStepping();
     }
     void load_page(Imm8 a) {
         regs.page = a.Unsigned16();
     }
     void load_modi(Imm9 a) {
         regs.modi = a.Unsigned16();
+        RefreshStepping();
     }
     void load_modj(Imm9 a) {
         regs.modj = a.Unsigned16();
+        RefreshStepping();
     }
     void load_movpd(Imm2 a) {
         regs.pcmhi = a.Unsigned16();
@@ -1748,7 +1839,7 @@ public:
         SatAndSetAccAndFlag(b.GetName(), value);
     }
     void mov_dvm(Abl a) {
-        UNREACHABLE();
+        throw UnimplementedException();
     }
     void mov_x0(Abl a) {
         u16 value16 = RegToBus16(a.GetName(), true);
@@ -1834,7 +1925,7 @@ public:
         regs.sv = value;
     }
     void mov_dvm_to(Ab b) {
-        UNREACHABLE();
+        throw UnimplementedException();
     }
     void mov_icr_to(Ab b) {
         u16 value = regs.Get<icr>();
@@ -1980,10 +2071,12 @@ public:
     void mov_stepi0(Imm16 a) {
         u16 value = a.Unsigned16();
         regs.stepi0 = value;
+        RefreshStepping();
     }
     void mov_stepj0(Imm16 a) {
         u16 value = a.Unsigned16();
         regs.stepj0 = value;
+        RefreshStepping();
     }
     void mov(Imm16 a, SttMod b) {
         u16 value = a.Unsigned16();
@@ -1996,10 +2089,12 @@ public:
     void mov_a0h_stepi0() {
         u16 value = RegToBus16(RegName::a0h, true);
         regs.stepi0 = value;
+        RefreshStepping();
     }
     void mov_a0h_stepj0() {
         u16 value = RegToBus16(RegName::a0h, true);
         regs.stepj0 = value;
+        RefreshStepping();
     }
     void mov_stepi0_a0h() {
         u16 value = regs.stepi0;
@@ -3035,6 +3130,11 @@ public:
     std::atomic<u32> vinterrupt_address;
 
     bool idle = false;
+    // Address of the instruction being executed, reported to watchpoints
+    u32 inst_pc = 0;
+    CallProfiler* profiler = nullptr;
+    // Called on vectoring to interrupt 0-2, or 3 for the vectored interrupt
+    std::function<void(u32 interrupt, u64 offset)> interrupt_service_handler;
 
     u64 GetAcc(RegName name) const {
         switch (name) {
@@ -3131,7 +3231,7 @@ public:
         case RegName::a1e:
         case RegName::b0e:
         case RegName::b1e:
-            UNREACHABLE();
+            throw UnimplementedException();
 
         case RegName::r0:
             return regs.r[0];
@@ -3158,7 +3258,7 @@ public:
             return (ProductToBus40(Px{0}) >> 16) & 0xFFFF;
 
         case RegName::pc:
-            UNREACHABLE();
+            throw UnimplementedException();
         case RegName::sp:
             return regs.sp;
         case RegName::sv:
@@ -3217,7 +3317,7 @@ public:
         case RegName::mod3:
             return regs.Get<mod3>();
         default:
-            UNREACHABLE();
+            throw UnimplementedException();
         }
     }
 
@@ -3298,7 +3398,7 @@ public:
         case RegName::a1e:
         case RegName::b0e:
         case RegName::b1e:
-            UNREACHABLE();
+            throw UnimplementedException();
 
         case RegName::r0:
             regs.r[0] = value;
@@ -3334,7 +3434,7 @@ public:
             break;
 
         case RegName::pc:
-            UNREACHABLE();
+            throw UnimplementedException();
         case RegName::sp:
             regs.sp = value;
             break;
@@ -3396,13 +3496,16 @@ public:
             break;
         case RegName::st2:
             regs.Set<st2>(value);
+            RefreshStepping();
             break;
 
         case RegName::cfgi:
             regs.Set<cfgi>(value);
+            RefreshStepping();
             break;
         case RegName::cfgj:
             regs.Set<cfgj>(value);
+            RefreshStepping();
             break;
 
         case RegName::mod0:
@@ -3410,15 +3513,17 @@ public:
             break;
         case RegName::mod1:
             regs.Set<mod1>(value);
+            RefreshStepping();
             break;
         case RegName::mod2:
             regs.Set<mod2>(value);
+            RefreshStepping();
             break;
         case RegName::mod3:
             regs.Set<mod3>(value);
             break;
         default:
-            UNREACHABLE();
+            throw UnimplementedException();
         }
     }
 
@@ -3491,10 +3596,51 @@ public:
                                (OffsetValue)regs.arpoffsetj[arpstepj.Index()]);
     }
 
+    // Post-modify and addressing behaviour of an address unit, derived from cmd, stp16, m, br,
+    // cfgi/cfgj and stepi0/stepj0. Refreshed on every write to one of them, so stepping an
+    // address doesn't re-derive it.
+    struct AddressStepping {
+        u16 plus_step = 0;        // step of StepValue::PlusStep
+        u16 mod = 0;              // modi or modj
+        u16 mask = 0;             // (1 << log2p1(mod)) - 1, the wrap-around of the Teak method
+        bool modulo = false;      // m && !br
+        bool bit_reverse = false; // br && !m
+        bool legacy = true;       // cmd, the TeakLite method
+    };
+
+    void RefreshStepping() {
+        const bool legacy = regs.cmd;
+        for (unsigned unit = 0; unit < stepping.size(); ++unit) {
+            AddressStepping& stepping_unit = stepping[unit];
+            const u16 step0 = unit < 4 ? regs.stepi0 : regs.stepj0;
+            u16 s;
+            if (regs.br[unit] && !regs.m[unit]) {
+                s = step0;
+            } else {
+                s = unit < 4 ? regs.stepi : regs.stepj;
+                s = SignExtend<7>(s);
+            }
+            if (regs.stp16 == 1 && !legacy) {
+                s = step0;
+                if (regs.m[unit]) {
+                    s = SignExtend<9>(s);
+                }
+            }
+            stepping_unit.plus_step = s;
+            stepping_unit.mod = unit < 4 ? regs.modi : regs.modj;
+            stepping_unit.mask = (1 << std20::log2p1(stepping_unit.mod)) - 1;
+            stepping_unit.modulo = regs.m[unit] && !regs.br[unit];
+            stepping_unit.bit_reverse = regs.br[unit] && !regs.m[unit];
+            stepping_unit.legacy = legacy;
+        }
+    }
+
+    std::array<AddressStepping, 8> stepping{};
+
     u16 RnAddress(unsigned unit, unsigned value) {
         u16 ret = value;
-        if (regs.br[unit] && !regs.m[unit]) {
-            ret = BitReverse(ret);
+        if (stepping[unit].bit_reverse) {
+            ret = BitReverseTable[ret];
         }
         return ret;
     }
@@ -3509,12 +3655,10 @@ public:
         if (offset == OffsetValue::MinusOneDmod) {
             return address - 1;
         }
-        bool emod = regs.m[unit] & !regs.br[unit] & !dmod;
-        u16 mod = unit < 4 ? regs.modi : regs.modj;
-        u16 mask = 1; // mod = 0 still have one bit mask
-        for (unsigned i = 0; i < 9; ++i) {
-            mask |= mod >> i;
-        }
+        const AddressStepping& stepping_unit = stepping[unit];
+        bool emod = stepping_unit.modulo && !dmod;
+        u16 mod = stepping_unit.mod;
+        u16 mask = stepping_unit.mask | 1; // mod = 0 still have one bit mask
         if (offset == OffsetValue::PlusOne) {
             if (!emod)
                 return address + 1;
@@ -3536,8 +3680,9 @@ public:
     }
 
     u16 StepAddress(unsigned unit, u16 address, StepValue step, bool dmod = false) {
+        const AddressStepping& stepping_unit = stepping[unit];
         u16 s;
-        bool legacy = regs.cmd;
+        bool legacy = stepping_unit.legacy;
         bool step2_mode1 = false;
         bool step2_mode2 = false;
         switch (step) {
@@ -3568,21 +3713,9 @@ public:
             s = 0xFFFE;
             step2_mode2 = !legacy;
             break;
-        case StepValue::PlusStep: {
-            if (regs.br[unit] && !regs.m[unit]) {
-                s = unit < 4 ? regs.stepi0 : regs.stepj0;
-            } else {
-                s = unit < 4 ? regs.stepi : regs.stepj;
-                s = SignExtend<7>(s);
-            }
-            if (regs.stp16 == 1 && !legacy) {
-                s = unit < 4 ? regs.stepi0 : regs.stepj0;
-                if (regs.m[unit]) {
-                    s = SignExtend<9>(s);
-                }
-            }
+        case StepValue::PlusStep:
+            s = stepping_unit.plus_step;
             break;
-        }
         default:
             UNREACHABLE();
         }
@@ -3590,8 +3723,8 @@ public:
         if (s == 0)
             return address;
 
-        if (!dmod && !regs.br[unit] && regs.m[unit]) {
-            u16 mod = unit < 4 ? regs.modi : regs.modj;
+        if (!dmod && stepping_unit.modulo) {
+            u16 mod = stepping_unit.mod;
 
             if (mod == 0) {
                 return address;
@@ -3636,7 +3769,7 @@ public:
                     address &= ~mask;
                     address |= next;
                 } else {
-                    u16 mask = (1 << std20::log2p1(mod)) - 1;
+                    u16 mask = stepping_unit.mask;
                     u16 next;
                     if (s < 0x8000) {
                         next = (address + s) & mask;
@@ -3708,17 +3841,7 @@ public:
     }
 
     static RegName CounterAcc(RegName in) {
-        static std::unordered_map<RegName, RegName> map{
-            {RegName::a0, RegName::a1},   {RegName::a1, RegName::a0},
-            {RegName::b0, RegName::b1},   {RegName::b1, RegName::b0},
-            {RegName::a0l, RegName::a1l}, {RegName::a1l, RegName::a0l},
-            {RegName::b0l, RegName::b1l}, {RegName::b1l, RegName::b0l},
-            {RegName::a0h, RegName::a1h}, {RegName::a1h, RegName::a0h},
-            {RegName::b0h, RegName::b1h}, {RegName::b1h, RegName::b0h},
-            {RegName::a0e, RegName::a1e}, {RegName::a1e, RegName::a0e},
-            {RegName::b0e, RegName::b1e}, {RegName::b1e, RegName::b0e},
-        };
-        return map.at(in);
+        return CounterAccTable[static_cast<std::size_t>(in)];
     }
 
     const std::vector<Matcher<Interpreter>> decoders = GetDecoderTable<Interpreter>();
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <mutex>
+#include <optional>
+#include "common_types.h"
+#include "icu.h"
+#include "teakra/stats.h"
+
+namespace Teakra {
+
+/**
+ * Measures the DSP cycles between an IRQ being raised on the ICU and the processor vectoring to
+ * the interrupt handler that services it. The first trigger of an IRQ is kept until serviced, or
+ * until the firmware acknowledges the IRQ on the ICU without taking the interrupt. Triggers not
+ * routed to any interrupt can't be serviced and are not kept.
+ */
+class InterruptLatency {
+public:
+    static constexpr u32 VectoredInterrupt = 3;
+
+    explicit InterruptLatency(ICU& icu) : icu(icu) {
+        icu.SetAcknowledgeObserver([this](u16 irq_bits) { Acknowledge(irq_bits); });
+    }
+
+    void Trigger(u32 irq, u64 now) {
+        if (!((icu.GetRouted() >> irq) & 1)) {
+            return;
+        }
+        std::lock_guard lock(mutex);
+        if (!pending_since[irq]) {
+            pending_since[irq] = now;
+        }
+    }
+
+    // Polled IRQs are acknowledged without being serviced; those serviced are already cleared
+    void Acknowledge(u16 irq_bits) {
+        std::lock_guard lock(mutex);
+        for (u32 irq = 0; irq < pending_since.size(); ++irq) {
+            if ((irq_bits >> irq) & 1) {
+                pending_since[irq].reset();
+            }
+        }
+    }
+
+    // interrupt is 0-2 for the regular interrupt lines, or VectoredInterrupt
+    void Service(u32 interrupt, u64 now) {
+        const u16 routed = interrupt == VectoredInterrupt ? icu.GetEnableVectored()
+                                                          : icu.GetEnable(interrupt);
+        std::lock_guard lock(mutex);
+        for (u32 irq = 0; irq < pending_since.size(); ++irq) {
+            if (!pending_since[irq] || !((routed >> irq) & 1)) {
+                continue;
+            }
+            const auto source = interrupt == VectoredInterrupt ? InterruptSource::Vectored
+                                                               : SourceOf(irq);
+            if (source != InterruptSource::Count) {
+                Record(stats.latency[static_cast<std::size_t>(source)], now - *pending_since[irq]);
+            }
+            pending_since[irq].reset();
+        }
+    }
+
+    InterruptStats GetStats() const {
+        std::lock_guard lock(mutex);
+        return stats;
+    }
+
+private:
+    static InterruptSource SourceOf(u32 irq) {
+        switch (irq) {
+        case 0xA:
+            return InterruptSource::Timer0;
+        case 0x9:
+            return InterruptSource::Timer1;
+        case 0xE:
+            return InterruptSource::Apbp;
+        case 0xB:
+            return InterruptSource::Btdmp;
+        case 0xF:
+            return InterruptSource::Dma;
+        default:
+            return InterruptSource::Count;
+        }
+    }
+
+    static void Record(LatencyHistogram& histogram, u64 cycles) {
+        const std::size_t bucket = std::min<std::size_t>(std::bit_width(cycles),
+                                                         histogram.buckets.size() - 1);
+        ++histogram.buckets[bucket];
+        ++histogram.count;
+        histogram.total_cycles += cycles;
+        histogram.max_cycles = std::max(histogram.max_cycles, cycles);
+    }
+
+    ICU& icu;
+    mutable std::mutex mutex;
+    std::array<std::optional<u64>, 16> pending_since{};
+    InterruptStats stats;
+};
+
+} // namespace Teakra
@@ -0,0 +1,666 @@
+#include <array>
+#include <cinttypes>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include "../ahbm.h"
+#include "../apbp.h"
+#include "../btdmp.h"
+#include "../core_timing.h"
+#include "../decoder.h"
+#include "../dma.h"
+#include "../icu.h"
+#include "../interpreter.h"
+#include "../jit_no_ir.h"
+#include "../memory_interface.h"
+#include "../mmio.h"
+#include "../shared_memory.h"
+#include "../timer.h"
+
+// Differential fuzzer for the JIT. An input is turned into an initial register state, a data
+// memory image, a short program and optionally an interrupt handler. The program runs on the
+// interpreter and on the JIT, each with a private core, and all architectural state and memory
+// are compared once both have halted.
+//
+// Only inputs the interpreter can run are compared. Inputs are dropped when the interpreter hits
+// unimplemented behaviour, touches MMIO (the peripherals are not part of the comparison) or does
+// not halt within the budget, and when the JIT stops in front of an instruction it cannot compile.
+//
+// Interrupts are only raised once both backends have halted: the JIT checks for interrupts
+// between blocks and the interpreter after every instruction, so anything earlier would compare
+// the block boundaries rather than the instructions. The input picks whether the interrupt
+// switches context, through ic for interrupts 0-2 or the vectored interrupt's own flag.
+//
+// Built with TEAKRA_LIBFUZZER this is a libFuzzer target. Otherwise it runs the given input
+// files, or generates random inputs from a seed.
+
+namespace {
+
+// brr 0xffff always: jumps to itself, which both backends treat as idle
+constexpr u16 Halt = 0x57F0;
+constexpr u32 ProgramStart = 0x0100;
+constexpr std::size_t MaxProgramWords = 64;
+constexpr u32 HandlerStart = ProgramStart + MaxProgramWords;
+// br HandlerStart always, placed at the interrupt vectors. Keeping code away from address 0
+// means relative branches cannot take pc below it.
+constexpr u16 BranchToHandler = 0x4180;
+constexpr u32 ProgramWords = 0x20000;
+constexpr u32 MemoryWords = 0x40000;
+// Halts past the end of memory, for programs running or branching off it. The JIT cannot run
+// there, so inputs ending up in it are dropped.
+constexpr u32 PaddingWords = 0x100;
+constexpr std::size_t MemoryBytes = (MemoryWords + PaddingWords) * 2;
+constexpr u64 InterpreterBudget = 4096;
+// The JIT ticks whole blocks even when it leaves them early, so give it some slack
+constexpr u64 JitBudget = InterpreterBudget * 16;
+
+void Append(std::string& out, const char* format, ...) {
+    char buffer[256];
+    va_list args;
+    va_start(args, format);
+    std::vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    out += buffer;
+}
+
+// Reads the input as little endian words, zero past its end
+class Reader {
+public:
+    Reader(const u8* data, std::size_t size) : data(data), size(size) {}
+
+    u16 Next() {
+        u16 value = 0;
+        if (pos < size) {
+            value = data[pos++];
+        }
+        if (pos < size) {
+            value |= data[pos++] << 8;
+        }
+        return value;
+    }
+
+    std::size_t Remaining() const {
+        return (size - pos) / 2;
+    }
+
+private:
+    const u8* data;
+    std::size_t size;
+    std::size_t pos = 0;
+};
+
+struct Input {
+    std::array<u64, 2> a, b;
+    std::array<u32, 2> p;
+    std::array<u16, 8> r;
+    std::array<u16, 2> x, y;
+    u16 stepi0, stepj0, mixp, sv, sp, repc, lc;
+    u16 cfgi, cfgj, stt0, stt1, stt2, mod0, mod1, mod2;
+    std::array<u16, 2> ar;
+    std::array<u16, 4> arp;
+    u32 memory_seed;
+    // 0-2: interrupt 0-2, 3: vectored interrupt, otherwise none
+    u16 interrupt;
+    // the interrupt stores the context on entry
+    bool context_switch;
+    std::vector<u16> handler;
+    std::vector<u16> program;
+};
+
+Input Parse(const u8* data, std::size_t size) {
+    Reader in(data, size);
+    Input input;
+    auto acc = [&] {
+        const u64 low = in.Next();
+        const u64 mid = in.Next();
+        const u64 high = in.Next();
+        return SignExtend<40>(low | mid << 16 | (high & 0xFF) << 32);
+    };
+    auto product = [&] {
+        const u32 low = in.Next();
+        return low | static_cast<u32>(in.Next()) << 16;
+    };
+    input.a = {acc(), acc()};
+    input.b = {acc(), acc()};
+    input.p = {product(), product()};
+    for (u16& r : input.r) {
+        r = in.Next();
+    }
+    input.x = {in.Next(), in.Next()};
+    input.y = {in.Next(), in.Next()};
+    input.stepi0 = in.Next();
+    input.stepj0 = in.Next();
+    input.mixp = in.Next();
+    input.sv = in.Next();
+    input.sp = in.Next();
+    input.repc = in.Next();
+    input.lc = in.Next();
+    input.cfgi = in.Next();
+    input.cfgj = in.Next();
+    input.stt0 = in.Next();
+    input.stt1 = in.Next();
+    input.stt2 = in.Next();
+    input.mod0 = in.Next();
+    input.mod1 = in.Next();
+    input.mod2 = in.Next();
+    input.ar = {in.Next(), in.Next()};
+    input.arp = {in.Next(), in.Next(), in.Next(), in.Next()};
+    input.memory_seed = in.Next();
+    input.memory_seed |= static_cast<u32>(in.Next()) << 16;
+    const u16 control = in.Next();
+    input.interrupt = control & 7;
+    input.context_switch = (control >> 7) & 1;
+    const std::size_t handler_words = std::min<std::size_t>((control >> 3) & 0xF, in.Remaining());
+    for (std::size_t i = 0; i < handler_words; ++i) {
+        input.handler.push_back(in.Next());
+    }
+    while (in.Remaining() != 0 && input.program.size() < MaxProgramWords) {
+        input.program.push_back(in.Next());
+    }
+    return input;
+}
+
+// Teakra keeps prpage at zero, and a program switching it away would run off program memory
+bool ChangesProgramPage(u16 word) {
+    static const std::vector<bool> table = [] {
+        const auto decoders = GetDecoderTable<Teakra::Interpreter>();
+        std::vector<bool> result(decoders.size());
+        for (std::size_t i = 0; i < decoders.size(); ++i) {
+            const char* name = decoders[i].GetName();
+            result[i] =
+                std::strcmp(name, "mov_prpage") == 0 || std::strcmp(name, "pop_prpage") == 0;
+        }
+        return result;
+    }();
+    return table[word];
+}
+
+u16 Sanitize(u16 word) {
+    return ChangesProgramPage(word) ? 0 : word;
+}
+
+struct MmioAccess {};
+
+void BuildImage(const Input& input, std::vector<u8>& image) {
+    Teakra::SharedMemory shared_memory{image.data()};
+    for (u32 address = 0; address < ProgramWords; ++address) {
+        shared_memory.WriteWord(address, Halt);
+    }
+    for (std::size_t i = 0; i < input.program.size(); ++i) {
+        shared_memory.WriteWord(ProgramStart + i, Sanitize(input.program[i]));
+    }
+    for (std::size_t i = 0; i < input.handler.size(); ++i) {
+        shared_memory.WriteWord(HandlerStart + i, Sanitize(input.handler[i]));
+    }
+    if (input.interrupt < 3) {
+        shared_memory.WriteWord(0x0006 + input.interrupt * 8, BranchToHandler);
+        shared_memory.WriteWord(0x0007 + input.interrupt * 8, HandlerStart);
+    }
+
+    // xorshift32, which must not start from zero
+    u32 state = input.memory_seed | 1;
+    for (u32 address = ProgramWords; address < MemoryWords; ++address) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        shared_memory.WriteWord(address, Sanitize(static_cast<u16>(state)));
+    }
+    for (u32 address = MemoryWords; address < MemoryWords + PaddingWords; ++address) {
+        shared_memory.WriteWord(address, Halt);
+    }
+}
+
+// One emulated core per backend, wired up the same way as Teakra::Impl.
+struct Core {
+    std::vector<u8> dsp_memory = std::vector<u8>(MemoryBytes);
+    std::array<Teakra::Timer, 2> timer{};
+    std::array<Teakra::Btdmp, 2> btdmp{};
+    Teakra::CoreTiming core_timing{timer, btdmp};
+    Teakra::SharedMemory shared_memory{dsp_memory.data()};
+    Teakra::MemoryInterfaceUnit miu;
+    Teakra::ICU icu;
+    Teakra::Apbp apbp_from_cpu, apbp_from_dsp;
+    Teakra::Ahbm ahbm;
+    Teakra::Dma dma{shared_memory, ahbm};
+    Teakra::MMIORegion mmio{miu, icu, apbp_from_cpu, apbp_from_dsp, timer, dma, ahbm, btdmp};
+    Teakra::MemoryInterface memory_interface{shared_memory, miu, mmio};
+};
+
+void LoadInterpreter(Teakra::RegisterState& regs, const Input& input) {
+    regs.Reset();
+    regs.pc = ProgramStart;
+    regs.a = input.a;
+    regs.b = input.b;
+    regs.p = input.p;
+    regs.r = input.r;
+    regs.x = input.x;
+    regs.y = input.y;
+    regs.stepi0 = input.stepi0;
+    regs.stepj0 = input.stepj0;
+    regs.mixp = input.mixp;
+    regs.sv = input.sv;
+    regs.sp = input.sp;
+    regs.repc = input.repc;
+    regs.Lc() = input.lc;
+    regs.Set<Teakra::cfgi>(input.cfgi);
+    regs.Set<Teakra::cfgj>(input.cfgj);
+    regs.Set<Teakra::stt0>(input.stt0);
+    regs.Set<Teakra::stt1>(input.stt1);
+    // Only the program memory page; the loop and interrupt state is not loaded into the JIT
+    regs.Set<Teakra::stt2>(input.stt2 & 0x00C0);
+    regs.Set<Teakra::mod0>(input.mod0);
+    regs.Set<Teakra::mod1>(input.mod1);
+    regs.Set<Teakra::mod2>(input.mod2);
+    regs.Set<Teakra::ar0>(input.ar[0]);
+    regs.Set<Teakra::ar1>(input.ar[1]);
+    regs.Set<Teakra::arp0>(input.arp[0]);
+    regs.Set<Teakra::arp1>(input.arp[1]);
+    regs.Set<Teakra::arp2>(input.arp[2]);
+    regs.Set<Teakra::arp3>(input.arp[3]);
+}
+
+// Loads the JIT from the interpreter state, after the register setters have dropped the bits
+// they do not keep.
+void LoadJit(Teakra::JitRegisters& jregs, Teakra::RegisterState& regs) {
+    jregs.Reset();
+    jregs.pc = regs.pc;
+    jregs.a = regs.a;
+    jregs.b = regs.b;
+    jregs.p = regs.p;
+    jregs.pe = regs.pe;
+    jregs.r = regs.r;
+    jregs.x = regs.x;
+    jregs.y = regs.y;
+    jregs.stepi0 = regs.stepi0;
+    jregs.stepj0 = regs.stepj0;
+    jregs.mixp = regs.mixp;
+    jregs.sv = regs.sv;
+    jregs.sp = regs.sp;
+    jregs.repc = regs.repc;
+    jregs.bkrep_stack[0].lc = regs.bkrep_stack[0].lc;
+    jregs.pcmhi = regs.pcmhi;
+    jregs.flags.fr.Assign(regs.fr);
+    jregs.flags.flm.Assign(regs.flm);
+    jregs.flags.fvl.Assign(regs.fvl);
+    jregs.flags.fe.Assign(regs.fe);
+    jregs.flags.fc0.Assign(regs.fc0);
+    jregs.flags.fv.Assign(regs.fv);
+    jregs.flags.fn.Assign(regs.fn);
+    jregs.flags.fm.Assign(regs.fm);
+    jregs.flags.fz.Assign(regs.fz);
+    jregs.flags.fc1.Assign(regs.fc1);
+    jregs.cfgi.raw = regs.Get<Teakra::cfgi>();
+    jregs.cfgj.raw = regs.Get<Teakra::cfgj>();
+    jregs.mod0.raw = regs.Get<Teakra::mod0>();
+    jregs.mod1.raw = regs.Get<Teakra::mod1>();
+    jregs.mod2.raw = regs.Get<Teakra::mod2>();
+    jregs.ar[0].raw = regs.Get<Teakra::ar0>();
+    jregs.ar[1].raw = regs.Get<Teakra::ar1>();
+    jregs.arp[0].raw = regs.Get<Teakra::arp0>();
+    jregs.arp[1].raw = regs.Get<Teakra::arp1>();
+    jregs.arp[2].raw = regs.Get<Teakra::arp2>();
+    jregs.arp[3].raw = regs.Get<Teakra::arp3>();
+}
+
+bool Halted(Core& core, const Teakra::RegisterState& regs) {
+    if (regs.pc >= MemoryWords || core.shared_memory.ReadWord(regs.pc) != Halt || regs.rep) {
+        return false;
+    }
+    // A loop ending on the halt would still go around
+    return !(regs.lp && regs.bkrep_stack[regs.bcn - 1].end == regs.pc);
+}
+
+class Comparer {
+public:
+    explicit Comparer(std::string& log) : log(log) {}
+
+    template <typename T>
+    void Check(const char* name, T expected, T actual) {
+        if (expected != actual) {
+            Append(log, "Mismatch: %s: %" PRIX64 " != %" PRIX64 "\n", name,
+                   static_cast<u64>(expected), static_cast<u64>(actual));
+            pass = false;
+        }
+    }
+
+    template <typename T, std::size_t N>
+    void CheckArray(const char* name, const std::array<T, N>& expected,
+                    const std::array<T, N>& actual) {
+        for (std::size_t i = 0; i < N; ++i) {
+            const std::string element = std::string(name) + std::to_string(i);
+            Check<u64>(element.c_str(), expected[i], actual[i]);
+        }
+    }
+
+    bool pass = true;
+
+private:
+    std::string& log;
+};
+
+bool Compare(std::string& log, Teakra::RegisterState& regs, const Teakra::JitRegisters& jregs,
+             const Core& interpreter_core, const Core& jit_core) {
+    Comparer c(log);
+    c.Check<u32>("pc", regs.pc, jregs.pc);
+    c.Check<u16>("prpage", regs.prpage, jregs.prpage);
+    c.Check<u16>("repc", regs.repc, jregs.repc);
+    c.Check<u16>("repcs", regs.repcs, jregs.repcs);
+    c.Check<bool>("rep", regs.rep, jregs.rep);
+    c.Check<u16>("crep", regs.crep, jregs.crep);
+    c.Check<u16>("cpc", regs.cpc, jregs.cpc);
+    c.Check<u16>("bcn", regs.bcn, jregs.bcn);
+    c.Check<u16>("lp", regs.lp, jregs.lp);
+    c.Check<u16>("lc", regs.bkrep_stack[0].lc, jregs.bkrep_stack[0].lc);
+    for (u16 i = 0; i < std::min<u16>(regs.bcn, 4); ++i) {
+        const std::string frame = "bkrep" + std::to_string(i);
+        c.Check<u32>((frame + ".start").c_str(), regs.bkrep_stack[i].start,
+                     jregs.bkrep_stack[i].start);
+        c.Check<u32>((frame + ".end").c_str(), regs.bkrep_stack[i].end, jregs.bkrep_stack[i].end);
+        c.Check<u16>((frame + ".lc").c_str(), regs.bkrep_stack[i].lc, jregs.bkrep_stack[i].lc);
+    }
+    c.CheckArray("a", regs.a, jregs.a);
+    c.CheckArray("b", regs.b, jregs.b);
+    c.Check<u64>("a1s", regs.a1s, jregs.a1s);
+    c.Check<u64>("b1s", regs.b1s, jregs.b1s);
+    c.Check<u16>("ccnta", regs.ccnta, jregs.ccnta);
+    c.Check<u16>("sv", regs.sv, jregs.sv);
+    c.Check<u16>("vtr0", regs.vtr0, jregs.vtr0);
+    c.Check<u16>("vtr1", regs.vtr1, jregs.vtr1);
+    c.CheckArray("x", regs.x, jregs.x);
+    c.CheckArray("y", regs.y, jregs.y);
+    c.CheckArray("p", regs.p, jregs.p);
+    c.CheckArray("pe", regs.pe, jregs.pe);
+    c.Check<u16>("p0h_cbs", regs.p0h_cbs, jregs.p0h_cbs);
+    c.CheckArray("r", regs.r, jregs.r);
+    c.Check<u16>("mixp", regs.mixp, jregs.mixp);
+    c.Check<u16>("sp", regs.sp, jregs.sp);
+    c.Check<u16>("pcmhi", regs.pcmhi, jregs.pcmhi);
+    c.Check<u16>("r0b", regs.r0b, jregs.r0b);
+    c.Check<u16>("r1b", regs.r1b, jregs.r1b);
+    c.Check<u16>("r4b", regs.r4b, jregs.r4b);
+    c.Check<u16>("r7b", regs.r7b, jregs.r7b);
+    c.Check<u16>("stepi0", regs.stepi0, jregs.stepi0);
+    c.Check<u16>("stepj0", regs.stepj0, jregs.stepj0);
+    c.Check<u16>("stepi0b", regs.stepi0b, jregs.stepi0b);
+    c.Check<u16>("stepj0b", regs.stepj0b, jregs.stepj0b);
+    c.CheckArray("ip", regs.ip, jregs.ip);
+    c.Check<u16>("ipv", regs.ipv, jregs.ipv);
+    c.CheckArray("im", regs.im, jregs.im);
+    c.Check<u16>("imv", regs.imv, jregs.imv);
+    c.CheckArray("ic", regs.ic, jregs.ic);
+    c.Check<u16>("nimc", regs.nimc, jregs.nimc);
+    c.Check<u16>("ie", regs.ie, jregs.ie);
+    c.CheckArray("ou", regs.ou, jregs.ou);
+    c.Check<u16>("fr", regs.fr, jregs.flags.fr);
+    c.Check<u16>("flm", regs.flm, jregs.flags.flm);
+    c.Check<u16>("fvl", regs.fvl, jregs.flags.fvl);
+    c.Check<u16>("fe", regs.fe, jregs.flags.fe);
+    c.Check<u16>("fc0", regs.fc0, jregs.flags.fc0);
+    c.Check<u16>("fv", regs.fv, jregs.flags.fv);
+    c.Check<u16>("fn", regs.fn, jregs.flags.fn);
+    c.Check<u16>("fm", regs.fm, jregs.flags.fm);
+    c.Check<u16>("fz", regs.fz, jregs.flags.fz);
+    c.Check<u16>("fc1", regs.fc1, jregs.flags.fc1);
+    c.Check<u16>("cfgi", regs.Get<Teakra::cfgi>(), jregs.cfgi.raw);
+    c.Check<u16>("cfgj", regs.Get<Teakra::cfgj>(), jregs.cfgj.raw);
+    c.Check<u16>("mod0", regs.Get<Teakra::mod0>(), jregs.mod0.raw);
+    c.Check<u16>("mod1", regs.Get<Teakra::mod1>(), jregs.mod1.raw);
+    c.Check<u16>("mod2", regs.Get<Teakra::mod2>(), jregs.mod2.raw);
+    c.Check<u16>("ar0", regs.Get<Teakra::ar0>(), jregs.ar[0].raw);
+    c.Check<u16>("ar1", regs.Get<Teakra::ar1>(), jregs.ar[1].raw);
+    c.Check<u16>("arp0", regs.Get<Teakra::arp0>(), jregs.arp[0].raw);
+    c.Check<u16>("arp1", regs.Get<Teakra::arp1>(), jregs.arp[1].raw);
+    c.Check<u16>("arp2", regs.Get<Teakra::arp2>(), jregs.arp[2].raw);
+    c.Check<u16>("arp3", regs.Get<Teakra::arp3>(), jregs.arp[3].raw);
+
+    // Program and data memory, compared in place of going through the MMIO window
+    if (interpreter_core.dsp_memory == jit_core.dsp_memory) {
+        return c.pass;
+    }
+    std::size_t reported = 0;
+    for (u32 address = 0; address < MemoryWords; ++address) {
+        const u16 expected = interpreter_core.shared_memory.ReadWord(address);
+        const u16 actual = jit_core.shared_memory.ReadWord(address);
+        if (expected != actual) {
+            if (reported++ < 16) {
+                Append(log, "Mismatch: memory %05X: %04X != %04X\n", address, expected, actual);
+            }
+            c.pass = false;
+        }
+    }
+    if (reported > 16) {
+        Append(log, "... %zu memory words differ\n", reported);
+    }
+    return c.pass;
+}
+
+enum class Outcome { Passed, Failed, Rejected };
+
+class Fuzzer {
+public:
+    Fuzzer() {
+        // Nothing tracks the peripherals' state, so inputs driving them are not comparable
+        interpreter_core.memory_interface.AddWatchpoint(
+            0x8000, 0x8000 + Teakra::MemoryInterfaceUnit::MMIOSize - 1,
+            Teakra::MemoryInterface::WatchRead | Teakra::MemoryInterface::WatchWrite,
+            [](u32, u16, u16, bool) { throw MmioAccess{}; });
+    }
+
+    Outcome Run(const u8* data, std::size_t size, std::string& log) {
+        const Input input = Parse(data, size);
+        if (input.program.empty()) {
+            return Outcome::Rejected;
+        }
+
+        BuildImage(input, image);
+        std::memcpy(interpreter_core.dsp_memory.data(), image.data(), MemoryBytes);
+        std::memcpy(jit_core.dsp_memory.data(), image.data(), MemoryBytes);
+        LoadInterpreter(regs, input);
+        jit.Reset();
+        LoadJit(jregs, regs);
+
+        if (!RunInterpreter() || !RunJit()) {
+            return Outcome::Rejected;
+        }
+        if (!Compare(log, regs, jregs, interpreter_core, jit_core)) {
+            log += "after the program\n";
+            return Outcome::Failed;
+        }
+
+        if (input.interrupt > 3) {
+            return Outcome::Passed;
+        }
+        // Each backend is only signalled right before it runs, so a rejected input leaves no
+        // interrupt pending for the next one
+        RaiseInterpreterInterrupt(input.interrupt, input.context_switch);
+        if (!RunInterpreter()) {
+            return Outcome::Passed;
+        }
+        RaiseJitInterrupt(input.interrupt, input.context_switch);
+        if (!RunJit()) {
+            return Outcome::Passed;
+        }
+        if (!Compare(log, regs, jregs, interpreter_core, jit_core)) {
+            log += "after the interrupt handler\n";
+            return Outcome::Failed;
+        }
+        return Outcome::Passed;
+    }
+
+private:
+    bool RunInterpreter() {
+        try {
+            interpreter.Run(InterpreterBudget);
+        } catch (const Teakra::UnimplementedException&) {
+            return false;
+        } catch (const MmioAccess&) {
+            return false;
+        }
+        return Halted(interpreter_core, regs);
+    }
+
+    bool RunJit() {
+        jit.Run(JitBudget);
+        return !jit.unimplemented;
+    }
+
+    void RaiseInterpreterInterrupt(u16 interrupt, bool context_switch) {
+        regs.ie = 1;
+        regs.ic = {};
+        if (interrupt < 3) {
+            regs.im[interrupt] = 1;
+            regs.ic[interrupt] = context_switch;
+            interpreter.SignalInterrupt(interrupt);
+        } else {
+            regs.imv = 1;
+            interpreter.SignalVectoredInterrupt(HandlerStart, context_switch);
+        }
+    }
+
+    void RaiseJitInterrupt(u16 interrupt, bool context_switch) {
+        jregs.ie = 1;
+        jregs.ic = {};
+        if (interrupt < 3) {
+            jregs.im[interrupt] = 1;
+            jregs.ic[interrupt] = context_switch;
+            jit.SignalInterrupt(interrupt);
+        } else {
+            jregs.imv = 1;
+            jit.SignalVectoredInterrupt(HandlerStart, context_switch);
+        }
+    }
+
+    std::vector<u8> image = std::vector<u8>(MemoryBytes);
+    Core interpreter_core;
+    Core jit_core;
+    Teakra::RegisterState regs;
+    Teakra::Interpreter interpreter{interpreter_core.core_timing, regs,
+                                    interpreter_core.memory_interface};
+    Teakra::JitRegisters jregs;
+    Teakra::EmitX64 jit{jit_core.core_timing, jregs, jit_core.memory_interface};
+};
+
+Fuzzer& GetFuzzer() {
+    static Fuzzer fuzzer;
+    return fuzzer;
+}
+
+} // Anonymous namespace
+
+#ifdef TEAKRA_LIBFUZZER
+
+extern "C" int LLVMFuzzerTestOneInput(const u8* data, std::size_t size) {
+    std::string log;
+    if (GetFuzzer().Run(data, size, log) == Outcome::Failed) {
+        std::fputs(log.c_str(), stderr);
+        std::abort();
+    }
+    return 0;
+}
+
+#else
+
+namespace {
+
+bool ReadFile(const char* path, std::vector<u8>& out) {
+    std::FILE* file = std::fopen(path, "rb");
+    if (!file) {
+        return false;
+    }
+    u8 buffer[4096];
+    std::size_t read;
+    while ((read = std::fread(buffer, 1, sizeof(buffer), file)) != 0) {
+        out.insert(out.end(), buffer, buffer + read);
+    }
+    std::fclose(file);
+    return true;
+}
+
+bool WriteFile(const char* path, const std::vector<u8>& data) {
+    std::FILE* file = std::fopen(path, "wb");
+    if (!file) {
+        return false;
+    }
+    const bool ok = std::fwrite(data.data(), 1, data.size(), file) == data.size();
+    return std::fclose(file) == 0 && ok;
+}
+
+} // Anonymous namespace
+
+int main(int argc, char** argv) {
+    u64 seed = std::random_device{}();
+    u64 iterations = 100000;
+    std::vector<const char*> files;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            seed = std::strtoull(argv[++i], nullptr, 0);
+        } else if (std::strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            iterations = std::strtoull(argv[++i], nullptr, 0);
+        } else {
+            files.push_back(argv[i]);
+        }
+    }
+
+    Fuzzer& fuzzer = GetFuzzer();
+    std::string log;
+
+    if (!files.empty()) {
+        int result = 0;
+        for (const char* path : files) {
+            std::vector<u8> data;
+            if (!ReadFile(path, data)) {
+                std::fprintf(stderr, "Unable to open file %s. Exiting...\n", path);
+                return -2;
+            }
+            log.clear();
+            const Outcome outcome = fuzzer.Run(data.data(), data.size(), log);
+            std::printf("%s: %s\n%s", path,
+                        outcome == Outcome::Passed   ? "passed"
+                        : outcome == Outcome::Failed ? "FAILED"
+                                                     : "rejected",
+                        log.c_str());
+            if (outcome == Outcome::Failed) {
+                result = 1;
+            }
+        }
+        return result;
+    }
+
+    std::printf("seed: %" PRIu64 "\n", seed);
+    std::mt19937_64 gen(seed);
+    std::uniform_int_distribution<std::size_t> length_dist(40, 160);
+    std::uniform_int_distribution<u16> word_dist;
+    std::size_t passed = 0, rejected = 0;
+    for (u64 i = 0; i < iterations; ++i) {
+        std::vector<u8> data(length_dist(gen) * 2);
+        for (std::size_t j = 0; j < data.size(); j += 2) {
+            const u16 word = word_dist(gen);
+            data[j] = static_cast<u8>(word);
+            data[j + 1] = static_cast<u8>(word >> 8);
+        }
+        log.clear();
+        const Outcome outcome = fuzzer.Run(data.data(), data.size(), log);
+        if (outcome == Outcome::Rejected) {
+            ++rejected;
+            continue;
+        }
+        if (outcome == Outcome::Passed) {
+            ++passed;
+            continue;
+        }
+        const std::string path = "jit_fuzzer-" + std::to_string(seed) + "-" + std::to_string(i);
+        std::printf("Input %" PRIu64 " failed, saved to %s\n%s", i, path.c_str(), log.c_str());
+        if (!WriteFile(path.c_str(), data)) {
+            std::fprintf(stderr, "Unable to write file %s\n", path.c_str());
+        }
+        return 1;
+    }
+    std::printf("%zu passed, %zu rejected\n", passed, rejected);
+    return 0;
+}
+
+#endif
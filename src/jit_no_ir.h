@@ -1,15 +1,18 @@
 #pragma once
 #include "shared_memory.h"
+#include <algorithm>
 #include <utility>
 #include <atomic>
+#include <chrono>
 #include <tuple>
 #include <optional>
 #include <type_traits>
 #include <unordered_map>
 #include <unordered_set>
 #include <xbyak/xbyak.h>
+#include <xbyak/xbyak_util.h>
 #include "bit.h"
-#include <set>
+#include "call_profiler.h"
 #include <stack>
 #include "core_timing.h"
 #include "memory_interface.h"
@@ -18,7 +21,9 @@
 #include "hash.h"
 #include "mmio.h"
 #include "jit_regs.h"
+#include "lockstep.h"
 #include "register.h"
+#include "teakra/stats.h"
 #include "xbyak_abi.h"
 
 #ifdef WIN32
@@ -45,8 +50,20 @@ std::string Do(std::uint16_t opcode, std::uint16_t expansion = 0,
 namespace Teakra {
 
 constexpr size_t MAX_CODE_SIZE = 256 * 1024 * 1024;
-
-#define NOT_IMPLEMENTED() UNREACHABLE()
+// Unlikely paths are emitted into the far code region at the end of the buffer, so the near
+// code of each block is a short, contiguous hot path.
+constexpr size_t FAR_CODE_OFFSET = MAX_CODE_SIZE / 4 * 3;
+// The most executed blocks are periodically compiled again into the hot region in front of the
+// far code, see RelayoutHotBlocks. Each relayout overwrites the previous one, along with its
+// far code, which lives in a region of its own at the end of the buffer.
+constexpr size_t HOT_CODE_OFFSET = FAR_CODE_OFFSET - 16 * 1024 * 1024;
+constexpr size_t HOT_FAR_CODE_OFFSET = MAX_CODE_SIZE - 16 * 1024 * 1024;
+// Room left in both regions before compiling a block, or the cache is cleared
+constexpr size_t MAX_BLOCK_CODE_SIZE = 1024 * 1024;
+
+// Thrown while compiling a block; LookupBlock stops the run in front of that block and sets
+// `unimplemented` so the caller can decide what to do with it.
+#define NOT_IMPLEMENTED() throw UnimplementedException()
 
 struct alignas(16) StackLayout {
     s64 cycles_remaining;
@@ -58,12 +75,17 @@ class EmitX64 {
     static constexpr size_t BlockCacheSize = 1ULL << 18;
 public:
     EmitX64(CoreTiming& core_timing, JitRegisters& regs, MemoryInterface& mem)
-        : core_timing(core_timing), regs(regs), mem(mem), c(MAX_CODE_SIZE) {
+        : core_timing(core_timing), regs(regs), mem(mem), c(MAX_CODE_SIZE),
+          host_tier(DetectCpuTier()) {
+        cpu_tier = std::min(host_tier, JitCpuTier::Bmi2);
+        compile_stats.cpu_tier = cpu_tier;
         block_cache = std::make_unique<BlockList[]>(BlockCacheSize);
         auto& miu = mem.memory_interface_unit;
         miu.SetOffsets(&regs.x_offset, &regs.y_offset, &regs.z_offset);
         miu.SetPageMode(&regs.page_mode);
         miu.SetMmioBase(&regs.mmio_base);
+        mem.SetWatchPages(regs.watch_pages.data());
+        cache_watch_generation = mem.watch_generation;
         EmitDispatcher();
     }
 
@@ -89,7 +111,7 @@ public:
         Cfg cfgib, cfgjb;
         u16 stepi0b, stepj0b;
         u32 pc;
-        u32 pad;
+        u32 watch_generation;
 
         FORCE_INLINE bool operator==(const BlockKey& other) const {
             return std::memcmp(this, &other, sizeof(BlockKey)) == 0;
@@ -101,6 +123,30 @@ public:
     struct Block {
         BlockFunc func;
         s32 cycles;
+        // Cleared for context switching blocks, whose shadows the lockstep interpreter can't load
+        bool verifiable = true;
+        // Entry of the block's original code, for when func points into the hot region
+        BlockFunc near_func{};
+        // Dispatches since the last relayout
+        u32 executions = 0;
+    };
+
+    // Dense set over the 18-bit program address space. Lookups take any u32, as callers probe
+    // pc - 1 at pc 0.
+    struct PcBitmap {
+        static constexpr u32 Size = 1 << 18;
+        std::array<u64, Size / 64> bits{};
+
+        void insert(u32 pc) {
+            ASSERT(pc < Size);
+            bits[pc >> 6] |= 1ULL << (pc & 63);
+        }
+        bool contains(u32 pc) const {
+            return pc < Size && ((bits[pc >> 6] >> (pc & 63)) & 1);
+        }
+        void clear() {
+            bits.fill(0);
+        }
     };
 
     enum JitStatus {
@@ -113,11 +159,21 @@ public:
     JitRegisters& regs;
     MemoryInterface& mem;
     Xbyak::CodeGenerator c;
+    // Highest tier the host supports, and the one code is generated for. The vector tiers are
+    // opt-in, see SetMaxCpuTier.
+    const JitCpuTier host_tier;
+    JitCpuTier cpu_tier;
+    // Emission offset of the region that is not currently being emitted to
+    std::size_t near_code_size = 0;
+    std::size_t far_code_size = FAR_CODE_OFFSET;
+    bool in_far_code = false;
     s32 cycles_remaining;
     Xbyak::Label block_exit;
+    // Emitted along with the dispatcher, indexed by interrupt line (3 = vectored)
+    std::array<BlockFunc, 4> interrupt_entries{};
     const std::vector<Matcher<EmitX64>> decoders = GetDecoderTable<EmitX64>();
-    std::set<u32> bkrep_end_locations;
-    std::set<u32> rep_end_locations;
+    PcBitmap bkrep_end_locations;
+    PcBitmap rep_end_locations;
     bool compiling = false;
     JitStatus status = JitStatus::Compiling;
     using BlockList = std::vector<std::pair<BlockKey, Block>>;
@@ -125,25 +181,141 @@ public:
     std::stack<u32> call_stack;
     Block* current_blk{};
     BlockKey blk_key{};
+    JitStats compile_stats{};
     bool unimplemented = false;
+    bool watching = false;
+    u32 cache_watch_generation = 0;
+    u32 inst_pc{};
+    CallProfiler* profiler = nullptr;
+    // Sampled verification against a shadow interpreter, see Lockstep
+    Lockstep* lockstep = nullptr;
+    u32 lockstep_countdown = 0;
+    bool lockstep_armed = false;
+    // Hot code relayout, see RelayoutHotBlocks
+    u32 relayout_interval = 0;
+    u32 relayout_blocks = 0;
+    u32 relayout_countdown = 0;
+    // Entry pcs of the blocks executed since the last relayout, in the order of their first run
+    std::vector<u32> executed_pcs;
+    PcBitmap executed_pc_set;
+    // Entry pcs of the blocks currently in the hot region
+    std::vector<u32> hot_pcs;
+    // Set when a divergence hands the rest of the run over to the interpreter. fallback_cycles
+    // is also set when an unimplemented instruction ends the run.
+    bool fallback = false;
+    s32 fallback_cycles = 0;
+    // Instructions of the block which ended the run as unimplemented, up to and including the
+    // one the JIT can't compile
+    u32 unimplemented_instructions = 0;
+    // Called on vectoring to interrupt 0-2, or 3 for the vectored interrupt. The offset is
+    // the number of cycles of the current block which have not been ticked yet.
+    std::function<void(u32 interrupt, u64 offset)> interrupt_service_handler;
 
     void Reset() {
         // Reset registers
         regs.Reset();
+        mem.SetWatchPages(regs.watch_pages.data());
 
         // Clear any program data from previous runs
-        block_cache = std::make_unique<BlockList[]>(BlockCacheSize);
         bkrep_end_locations.clear();
         rep_end_locations.clear();
+        ClearCache();
+    }
+
+    // Drops all compiled code. Loop end locations are kept, as they are only
+    // discovered when the loop instruction itself is compiled.
+    void ClearCache() {
+        block_cache = std::make_unique<BlockList[]>(BlockCacheSize);
+        cache_watch_generation = mem.watch_generation;
 
         // Reset code generator and emit the dispatcher again
         c.reset();
+        far_code_size = FAR_CODE_OFFSET;
+        executed_pcs.clear();
+        executed_pc_set.clear();
+        hot_pcs.clear();
         EmitDispatcher();
     }
 
+    static JitCpuTier DetectCpuTier() {
+        using Cpu = Xbyak::util::Cpu;
+        const Cpu cpu;
+        if (!cpu.has(Cpu::tBMI2) || !cpu.has(Cpu::tLZCNT)) {
+            return JitCpuTier::Baseline;
+        }
+        if (!cpu.has(Cpu::tAVX2)) {
+            return JitCpuTier::Bmi2;
+        }
+        if (!cpu.has(Cpu::tAVX512F) || !cpu.has(Cpu::tAVX512BW) || !cpu.has(Cpu::tAVX512VL)) {
+            return JitCpuTier::Avx2;
+        }
+        return JitCpuTier::Avx512;
+    }
+
+    // Caps the tier at `max_tier`, or lower if the host lacks it. Blocks already compiled for
+    // another tier are dropped.
+    void SetMaxCpuTier(JitCpuTier max_tier) {
+        const JitCpuTier tier = std::min(host_tier, max_tier);
+        if (tier == cpu_tier) {
+            return;
+        }
+        cpu_tier = tier;
+        compile_stats.cpu_tier = tier;
+        ClearCache();
+    }
+
+    bool HasBmi2() const {
+        return cpu_tier >= JitCpuTier::Bmi2;
+    }
+
+    bool HasAvx2() const {
+        return cpu_tier >= JitCpuTier::Avx2;
+    }
+
+    void Rorx(const Xbyak::Reg& dst, const Xbyak::Reg& src, u8 imm) {
+        JitRegisters::Rorx(c, dst, src, imm, HasBmi2());
+    }
+
+    void SwitchToFarCode() {
+        ASSERT(!in_far_code);
+        in_far_code = true;
+        near_code_size = c.getSize();
+        c.setSize(far_code_size);
+    }
+
+    void SwitchToNearCode() {
+        ASSERT(in_far_code);
+        in_far_code = false;
+        far_code_size = c.getSize();
+        c.setSize(near_code_size);
+    }
+
+    // Emits a cold path into the far code region. Near code branches to `entry` with T_NEAR,
+    // and the far code jumps back to `resume`, which the caller binds in near code.
+    template <typename F>
+    void EmitFarCode(Xbyak::Label& entry, const Xbyak::Label& resume, F&& emit) {
+        SwitchToFarCode();
+        c.L(entry);
+        emit();
+        c.jmp(resume, c.T_NEAR);
+        SwitchToNearCode();
+    }
+
+    // Drops the blocks starting at pc, for callers that rewrite program memory between runs.
+    // The code they occupied is only reclaimed once the buffer is half full.
+    void InvalidateBlocks(u32 pc) {
+        block_cache[pc].clear();
+        if (c.getSize() > HOT_CODE_OFFSET / 2) {
+            ClearCache();
+        }
+    }
+
     u32 Run(s64 cycles) {
         cycles_remaining = cycles;
         current_blk = nullptr;
+        unimplemented = false;
+        lockstep_armed = false;
+        fallback = false;
         regs.idle = false;
         run_code(this);
         return std::abs(cycles_remaining);
@@ -166,13 +338,89 @@ public:
         c.L(block_exit);
         c.mov(ABI_PARAM1, reinterpret_cast<uintptr_t>(this));
         CallFarFunction(c, DoInterruptsAndRunDebugThunk);
-        c.jmp(dispatcher_start);
+        // Run the entry of the interrupt taken, if any, which returns to the dispatcher
+        c.test(ABI_RETURN, ABI_RETURN);
+        c.jz(dispatcher_start);
+        c.mov(ABI_PARAM1, reinterpret_cast<uintptr_t>(&regs));
+        c.jmp(ABI_RETURN);
         c.L(dispatcher_end);
         ABI_PopRegistersAndAdjustStack(c, ABI_ALL_CALLEE_SAVED, 8, 16);
         c.ret();
+
+        // The entries record their own watch pc, the return address. Don't let the stores
+        // overwrite it with the pc of whichever block was compiled last.
+        const bool was_watching = watching;
+        watching = false;
+        for (u32 line = 0; line < interrupt_entries.size(); ++line) {
+            EmitInterruptEntry(line, dispatcher_start);
+        }
+        watching = was_watching;
         c.ready();
     }
 
+    // Emits the entry sequence of an interrupt line (3 = vectored): push pc, clear ie and the
+    // pending bit, store the context if the line asks for it, and jump to the vector. Entered
+    // like a block, with the register state in memory.
+    void EmitInterruptEntry(u32 line, const Xbyak::Label& dispatcher_start) {
+        interrupt_entries[line] = c.getCurr<BlockFunc>();
+        c.mov(REGS, ABI_PARAM1);
+
+        const Reg64 sp = rbx, pc = rcx, address = rdx, value = rax;
+        c.mov(pc.cvt32(), dword[REGS + offsetof(JitRegisters, pc)]);
+        // Watchpoints hit by the push report the return address
+        c.mov(rsi, reinterpret_cast<uintptr_t>(&mem.watch_pc_storage));
+        c.mov(dword[rsi], pc.cvt32());
+        c.movzx(sp, word[REGS + offsetof(JitRegisters, sp)]);
+        const auto push = [&](bool high) {
+            c.sub(sp.cvt16(), 1);
+            c.mov(address.cvt32(), sp.cvt32());
+            if (high) {
+                c.mov(value.cvt32(), pc.cvt32());
+                c.shr(value.cvt32(), 16);
+            } else {
+                c.movzx(value.cvt32(), pc.cvt16());
+            }
+            EmitStoreToMemory(address, value);
+        };
+        Xbyak::Label cpc_label, pushed_label;
+        c.test(word[REGS + offsetof(JitRegisters, cpc)], 0x1);
+        c.jnz(cpc_label, c.T_NEAR);
+        push(false);
+        push(true);
+        c.jmp(pushed_label, c.T_NEAR);
+        c.L(cpc_label);
+        push(true);
+        push(false);
+        c.L(pushed_label);
+        c.mov(word[REGS + offsetof(JitRegisters, sp)], sp.cvt16());
+
+        c.mov(word[REGS + offsetof(JitRegisters, ie)], 0);
+        c.mov(dword[REGS + offsetof(JitRegisters, idle)], 0);
+        Xbyak::Label end_label;
+        if (line < 3) {
+            c.mov(word[REGS + offsetof(JitRegisters, ip) + line * sizeof(u16)], 0);
+            c.mov(dword[REGS + offsetof(JitRegisters, pc)], 0x0006 + line * 8);
+            c.test(word[REGS + offsetof(JitRegisters, ic) + line * sizeof(u16)], 0x1);
+        } else {
+            c.mov(word[REGS + offsetof(JitRegisters, ipv)], 0);
+            c.mov(rax, reinterpret_cast<uintptr_t>(&vinterrupt_address));
+            c.mov(eax, dword[rax]);
+            c.mov(dword[REGS + offsetof(JitRegisters, pc)], eax);
+            c.mov(rax, reinterpret_cast<uintptr_t>(&vinterrupt_context_switch));
+            c.test(byte[rax], 0x1);
+        }
+        c.jz(end_label, c.T_NEAR);
+        c.mov(A[1], qword[REGS + offsetof(JitRegisters, a) + sizeof(u64)]);
+        c.mov(B[1], qword[REGS + offsetof(JitRegisters, b) + sizeof(u64)]);
+        c.mov(FLAGS, word[REGS + offsetof(JitRegisters, flags)]);
+        EmitContextStore();
+        c.mov(qword[REGS + offsetof(JitRegisters, a) + sizeof(u64)], A[1]);
+        c.mov(qword[REGS + offsetof(JitRegisters, b) + sizeof(u64)], B[1]);
+        c.mov(word[REGS + offsetof(JitRegisters, flags)], FLAGS.cvt16());
+        c.L(end_label);
+        c.jmp(dispatcher_start, c.T_NEAR);
+    }
+
     static BlockFunc LookupNewBlockThunk(void* this_ptr) {
         return reinterpret_cast<EmitX64*>(this_ptr)->LookupNewBlock();
     }
@@ -182,8 +430,14 @@ public:
             return nullptr;
         }
 
+        // Blocks of an older watch generation can never match again, so drop them
+        if (mem.watch_generation != cache_watch_generation) {
+            ClearCache();
+        }
+
         // State for bank exchange.
         blk_key.pc = regs.pc;
+        blk_key.watch_generation = mem.watch_generation;
         std::memcpy(&blk_key.cfgi, &regs.cfgi, sizeof(u16) * 8);
         // Current state
         std::memcpy(&blk_key.curr.mod1, &regs.mod1, sizeof(u16) * 3);
@@ -193,6 +447,9 @@ public:
         std::memcpy(&blk_key.shadow.arp, &regs.arpb, sizeof(regs.arpb) + sizeof(regs.arb));
 
         LookupBlock();
+        if (!current_blk) {
+            return nullptr;
+        }
 
         // Check if we are idle, and skip ahead
         if (regs.idle) {
@@ -218,55 +475,218 @@ public:
             vinterrupt_pending = false;
         }
 
+        if (lockstep && --lockstep_countdown == 0) {
+            lockstep_countdown = lockstep->NextInterval();
+            lockstep_armed =
+                current_blk->verifiable && lockstep->Checkpoint(regs, current_blk->cycles);
+            if (!lockstep_armed) {
+                ++compile_stats.lockstep_skipped;
+            }
+        }
+
+        if (relayout_interval != 0) {
+            if (current_blk->executions++ == 0 && !executed_pc_set.contains(regs.pc)) {
+                executed_pc_set.insert(regs.pc);
+                executed_pcs.push_back(regs.pc);
+            }
+            if (--relayout_countdown == 0) {
+                relayout_countdown = relayout_interval;
+                RelayoutHotBlocks();
+            }
+        }
+
         // Return the block function to execute.
         return current_blk->func;
     }
 
-    static void DoInterruptsAndRunDebugThunk(void* this_ptr) {
-        reinterpret_cast<EmitX64*>(this_ptr)->DoInterruptsAndRunDebug();
+    static BlockFunc DoInterruptsAndRunDebugThunk(void* this_ptr) {
+        return reinterpret_cast<EmitX64*>(this_ptr)->DoInterruptsAndRunDebug();
     }
 
     FORCE_INLINE void LookupBlock() {
-        auto& vec = block_cache[regs.pc];
-        for (auto& [key, block] : vec) {
+        for (auto& [key, block] : block_cache[regs.pc]) {
             if (key == blk_key) {
                 current_blk = &block;
                 return;
             }
         }
 
+        // Out of room for another block. The dispatcher calling us is emitted again at the same
+        // place, byte for byte, so it can still be returned to.
+        if (c.getSize() > HOT_CODE_OFFSET - MAX_BLOCK_CODE_SIZE ||
+            far_code_size > HOT_FAR_CODE_OFFSET - MAX_BLOCK_CODE_SIZE) {
+            ClearCache();
+        }
+
+        auto& vec = block_cache[regs.pc];
         auto& [key, blk] = vec.emplace_back();
         key = blk_key;
         current_blk = &blk;
-        CompileBlock(blk);
+        const std::size_t code_start = c.getSize();
+        const std::size_t far_code_start = far_code_size;
+        try {
+            CompileBlock(blk);
+        } catch (const UnimplementedException&) {
+            // Compiling moves regs.pc along, so rewind to the block entry and end the run there,
+            // dropping the code emitted so far. The caller interprets the block.
+            if (in_far_code) {
+                SwitchToNearCode();
+            }
+            c.setSize(code_start);
+            far_code_size = far_code_start;
+            unimplemented_instructions = blk.cycles + 1;
+            vec.pop_back();
+            current_blk = nullptr;
+            compiling = false;
+            regs.pc = blk_key.pc;
+            fallback_cycles = static_cast<s32>(std::max<s64>(cycles_remaining, 0));
+            cycles_remaining = 0;
+            unimplemented = true;
+        }
         //printf("Compiling block at 0x%x with size = %d\n", blk_key.pc, blk.cycles);
     }
 
-    void DoInterruptsAndRunDebug() {
+    // Compiles the blocks executed most since the last relayout once more, back to back into
+    // the hot region and in the order they first ran, which tends to follow the control flow of
+    // the hot loop. Their far code is emitted again as well, into the hot far region. Blocks
+    // whose loop ends changed since they were compiled would come out a different length, and
+    // keep their original code. There is no block linking, so
+    // repointing the cache entries between two dispatches swaps the code over atomically.
+    void RelayoutHotBlocks() {
+        struct Candidate {
+            u32 executions;
+            u32 order;
+            u32 pc;
+            std::size_t index;
+        };
+        std::vector<Candidate> candidates;
+        for (u32 order = 0; order < executed_pcs.size(); ++order) {
+            const u32 pc = executed_pcs[order];
+            auto& vec = block_cache[pc];
+            for (std::size_t i = 0; i < vec.size(); ++i) {
+                if (vec[i].second.executions != 0) {
+                    candidates.push_back({vec[i].second.executions, order, pc, i});
+                }
+            }
+        }
+        if (candidates.size() > relayout_blocks) {
+            std::nth_element(candidates.begin(), candidates.begin() + relayout_blocks,
+                             candidates.end(), [](const Candidate& a, const Candidate& b) {
+                                 return a.executions > b.executions;
+                             });
+            candidates.resize(relayout_blocks);
+        }
+        std::sort(candidates.begin(), candidates.end(),
+                  [](const Candidate& a, const Candidate& b) {
+                      return a.order != b.order ? a.order < b.order : a.index < b.index;
+                  });
+
+        // The previous hot code is overwritten, so send its blocks back to their near code
+        for (const u32 pc : hot_pcs) {
+            for (auto& [key, block] : block_cache[pc]) {
+                block.func = block.near_func;
+            }
+        }
+        hot_pcs.clear();
+
+        // Compiling uses the block key and moves regs.pc along
+        Block* const saved_blk = current_blk;
+        const BlockKey saved_key = blk_key;
+        const u32 saved_pc = regs.pc;
+        const std::size_t saved_near_size = c.getSize();
+        const std::size_t saved_far_size = far_code_size;
+        c.setSize(HOT_CODE_OFFSET);
+        far_code_size = HOT_FAR_CODE_OFFSET;
+
+        for (const Candidate& candidate : candidates) {
+            if (c.getSize() > FAR_CODE_OFFSET - MAX_BLOCK_CODE_SIZE ||
+                far_code_size > MAX_CODE_SIZE - MAX_BLOCK_CODE_SIZE) {
+                break;
+            }
+            auto& [key, blk] = block_cache[candidate.pc][candidate.index];
+            const std::size_t code_start = c.getSize();
+            const std::size_t far_code_start = far_code_size;
+            Block hot{};
+            blk_key = key;
+            regs.pc = candidate.pc;
+            current_blk = &hot;
+            try {
+                EmitBlock(hot);
+            } catch (const UnimplementedException&) {
+                if (in_far_code) {
+                    SwitchToNearCode();
+                }
+                compiling = false;
+                c.setSize(code_start);
+                far_code_size = far_code_start;
+                continue;
+            }
+            if (hot.cycles != blk.cycles || hot.verifiable != blk.verifiable) {
+                c.setSize(code_start);
+                far_code_size = far_code_start;
+                continue;
+            }
+            if (hot_pcs.empty() || hot_pcs.back() != candidate.pc) {
+                hot_pcs.push_back(candidate.pc);
+            }
+            blk.func = hot.func;
+            ++compile_stats.relayout_blocks;
+            compile_stats.relayout_bytes +=
+                c.getSize() - code_start + far_code_size - far_code_start;
+        }
+
+        c.setSize(saved_near_size);
+        far_code_size = saved_far_size;
+        current_blk = saved_blk;
+        blk_key = saved_key;
+        regs.pc = saved_pc;
+        ++compile_stats.relayouts;
+
+        // Start the next profile afresh, so it follows the firmware moving between phases
+        for (const u32 pc : executed_pcs) {
+            for (auto& [key, block] : block_cache[pc]) {
+                block.executions = 0;
+            }
+        }
+        executed_pcs.clear();
+        executed_pc_set.clear();
+    }
+
+    // Returns the entry of the interrupt to take, see EmitInterruptEntry
+    BlockFunc DoInterruptsAndRunDebug() {
+        if (lockstep_armed) {
+            lockstep_armed = false;
+            ++compile_stats.lockstep_samples;
+            if (!lockstep->Verify(regs)) {
+                ++compile_stats.lockstep_divergences;
+                if (lockstep->GetConfig().fallback_to_interpreter) {
+                    // End the run here and leave dispatching interrupts to the interpreter
+                    core_timing.Tick(current_blk->cycles);
+                    fallback_cycles = std::max(cycles_remaining - current_blk->cycles, 0);
+                    cycles_remaining = 0;
+                    fallback = true;
+                    return nullptr;
+                }
+            }
+        }
+
+        BlockFunc entry = nullptr;
         if (regs.ie && !regs.rep) {
-            bool interrupt_handled = false;
+            u32 line = 3;
             for (u32 i = 0; i < regs.im.size(); ++i) {
                 if (regs.im[i] && regs.ip[i]) {
-                    regs.ip[i] = 0;
-                    regs.ie = 0;
-                    PushPC();
-                    regs.pc = 0x0006 + i * 8;
-                    regs.idle = false;
-                    interrupt_handled = true;
-                    if (regs.ic[i]) {
-                        ContextStore();
-                    }
+                    line = i;
                     break;
                 }
             }
-            if (!interrupt_handled && regs.imv && regs.ipv) {
-                regs.ipv = 0;
-                regs.ie = 0;
-                PushPC();
-                regs.pc = vinterrupt_address;
-                regs.idle = false;
-                if (vinterrupt_context_switch) {
-                    ContextStore();
+            if (line < 3 || (regs.imv && regs.ipv)) {
+                entry = interrupt_entries[line];
+                if (profiler) {
+                    profiler->Enter(line < 3 ? 0x0006 + line * 8 : vinterrupt_address,
+                                    current_blk->cycles);
+                }
+                if (interrupt_service_handler) {
+                    interrupt_service_handler(line, current_blk->cycles);
                 }
             }
         }
@@ -274,9 +694,27 @@ public:
         // Count the cycles of the previous executed block.
         core_timing.Tick(current_blk->cycles);
         cycles_remaining -= current_blk->cycles;
+        return entry;
     }
 
     void CompileBlock(Block& blk) {
+        const auto compile_start = std::chrono::steady_clock::now();
+        const std::size_t code_start = c.getSize();
+        const std::size_t far_code_start = far_code_size;
+
+        EmitBlock(blk);
+        blk.near_func = blk.func;
+
+        ++compile_stats.blocks_compiled;
+        compile_stats.instructions_compiled += blk.cycles;
+        compile_stats.host_bytes += c.getSize() - code_start + far_code_size - far_code_start;
+        compile_stats.compile_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                        std::chrono::steady_clock::now() - compile_start)
+                                        .count();
+    }
+
+    // Emits the block starting at regs.pc for the state in blk_key
+    void EmitBlock(Block& blk) {
         // Load block state
         blk.func = c.getCurr<BlockFunc>();
         c.mov(REGS, ABI_PARAM1);
@@ -290,6 +728,7 @@ public:
         c.mov(FLAGS, word[REGS + offsetof(JitRegisters, flags)]);
 
         call_stack = {};
+        watching = mem.HasWatchpoints();
 
         //Disassembler::ArArpSettings settings;
         //std::memcpy(&settings.ar, &blk_key.curr.ar, sizeof(settings.ar));
@@ -298,6 +737,7 @@ public:
         compiling = true;
         while (compiling) {
             const u32 current_pc = regs.pc;
+            inst_pc = current_pc;
             u16 opcode = mem.ProgramRead((regs.pc++) | (regs.prpage << 18));
             auto& decoder = decoders[opcode];
             u16 expand_value = 0;
@@ -398,18 +838,6 @@ public:
         c.mov(word[REGS + offsetof(JitRegisters, sp)], sp.cvt16());
     }
 
-    void PushPC() {
-        u16 l = (u16)(regs.pc & 0xFFFF);
-        u16 h = (u16)(regs.pc >> 16);
-        if (regs.cpc == 1) {
-            mem.DataWrite(--regs.sp, h);
-            mem.DataWrite(--regs.sp, l);
-        } else {
-            mem.DataWrite(--regs.sp, l);
-            mem.DataWrite(--regs.sp, h);
-        }
-    }
-
     void EmitPopPC() {
         const Reg64 sp = rbx;
         c.movzx(sp, word[REGS + offsetof(JitRegisters, sp)]);
@@ -461,8 +889,8 @@ public:
 
     std::array<bool, 3> interrupt_pending{};
     bool vinterrupt_pending{false};
-    bool vinterrupt_context_switch;
-    u32 vinterrupt_address;
+    bool vinterrupt_context_switch{false};
+    u32 vinterrupt_address{};
 
     void nop() {
         // literally nothing
@@ -473,14 +901,6 @@ public:
         NOT_IMPLEMENTED();
     }
 
-    void ContextStore() {
-        NOT_IMPLEMENTED();
-    }
-
-    void ContextRestore() {
-        NOT_IMPLEMENTED();
-    }
-
     void norm(Ax a, Rn b, StepZIDS bs) {
         NOT_IMPLEMENTED();
     }
@@ -576,6 +996,21 @@ public:
         return reinterpret_cast<MemoryInterface*>(mem_ptr)->DataRead(address);
     }
 
+    static u16 MemDataReadBypassThunk(void* mem_ptr, u16 address) {
+        return reinterpret_cast<MemoryInterface*>(mem_ptr)->DataRead(address, true);
+    }
+
+    // Records the address of the current instruction for watchpoint callbacks.
+    // Must be emitted after rbp has been pushed.
+    void EmitWatchPc() {
+        if (!watching) {
+            return;
+        }
+        c.mov(rbp, reinterpret_cast<uintptr_t>(&mem.watch_pc_storage));
+        c.mov(dword[rbp], inst_pc);
+    }
+
+    template <bool bypass_mmio = false>
     void EmitLoadFunctionCall(Reg64 out, Reg64 address) {
         // TODO: Non MMIO reads can be performed inside the JIT.
         // Push all registers because our JIT assumes everything is non volatile
@@ -593,6 +1028,7 @@ public:
         c.push(r13);
         c.push(r14);
         c.push(r15);
+        EmitWatchPc();
 
         c.mov(rbp, rsp);
         // Reserve a bunch of stack space for Windows shadow stack et al, then force align rsp to 16 bytes to respect the ABI
@@ -601,7 +1037,11 @@ public:
 
         c.movzx(ABI_PARAM2, address.cvt16());
         c.mov(ABI_PARAM1, reinterpret_cast<uintptr_t>(&mem));
-        CallFarFunction(c, MemDataReadThunk);
+        if constexpr (bypass_mmio) {
+            CallFarFunction(c, MemDataReadBypassThunk);
+        } else {
+            CallFarFunction(c, MemDataReadThunk);
+        }
 
         // Undo anything we did
         c.mov(rsp, rbp);
@@ -632,29 +1072,60 @@ public:
         c.add(addr, scratch);
     }
 
+    // Stores through the shared memory directly, like EmitLoadFromMemory loads. MMIO and watched
+    // pages are checked at run time and take StoreToMemory instead. Clobbers address.
+    void EmitStoreToMemory(Reg64 address, Reg64 value) {
+        Xbyak::Label end_label, slow_label;
+        const Reg64 scratch = rsi;
+        c.movzx(scratch, word[REGS + offsetof(JitRegisters, mmio_base)]);
+        c.neg(scratch);
+        c.add(scratch, address);
+        c.cmp(scratch, MemoryInterfaceUnit::MMIOSize);
+        c.jb(slow_label, c.T_NEAR);
+        c.mov(scratch.cvt32(), address.cvt32());
+        c.shr(scratch.cvt32(), MemoryInterface::WatchPageShift);
+        c.bt(dword[REGS + offsetof(JitRegisters, watch_pages)], scratch.cvt32());
+        c.jc(slow_label, c.T_NEAR);
+        EmitFarCode(slow_label, end_label, [&] { StoreToMemory(address, value); });
+
+        EmitConvertAddress(address, scratch);
+        c.mov(scratch, reinterpret_cast<uintptr_t>(mem.shared_memory.raw));
+        c.mov(word[scratch + address * 2], value.cvt16());
+
+        c.L(end_label);
+    }
+
     template <bool bypass_mmio = false>
     void EmitLoadFromMemory(Reg64 out, Reg64 address) {
-        Xbyak::Label end_label, read_label;
+        Xbyak::Label end_label;
         const Reg64 scratch = rsi;
         if constexpr (!bypass_mmio) {
+            // address - mmio_base < MMIOSize, unsigned
+            Xbyak::Label mmio_label;
             c.movzx(scratch, word[REGS + offsetof(JitRegisters, mmio_base)]);
-            c.cmp(address, scratch);
-            c.jl(read_label);
-            c.add(scratch, MemoryInterfaceUnit::MMIOSize);
-            c.cmp(address, scratch);
-            c.jge(read_label);
-            EmitLoadFunctionCall(out, address);
-            c.jmp(end_label);
-            c.L(read_label);
+            c.neg(scratch);
+            c.add(scratch, address);
+            c.cmp(scratch, MemoryInterfaceUnit::MMIOSize);
+            c.jb(mmio_label, c.T_NEAR);
+            EmitFarCode(mmio_label, end_label, [&] { EmitLoadFunctionCall(out, address); });
+        }
+
+        if (watching) {
+            // Watched pages take the slow path so MemoryInterface can report the access
+            Xbyak::Label watch_label;
+            c.mov(scratch.cvt32(), address.cvt32());
+            c.shr(scratch.cvt32(), MemoryInterface::WatchPageShift);
+            c.bt(dword[REGS + offsetof(JitRegisters, watch_pages)], scratch.cvt32());
+            c.jc(watch_label, c.T_NEAR);
+            EmitFarCode(watch_label, end_label,
+                        [&] { EmitLoadFunctionCall<bypass_mmio>(out, address); });
         }
 
         EmitConvertAddress(address, scratch);
         c.mov(scratch, reinterpret_cast<uintptr_t>(mem.shared_memory.raw));
         c.mov(out.cvt16(), word[scratch + address * 2]);
 
-        if constexpr (!bypass_mmio) {
-            c.L(end_label);
-        }
+        c.L(end_label);
     }
 
     void LoadFromMemory(Reg64 out, MemImm8 addr) {
@@ -679,6 +1150,7 @@ public:
         c.push(r13);
         c.push(r14);
         c.push(r15);
+        EmitWatchPc();
 
         c.mov(rbp, rsp);
         // Reserve a bunch of stack space for Windows shadow stack et al, then force align rsp to 16 bytes to respect the ABI
@@ -730,6 +1202,7 @@ public:
         c.push(r13);
         c.push(r14);
         c.push(r15);
+        EmitWatchPc();
 
         c.mov(rbp, rsp);
         // Reserve a bunch of stack space for Windows shadow stack et al, then force align rsp to 16 bytes to respect the ABI
@@ -1590,16 +2063,17 @@ public:
 
             Xbyak::Label end_label, saturate_label;
             c.bt(FLAGS, decltype(Flags::fv)::position);
-            c.jc(saturate_label);
+            c.jc(saturate_label, c.T_NEAR);
             c.movsxd(rcx, value.cvt32());
             c.cmp(rcx, value);
-            c.je(end_label);
-            c.L(saturate_label);
-            c.or_(FLAGS, decltype(Flags::flm)::mask);
-            c.mov(value, 0x7FFF'FFFF);
-            c.mov(rcx, 0xFFFF'FFFF'8000'0000);
-            c.cmp(original_sign, 1);
-            c.cmove(value, rcx);
+            c.jne(saturate_label, c.T_NEAR);
+            EmitFarCode(saturate_label, end_label, [&] {
+                c.or_(FLAGS, decltype(Flags::flm)::mask);
+                c.mov(value, 0x7FFF'FFFF);
+                c.mov(rcx, 0xFFFF'FFFF'8000'0000);
+                c.cmp(original_sign, 1);
+                c.cmove(value, rcx);
+            });
             c.L(end_label);
         }
         SetAcc(dest, value);
@@ -1729,16 +2203,17 @@ public:
         if (blk_key.curr.mod0.s == 0 && blk_key.curr.mod0.sata == 0) {
             Xbyak::Label end_label, saturate_label;
             c.bt(FLAGS, decltype(Flags::fv)::position);
-            c.jc(saturate_label);
+            c.jc(saturate_label, c.T_NEAR);
             c.movsxd(rcx, value.cvt32());
             c.cmp(rcx, value);
-            c.je(end_label);
-            c.L(saturate_label);
-            c.or_(FLAGS, decltype(Flags::flm)::mask);
-            c.mov(value, 0x7FFF'FFFF);
-            c.mov(rcx, 0xFFFF'FFFF'8000'0000);
-            c.cmp(original_sign, 1);
-            c.cmove(value, rcx);
+            c.jne(saturate_label, c.T_NEAR);
+            EmitFarCode(saturate_label, end_label, [&] {
+                c.or_(FLAGS, decltype(Flags::flm)::mask);
+                c.mov(value, 0x7FFF'FFFF);
+                c.mov(rcx, 0xFFFF'FFFF'8000'0000);
+                c.cmp(original_sign, 1);
+                c.cmove(value, rcx);
+            });
             c.L(end_label);
         }
         SetAcc(dest, value);
@@ -2012,22 +2487,22 @@ public:
         LoadFromMemory(flag, address_reg);
         c.add(address_reg, 1);
 
-        Xbyak::Label end_label, not_in_loop;
+        Xbyak::Label end_label, in_loop;
         c.test(word[REGS + offsetof(JitRegisters, lp)], 0x1);
-        c.jz(not_in_loop);
-        ABI_PushRegistersAndAdjustStack(c, ABI_ALL_CALLER_SAVED_GPR, 8);
-        c.mov(ABI_PARAM1, REGS);
-        CallFarFunction(c, DoBkrepStackCopyThunkRestore);
-        ABI_PopRegistersAndAdjustStack(c, ABI_ALL_CALLER_SAVED_GPR, 8);
-        c.jmp(end_label);
-        c.L(not_in_loop);
+        c.jnz(in_loop, c.T_NEAR);
+        EmitFarCode(in_loop, end_label, [&] {
+            ABI_PushRegistersAndAdjustStack(c, ABI_ALL_CALLER_SAVED_GPR, 8);
+            c.mov(ABI_PARAM1, REGS);
+            CallFarFunction(c, DoBkrepStackCopyThunkRestore);
+            ABI_PopRegistersAndAdjustStack(c, ABI_ALL_CALLER_SAVED_GPR, 8);
+        });
         c.bt(flag, 15);
         c.setc(byte[REGS + offsetof(JitRegisters, lp)]);
         c.setc(byte[REGS + offsetof(JitRegisters, bcn)]);
         c.L(end_label);
 
         const Reg64 start_end = IsWindows() ? rsi : rdx;
-        c.rorx(start_end, flag, 8);
+        Rorx(start_end, flag, 8);
         c.and_(start_end, 0x3);
         c.shl(start_end, 16);
         LoadFromMemory(start_end, address_reg);
@@ -2066,13 +2541,15 @@ public:
         c.sub(address_reg, 1);
         StoreToMemory(address_reg, flag);
 
-        Xbyak::Label end_label;
+        Xbyak::Label end_label, in_loop;
         c.test(word[REGS + offsetof(JitRegisters, lp)], 0x1);
-        c.jz(end_label);
-        ABI_PushRegistersAndAdjustStack(c, ABI_ALL_CALLER_SAVED_GPR, 8);
-        c.mov(ABI_PARAM1, REGS);
-        CallFarFunction(c, DoBkrepStackCopyThunk);
-        ABI_PopRegistersAndAdjustStack(c, ABI_ALL_CALLER_SAVED_GPR, 8);
+        c.jnz(in_loop, c.T_NEAR);
+        EmitFarCode(in_loop, end_label, [&] {
+            ABI_PushRegistersAndAdjustStack(c, ABI_ALL_CALLER_SAVED_GPR, 8);
+            c.mov(ABI_PARAM1, REGS);
+            CallFarFunction(c, DoBkrepStackCopyThunk);
+            ABI_PopRegistersAndAdjustStack(c, ABI_ALL_CALLER_SAVED_GPR, 8);
+        });
         c.L(end_label);
     }
 
@@ -2110,17 +2587,17 @@ public:
             c.xchg(word[REGS + offsetof(JitRegisters, r4b)], R4_5_6_7.cvt16());
         }
         if (flags.R1()) {
-            c.rorx(R0_1_2_3, R0_1_2_3, 16);
+            Rorx(R0_1_2_3, R0_1_2_3, 16);
             c.xchg(word[REGS + offsetof(JitRegisters, r1b)], R0_1_2_3.cvt16());
-            c.rorx(R0_1_2_3, R0_1_2_3, 48);
+            Rorx(R0_1_2_3, R0_1_2_3, 48);
         }
         if (flags.R0()) {
             c.xchg(word[REGS + offsetof(JitRegisters, r0b)], R0_1_2_3.cvt16());
         }
         if (flags.R7()) {
-            c.rorx(R4_5_6_7, R4_5_6_7, 48);
+            Rorx(R4_5_6_7, R4_5_6_7, 48);
             c.xchg(word[REGS + offsetof(JitRegisters, r7b)], R4_5_6_7.cvt16());
-            c.rorx(R4_5_6_7, R4_5_6_7, 16);
+            Rorx(R4_5_6_7, R4_5_6_7, 16);
         }
         if (flags.Cfgj()) {
             c.mov(word[REGS + offsetof(JitRegisters, cfgj)], blk_key.cfgjb.raw);
@@ -2186,6 +2663,63 @@ public:
         NOT_IMPLEMENTED();
     }
 
+    static void ProfileEnterThunk(void* this_ptr, u32 offset) {
+        auto* jit = reinterpret_cast<EmitX64*>(this_ptr);
+        jit->profiler->Enter(jit->regs.pc, offset);
+    }
+
+    static void ProfileLeaveThunk(void* this_ptr, u32 offset) {
+        reinterpret_cast<EmitX64*>(this_ptr)->profiler->Leave(offset);
+    }
+
+    // Calls into the profiler once the new pc has been written back to regs.
+    // Timers only tick at block exit, so pass how far into the block we are.
+    template <typename F>
+    void EmitProfilerCall(F thunk) {
+        if (!profiler) {
+            return;
+        }
+        // Push all registers because our JIT assumes everything is non volatile
+        c.push(rbp);
+        c.push(rbx);
+        c.push(rcx);
+        c.push(rdx);
+        c.push(rsi);
+        c.push(rdi);
+        c.push(r8);
+        c.push(r9);
+        c.push(r10);
+        c.push(r11);
+        c.push(r12);
+        c.push(r13);
+        c.push(r14);
+        c.push(r15);
+
+        c.mov(rbp, rsp);
+        c.sub(rsp, 64);
+        c.and_(rsp, ~0xF);
+
+        c.mov(ABI_PARAM2, current_blk->cycles);
+        c.mov(ABI_PARAM1, reinterpret_cast<uintptr_t>(this));
+        CallFarFunction(c, thunk);
+
+        c.mov(rsp, rbp);
+        c.pop(r15);
+        c.pop(r14);
+        c.pop(r13);
+        c.pop(r12);
+        c.pop(r11);
+        c.pop(r10);
+        c.pop(r9);
+        c.pop(r8);
+        c.pop(rdi);
+        c.pop(rsi);
+        c.pop(rdx);
+        c.pop(rcx);
+        c.pop(rbx);
+        c.pop(rbp);
+    }
+
     void call(Address18_16 addr_low, Address18_2 addr_high, Cond cond) {
         const u32 ret_pc = regs.pc;
         c.mov(dword[REGS + offsetof(JitRegisters, pc)], ret_pc);
@@ -2193,6 +2727,7 @@ public:
             EmitPushPC();
             regs.pc = Address32(addr_low, addr_high);
             c.mov(dword[REGS + offsetof(JitRegisters, pc)], regs.pc);
+            EmitProfilerCall(ProfileEnterThunk);
         });
         // For static jump we can continue compiling.
         compiling = cond.GetName() == CondValue::True;
@@ -2209,6 +2744,7 @@ public:
         GetAcc(pc, a.GetName());
         c.and_(pc, 0x3FFFF);
         c.mov(dword[REGS + offsetof(JitRegisters, pc)], pc.cvt32());
+        EmitProfilerCall(ProfileEnterThunk);
         compiling = false;
     }
     void callr(RelAddr7 addr, Cond cond) {
@@ -2218,6 +2754,7 @@ public:
             EmitPushPC();
             regs.pc += addr.Relative32();
             c.mov(dword[REGS + offsetof(JitRegisters, pc)], regs.pc);
+            EmitProfilerCall(ProfileEnterThunk);
         });
         // For static jump we can continue compiling.
         compiling = cond.GetName() == CondValue::True;
@@ -2227,9 +2764,15 @@ public:
     }
 
     void cntx_s() {
-        regs.ShadowStore(c);
-        regs.ShadowSwap(c);
+        current_blk->verifiable = false;
+        EmitContextStore();
         std::swap(blk_key.curr, blk_key.shadow);
+    }
+
+    // Shared with the interrupt entries. A[1], B[1] and FLAGS must hold the live values.
+    void EmitContextStore() {
+        regs.ShadowStore(c);
+        regs.ShadowSwap(c, HasAvx2());
         // if (!regs.crep) {
         //     regs.repcs = regs.repc;
         // }
@@ -2251,8 +2794,9 @@ public:
         c.L(end_label);
     }
     void cntx_r() {
+        current_blk->verifiable = false;
         regs.ShadowRestore(c);
-        regs.ShadowSwap(c);
+        regs.ShadowSwap(c, HasAvx2());
         std::swap(blk_key.curr, blk_key.shadow);
 
                // if (!regs.crep) {
@@ -2278,6 +2822,7 @@ public:
         c.mov(dword[REGS + offsetof(JitRegisters, pc)], regs.pc);
         ConditionPass(cond, [&] {
             EmitPopPC();
+            EmitProfilerCall(ProfileLeaveThunk);
         });
         // If the last call instruction had a static target and this instruction
         // always returns, we don't have to stop compiling.
@@ -2296,6 +2841,7 @@ public:
         ConditionPass(cond, [&]{
             EmitPopPC();
             c.mov(word[REGS + offsetof(JitRegisters, ie)], 1);
+            EmitProfilerCall(ProfileLeaveThunk);
         });
         if (cond.GetName() == CondValue::True && !call_stack.empty()) {
             regs.pc = call_stack.top();
@@ -2310,6 +2856,7 @@ public:
             EmitPopPC();
             c.mov(word[REGS + offsetof(JitRegisters, ie)], 1);
             cntx_r();
+            EmitProfilerCall(ProfileLeaveThunk);
         });
         if (cond.GetName() == CondValue::True && !call_stack.empty()) {
             regs.pc = call_stack.top();
@@ -2327,6 +2874,7 @@ public:
     void rets(Imm8 a) {
         EmitPopPC();
         c.add(word[REGS + offsetof(JitRegisters, sp)], a.Unsigned16());
+        EmitProfilerCall(ProfileLeaveThunk);
         if (!call_stack.empty()) {
             regs.pc = call_stack.top();
             call_stack.pop();
@@ -2495,7 +3043,7 @@ public:
     }
     void push_x0() {
         const Reg64 value = rax;
-        c.rorx(value, FACTORS, 32);
+        Rorx(value, FACTORS, 32);
         const Reg64 sp = rbx;
         c.mov(sp, word[REGS + offsetof(JitRegisters, sp)]);
         c.sub(sp, 1);
@@ -2504,7 +3052,7 @@ public:
     }
     void push_x1() {
         const Reg64 value = rax;
-        c.rorx(value, FACTORS, 48);
+        Rorx(value, FACTORS, 48);
         const Reg64 sp = rbx;
         c.mov(sp, word[REGS + offsetof(JitRegisters, sp)]);
         c.sub(sp, 1);
@@ -2513,7 +3061,7 @@ public:
     }
     void push_y1() {
         const Reg64 value = rax;
-        c.rorx(value, FACTORS, 16);
+        Rorx(value, FACTORS, 16);
         const Reg64 sp = rbx;
         c.mov(sp, word[REGS + offsetof(JitRegisters, sp)]);
         c.sub(sp, 1);
@@ -2615,9 +3163,9 @@ public:
         const Reg64 value = rcx;
         EmitLoadFromMemory<true>(value, sp);
         c.add(word[REGS + offsetof(JitRegisters, sp)], 1);
-        c.rorx(FACTORS, FACTORS, 32);
+        Rorx(FACTORS, FACTORS, 32);
         c.mov(FACTORS.cvt16(), value.cvt16());
-        c.rorx(FACTORS, FACTORS, 32);
+        Rorx(FACTORS, FACTORS, 32);
     }
     void pop_x1() {
         const Reg64 sp = rbx;
@@ -2625,9 +3173,9 @@ public:
         const Reg64 value = rcx;
         EmitLoadFromMemory<true>(value, sp);
         c.add(word[REGS + offsetof(JitRegisters, sp)], 1);
-        c.rorx(FACTORS, FACTORS, 48);
+        Rorx(FACTORS, FACTORS, 48);
         c.mov(FACTORS.cvt16(), value.cvt16());
-        c.rorx(FACTORS, FACTORS, 16);
+        Rorx(FACTORS, FACTORS, 16);
     }
     void pop_y1() {
         const Reg64 sp = rbx;
@@ -2635,9 +3183,9 @@ public:
         const Reg64 value = rcx;
         EmitLoadFromMemory<true>(value, sp);
         c.add(word[REGS + offsetof(JitRegisters, sp)], 1);
-        c.rorx(FACTORS, FACTORS, 16);
+        Rorx(FACTORS, FACTORS, 16);
         c.mov(FACTORS.cvt16(), value.cvt16());
-        c.rorx(FACTORS, FACTORS, 48);
+        Rorx(FACTORS, FACTORS, 48);
     }
     void popa(Ab a) {
         const Reg64 value = rbx;
@@ -2802,17 +3350,17 @@ public:
         RnAddressAndModify(x.Index(), xs.GetName(), address);
         const Reg64 value = rbx;
         EmitLoadFromMemory(value, address);
-        c.rorx(FACTORS, FACTORS, 32);
+        Rorx(FACTORS, FACTORS, 32);
         c.mov(FACTORS.cvt16(), value.cvt16());
-        c.rorx(FACTORS, FACTORS, 32);
+        Rorx(FACTORS, FACTORS, 32);
         MulGeneric(op.GetName(), a);
     }
     void mul_y0(Mul3 op, Register x, Ax a) {
         const Reg64 x0 = rax;
         RegToBus16(x.GetName(), x0);
-        c.rorx(FACTORS, FACTORS, 32);
+        Rorx(FACTORS, FACTORS, 32);
         c.mov(FACTORS.cvt16(), x0.cvt16());
-        c.rorx(FACTORS, FACTORS, 32);
+        Rorx(FACTORS, FACTORS, 32);
         MulGeneric(op.GetName(), a);
     }
     void mul(Mul3 op, R45 y, StepZIDS ys, R0123 x, StepZIDS xs, Ax a) {
@@ -2821,9 +3369,9 @@ public:
         RnAddressAndModify(y.Index(), ys.GetName(), address_y);
         RnAddressAndModify(x.Index(), xs.GetName(), address_x);
         EmitLoadFromMemory(FACTORS, address_y);
-        c.rorx(FACTORS, FACTORS, 32);
+        Rorx(FACTORS, FACTORS, 32);
         EmitLoadFromMemory(FACTORS, address_x);
-        c.rorx(FACTORS, FACTORS, 32);
+        Rorx(FACTORS, FACTORS, 32);
         MulGeneric(op.GetName(), a);
     }
     void mul_y0_r6(Mul3 op, Ax a) {
@@ -2834,9 +3382,9 @@ public:
         const Reg64 address = rbx;
         c.mov(address, x.Unsigned16() + (blk_key.curr.mod1.page << 8));
         EmitLoadFromMemory(x0, address);
-        c.rorx(FACTORS, FACTORS, 32);
+        Rorx(FACTORS, FACTORS, 32);
         c.mov(FACTORS.cvt16(), x0.cvt16());
-        c.rorx(FACTORS, FACTORS, 32);
+        Rorx(FACTORS, FACTORS, 32);
         MulGeneric(op.GetName(), a);
     }
 
@@ -2941,7 +3489,19 @@ public:
         RegFromBus16(b.GetName(), value);
     }
     void movp(Rn a, StepZIDS as, R0123 b, StepZIDS bs) {
-        NOT_IMPLEMENTED();
+        const Reg64 address_s = rax;
+        RnAddressAndModify(a.Index(), as.GetName(), address_s);
+        const Reg64 address_d = rcx;
+        RnAddressAndModify(b.Index(), bs.GetName(), address_d);
+        // address_s |= pcmhi << 16
+        const Reg64 value = rbx;
+        c.movzx(address_s, address_s.cvt16());
+        c.movzx(value, word[REGS + offsetof(JitRegisters, pcmhi)]);
+        c.shl(value, 16);
+        c.or_(address_s, value);
+        c.mov(value, reinterpret_cast<uintptr_t>(mem.GetMemory().raw));
+        c.movzx(value, word[value + address_s * 2]);
+        StoreToMemory(address_d, value);
     }
     void movpdw(Ax a) {
         const Reg64 address = rbx;
@@ -2974,9 +3534,9 @@ public:
     void mov_y1(Abl a) {
         const Reg64 value16 = rax;
         RegToBus16(a.GetName(), value16, true);
-        c.rorx(FACTORS, FACTORS, 16);
+        Rorx(FACTORS, FACTORS, 16);
         c.mov(FACTORS.cvt16(), value16.cvt16());
-        c.rorx(FACTORS, FACTORS, 48);
+        Rorx(FACTORS, FACTORS, 48);
     }
 
     static void MemDataWriteThunk(void* mem_ptr, u16 address, u16 data) {
@@ -3005,6 +3565,7 @@ public:
         c.push(r13);
         c.push(r14);
         c.push(r15);
+        EmitWatchPc();
 
         c.mov(rbp, rsp);
         // Reserve a bunch of stack space for Windows shadow stack et al, then force align rsp to 16 bytes to respect the ABI
@@ -3610,7 +4171,13 @@ public:
         c.cmovc(value, rsi);
         c.shl(value, 64 - 39);
         c.or_(value, 0x1FFFFFF);
-        c.lzcnt(count, value);
+        if (HasBmi2()) {
+            c.lzcnt(count, value);
+        } else {
+            // value is nonzero here
+            c.bsr(count, value);
+            c.xor_(count, 63);
+        }
         c.sub(count, 8);
     }
 
@@ -3967,11 +4534,11 @@ public:
         const Reg64 address2 = rbx;
         c.mov(address2, address);
         OffsetAddress(unit, address2.cvt16(), GetArOffset(xs));
-        c.rorx(FACTORS, FACTORS, 32);
+        Rorx(FACTORS, FACTORS, 32);
         EmitLoadFromMemory<true>(FACTORS, address);
-        c.rorx(FACTORS, FACTORS, 16);
+        Rorx(FACTORS, FACTORS, 16);
         EmitLoadFromMemory<true>(FACTORS, address2);
-        c.rorx(FACTORS, FACTORS, 16);
+        Rorx(FACTORS, FACTORS, 16);
         DoMultiplication(0, eax, ebx, x0_sign, y0_sign);
         DoMultiplication(1, eax, ebx, x1_sign, y1_sign);
     }
@@ -4125,25 +4692,25 @@ private:
             c.movzx(out, R0_1_2_3.cvt16());
             break;
         case RegName::r1:
-            c.rorx(out, R0_1_2_3, 16);
+            Rorx(out, R0_1_2_3, 16);
             break;
         case RegName::r2:
-            c.rorx(out, R0_1_2_3, 32);
+            Rorx(out, R0_1_2_3, 32);
             break;
         case RegName::r3:
-            c.rorx(out, R0_1_2_3, 48);
+            Rorx(out, R0_1_2_3, 48);
             break;
         case RegName::r4:
             c.movzx(out, R4_5_6_7.cvt16());
             break;
         case RegName::r5:
-            c.rorx(out, R4_5_6_7, 16);
+            Rorx(out, R4_5_6_7, 16);
             break;
         case RegName::r6:
-            c.rorx(out, R4_5_6_7, 32);
+            Rorx(out, R4_5_6_7, 32);
             break;
         case RegName::r7:
-            c.rorx(out, R4_5_6_7, 48);
+            Rorx(out, R4_5_6_7, 48);
             break;
         case RegName::y0:
             c.movzx(out, FACTORS.cvt16());
@@ -4174,10 +4741,10 @@ private:
             regs.GetStt2(c, out.cvt16());
             break;
         case RegName::st0:
-            regs.GetSt0(c, out.cvt16(), blk_key.curr.mod0);
+            regs.GetSt0(c, out.cvt16(), blk_key.curr.mod0, HasBmi2());
             break;
         case RegName::st1:
-            regs.GetSt1(c, out.cvt16(), blk_key.curr.mod0, blk_key.curr.mod1);
+            regs.GetSt1(c, out.cvt16(), blk_key.curr.mod0, blk_key.curr.mod1, HasBmi2());
             break;
 
         case RegName::cfgi:
@@ -4311,37 +4878,37 @@ private:
             c.mov(R0_1_2_3.cvt16(), value.cvt16());
             break;
         case RegName::r1:
-            c.rorx(R0_1_2_3, R0_1_2_3, 16);
+            Rorx(R0_1_2_3, R0_1_2_3, 16);
             c.mov(R0_1_2_3.cvt16(), value.cvt16());
-            c.rorx(R0_1_2_3, R0_1_2_3, 48);
+            Rorx(R0_1_2_3, R0_1_2_3, 48);
             break;
         case RegName::r2:
-            c.rorx(R0_1_2_3, R0_1_2_3, 32);
+            Rorx(R0_1_2_3, R0_1_2_3, 32);
             c.mov(R0_1_2_3.cvt16(), value.cvt16());
-            c.rorx(R0_1_2_3, R0_1_2_3, 32);
+            Rorx(R0_1_2_3, R0_1_2_3, 32);
             break;
         case RegName::r3:
-            c.rorx(R0_1_2_3, R0_1_2_3, 48);
+            Rorx(R0_1_2_3, R0_1_2_3, 48);
             c.mov(R0_1_2_3.cvt16(), value.cvt16());
-            c.rorx(R0_1_2_3, R0_1_2_3, 16);
+            Rorx(R0_1_2_3, R0_1_2_3, 16);
             break;
         case RegName::r4:
             c.mov(R4_5_6_7.cvt16(), value.cvt16());
             break;
         case RegName::r5:
-            c.rorx(R4_5_6_7, R4_5_6_7, 16);
+            Rorx(R4_5_6_7, R4_5_6_7, 16);
             c.mov(R4_5_6_7.cvt16(), value.cvt16());
-            c.rorx(R4_5_6_7, R4_5_6_7, 48);
+            Rorx(R4_5_6_7, R4_5_6_7, 48);
             break;
         case RegName::r6:
-            c.rorx(R4_5_6_7, R4_5_6_7, 32);
+            Rorx(R4_5_6_7, R4_5_6_7, 32);
             c.mov(R4_5_6_7.cvt16(), value.cvt16());
-            c.rorx(R4_5_6_7, R4_5_6_7, 32);
+            Rorx(R4_5_6_7, R4_5_6_7, 32);
             break;
         case RegName::r7:
-            c.rorx(R4_5_6_7, R4_5_6_7, 48);
+            Rorx(R4_5_6_7, R4_5_6_7, 48);
             c.mov(R4_5_6_7.cvt16(), value.cvt16());
-            c.rorx(R4_5_6_7, R4_5_6_7, 16);
+            Rorx(R4_5_6_7, R4_5_6_7, 16);
             break;
 
         case RegName::st1:
@@ -4381,7 +4948,7 @@ private:
             break;
 
         case RegName::st0:
-            regs.SetSt0(c, value, blk_key.curr.mod0);
+            regs.SetSt0(c, value, blk_key.curr.mod0, HasBmi2());
             c.mov(dword[REGS + offsetof(JitRegisters, pc)], regs.pc);
             compiling = false; // Static state changed, end block
             break;
@@ -4481,37 +5048,37 @@ private:
             c.mov(R0_1_2_3.cvt16(), value);
             break;
         case RegName::r1:
-            c.rorx(R0_1_2_3, R0_1_2_3, 16);
+            Rorx(R0_1_2_3, R0_1_2_3, 16);
             c.mov(R0_1_2_3.cvt16(), value);
-            c.rorx(R0_1_2_3, R0_1_2_3, 48);
+            Rorx(R0_1_2_3, R0_1_2_3, 48);
             break;
         case RegName::r2:
-            c.rorx(R0_1_2_3, R0_1_2_3, 32);
+            Rorx(R0_1_2_3, R0_1_2_3, 32);
             c.mov(R0_1_2_3.cvt16(), value);
-            c.rorx(R0_1_2_3, R0_1_2_3, 32);
+            Rorx(R0_1_2_3, R0_1_2_3, 32);
             break;
         case RegName::r3:
-            c.rorx(R0_1_2_3, R0_1_2_3, 48);
+            Rorx(R0_1_2_3, R0_1_2_3, 48);
             c.mov(R0_1_2_3.cvt16(), value);
-            c.rorx(R0_1_2_3, R0_1_2_3, 16);
+            Rorx(R0_1_2_3, R0_1_2_3, 16);
             break;
         case RegName::r4:
             c.mov(R4_5_6_7.cvt16(), value);
             break;
         case RegName::r5:
-            c.rorx(R4_5_6_7, R4_5_6_7, 16);
+            Rorx(R4_5_6_7, R4_5_6_7, 16);
             c.mov(R4_5_6_7.cvt16(), value);
-            c.rorx(R4_5_6_7, R4_5_6_7, 48);
+            Rorx(R4_5_6_7, R4_5_6_7, 48);
             break;
         case RegName::r6:
-            c.rorx(R4_5_6_7, R4_5_6_7, 32);
+            Rorx(R4_5_6_7, R4_5_6_7, 32);
             c.mov(R4_5_6_7.cvt16(), value);
-            c.rorx(R4_5_6_7, R4_5_6_7, 32);
+            Rorx(R4_5_6_7, R4_5_6_7, 32);
             break;
         case RegName::r7:
-            c.rorx(R4_5_6_7, R4_5_6_7, 48);
+            Rorx(R4_5_6_7, R4_5_6_7, 48);
             c.mov(R4_5_6_7.cvt16(), value);
-            c.rorx(R4_5_6_7, R4_5_6_7, 16);
+            Rorx(R4_5_6_7, R4_5_6_7, 16);
             break;
 
         case RegName::y0:
@@ -4555,7 +5122,7 @@ private:
             break;
 
         case RegName::st0:
-            regs.SetSt0(c, value, blk_key.curr.mod0);
+            regs.SetSt0(c, value, blk_key.curr.mod0, HasBmi2());
             break;
         case RegName::st1:
             regs.SetSt1(c, value, blk_key.curr.mod0, blk_key.curr.mod1);
@@ -4692,18 +5259,20 @@ private:
     template <bool flag, typename T>
     void SaturateAcc(T& value) {
         if constexpr (std::is_base_of_v<Xbyak::Reg, T>) {
-            Xbyak::Label end_saturate;
+            Xbyak::Label end_saturate, saturate;
             c.movsxd(rsi, value.cvt32()); // rbx = SignExtend<32>(value);
             c.cmp(value, rsi);
-            c.je(end_saturate);
-            if constexpr (flag) {
-                c.or_(FLAGS, decltype(Flags::flm)::mask); // regs.flm = 1;
-            }
-            c.shr(value, 39);
-            c.mov(rsi, 0x0000'0000'7FFF'FFFF);
-            c.test(value, value);
-            c.mov(value, 0xFFFF'FFFF'8000'0000);
-            c.cmovz(value, rsi);
+            c.jne(saturate, c.T_NEAR);
+            EmitFarCode(saturate, end_saturate, [&] {
+                if constexpr (flag) {
+                    c.or_(FLAGS, decltype(Flags::flm)::mask); // regs.flm = 1;
+                }
+                c.shr(value, 39);
+                c.mov(rsi, 0x0000'0000'7FFF'FFFF);
+                c.test(value, value);
+                c.mov(value, 0xFFFF'FFFF'8000'0000);
+                c.cmovz(value, rsi);
+            });
             // note: flm doesn't change value otherwise
             c.L(end_saturate);
         } else {
@@ -4776,24 +5345,9 @@ private:
 
     void RnAddress(u32 unit, Reg64 value) {
         if (blk_key.curr.mod2.IsBr(unit) && !blk_key.curr.mod2.IsM(unit)) {
-            c.rol(value.cvt16(), 8);
-            c.mov(esi, value.cvt32());
-            c.and_(esi, 3855);
-            c.shl(esi, 4);
-            c.shr(value.cvt32(), 4);
-            c.and_(value.cvt32(), 3855);
-            c.or_(value.cvt32(), esi);
-            c.mov(esi, value.cvt32());
-            c.and_(esi, 13107);
-            c.shr(value.cvt32(), 2);
-            c.and_(value.cvt32(), 13107);
-            c.lea(esi, ptr[value + 4*rsi]);
-            c.mov(edx, esi);
-            c.and_(edx, 21845);
-            c.shr(esi, 1);
-            c.and_(esi, 21845);
-            c.lea(esi, ptr[rsi + 2*rdx]);
-            c.mov(value.cvt32(), esi);
+            c.movzx(value.cvt32(), value.cvt16());
+            c.mov(rsi, reinterpret_cast<u64>(BitReverseTable.data()));
+            c.movzx(value.cvt32(), word[rsi + value * 2]);
         }
     }
 
@@ -5106,30 +5660,30 @@ private:
             c.movzx(out, R0_1_2_3.cvt16());
             break;
         case 1:
-            c.rorx(out, R0_1_2_3, 16);
+            Rorx(out, R0_1_2_3, 16);
             c.movzx(out, out.cvt16()); // Needed?
             break;
         case 2:
-            c.rorx(out, R0_1_2_3, 32);
+            Rorx(out, R0_1_2_3, 32);
             c.movzx(out, out.cvt16()); // Needed?
             break;
         case 3:
-            c.rorx(out, R0_1_2_3, 48);
+            Rorx(out, R0_1_2_3, 48);
             c.movzx(out, out.cvt16()); // Needed?
             break;
         case 4:
             c.movzx(out, R4_5_6_7.cvt16());
             break;
         case 5:
-            c.rorx(out, R4_5_6_7, 16);
+            Rorx(out, R4_5_6_7, 16);
             c.movzx(out, out.cvt16()); // Needed?
             break;
         case 6:
-            c.rorx(out, R4_5_6_7, 32);
+            Rorx(out, R4_5_6_7, 32);
             c.movzx(out, out.cvt16()); // Needed?
             break;
         case 7:
-            c.rorx(out, R4_5_6_7, 48);
+            Rorx(out, R4_5_6_7, 48);
             c.movzx(out, out.cvt16()); // Needed?
             break;
         default:
@@ -5199,9 +5753,9 @@ private:
             StepAddress(unit, R4_5_6_7.cvt16(), step, dmod);
             break;
         case 5:
-            c.rorx(R4_5_6_7, R4_5_6_7, 16);
+            Rorx(R4_5_6_7, R4_5_6_7, 16);
             StepAddress(unit, R4_5_6_7.cvt16(), step, dmod);
-            c.rorx(R4_5_6_7, R4_5_6_7, 48);
+            Rorx(R4_5_6_7, R4_5_6_7, 48);
             break;
         case 6:
             c.ror(R4_5_6_7, 32);
@@ -5332,17 +5886,7 @@ private:
     }
 
     static RegName CounterAcc(RegName in) {
-        static std::unordered_map<RegName, RegName> map{
-                                                        {RegName::a0, RegName::a1},   {RegName::a1, RegName::a0},
-                                                        {RegName::b0, RegName::b1},   {RegName::b1, RegName::b0},
-                                                        {RegName::a0l, RegName::a1l}, {RegName::a1l, RegName::a0l},
-                                                        {RegName::b0l, RegName::b1l}, {RegName::b1l, RegName::b0l},
-                                                        {RegName::a0h, RegName::a1h}, {RegName::a1h, RegName::a0h},
-                                                        {RegName::b0h, RegName::b1h}, {RegName::b1h, RegName::b0h},
-                                                        {RegName::a0e, RegName::a1e}, {RegName::a1e, RegName::a0e},
-                                                        {RegName::b0e, RegName::b1e}, {RegName::b1e, RegName::b0e},
-                                                        };
-        return map.at(in);
+        return CounterAccTable[static_cast<std::size_t>(in)];
     }
 };
 
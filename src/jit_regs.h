@@ -410,6 +410,13 @@ struct JitRegisters {
     u16 imv = 0;
     ///< Swap register list end
 
+    /** Indirect address unit **/
+    // Follows the swap register list, as both are exchanged with their shadows on a context
+    // switch. See ShadowSwap.
+    std::array<ArpU, 4> arp{};
+    std::array<ArU, 2> ar{};
+    u32 pad3; // SSE padding
+
     u16 sv = 0;   // 16-bit two's complement shift value
 
     Flags flags{};  // Not a register, but used to store host flags register.
@@ -451,16 +458,6 @@ struct JitRegisters {
     Cfg cfgib{}, cfgjb{};
     u16 stepi0b = 0, stepj0b = 0;
 
-    /** Indirect address unit **/
-    std::array<ArpU, 4> arp{};
-    std::array<ArU, 2> ar{};
-    u32 pad3; // SSE padding
-
-    // Shadows for bank exchange
-    std::array<ArpU, 4> arpb{};
-    std::array<ArU, 2> arb{};
-    u32 pad4; // SSE padding
-
     /** Interrupt unit **/
 
     // interrupt pending bit
@@ -487,6 +484,14 @@ struct JitRegisters {
     std::array<u16, 3> imb{}; // interrupt enable bit
     u16 imvb = 0;
 
+    // Shadows for bank exchange
+    std::array<ArpU, 4> arpb{};
+    std::array<ArU, 2> arb{};
+    std::array<u16, 2> pad4; // SSE padding
+
+    // Data watchpoint page bitmap, owned by MemoryInterface (see SetWatchPages)
+    std::array<u64, MemoryInterface::WatchPageCount / 64> watch_pages{};
+
     void ShadowStore(Xbyak::CodeGenerator& c) {
         c.mov(word[REGS + offsetof(JitRegisters, flagsb)], FLAGS);
     }
@@ -495,23 +500,27 @@ struct JitRegisters {
         c.mov(FLAGS, word[REGS + offsetof(JitRegisters, flagsb)]);
     }
 
-    void SwapAllArArp(Xbyak::CodeGenerator& c) {
-        // std::swap(ar, arb);
-        // std::swap(arp, arpb);
-        c.movdqu(xmm0, xword[REGS + offsetof(JitRegisters, arp)]);
-        c.movdqu(xmm1, xword[REGS + offsetof(JitRegisters, arpb)]);
-        c.movdqu(xword[REGS + offsetof(JitRegisters, arp)], xmm1);
-        c.movdqu(xword[REGS + offsetof(JitRegisters, arpb)], xmm0);
-    }
-
-    void ShadowSwap(Xbyak::CodeGenerator& c) {
+    void ShadowSwap(Xbyak::CodeGenerator& c, bool avx2) {
         //shadow_swap_registers.Swap(this);
-        static_assert(offsetof(JitRegisters, imv) + sizeof(imv) - offsetof(JitRegisters, pcmhi) == sizeof(u64) * 2);
-        c.movdqu(xmm0, xword[REGS + offsetof(JitRegisters, pcmhi)]);
-        c.movdqu(xmm1, xword[REGS + offsetof(JitRegisters, pcmhib)]);
-        c.movdqu(xword[REGS + offsetof(JitRegisters, pcmhi)], xmm1);
-        c.movdqu(xword[REGS + offsetof(JitRegisters, pcmhib)], xmm0);
-        SwapAllArArp(c);
+        //std::swap(ar, arb);
+        //std::swap(arp, arpb);
+        // The swap list and ar/arp, and their shadows, are each one 32 byte region
+        static_assert(offsetof(JitRegisters, pad3) + sizeof(pad3) - offsetof(JitRegisters, pcmhi) == sizeof(u64) * 4);
+        static_assert(offsetof(JitRegisters, pad4) + sizeof(pad4) - offsetof(JitRegisters, pcmhib) == sizeof(u64) * 4);
+        if (avx2) {
+            c.vmovdqu(ymm0, yword[REGS + offsetof(JitRegisters, pcmhi)]);
+            c.vmovdqu(ymm1, yword[REGS + offsetof(JitRegisters, pcmhib)]);
+            c.vmovdqu(yword[REGS + offsetof(JitRegisters, pcmhi)], ymm1);
+            c.vmovdqu(yword[REGS + offsetof(JitRegisters, pcmhib)], ymm0);
+            c.vzeroupper();
+            return;
+        }
+        for (std::size_t offset = 0; offset < sizeof(u64) * 4; offset += sizeof(u64) * 2) {
+            c.movdqu(xmm0, xword[REGS + offsetof(JitRegisters, pcmhi) + offset]);
+            c.movdqu(xmm1, xword[REGS + offsetof(JitRegisters, pcmhib) + offset]);
+            c.movdqu(xword[REGS + offsetof(JitRegisters, pcmhi) + offset], xmm1);
+            c.movdqu(xword[REGS + offsetof(JitRegisters, pcmhib) + offset], xmm0);
+        }
     }
 
     void SwapAr(Xbyak::CodeGenerator& c, u16 index) {
@@ -656,7 +665,21 @@ struct JitRegisters {
         c.mov(word[REGS + offsetof(JitRegisters, mod2)], value);
     }
 
-    void GetSt0(Xbyak::CodeGenerator& c, Xbyak::Reg16 out, Mod0& mod0_const) {
+    // Rotate without touching host flags on BMI2. The fallback only changes CF and OF, which
+    // no caller has live across a rotate.
+    static void Rorx(Xbyak::CodeGenerator& c, const Xbyak::Reg& dst, const Xbyak::Reg& src, u8 imm,
+                     bool bmi2) {
+        if (bmi2) {
+            c.rorx(dst, src, imm);
+            return;
+        }
+        if (dst.getIdx() != src.getIdx()) {
+            c.mov(dst, src);
+        }
+        c.ror(dst, imm);
+    }
+
+    void GetSt0(Xbyak::CodeGenerator& c, Xbyak::Reg16 out, Mod0& mod0_const, bool bmi2) {
         c.mov(out, mod0_const.sat.Value() << 15);
         c.mov(out.cvt8(), byte[REGS + offsetof(JitRegisters, ie)]);
         c.ror(out, 1);
@@ -672,14 +695,14 @@ struct JitRegisters {
         c.and_(out.cvt8(), 0b11);
         c.or_(out.cvt8(), sil);
         c.ror(out, 8);
-        c.rorx(rsi, A[0], 32);
+        Rorx(c, rsi, A[0], 32, bmi2);
         c.and_(rsi, 0xFF);
         c.or_(out, sil);
         c.ror(out, 4);
     }
 
     template <typename T>
-    void SetSt0(Xbyak::CodeGenerator& c, T value, Mod0& mod0_const) {
+    void SetSt0(Xbyak::CodeGenerator& c, T value, Mod0& mod0_const, bool bmi2) {
         if constexpr (std::is_base_of_v<Xbyak::Reg, T>) {
             // Set sat in mod0
             c.and_(byte[REGS + offsetof(JitRegisters, mod0)], ~decltype(Mod0::sat)::mask);
@@ -697,10 +720,10 @@ struct JitRegisters {
 
             // Update flags.
             c.and_(FLAGS, ~decltype(Flags::st0_flags)::mask);
-            c.rorx(rsi, value, decltype(St0::fr)::position);
+            Rorx(c, rsi, value, decltype(St0::fr)::position, bmi2);
             c.and_(rsi, 0x3);
             c.or_(FLAGS.cvt8(), sil);
-            c.rorx(rsi, value, decltype(St0::flm_fvl)::position);
+            Rorx(c, rsi, value, decltype(St0::flm_fvl)::position, bmi2);
             c.shl(rsi, 2);
             c.and_(rsi, 0x1fc);
             c.or_(FLAGS.cvt16(), si);
@@ -734,7 +757,8 @@ struct JitRegisters {
         }
     }
 
-    void GetSt1(Xbyak::CodeGenerator& c, Xbyak::Reg16 out, Mod0& mod0_const, Mod1& mod1_const) {
+    void GetSt1(Xbyak::CodeGenerator& c, Xbyak::Reg16 out, Mod0& mod0_const, Mod1& mod1_const,
+                bool bmi2) {
         // Copy lowest byte to out, which is page
         c.xor_(out, out);
         c.mov(out.cvt8(), mod1_const.page.Value());
@@ -743,7 +767,7 @@ struct JitRegisters {
         c.or_(out.cvt16(), mod0_const.ps0.Value() << decltype(St1::ps0_alias)::position);
 
         // Load a1e and place it in out.
-        c.rorx(rsi, A[1], 32);
+        Rorx(c, rsi, A[1], 32, bmi2);
         c.shl(rsi, decltype(St1::a1e_alias)::position);
         c.or_(out.cvt16(), si);
     }
@@ -0,0 +1,87 @@
+// Direct form I biquad over 256 generated samples, run 32 times.
+// Result: the 256 filtered samples at data 0x0100, their sum at data 0x0001.
+
+segment p 0000
+br 0x0000$0100 always // reset vector
+reti always
+data 0000
+reti always
+data 0000
+reti always // int0
+data 0000
+data 0000
+data 0000
+data 0000
+data 0000
+data 0000
+data 0000
+reti always // int1
+data 0000
+data 0000
+data 0000
+data 0000
+data 0000
+data 0000
+
+segment p 0100
+mov 0x$f000 sp
+load 0x0030u8 page // history at 0x3000: x, x1, x2, y1, y2
+
+// coefficients b0, b1, b2, -a1, -a2 at 0x1000
+mov 0x$1000 r0
+mov 0x$0800 a0
+mov a0l [r0++]
+mov 0x$1000 a0
+mov a0l [r0++]
+mov 0x$0800 a0
+mov a0l [r0++]
+mov 0x$5a00 a0
+mov a0l [r0++]
+mov 0x$d600 a0
+mov a0l [r0++]
+
+clr a0 always
+mov 0x$3000 r0
+rep 0x0004u8
+mov a0l [r0++]
+
+// input samples at 0x2000
+mov 0x$2000 r0
+mov 0x$0000 a0
+bkrep 0x00ffu8 0x0000$0121
+mov a0l [r0++]
+add 0x$0d31 a0
+
+mov 0x$0000 r3
+bkrep 0x001fu8 0x0000$013f
+mov 0x$2000 r2
+mov 0x$0100 r1
+bkrep 0x00ffu8 0x0000$013e
+mov [r2++] a0l
+mov a0l [page:0x0000u8]
+mov 0x$1000 r4
+mov 0x$3000 r0
+clr a0 always
+mpy [r4++] [r0++] a0
+rep 0x0003u8
+mac [r4++] [r0++] a0
+add p* a0
+mov a0h [r1++]
+mov [page:0x0003u8] a1
+mov a1l [page:0x0004u8]
+mov a0h [page:0x0003u8]
+mov [page:0x0001u8] a1
+mov a1l [page:0x0002u8]
+mov [page:0x0000u8] a1
+mov a1l [page:0x0001u8]
+modr [r3++] // counts passes
+
+// checksum
+mov 0x$0100 r0
+clr a0 always
+rep 0x00ffu8
+add [r0++] a0
+mov a0l [0x$0001]
+mov 0x$600d a0
+mov a0l [0x$0000]
+brr 0xffff always
@@ -0,0 +1,70 @@
+// 16-tap FIR filter over 256 generated samples.
+// Result: 241 filtered samples at data 0x0100, their sum at data 0x0001.
+
+segment p 0000
+br 0x0000$0100 always // reset vector
+reti always
+data 0000
+reti always
+data 0000
+reti always // int0
+data 0000
+data 0000
+data 0000
+data 0000
+data 0000
+data 0000
+data 0000
+reti always // int1
+data 0000
+data 0000
+data 0000
+data 0000
+data 0000
+data 0000
+data 0000
+reti always // int2
+
+segment p 0100
+mov 0x$f000 sp
+
+// coefficients at 0x1000
+mov 0x$1000 r0
+mov 0x$0123 a0
+bkrep 0x000fu8 0x0000$010a
+mov a0l [r0++]
+add 0x$0777 a0 // 0109-010a
+
+// input samples at 0x2000
+mov 0x$2000 r0
+mov 0x$4321 a0
+bkrep 0x00ffu8 0x0000$0113
+mov a0l [r0++]
+add 0x$3b9d a0 // 0112-0113
+
+// one output per input position, repeated 64 times
+mov 0x$0040 a1
+mov 0x$2000 r2 // 0116
+mov 0x$0100 r1
+bkrep 0x00f0u8 0x0000$0125
+mov 0x$1000 r4
+mov r2 r0
+clr a0 always
+mpy [r4++] [r0++] a0
+rep 0x000eu8
+mac [r4++] [r0++] a0
+add p* a0
+mov a0h [r1++]
+modr [r2++] // 0125
+sub 0x$0001 a1
+br 0x0000$0116 neq
+
+// checksum
+mov 0x$0100 r0
+clr a0 always
+rep 0x00f0u8
+add [r0++] a0
+mov a0l [0x$0001]
+mov 0x$600d a0
+mov a0l [0x$0000]
+brr 0xffff always
@@ -0,0 +1,142 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include <teakra/teakra.h>
+#include "../common_types.h"
+
+// Runs one of the kernels in this directory on both backends and checks that they agree, and
+// optionally that they match known good values. A kernel signals completion by writing 0x600D to
+// data 0x0000. Its results live at data 0x0001 and from 0x0100 up; data 0x0002-0x00FF is scratch
+// whose contents may depend on timing.
+
+static constexpr u32 DspDataOffset = 0x40000;
+static constexpr u32 Slice = 4096;
+static constexpr u16 DoneMarker = 0x600D;
+static constexpr u16 ResultBegin = 0x0100;
+static constexpr u16 ResultEnd = 0x8000; // MMIO starts here
+
+static u16 DataRead(const Teakra::Teakra& teakra, u16 address) {
+    const auto& memory = teakra.GetDspMemory();
+    u16 value;
+    std::memcpy(&value, memory.data() + DspDataOffset + address * 2, sizeof(u16));
+    return value;
+}
+
+// FNV-1a over the result buffer, low byte of each word first
+static u32 ResultChecksum(const Teakra::Teakra& teakra) {
+    u32 checksum = 2166136261u;
+    for (u32 address = ResultBegin; address < ResultEnd; ++address) {
+        const u16 value = DataRead(teakra, static_cast<u16>(address));
+        checksum = (checksum ^ (value & 0xFF)) * 16777619u;
+        checksum = (checksum ^ (value >> 8)) * 16777619u;
+    }
+    return checksum;
+}
+
+struct Run {
+    std::unique_ptr<Teakra::Teakra> teakra;
+    bool done = false;
+    u64 cycles = 0;
+    u64 wall_ns = 0;
+};
+
+static Run RunKernel(const std::vector<u8>& raw, bool use_jit, u64 max_cycles) {
+    Run run;
+    run.teakra = std::make_unique<Teakra::Teakra>(use_jit);
+    auto& teakra = *run.teakra;
+    teakra.SetAHBMCallback({
+        [](u32) -> u8 { return 0; }, [](u32, u8) {},
+        [](u32) -> u16 { return 0; }, [](u32, u16) {},
+        [](u32) -> u32 { return 0; }, [](u32, u32) {},
+    });
+    if (teakra.LoadDsp1(raw).status != Teakra::Dsp1LoadResult::Status::Ok) {
+        std::printf("Cannot load the kernel image\n");
+        return run;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    for (u64 ran = 0; ran < max_cycles; ran += Slice) {
+        teakra.Run(Slice);
+        if (DataRead(teakra, 0) == DoneMarker) {
+            run.done = true;
+            break;
+        }
+    }
+    run.wall_ns = static_cast<u64>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                       std::chrono::steady_clock::now() - start)
+                                       .count());
+    run.cycles = teakra.GetStats().cycles;
+    return run;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::printf("Usage: %s <kernel.dsp1> [<result> <checksum> [max cycles]]\n", argv[0]);
+        return -1;
+    }
+    const bool has_golden = argc > 3;
+    const u16 golden_result = has_golden ? static_cast<u16>(std::strtoul(argv[2], nullptr, 16)) : 0;
+    const u32 golden_checksum =
+        has_golden ? static_cast<u32>(std::strtoul(argv[3], nullptr, 16)) : 0;
+    const u64 max_cycles = argc > 4 ? std::strtoull(argv[4], nullptr, 0) : 50'000'000;
+
+    FILE* file = std::fopen(argv[1], "rb");
+    if (!file) {
+        std::printf("Cannot open %s\n", argv[1]);
+        return -1;
+    }
+    std::fseek(file, 0, SEEK_END);
+    std::vector<u8> raw(std::ftell(file));
+    std::fseek(file, 0, SEEK_SET);
+    if (std::fread(raw.data(), 1, raw.size(), file) != raw.size()) {
+        std::fclose(file);
+        return -1;
+    }
+    std::fclose(file);
+
+    const Run interpreter = RunKernel(raw, false, max_cycles);
+    const Run jit = RunKernel(raw, true, max_cycles);
+
+    int result = 0;
+    for (const auto* run : {&interpreter, &jit}) {
+        const char* backend = run == &interpreter ? "interpreter" : "jit";
+        if (!run->done) {
+            std::printf("%s: kernel did not finish within %llu cycles\n", backend,
+                        (unsigned long long)max_cycles);
+            result = -1;
+            continue;
+        }
+        const u16 result_word = DataRead(*run->teakra, 1);
+        const u32 checksum = ResultChecksum(*run->teakra);
+        std::printf("%-12s result=%04X checksum=%08X cycles=%llu wall_ns=%llu\n", backend,
+                    result_word, checksum, (unsigned long long)run->cycles,
+                    (unsigned long long)run->wall_ns);
+        if (has_golden && (result_word != golden_result || checksum != golden_checksum)) {
+            std::printf("%s: expected result=%04X checksum=%08X\n", backend, golden_result,
+                        golden_checksum);
+            result = -3;
+        }
+    }
+    if (result != 0) {
+        return result;
+    }
+
+    unsigned mismatches = DataRead(*interpreter.teakra, 1) != DataRead(*jit.teakra, 1);
+    for (u32 address = ResultBegin; address < ResultEnd; ++address) {
+        const u16 expected = DataRead(*interpreter.teakra, static_cast<u16>(address));
+        const u16 actual = DataRead(*jit.teakra, static_cast<u16>(address));
+        if (expected != actual && mismatches++ < 16) {
+            std::printf("mismatch at data %04X: interpreter=%04X jit=%04X\n", address, expected,
+                        actual);
+        }
+    }
+    if (mismatches != 0) {
+        std::printf("%u words differ between the backends\n", mismatches);
+        return -2;
+    }
+    return 0;
+}
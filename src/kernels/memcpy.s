@@ -0,0 +1,57 @@
+// Block copies, run 64 times: 1024 words from program memory into data 0x4000 with a single
+// repeated instruction, then 0x4000 to 0x5000 through the accumulators in an unrolled loop.
+// Result: the sum of the words at 0x5000 at data 0x0001.
+
+segment p 0000
+br 0x0000$0100 always // reset vector
+reti always
+data 0000
+reti always
+data 0000
+reti always // int0
+data 0000
+data 0000
+data 0000
+data 0000
+data 0000
+data 0000
+data 0000
+reti always // int1
+data 0000
+data 0000
+data 0000
+data 0000
+data 0000
+data 0000
+
+segment p 0100
+mov 0x$f000 sp
+mov 0x$03ff r5 // word count - 1
+mov 0x$0000 r3
+bkrep 0x003fu8 0x0000$011c
+mov 0x$0000 r4
+mov 0x$4000 r0
+rep r5
+mov p->d [r4++] [r0++]
+mov 0x$4000 r0
+mov 0x$5000 r1
+bkrep 0x00ffu8 0x0000$011b
+mov [r0++] a0l
+mov [r0++] a1l
+mov a0l [r1++]
+mov a1l [r1++]
+mov [r0++] a0l
+mov [r0++] a1l
+mov a0l [r1++]
+mov a1l [r1++]
+modr [r3++] // counts passes
+
+// checksum
+mov 0x$5000 r0
+clr a0 always
+rep r5
+add [r0++] a0
+mov a0l [0x$0001]
+mov 0x$600d a0
+mov a0l [0x$0000]
+brr 0xffff always
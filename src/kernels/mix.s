@@ -0,0 +1,80 @@
+// Four voice mixer built from three nested block repeats: 32 passes, each mixing 4 voices of
+// 160 generated samples with per-voice gains into one output buffer.
+// Result: the mixed buffer at data 0x0100, its sum at data 0x0001.
+
+segment p 0000
+br 0x0000$0100 always // reset vector
+reti always
+data 0000
+reti always
+data 0000
+reti always // int0
+data 0000
+data 0000
+data 0000
+data 0000
+data 0000
+data 0000
+data 0000
+reti always // int1
+data 0000
+data 0000
+data 0000
+data 0000
+data 0000
+data 0000
+
+segment p 0100
+mov 0x$f000 sp
+
+// gains at 0x1000
+mov 0x$1000 r0
+mov 0x$2000 a0
+mov a0l [r0++]
+mov 0x$1800 a0
+mov a0l [r0++]
+mov 0x$e000 a0
+mov a0l [r0++]
+mov 0x$0c00 a0
+mov a0l [r0++]
+
+// voices at 0x2000, one after another
+mov 0x$2000 r0
+mov 0x$0000 a0
+mov 0x$0000 a1
+bkrep 0x0003u8 0x0000$011f
+bkrep 0x009fu8 0x0000$011c
+mov a0l [r0++]
+add 0x$0a41 a0
+add 0x$1357 a1 // next voice starts elsewhere
+mov a1 a0
+
+mov 0x$0000 r3
+bkrep 0x001fu8 0x0000$013a
+mov 0x$0100 r1
+clr a0 always
+rep 0x009fu8
+mov a0l [r1++]
+mov 0x$2000 r0
+mov 0x$1000 r4
+bkrep 0x0003u8 0x0000$0139
+mov [r4++] y0
+mov 0x$0100 r1
+bkrep 0x009fu8 0x0000$0138
+clr a1 always
+mov [r1] a1h
+mpy y0 [r0++] a0
+add p* a1
+mov a1h [r1++]
+modr [r5++] // counts voices
+modr [r3++] // counts passes
+
+// checksum
+mov 0x$0100 r0
+clr a0 always
+rep 0x009fu8
+add [r0++] a0
+mov a0l [0x$0001]
+mov 0x$600d a0
+mov a0l [0x$0000]
+brr 0xffff always
@@ -0,0 +1,55 @@
+// Busy-waits on timer 1 through MMIO, 64 times: start a single-shot count, then poll the counter
+// until it drops below 0x0100 or wraps past zero. Exercises MMIO reads and short backward branches.
+// Result: the number of completed rounds at data 0x0001. The number of polls depends on how the
+// backend batches cycles and is written to data 0x0002 for information only.
+
+segment p 0000
+br 0x0000$0100 always // reset vector
+reti always
+data 0000
+reti always
+data 0000
+reti always // int0
+data 0000
+data 0000
+data 0000
+data 0000
+data 0000
+data 0000
+data 0000
+reti always // int1
+data 0000
+data 0000
+data 0000
+data 0000
+data 0000
+data 0000
+
+segment p 0100
+mov 0x$f000 sp
+load 0x0080u8 page // MMIO registers at 0x8000
+mov 0x$0000 r2
+mov 0x$0000 r3
+bkrep 0x003fu8 0x0000$0117
+mov 0x$2000 a0
+mov a0l [page:0x0034u8] // TIMER1_SCL
+clr a0 always
+mov a0l [page:0x0036u8] // TIMER1_SCH
+mov 0x$0600 a0
+mov a0l [page:0x0030u8] // TIMER1_CFG: single count, MU, RES
+modr [r3++] // poll loop
+mov [page:0x0038u8] a0 // TIMER1_CCL
+cmp 0x$0100 a0
+br 0x0000$0111 gt
+modr [r2++]
+
+mov 0x$0000 a0
+mov a0l [page:0x0030u8] // leave the counter stopped at zero
+load 0x0000u8 page
+mov r2 a0l
+mov a0l [0x$0001]
+mov r3 a0l
+mov a0l [0x$0002]
+mov 0x$600d a0
+mov a0l [0x$0000]
+brr 0xffff always
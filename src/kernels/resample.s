@@ -0,0 +1,66 @@
+// Linear interpolation resampler stepping through 256 generated samples at a ratio of 0.75,
+// run 32 times. The phase lives in b0; its integer part is the input address.
+// Result: 256 resampled samples at data 0x0100, their sum at data 0x0001.
+
+segment p 0000
+br 0x0000$0100 always // reset vector
+reti always
+data 0000
+reti always
+data 0000
+reti always // int0
+data 0000
+data 0000
+data 0000
+data 0000
+data 0000
+data 0000
+data 0000
+reti always // int1
+data 0000
+data 0000
+data 0000
+data 0000
+data 0000
+data 0000
+
+segment p 0100
+mov 0x$f000 sp
+
+// input samples at 0x2000
+mov 0x$2000 r0
+mov 0x$0000 a0
+bkrep 0x00ffu8 0x0000$010a
+mov a0l [r0++]
+add 0x$0d31 a0
+
+clr b1 always
+mov 0x$c000 b1l // phase step
+mov 0x$0000 r3
+bkrep 0x001fu8 0x0000$0124
+clr b0 always
+mov 0x$2000 b0h
+mov 0x$0100 r1
+bkrep 0x00ffu8 0x0000$0123
+mov b0h r0
+clr a0 always
+clr a1 always
+mov [r0++] a0h
+mov [r0] a1h
+sub a0 a1
+mov a1h y0
+mpysu y0 b0l a1
+add p* a0
+mov a0h [r1++]
+add b1 b0
+modr [r3++] // counts passes
+
+// checksum
+mov 0x$0100 r0
+clr a0 always
+rep 0x00ffu8
+add [r0++] a0
+mov a0l [0x$0001]
+mov 0x$600d a0
+mov a0l [0x$0000]
+brr 0xffff always
@@ -0,0 +1,77 @@
+// Interrupt-driven work: timer 0 restarts every 0x0400 cycles and raises int0 through the ICU.
+// Each interrupt acknowledges the ICU and adds a constant to 16 words at data 0x0100 in a bkrep loop;
+// the 256th one pauses the timer. The main loop spins until it sees 256 ticks.
+// Result: the tick count at data 0x0001 and the buffer at 0x0100. The number of main loop
+// iterations depends on interrupt timing and is written to data 0x0002 for information only.
+
+segment p 0000
+br 0x0000$0100 always // reset vector
+reti always
+data 0000
+reti always
+data 0000
+br 0x0000$0200 always // int0
+data 0000
+data 0000
+data 0000
+data 0000
+data 0000
+data 0000
+reti always // int1
+data 0000
+data 0000
+data 0000
+data 0000
+data 0000
+data 0000
+
+segment p 0100
+mov 0x$f000 sp
+clr a0 always
+mov a0l [0x$0003] // tick count
+mov 0x$0400 a0
+mov a0l [0x$8024] // TIMER0_SCL
+clr a0 always
+mov a0l [0x$8026] // TIMER0_SCH
+mov 0x$0400 a0
+mov a0l [0x$8206] // ICU: IRQ 0xA (timer 0) to int0
+mov 0x$0604 a0
+mov a0l [0x$8020] // TIMER0_CFG: auto-restart, MU, RES
+mov 0x$0180 mod3 // ie, im0
+mov 0x$0000 r3
+modr [r3++] // wait loop
+mov [0x$0003] a1
+cmp 0x$0100 a1
+br 0x0000$0118 lt
+dint
+
+mov r3 a0l
+mov a0l [0x$0002]
+mov [0x$0003] a0
+mov a0l [0x$0001]
+mov 0x$600d a0
+mov a0l [0x$0000]
+brr 0xffff always
+
+segment p 0200
+push stt0
+push a0e
+pusha a0
+push r4
+mov 0x$0400 a0
+mov a0l [0x$8202] // ICU acknowledge
+mov 0x$0100 r4
+bkrep 0x000fu8 0x0000$020d
+addv 0x$0123 [r4++]
+mov [0x$0003] a0
+add 0x$0001 a0
+mov a0l [0x$0003]
+cmp 0x$0100 a0
+br 0x0000$021c neq
+mov 0x$0100 a0
+mov a0l [0x$8020] // TIMER0_CFG: pause
+pop r4
+popa a0
+pop a0e
+pop stt0
+reti always
@@ -0,0 +1,511 @@
+#include <cinttypes>
+#include <cstdarg>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+#include "ahbm.h"
+#include "apbp.h"
+#include "btdmp.h"
+#include "core_timing.h"
+#include "dma.h"
+#include "icu.h"
+#include "interpreter.h"
+#include "jit_regs.h"
+#include "lockstep.h"
+#include "memory_interface.h"
+#include "mmio.h"
+#include "register.h"
+#include "shared_memory.h"
+#include "teakra/disassembler.h"
+#include "timer.h"
+
+namespace Teakra {
+
+namespace {
+
+struct MmioAccess {};
+
+void Append(std::string& out, const char* format, ...) {
+    char buffer[256];
+    va_list args;
+    va_start(args, format);
+    std::vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    out += buffer;
+}
+
+class Comparer {
+public:
+    explicit Comparer(std::string& report) : report(report) {}
+
+    void Check(const char* name, u64 expected, u64 actual) {
+        if (expected != actual) {
+            Append(report, "  %s: interpreter %" PRIX64 ", jit %" PRIX64 "\n", name, expected,
+                   actual);
+            pass = false;
+        }
+    }
+
+    template <typename T, std::size_t N, typename U>
+    void CheckArray(const char* name, const std::array<T, N>& expected,
+                    const std::array<U, N>& actual) {
+        for (std::size_t i = 0; i < N; ++i) {
+            const std::string element = name + std::to_string(i);
+            Check(element.c_str(), expected[i], actual[i]);
+        }
+    }
+
+    bool pass = true;
+
+private:
+    std::string& report;
+};
+
+void LoadFlags(RegisterState& regs, Flags flags) {
+    regs.fr = flags.fr;
+    regs.flm = flags.flm;
+    regs.fvl = flags.fvl;
+    regs.fe = flags.fe;
+    regs.fc0 = flags.fc0;
+    regs.fv = flags.fv;
+    regs.fn = flags.fn;
+    regs.fm = flags.fm;
+    regs.fz = flags.fz;
+    regs.fc1 = flags.fc1;
+}
+
+void StoreFlags(Flags& flags, const RegisterState& regs) {
+    flags.fr.Assign(regs.fr);
+    flags.flm.Assign(regs.flm);
+    flags.fvl.Assign(regs.fvl);
+    flags.fe.Assign(regs.fe);
+    flags.fc0.Assign(regs.fc0);
+    flags.fv.Assign(regs.fv);
+    flags.fn.Assign(regs.fn);
+    flags.fm.Assign(regs.fm);
+    flags.fz.Assign(regs.fz);
+    flags.fc1.Assign(regs.fc1);
+}
+
+} // Anonymous namespace
+
+void LoadRegisterState(RegisterState& regs, const JitRegisters& jit_regs) {
+    // The interpreter's shadows can only be reached through the live registers. Load those with
+    // the shadow values first and store or swap them away; the live values are loaded after.
+    LoadFlags(regs, jit_regs.flagsb);
+    regs.ShadowStore();
+    regs.pcmhi = jit_regs.pcmhib;
+    regs.im = jit_regs.imb;
+    regs.imv = jit_regs.imvb;
+    regs.Set<mod0>(jit_regs.mod0b.raw);
+    regs.Set<mod1>(jit_regs.mod1b.raw);
+    regs.Set<mod2>(jit_regs.mod2b.raw);
+    regs.Set<ar0>(jit_regs.arb[0].raw);
+    regs.Set<ar1>(jit_regs.arb[1].raw);
+    regs.Set<arp0>(jit_regs.arpb[0].raw);
+    regs.Set<arp1>(jit_regs.arpb[1].raw);
+    regs.Set<arp2>(jit_regs.arpb[2].raw);
+    regs.Set<arp3>(jit_regs.arpb[3].raw);
+    regs.ShadowSwap();
+
+    regs.pc = jit_regs.pc;
+    regs.prpage = jit_regs.prpage;
+    regs.repc = jit_regs.repc;
+    regs.repcs = jit_regs.repcs;
+    regs.rep = jit_regs.rep;
+    regs.bcn = jit_regs.bcn;
+    regs.lp = jit_regs.lp;
+    for (std::size_t i = 0; i < regs.bkrep_stack.size(); ++i) {
+        regs.bkrep_stack[i].start = jit_regs.bkrep_stack[i].start;
+        regs.bkrep_stack[i].end = jit_regs.bkrep_stack[i].end;
+        regs.bkrep_stack[i].lc = jit_regs.bkrep_stack[i].lc;
+    }
+    regs.a = jit_regs.a;
+    regs.b = jit_regs.b;
+    regs.a1s = jit_regs.a1s;
+    regs.b1s = jit_regs.b1s;
+    regs.ccnta = jit_regs.ccnta;
+    regs.cpc = jit_regs.cpc;
+    regs.crep = jit_regs.crep;
+    regs.pcmhi = jit_regs.pcmhi;
+    regs.im = jit_regs.im;
+    regs.imv = jit_regs.imv;
+    regs.sv = jit_regs.sv;
+    LoadFlags(regs, jit_regs.flags);
+    regs.vtr0 = jit_regs.vtr0;
+    regs.vtr1 = jit_regs.vtr1;
+    regs.y = jit_regs.y;
+    regs.x = jit_regs.x;
+    regs.p = jit_regs.p;
+    regs.pe = jit_regs.pe;
+    regs.p0h_cbs = jit_regs.p0h_cbs;
+    regs.r = jit_regs.r;
+    regs.mixp = jit_regs.mixp;
+    regs.sp = jit_regs.sp;
+    regs.r0b = jit_regs.r0b;
+    regs.r1b = jit_regs.r1b;
+    regs.r4b = jit_regs.r4b;
+    regs.r7b = jit_regs.r7b;
+    regs.stepi0 = jit_regs.stepi0;
+    regs.stepj0 = jit_regs.stepj0;
+    regs.stepi0b = jit_regs.stepi0b;
+    regs.stepj0b = jit_regs.stepj0b;
+    regs.stepib = jit_regs.cfgib.step;
+    regs.modib = jit_regs.cfgib.mod;
+    regs.stepjb = jit_regs.cfgjb.step;
+    regs.modjb = jit_regs.cfgjb.mod;
+    regs.ip = jit_regs.ip;
+    regs.ipv = jit_regs.ipv;
+    regs.nimc = jit_regs.nimc;
+    regs.ic = jit_regs.ic;
+    regs.ou = jit_regs.ou;
+    regs.ie = jit_regs.ie;
+    regs.iu = jit_regs.iu;
+    regs.ext = jit_regs.ext;
+    regs.Set<cfgi>(jit_regs.cfgi.raw);
+    regs.Set<cfgj>(jit_regs.cfgj.raw);
+    regs.Set<mod0>(jit_regs.mod0.raw);
+    regs.Set<mod1>(jit_regs.mod1.raw);
+    regs.Set<mod2>(jit_regs.mod2.raw);
+    regs.Set<ar0>(jit_regs.ar[0].raw);
+    regs.Set<ar1>(jit_regs.ar[1].raw);
+    regs.Set<arp0>(jit_regs.arp[0].raw);
+    regs.Set<arp1>(jit_regs.arp[1].raw);
+    regs.Set<arp2>(jit_regs.arp[2].raw);
+    regs.Set<arp3>(jit_regs.arp[3].raw);
+}
+
+void LoadJitRegisters(JitRegisters& jit_regs, const RegisterState& regs) {
+    jit_regs.pc = regs.pc;
+    jit_regs.prpage = regs.prpage;
+    jit_regs.repc = regs.repc;
+    jit_regs.repcs = regs.repcs;
+    jit_regs.rep = regs.rep;
+    jit_regs.bcn = regs.bcn;
+    jit_regs.lp = regs.lp;
+    for (std::size_t i = 0; i < regs.bkrep_stack.size(); ++i) {
+        jit_regs.bkrep_stack[i].start = regs.bkrep_stack[i].start;
+        jit_regs.bkrep_stack[i].end = regs.bkrep_stack[i].end;
+        jit_regs.bkrep_stack[i].lc = regs.bkrep_stack[i].lc;
+    }
+    jit_regs.a = regs.a;
+    jit_regs.b = regs.b;
+    jit_regs.a1s = regs.a1s;
+    jit_regs.b1s = regs.b1s;
+    jit_regs.ccnta = regs.ccnta;
+    jit_regs.cpc = regs.cpc;
+    jit_regs.crep = regs.crep;
+    jit_regs.pcmhi = regs.pcmhi;
+    jit_regs.im = regs.im;
+    jit_regs.imv = regs.imv;
+    jit_regs.sv = regs.sv;
+    StoreFlags(jit_regs.flags, regs);
+    jit_regs.vtr0 = regs.vtr0;
+    jit_regs.vtr1 = regs.vtr1;
+    jit_regs.y = regs.y;
+    jit_regs.x = regs.x;
+    jit_regs.p = regs.p;
+    jit_regs.pe = regs.pe;
+    jit_regs.p0h_cbs = regs.p0h_cbs;
+    jit_regs.r = regs.r;
+    jit_regs.mixp = regs.mixp;
+    jit_regs.sp = regs.sp;
+    jit_regs.r0b = regs.r0b;
+    jit_regs.r1b = regs.r1b;
+    jit_regs.r4b = regs.r4b;
+    jit_regs.r7b = regs.r7b;
+    jit_regs.stepi0 = regs.stepi0;
+    jit_regs.stepj0 = regs.stepj0;
+    jit_regs.stepi0b = regs.stepi0b;
+    jit_regs.stepj0b = regs.stepj0b;
+    jit_regs.cfgib.step.Assign(regs.stepib);
+    jit_regs.cfgib.mod.Assign(regs.modib);
+    jit_regs.cfgjb.step.Assign(regs.stepjb);
+    jit_regs.cfgjb.mod.Assign(regs.modjb);
+    jit_regs.ip = regs.ip;
+    jit_regs.ipv = regs.ipv;
+    jit_regs.nimc = regs.nimc;
+    jit_regs.ic = regs.ic;
+    jit_regs.ou = regs.ou;
+    jit_regs.ie = regs.ie;
+    jit_regs.iu = regs.iu;
+    jit_regs.ext = regs.ext;
+    jit_regs.cfgi.raw = regs.Get<cfgi>();
+    jit_regs.cfgj.raw = regs.Get<cfgj>();
+    jit_regs.mod0.raw = regs.Get<mod0>();
+    jit_regs.mod1.raw = regs.Get<mod1>();
+    jit_regs.mod2.raw = regs.Get<mod2>();
+    jit_regs.ar[0].raw = regs.Get<ar0>();
+    jit_regs.ar[1].raw = regs.Get<ar1>();
+    jit_regs.arp[0].raw = regs.Get<arp0>();
+    jit_regs.arp[1].raw = regs.Get<arp1>();
+    jit_regs.arp[2].raw = regs.Get<arp2>();
+    jit_regs.arp[3].raw = regs.Get<arp3>();
+
+    // Bring the shadows into the live registers of a copy to read them
+    RegisterState shadows = regs;
+    shadows.ShadowRestore();
+    shadows.ShadowSwap();
+    StoreFlags(jit_regs.flagsb, shadows);
+    jit_regs.pcmhib = shadows.pcmhi;
+    jit_regs.imb = shadows.im;
+    jit_regs.imvb = shadows.imv;
+    jit_regs.mod0b.raw = shadows.Get<mod0>();
+    jit_regs.mod1b.raw = shadows.Get<mod1>();
+    jit_regs.mod2b.raw = shadows.Get<mod2>();
+    jit_regs.arb[0].raw = shadows.Get<ar0>();
+    jit_regs.arb[1].raw = shadows.Get<ar1>();
+    jit_regs.arpb[0].raw = shadows.Get<arp0>();
+    jit_regs.arpb[1].raw = shadows.Get<arp1>();
+    jit_regs.arpb[2].raw = shadows.Get<arp2>();
+    jit_regs.arpb[3].raw = shadows.Get<arp3>();
+}
+
+struct Lockstep::Impl {
+    struct Write {
+        u32 address; // physical word address
+        u16 old_value;
+        u16 value;
+    };
+
+    Impl(MemoryInterface& real, const LockstepConfig& config)
+        : config(config), shared_memory(real.GetMemory()), miu(real.memory_interface_unit),
+          dma{shared_memory, ahbm}, mmio{miu, icu, apbp_from_cpu, apbp_from_dsp, timer, dma, ahbm,
+                                         btdmp},
+          memory_interface{shared_memory, miu, mmio},
+          interpreter(core_timing, regs, memory_interface) {
+        // Watching every page sends all shadow data accesses through OnAccess
+        memory_interface.AddWatchpoint(0, 0xFFFF,
+                                       MemoryInterface::WatchRead | MemoryInterface::WatchWrite,
+                                       [this](u32, u16 address, u16, bool is_write) {
+                                           OnAccess(address, is_write);
+                                       });
+    }
+
+    // Write callbacks run before the access and read callbacks after it, so MMIO writes never
+    // reach even the dummy peripherals, and reads have only hit them.
+    void OnAccess(u16 address, bool is_write) {
+        if (miu.InMMIO(address)) {
+            throw MmioAccess();
+        }
+        if (is_write) {
+            const u32 physical = miu.ConvertDataAddress(address);
+            writes.push_back({physical, shared_memory.ReadWord(physical), 0});
+        }
+    }
+
+    void Report(const std::string& report) {
+        if (config.divergence_handler) {
+            config.divergence_handler(report);
+        }
+    }
+
+    LockstepConfig config;
+    std::minstd_rand random;
+
+    SharedMemory& shared_memory;
+    MemoryInterfaceUnit& miu;
+
+    // Peripherals only the shadow can reach; every access to them aborts the sample
+    std::array<Timer, 2> timer{};
+    std::array<Btdmp, 2> btdmp{};
+    CoreTiming core_timing{timer, btdmp};
+    ICU icu;
+    Apbp apbp_from_cpu, apbp_from_dsp;
+    Ahbm ahbm;
+    Dma dma;
+    MMIORegion mmio;
+    MemoryInterface memory_interface;
+
+    RegisterState regs;
+    Interpreter interpreter;
+
+    std::vector<Write> writes;
+    std::vector<u32> trace; // address of each instruction executed in the block
+};
+
+Lockstep::Lockstep(MemoryInterface& memory_interface, const LockstepConfig& config)
+    : impl(new Impl(memory_interface, config)) {}
+
+Lockstep::~Lockstep() = default;
+
+const LockstepConfig& Lockstep::GetConfig() const {
+    return impl->config;
+}
+
+u32 Lockstep::NextInterval() {
+    const u32 interval = std::max<u32>(impl->config.interval, 1);
+    if (!impl->config.randomize || interval == 1) {
+        return interval;
+    }
+    // Uniform over [1, 2 * interval - 1], which averages out to the configured interval
+    const u32 limit = interval > 0x80000000 ? 0xFFFFFFFF : interval * 2 - 1;
+    std::uniform_int_distribution<u32> distribution(1, limit);
+    return distribution(impl->random);
+}
+
+bool Lockstep::Checkpoint(const JitRegisters& jit_regs, u32 instructions) {
+    auto& regs = impl->regs;
+    LoadRegisterState(regs, jit_regs);
+    // The JIT only takes interrupts between blocks, so the shadow must not take any inside one
+    regs.ip = {};
+    regs.ipv = 0;
+
+    impl->writes.clear();
+    impl->trace.clear();
+    bool verifiable = true;
+    try {
+        for (u32 i = 0; i < instructions; ++i) {
+            impl->trace.push_back(regs.pc);
+            impl->interpreter.Run(1);
+        }
+    } catch (const UnimplementedException&) {
+        verifiable = false;
+    } catch (const MmioAccess&) {
+        verifiable = false;
+    }
+
+    // Keep the values the shadow wrote, then roll them back newest first for the JIT to run
+    for (auto& write : impl->writes) {
+        write.value = impl->shared_memory.ReadWord(write.address);
+    }
+    for (auto it = impl->writes.rbegin(); it != impl->writes.rend(); ++it) {
+        impl->shared_memory.WriteWord(it->address, it->old_value);
+    }
+    return verifiable;
+}
+
+bool Lockstep::Verify(const JitRegisters& jit_regs) {
+    const auto& regs = impl->regs;
+    std::string report;
+    Comparer c(report);
+    c.Check("pc", regs.pc, jit_regs.pc);
+    c.Check("prpage", regs.prpage, jit_regs.prpage);
+    c.Check("repc", regs.repc, jit_regs.repc);
+    c.Check("repcs", regs.repcs, jit_regs.repcs);
+    c.Check("rep", regs.rep, jit_regs.rep);
+    c.Check("bcn", regs.bcn, jit_regs.bcn);
+    c.Check("lp", regs.lp, jit_regs.lp);
+    for (std::size_t i = 0; i < regs.bkrep_stack.size(); ++i) {
+        const std::string frame = "bkrep" + std::to_string(i);
+        c.Check((frame + ".start").c_str(), regs.bkrep_stack[i].start,
+                jit_regs.bkrep_stack[i].start);
+        c.Check((frame + ".end").c_str(), regs.bkrep_stack[i].end, jit_regs.bkrep_stack[i].end);
+        c.Check((frame + ".lc").c_str(), regs.bkrep_stack[i].lc, jit_regs.bkrep_stack[i].lc);
+    }
+    c.CheckArray("a", regs.a, jit_regs.a);
+    c.CheckArray("b", regs.b, jit_regs.b);
+    c.Check("a1s", regs.a1s, jit_regs.a1s);
+    c.Check("b1s", regs.b1s, jit_regs.b1s);
+    c.Check("ccnta", regs.ccnta, jit_regs.ccnta);
+    c.Check("cpc", regs.cpc, jit_regs.cpc);
+    c.Check("crep", regs.crep, jit_regs.crep);
+    c.Check("sv", regs.sv, jit_regs.sv);
+    c.Check("vtr0", regs.vtr0, jit_regs.vtr0);
+    c.Check("vtr1", regs.vtr1, jit_regs.vtr1);
+    c.CheckArray("x", regs.x, jit_regs.x);
+    c.CheckArray("y", regs.y, jit_regs.y);
+    c.CheckArray("p", regs.p, jit_regs.p);
+    c.CheckArray("pe", regs.pe, jit_regs.pe);
+    c.Check("p0h_cbs", regs.p0h_cbs, jit_regs.p0h_cbs);
+    c.CheckArray("r", regs.r, jit_regs.r);
+    c.Check("mixp", regs.mixp, jit_regs.mixp);
+    c.Check("sp", regs.sp, jit_regs.sp);
+    c.Check("pcmhi", regs.pcmhi, jit_regs.pcmhi);
+    c.Check("r0b", regs.r0b, jit_regs.r0b);
+    c.Check("r1b", regs.r1b, jit_regs.r1b);
+    c.Check("r4b", regs.r4b, jit_regs.r4b);
+    c.Check("r7b", regs.r7b, jit_regs.r7b);
+    c.Check("stepi0", regs.stepi0, jit_regs.stepi0);
+    c.Check("stepj0", regs.stepj0, jit_regs.stepj0);
+    c.Check("stepi0b", regs.stepi0b, jit_regs.stepi0b);
+    c.Check("stepj0b", regs.stepj0b, jit_regs.stepj0b);
+    c.Check("cfgib", regs.stepib | (regs.modib << 7), jit_regs.cfgib.raw);
+    c.Check("cfgjb", regs.stepjb | (regs.modjb << 7), jit_regs.cfgjb.raw);
+    c.CheckArray("im", regs.im, jit_regs.im);
+    c.Check("imv", regs.imv, jit_regs.imv);
+    c.CheckArray("ic", regs.ic, jit_regs.ic);
+    c.Check("nimc", regs.nimc, jit_regs.nimc);
+    c.Check("ie", regs.ie, jit_regs.ie);
+    c.CheckArray("ou", regs.ou, jit_regs.ou);
+    c.CheckArray("ext", regs.ext, jit_regs.ext);
+    c.Check("fr", regs.fr, jit_regs.flags.fr);
+    c.Check("flm", regs.flm, jit_regs.flags.flm);
+    c.Check("fvl", regs.fvl, jit_regs.flags.fvl);
+    c.Check("fe", regs.fe, jit_regs.flags.fe);
+    c.Check("fc0", regs.fc0, jit_regs.flags.fc0);
+    c.Check("fv", regs.fv, jit_regs.flags.fv);
+    c.Check("fn", regs.fn, jit_regs.flags.fn);
+    c.Check("fm", regs.fm, jit_regs.flags.fm);
+    c.Check("fz", regs.fz, jit_regs.flags.fz);
+    c.Check("fc1", regs.fc1, jit_regs.flags.fc1);
+    c.Check("cfgi", regs.Get<cfgi>(), jit_regs.cfgi.raw);
+    c.Check("cfgj", regs.Get<cfgj>(), jit_regs.cfgj.raw);
+    c.Check("mod0", regs.Get<mod0>(), jit_regs.mod0.raw);
+    c.Check("mod1", regs.Get<mod1>(), jit_regs.mod1.raw);
+    c.Check("mod2", regs.Get<mod2>(), jit_regs.mod2.raw);
+    c.Check("ar0", regs.Get<ar0>(), jit_regs.ar[0].raw);
+    c.Check("ar1", regs.Get<ar1>(), jit_regs.ar[1].raw);
+    c.Check("arp0", regs.Get<arp0>(), jit_regs.arp[0].raw);
+    c.Check("arp1", regs.Get<arp1>(), jit_regs.arp[1].raw);
+    c.Check("arp2", regs.Get<arp2>(), jit_regs.arp[2].raw);
+    c.Check("arp3", regs.Get<arp3>(), jit_regs.arp[3].raw);
+
+    // The shadows, in the JIT's layout. The ou bits of mod0 are not swapped by the interpreter,
+    // which leaves the live ones in its mod0b.
+    JitRegisters shadows;
+    LoadJitRegisters(shadows, regs);
+    constexpr u16 flags_mask = decltype(Flags::st0_flags)::mask | decltype(Flags::fc1)::mask;
+    constexpr u16 mod0_mask =
+        static_cast<u16>(~(decltype(Mod0::ou0)::mask | decltype(Mod0::ou1)::mask));
+    c.Check("flagsb", shadows.flagsb.raw & flags_mask, jit_regs.flagsb.raw & flags_mask);
+    c.Check("pcmhib", shadows.pcmhib, jit_regs.pcmhib);
+    c.Check("mod0b", shadows.mod0b.raw & mod0_mask, jit_regs.mod0b.raw & mod0_mask);
+    c.Check("mod1b", shadows.mod1b.raw, jit_regs.mod1b.raw);
+    c.Check("mod2b", shadows.mod2b.raw, jit_regs.mod2b.raw);
+    c.CheckArray("imb", shadows.imb, jit_regs.imb);
+    c.Check("imvb", shadows.imvb, jit_regs.imvb);
+    for (std::size_t i = 0; i < shadows.arb.size(); ++i) {
+        c.Check(("arb" + std::to_string(i)).c_str(), shadows.arb[i].raw, jit_regs.arb[i].raw);
+    }
+    for (std::size_t i = 0; i < shadows.arpb.size(); ++i) {
+        c.Check(("arpb" + std::to_string(i)).c_str(), shadows.arpb[i].raw, jit_regs.arpb[i].raw);
+    }
+
+    for (const auto& write : impl->writes) {
+        const u16 actual = impl->shared_memory.ReadWord(write.address);
+        if (actual != write.value) {
+            Append(report, "  memory %05X: interpreter %04X, jit %04X\n", write.address,
+                   write.value, actual);
+            c.pass = false;
+        }
+    }
+    if (c.pass) {
+        return true;
+    }
+
+    std::string header;
+    Append(header, "Lockstep divergence in block at 0x%05X:\n", impl->trace.front());
+    for (const u32 pc : impl->trace) {
+        const u16 opcode = impl->memory_interface.ProgramRead(pc);
+        const u16 expansion = Disassembler::NeedExpansion(opcode)
+                                  ? impl->memory_interface.ProgramRead(pc + 1)
+                                  : 0;
+        Append(header, "  %05X: %s\n", pc, Disassembler::Do(opcode, expansion).c_str());
+    }
+    impl->Report(header + report);
+    return false;
+}
+
+void Lockstep::Adopt(RegisterState& regs, const JitRegisters& jit_regs) {
+    regs = impl->regs;
+    // Interrupts latched while the block ran are still pending for the new owner
+    regs.ip = jit_regs.ip;
+    regs.ipv = jit_regs.ipv;
+    for (const auto& write : impl->writes) {
+        impl->shared_memory.WriteWord(write.address, write.value);
+    }
+}
+
+} // namespace Teakra
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <memory>
+#include "common_types.h"
+#include "teakra/teakra.h"
+
+namespace Teakra {
+
+struct JitRegisters;
+struct RegisterState;
+class MemoryInterface;
+
+/**
+ * Runtime verification of sampled JIT blocks. Right before a sampled block runs, the shadow
+ * interpreter executes the same instructions from a copy of the JIT registers; its data writes
+ * go to the real memory and are rolled back right after, keeping the new values. Once the block
+ * has run, its registers and the words the shadow wrote are compared against the shadow's.
+ * The shadow has its own MMIO region over dummy peripherals, and a block touching MMIO is
+ * abandoned before any access could have side effects.
+ */
+class Lockstep {
+public:
+    Lockstep(MemoryInterface& memory_interface, const LockstepConfig& config);
+    ~Lockstep();
+
+    const LockstepConfig& GetConfig() const;
+
+    /// Number of blocks to run until the next sample
+    u32 NextInterval();
+
+    /// Runs the block about to execute on the shadow interpreter. Returns false if the block
+    /// can't be verified, in which case Verify must not be called for it.
+    bool Checkpoint(const JitRegisters& regs, u32 instructions);
+
+    /// Compares the state after the JIT ran the block with the shadow's. A divergence is
+    /// reported to the divergence handler, and false is returned.
+    bool Verify(const JitRegisters& regs);
+
+    /// Hands the shadow's state after the last verified block over to an interpreter, undoing
+    /// whatever the JIT got wrong in the written memory words.
+    void Adopt(RegisterState& regs, const JitRegisters& jit_regs);
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl;
+};
+
+/// Converts the JIT register file into the interpreter's, including the bank exchange and context
+/// switch shadows
+void LoadRegisterState(RegisterState& regs, const JitRegisters& jit_regs);
+
+/// Converts the interpreter register file into the JIT's. The fields the JIT derives from the
+/// memory interface unit and the watchpoints are left alone.
+void LoadJitRegisters(JitRegisters& jit_regs, const RegisterState& regs);
+
+} // namespace Teakra
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include "memory_interface.h"
 #include "mmio.h"
 #include "shared_memory.h"
@@ -17,15 +18,23 @@ void MemoryInterface::ProgramWrite(u32 address, u16 value) {
 }
 
 u16 MemoryInterface::DataRead(u16 address, bool bypass_mmio) {
+    u16 value;
     if (memory_interface_unit.InMMIO(address) && !bypass_mmio) {
-        return mmio.Read(memory_interface_unit.ToMMIO(address));
+        value = mmio.Read(memory_interface_unit.ToMMIO(address));
+    } else {
+        u32 converted = memory_interface_unit.ConvertDataAddress(address);
+        value = shared_memory.ReadWord(converted);
+    }
+    if (IsWatchedPage(address)) [[unlikely]] {
+        CheckWatchpoints(address, value, false);
     }
-    u32 converted = memory_interface_unit.ConvertDataAddress(address);
-    u16 value = shared_memory.ReadWord(converted);
     return value;
 }
 
 void MemoryInterface::DataWrite(u16 address, u16 value, bool bypass_mmio) {
+    if (IsWatchedPage(address)) [[unlikely]] {
+        CheckWatchpoints(address, value, true);
+    }
     if (memory_interface_unit.InMMIO(address) && !bypass_mmio) {
         return mmio.Write(memory_interface_unit.ToMMIO(address), value);
     }
@@ -33,6 +42,55 @@ void MemoryInterface::DataWrite(u16 address, u16 value, bool bypass_mmio) {
     shared_memory.WriteWord(converted, value);
 }
 
+// Splits [address, address + count) into runs of words that map onto consecutive shared
+// memory, and single words that need the full access path
+template <typename Run, typename Single>
+void MemoryInterface::ForEachDataRun(u16 address, std::size_t count, bool bypass_mmio, Run&& run,
+                                     Single&& single) const {
+    const auto& miu = memory_interface_unit;
+    std::size_t i = 0;
+    while (i < count) {
+        const u16 start = static_cast<u16>(address + i);
+        if (IsWatchedPage(start) || (!bypass_mmio && miu.InMMIO(start))) {
+            single(i);
+            ++i;
+            continue;
+        }
+        // Runs end at the watch page boundary, so they don't wrap either
+        const std::size_t page_left = (1u << WatchPageShift) - (start & ((1u << WatchPageShift) - 1));
+        const u32 converted = miu.ConvertDataAddress(start);
+        std::size_t length = 1;
+        while (length < page_left && i + length < count) {
+            const u16 next = static_cast<u16>(start + length);
+            if ((!bypass_mmio && miu.InMMIO(next)) ||
+                miu.ConvertDataAddress(next) != converted + length) {
+                break;
+            }
+            ++length;
+        }
+        run(i, converted, length);
+        i += length;
+    }
+}
+
+void MemoryInterface::DataReadWords(u16 address, std::span<u16> out, bool bypass_mmio) {
+    ForEachDataRun(
+        address, out.size(), bypass_mmio,
+        [&](std::size_t i, u32 converted, std::size_t length) {
+            shared_memory.ReadWords(converted, out.subspan(i, length));
+        },
+        [&](std::size_t i) { out[i] = DataRead(static_cast<u16>(address + i), bypass_mmio); });
+}
+
+void MemoryInterface::DataWriteWords(u16 address, std::span<const u16> in, bool bypass_mmio) {
+    ForEachDataRun(
+        address, in.size(), bypass_mmio,
+        [&](std::size_t i, u32 converted, std::size_t length) {
+            shared_memory.WriteWords(converted, in.subspan(i, length));
+        },
+        [&](std::size_t i) { DataWrite(static_cast<u16>(address + i), in[i], bypass_mmio); });
+}
+
 u16 MemoryInterface::DataReadA32(u32 address) const {
     u32 converted = (address & ((MemoryInterfaceUnit::DataMemoryBankSize*2)-1))
         + MemoryInterfaceUnit::DataMemoryOffset;
@@ -54,4 +112,42 @@ void MemoryInterface::MMIOWrite(u16 address, u16 value) {
     mmio.Write(address & (MemoryInterfaceUnit::MMIOSize - 1), value);
 }
 
+u32 MemoryInterface::AddWatchpoint(u16 begin, u16 end, u8 type, WatchCallback callback) {
+    ASSERT(begin <= end);
+    const u32 id = next_watchpoint_id++;
+    watchpoints.push_back({id, begin, end, type, std::move(callback)});
+    RebuildWatchPages();
+    return id;
+}
+
+void MemoryInterface::RemoveWatchpoint(u32 id) {
+    std::erase_if(watchpoints, [id](const Watchpoint& w) { return w.id == id; });
+    RebuildWatchPages();
+}
+
+void MemoryInterface::RebuildWatchPages() {
+    std::fill_n(watch_pages, WatchPageCount / 64, 0);
+    for (const auto& w : watchpoints) {
+        for (u32 page = w.begin >> WatchPageShift; page <= (w.end >> WatchPageShift); ++page) {
+            watch_pages[page / 64] |= 1ULL << (page % 64);
+        }
+    }
+    ++watch_generation;
+}
+
+void MemoryInterface::CheckWatchpoints(u16 address, u16 value, bool is_write) {
+    const u8 type = is_write ? WatchWrite : WatchRead;
+    // Callbacks may change the watchpoints, so call a copy of the matching ones
+    std::vector<WatchCallback> hits;
+    for (const auto& w : watchpoints) {
+        if ((w.type & type) && address >= w.begin && address <= w.end) {
+            hits.push_back(w.callback);
+        }
+    }
+    const u32 pc = *watch_pc;
+    for (const auto& callback : hits) {
+        callback(pc, address, value, is_write);
+    }
+}
+
 } // namespace Teakra
@@ -2,6 +2,9 @@
 
 #include <array>
 #include <bit>
+#include <functional>
+#include <span>
+#include <vector>
 #include "common_types.h"
 #include "crash.h"
 
@@ -82,19 +85,77 @@ class MMIORegion;
 
 class MemoryInterface {
 public:
+    using WatchCallback = std::function<void(u32 pc, u16 address, u16 value, bool is_write)>;
+
+    static constexpr u8 WatchRead = 1 << 0;
+    static constexpr u8 WatchWrite = 1 << 1;
+
+    // Watchpoints are tracked with a bitmap of 256-word pages so that the common
+    // (unwatched) path only costs a single bit test.
+    static constexpr u32 WatchPageShift = 8;
+    static constexpr u32 WatchPageCount = 0x10000 >> WatchPageShift;
+
+    struct Watchpoint {
+        u32 id;
+        u16 begin; // inclusive
+        u16 end;   // inclusive
+        u8 type;
+        WatchCallback callback;
+    };
+
     MemoryInterface(SharedMemory& shared_memory, MemoryInterfaceUnit& memory_interface_unit,
                     MMIORegion& mmio);
     u16 ProgramRead(u32 address) const;
     void ProgramWrite(u32 address, u16 value);
     u16 DataRead(u16 address, bool bypass_mmio = false); // not const because it can be a FIFO register
     void DataWrite(u16 address, u16 value, bool bypass_mmio = false);
+    // DataRead / DataWrite over consecutive addresses, wrapping at the end of the data space.
+    // Plain memory is copied in bulk; MMIO and watched pages go word by word.
+    void DataReadWords(u16 address, std::span<u16> out, bool bypass_mmio = false);
+    void DataWriteWords(u16 address, std::span<const u16> in, bool bypass_mmio = false);
     u16 DataReadA32(u32 address) const;
     void DataWriteA32(u32 address, u16 value);
     u16 MMIORead(u16 address);
     void MMIOWrite(u16 address, u16 value);
     SharedMemory& GetMemory() { return shared_memory; }
 
+    u32 AddWatchpoint(u16 begin, u16 end, u8 type, WatchCallback callback);
+    void RemoveWatchpoint(u32 id);
+    bool HasWatchpoints() const {
+        return !watchpoints.empty();
+    }
+    bool IsWatchedPage(u16 address) const {
+        const u32 page = address >> WatchPageShift;
+        return (watch_pages[page / 64] >> (page % 64)) & 1;
+    }
+
+    // The JIT keeps its own copy of the page bitmap next to the guest registers
+    void SetWatchPages(u64* pages) {
+        watch_pages = pages;
+        RebuildWatchPages();
+    }
+
+    void SetWatchPc(const u32* pc) {
+        watch_pc = pc;
+    }
+
+private:
+    template <typename Run, typename Single>
+    void ForEachDataRun(u16 address, std::size_t count, bool bypass_mmio, Run&& run,
+                        Single&& single) const;
+    void RebuildWatchPages();
+    void CheckWatchpoints(u16 address, u16 value, bool is_write);
+
 public:
+    std::array<u64, WatchPageCount / 64> watch_page_storage{};
+    u64* watch_pages{watch_page_storage.data()};
+    u32 watch_pc_storage = 0;
+    const u32* watch_pc{&watch_pc_storage};
+    // Bumped on every watchpoint change so the JIT recompiles blocks with stale watch checks
+    u32 watch_generation = 0;
+    std::vector<Watchpoint> watchpoints;
+    u32 next_watchpoint_id = 1;
+
     SharedMemory& shared_memory;
     MemoryInterfaceUnit& memory_interface_unit;
     MMIORegion& mmio;
@@ -1,7 +1,7 @@
 #include <cstdio>
 #include <cstdlib>
-#include <memory>
 #include "../test.h"
+#include "../test_container.h"
 
 int main(int argc, char** argv) {
     if (argc < 2) {
@@ -9,8 +9,9 @@ int main(int argc, char** argv) {
         return -1;
     }
 
-    std::unique_ptr<std::FILE, decltype(&std::fclose)> f{std::fopen(argv[1], "wb"), std::fclose};
-    if (!f) {
+    // The hardware test runner reads raw TestCase arrays
+    Teakra::Test::TestCaseWriter writer(argv[1], Teakra::Test::TestFormat::Raw);
+    if (!writer.IsOpen()) {
         std::fprintf(stderr, "Unable to open file %s. Exiting...\n", argv[1]);
         return -2;
     }
@@ -41,7 +42,7 @@ int main(int argc, char** argv) {
                         u16 step_true = SignExtend<5>(step) & 0x7F;
                         for (u16 mod = 0; mod < 0x10; ++mod) {
                             test_case.before.cfgi = step_true | (mod << 7);
-                            if (std::fwrite(&test_case, sizeof(test_case), 1, f.get()) == 0) {
+                            if (!writer.Write(test_case)) {
                                 std::fprintf(stderr,
                                              "Unable to completely write test case. Exiting...\n");
                                 return -3;
@@ -53,5 +54,10 @@ int main(int argc, char** argv) {
         }
     }
 
+    if (!writer.Finish()) {
+        std::fprintf(stderr, "Unable to completely write test case. Exiting...\n");
+        return -3;
+    }
+
     return 0;
 }
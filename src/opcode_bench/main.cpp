@@ -0,0 +1,249 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include "../ahbm.h"
+#include "../apbp.h"
+#include "../btdmp.h"
+#include "../core_timing.h"
+#include "../decoder.h"
+#include "../dma.h"
+#include "../icu.h"
+#include "../interpreter.h"
+#include "../jit_no_ir.h"
+#include "../memory_interface.h"
+#include "../mmio.h"
+#include "../shared_memory.h"
+#include "../test.h"
+#include "../test_container.h"
+#include "../test_state.h"
+#include "../timer.h"
+
+// Measures the cost of every decoder entry on both backends, using the test case files written by
+// test_generator, mod_test_generator and step2_test_generator as operands. Each case is placed in
+// a bkrep loop so that the measured time is dominated by the instruction itself.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr u16 LoopCount = 0xFF;  // bkrep runs the body LoopCount + 1 times
+constexpr u16 Unroll = 16;       // copies of the instruction inside the loop body
+constexpr u64 Executed = (LoopCount + 1) * Unroll;
+constexpr std::size_t MaxCasesPerGroup = 8;
+constexpr double OutlierFactor = 4.0;
+
+// Instructions that leave the loop body or manipulate the loop machinery itself
+const std::set<std::string> ControlFlow{
+    "bkrep",   "bkrep_r6", "bkreprst", "bkreprst_memsp", "bkrepsto", "bkrepsto_memsp",
+    "br",      "brr",      "break_",   "call",           "calla",    "callr",
+    "mov_pc",  "movpdw",   "rep",      "rep_r6",         "ret",      "retd",
+    "reti",    "retic",    "retid",    "retidc",         "rets",     "trap",
+};
+
+struct Group {
+    std::vector<TestCase> cases;
+    u64 interpreter_ns = 0;
+    u64 jit_ns = 0;
+    u64 instructions = 0;
+    Teakra::JitStats compile{};
+    bool unimplemented = false;
+};
+
+void LoadProgram(Teakra::MemoryInterface& mem, const TestCase& test_case, bool expanded) {
+    const u16 size = expanded ? 2 : 1;
+    const u16 end = 2 + Unroll * size - 1;
+    mem.ProgramWrite(0, 0x5C00 | LoopCount); // bkrep #LoopCount, end
+    mem.ProgramWrite(1, end);
+    for (u16 i = 0; i < Unroll; ++i) {
+        mem.ProgramWrite(2 + i * size, test_case.opcode);
+        if (expanded) {
+            mem.ProgramWrite(3 + i * size, test_case.expand);
+        }
+    }
+    // Leave nops behind the loop in case a backend runs past it
+    for (u16 i = end + 1; i < end + 16; ++i) {
+        mem.ProgramWrite(i, 0);
+    }
+}
+
+void LoadData(Teakra::MemoryInterface& mem, const State& state) {
+    for (u16 offset = 0; offset < TestSpaceSize; ++offset) {
+        mem.DataWrite(TestSpaceX + offset, state.test_space_x[offset]);
+        mem.DataWrite(TestSpaceY + offset, state.test_space_y[offset]);
+    }
+}
+
+template <typename F>
+u64 Time(F&& f) {
+    const auto start = Clock::now();
+    f();
+    return static_cast<u64>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+}
+
+double Median(std::vector<double> values) {
+    if (values.empty()) {
+        return 0;
+    }
+    std::nth_element(values.begin(), values.begin() + values.size() / 2, values.end());
+    return values[values.size() / 2];
+}
+
+} // Anonymous namespace
+
+int main(int argc, char** argv) {
+    std::set<std::string> skip = ControlFlow;
+    std::vector<const char*> files;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--skip") == 0 && i + 1 < argc) {
+            skip.insert(argv[++i]);
+        } else {
+            files.push_back(argv[i]);
+        }
+    }
+    if (files.empty()) {
+        std::fprintf(stderr, "Usage: %s [--skip name]... <test case file>...\n", argv[0]);
+        return -1;
+    }
+
+    std::map<std::string, Group> groups;
+    for (const char* filename : files) {
+        Teakra::Test::TestCaseReader reader(filename);
+        if (!reader.IsOpen()) {
+            std::fprintf(stderr, "Unable to open file %s. Exiting...\n", filename);
+            return -2;
+        }
+        TestCase test_case;
+        for (std::size_t i = 0; i < reader.Size() && reader.Get(i, test_case); ++i) {
+            const auto name = Decode<Teakra::Interpreter>(test_case.opcode).GetName();
+            if (skip.count(name)) {
+                continue;
+            }
+            auto& group = groups[name];
+            if (group.cases.size() < MaxCasesPerGroup) {
+                group.cases.push_back(test_case);
+            }
+        }
+    }
+
+    std::vector<u8> dsp_memory(0x80000);
+    std::array<Teakra::Timer, 2> timer{};
+    std::array<Teakra::Btdmp, 2> btdmp{};
+    Teakra::CoreTiming core_timing{timer, btdmp};
+    Teakra::SharedMemory shared_memory{dsp_memory.data()};
+    Teakra::MemoryInterfaceUnit miu;
+    Teakra::ICU icu;
+    Teakra::Apbp apbp_from_cpu, apbp_from_dsp;
+    Teakra::Ahbm ahbm;
+    Teakra::Dma dma{shared_memory, ahbm};
+    Teakra::MMIORegion mmio{miu, icu, apbp_from_cpu, apbp_from_dsp, timer, dma, ahbm, btdmp};
+    Teakra::MemoryInterface memory_interface{shared_memory, miu, mmio};
+    Teakra::RegisterState regs;
+    Teakra::Interpreter interpreter(core_timing, regs, memory_interface);
+    Teakra::JitRegisters jregs;
+    Teakra::EmitX64 jit(core_timing, jregs, memory_interface);
+
+    for (auto& [name, group] : groups) {
+        const bool expanded = Decode<Teakra::Interpreter>(group.cases[0].opcode).NeedExpansion();
+
+        // The interpreter throws on unimplemented behaviour, and the JIT stops in front of it.
+        // Only hand cases to the JIT after the interpreter got through them.
+        try {
+            for (const auto& test_case : group.cases) {
+                LoadProgram(memory_interface, test_case, expanded);
+                Teakra::Test::LoadState(regs, test_case.before);
+                LoadData(memory_interface, test_case.before);
+                interpreter.Run(Executed + 1); // warm up
+                Teakra::Test::LoadState(regs, test_case.before);
+                LoadData(memory_interface, test_case.before);
+                group.interpreter_ns += Time([&] { interpreter.Run(Executed + 1); });
+            }
+        } catch (const Teakra::UnimplementedException&) {
+            group.unimplemented = true;
+            continue;
+        }
+
+        for (const auto& test_case : group.cases) {
+            LoadProgram(memory_interface, test_case, expanded);
+            jit.Reset();
+            Teakra::Test::LoadState(jregs, test_case.before);
+            LoadData(memory_interface, test_case.before);
+            const Teakra::JitStats before = jit.compile_stats;
+            jit.Run(Executed + 1); // compiles the loop
+            if (jit.unimplemented) {
+                group.unimplemented = true;
+                break;
+            }
+            group.compile.blocks_compiled += jit.compile_stats.blocks_compiled - before.blocks_compiled;
+            group.compile.instructions_compiled +=
+                jit.compile_stats.instructions_compiled - before.instructions_compiled;
+            group.compile.host_bytes += jit.compile_stats.host_bytes - before.host_bytes;
+            group.compile.compile_ns += jit.compile_stats.compile_ns - before.compile_ns;
+
+            Teakra::Test::LoadState(jregs, test_case.before);
+            LoadData(memory_interface, test_case.before);
+            group.jit_ns += Time([&] { jit.Run(Executed + 1); });
+        }
+        if (!group.unimplemented) {
+            group.instructions = group.cases.size() * Executed;
+        }
+    }
+
+    struct Row {
+        const std::string* name;
+        const Group* group;
+        double interpreter, jit, compile, bytes;
+    };
+    std::vector<Row> rows;
+    for (const auto& [name, group] : groups) {
+        if (group.unimplemented || group.instructions == 0) {
+            continue;
+        }
+        const double compiled = static_cast<double>(std::max<u64>(group.compile.instructions_compiled, 1));
+        rows.push_back({&name, &group, static_cast<double>(group.interpreter_ns) / group.instructions,
+                        static_cast<double>(group.jit_ns) / group.instructions,
+                        group.compile.compile_ns / compiled, group.compile.host_bytes / compiled});
+    }
+
+    std::vector<double> jit_times, sizes;
+    for (const auto& row : rows) {
+        jit_times.push_back(row.jit);
+        sizes.push_back(row.bytes);
+    }
+    const double median_jit = Median(jit_times);
+    const double median_bytes = Median(sizes);
+
+    std::sort(rows.begin(), rows.end(), [](const Row& a, const Row& b) { return a.jit > b.jit; });
+
+    std::printf("%-24s %5s %10s %10s %8s %12s %10s  %s\n", "instruction", "cases", "interp_ns",
+                "jit_ns", "speedup", "compile_ns", "bytes", "flags");
+    for (const auto& row : rows) {
+        std::string flags;
+        // Large blocks per instruction mean the emitter calls out to a C++ helper
+        if (row.bytes > median_bytes * OutlierFactor) {
+            flags += " helper";
+        }
+        if (row.jit > median_jit * OutlierFactor) {
+            flags += " slow";
+        }
+        if (row.jit >= row.interpreter) {
+            flags += " no-speedup";
+        }
+        std::printf("%-24s %5zu %10.2f %10.2f %8.2f %12.1f %10.1f %s\n", row.name->c_str(),
+                    row.group->cases.size(), row.interpreter, row.jit,
+                    row.jit > 0 ? row.interpreter / row.jit : 0.0, row.compile, row.bytes,
+                    flags.c_str());
+    }
+    for (const auto& [name, group] : groups) {
+        if (group.unimplemented) {
+            std::printf("%-24s %5zu unimplemented\n", name.c_str(), group.cases.size());
+        }
+    }
+    return 0;
+}
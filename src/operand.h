@@ -1,4 +1,6 @@
 #pragma once
+#include <array>
+#include <cstddef>
 #include "common_types.h"
 
 template <typename T, T... values>
@@ -164,6 +166,19 @@ enum class RegName {
     undefine,
 };
 
+// Maps an accumulator part to the same part of its counterpart (a0 <-> a1, b0 <-> b1), which
+// only differ in bit 2 of the enum value. Everything else maps to undefine.
+constexpr std::array<RegName, static_cast<std::size_t>(RegName::undefine) + 1> CounterAccTable = [] {
+    std::array<RegName, static_cast<std::size_t>(RegName::undefine) + 1> table{};
+    table.fill(RegName::undefine);
+    for (std::size_t i = 0; i <= static_cast<std::size_t>(RegName::b1e); ++i) {
+        table[i] = static_cast<RegName>(i ^ 4);
+    }
+    return table;
+}();
+static_assert(CounterAccTable[static_cast<std::size_t>(RegName::a0h)] == RegName::a1h);
+static_assert(CounterAccTable[static_cast<std::size_t>(RegName::b1e)] == RegName::b0e);
+
 template <RegName ... reg_names>
 using RegOperand = EnumOperand <RegName, reg_names...>;
 
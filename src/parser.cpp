@@ -1,54 +1,193 @@
 #include <algorithm>
-#include <functional>
-#include <optional>
-#include <unordered_map>
-#include <variant>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
 #include "../include/teakra/disassembler.h"
 #include "common_types.h"
 #include "crash.h"
 #include "parser.h"
 
-using NodeAsConst = std::string;
-struct NodeAsExpansion {};
+namespace Teakra {
 
-bool operator==(NodeAsExpansion, NodeAsExpansion) {
-    return true;
-}
+namespace {
+
+// The parse trie is stored in flat arrays. The edges of a node are contiguous and sorted by
+// token, and tokens are numbered in sorted order, so a lookup is a binary search per token.
+struct ParserNode {
+    u32 first_edge;
+    u16 edge_count;
+    u16 opcode;
+    u8 end;
+    u8 expansion;
+};
+
+struct ParserEdge {
+    u16 token;
+    u32 child;
+};
+
+struct ParserTrie {
+    const char* token_pool;
+    const u32* token_offsets; // token i spans [token_offsets[i], token_offsets[i + 1])
+    const ParserNode* nodes;
+    const ParserEdge* edges;
+};
 
-namespace std {
-template <>
-struct hash<NodeAsExpansion> {
-    typedef NodeAsExpansion argument_type;
-    typedef std::size_t result_type;
-    result_type operator()(argument_type const& s) const {
-        return 0x12345678;
+struct ParserTrieData {
+    std::string token_pool;
+    std::vector<u32> token_offsets;
+    std::vector<ParserNode> nodes;
+    std::vector<ParserEdge> edges;
+
+    ParserTrie View() const {
+        return {token_pool.data(), token_offsets.data(), nodes.data(), edges.data()};
     }
 };
-} // namespace std
 
-namespace Teakra {
-class ParserImpl : public Parser {
-public:
-    using NodeKey = std::variant<NodeAsConst, NodeAsExpansion>;
+struct Entry {
+    std::vector<u16> tokens;
+    u16 opcode;
+    bool expansion;
+};
 
-    struct Node {
-        bool end = false;
-        u16 opcode = 0;
-        bool expansion = false;
-        std::unordered_map<NodeKey, std::unique_ptr<Node>> children;
+// Adds the node for entries [begin, end), which share their first `depth` tokens
+u32 BuildNode(ParserTrieData& data, const std::vector<Entry>& entries, std::size_t begin,
+              std::size_t end, std::size_t depth) {
+    const u32 index = static_cast<u32>(data.nodes.size());
+    data.nodes.push_back({});
+
+    // Entries are sorted, so the ones ending here come first. Among equal token lists the
+    // lowest opcode wins, and the others may only differ from it in don't-care bits.
+    std::size_t i = begin;
+    if (entries[i].tokens.size() == depth) {
+        const Entry& first = entries[i];
+        data.nodes[index].end = 1;
+        data.nodes[index].opcode = first.opcode;
+        data.nodes[index].expansion = first.expansion;
+        for (; i < end && entries[i].tokens.size() == depth; ++i) {
+            ASSERT((first.opcode & (u16)(~entries[i].opcode)) == 0);
+        }
+    }
+
+    struct Group {
+        u16 token;
+        std::size_t begin, end;
     };
+    std::vector<Group> groups;
+    while (i < end) {
+        const u16 token = entries[i].tokens[depth];
+        std::size_t j = i;
+        while (j < end && entries[j].tokens[depth] == token) {
+            ++j;
+        }
+        groups.push_back({token, i, j});
+        i = j;
+    }
 
-    Node root;
+    // Edges of a node are reserved before recursing, to keep them contiguous
+    const u32 first_edge = static_cast<u32>(data.edges.size());
+    data.nodes[index].first_edge = first_edge;
+    data.nodes[index].edge_count = static_cast<u16>(groups.size());
+    data.edges.resize(data.edges.size() + groups.size());
+    for (std::size_t g = 0; g < groups.size(); ++g) {
+        const u32 child = BuildNode(data, entries, groups[g].begin, groups[g].end, depth + 1);
+        data.edges[first_edge + g] = {groups[g].token, child};
+    }
+    return index;
+}
+
+// Splits disassembler tokens such as "mov p->d" into words, so that the parser accepts the
+// same whitespace separated text that the disassembler prints
+std::vector<std::string> SplitWords(const std::vector<std::string>& list) {
+    std::vector<std::string> words;
+    for (const auto& token : list) {
+        std::size_t begin = 0;
+        while (begin < token.size()) {
+            const std::size_t end = std::min(token.find(' ', begin), token.size());
+            if (end != begin) {
+                words.push_back(token.substr(begin, end - begin));
+            }
+            begin = end + 1;
+        }
+    }
+    return words;
+}
+
+ParserTrieData BuildParserTrie() {
+    std::vector<std::vector<std::string>> token_lists(0x10000);
+    std::vector<std::string> tokens;
+    for (u32 opcode = 0; opcode < 0x10000; ++opcode) {
+        token_lists[opcode] = SplitWords(Disassembler::GetTokenList((u16)opcode));
+        tokens.insert(tokens.end(), token_lists[opcode].begin(), token_lists[opcode].end());
+    }
+    std::sort(tokens.begin(), tokens.end());
+    tokens.erase(std::unique(tokens.begin(), tokens.end()), tokens.end());
+    ASSERT(tokens.size() <= 0x10000);
+
+    ParserTrieData data;
+    for (const auto& token : tokens) {
+        data.token_offsets.push_back(static_cast<u32>(data.token_pool.size()));
+        data.token_pool += token;
+    }
+    data.token_offsets.push_back(static_cast<u32>(data.token_pool.size()));
+
+    std::vector<Entry> entries;
+    for (u32 opcode = 0; opcode < 0x10000; ++opcode) {
+        const auto& list = token_lists[opcode];
+        if (std::any_of(list.begin(), list.end(), [](const auto& token) {
+                return token.find("[ERROR]") != std::string::npos;
+            }))
+            continue;
+
+        Entry entry{{}, (u16)opcode, Disassembler::NeedExpansion((u16)opcode)};
+        for (const auto& token : list) {
+            entry.tokens.push_back(static_cast<u16>(
+                std::lower_bound(tokens.begin(), tokens.end(), token) - tokens.begin()));
+        }
+        entries.push_back(std::move(entry));
+    }
+    std::stable_sort(entries.begin(), entries.end(),
+                     [](const Entry& a, const Entry& b) { return a.tokens < b.tokens; });
+
+    BuildNode(data, entries, 0, entries.size(), 0);
+    return data;
+}
+
+#ifdef TEAKRA_PARSER_TABLE
+// Generated at build time by parser_gen, defining the ParserTable* arrays
+#include "parser_table.inc"
+
+const ParserTrie& GetParserTrie() {
+    static const ParserTrie trie{ParserTableTokenPool, ParserTableTokenOffsets, ParserTableNodes,
+                                 ParserTableEdges};
+    return trie;
+}
+#else
+const ParserTrie& GetParserTrie() {
+    static const ParserTrieData data = BuildParserTrie();
+    static const ParserTrie trie = data.View();
+    return trie;
+}
+#endif
+
+class ParserImpl : public Parser {
+public:
+    explicit ParserImpl(const ParserTrie& trie) : trie(trie) {}
 
     Opcode Parse(const std::vector<std::string>& tokens) override {
-        Node* current = &root;
-        for (auto& token : tokens) {
-            auto const_find = current->children.find(token);
-            if (const_find != current->children.end()) {
-                current = const_find->second.get();
-            } else {
+        const ParserNode* current = &trie.nodes[0];
+        for (const auto& token : tokens) {
+            const ParserEdge* begin = trie.edges + current->first_edge;
+            const ParserEdge* end = begin + current->edge_count;
+            const ParserEdge* edge =
+                std::lower_bound(begin, end, token, [this](const ParserEdge& e, const auto& t) {
+                    return Token(e.token) < std::string_view(t);
+                });
+            if (edge == end || Token(edge->token) != token) {
                 return Opcode{Opcode::Invalid};
             }
+            current = &trie.nodes[edge->child];
         }
         if (!current->end) {
             return Opcode{Opcode::Invalid};
@@ -56,37 +195,73 @@ public:
         return Opcode{current->expansion ? Opcode::ValidWithExpansion : Opcode::Valid,
                       current->opcode};
     }
+
+private:
+    std::string_view Token(u16 token) const {
+        const u32 offset = trie.token_offsets[token];
+        return {trie.token_pool + offset, trie.token_offsets[token + 1] - offset};
+    }
+
+    const ParserTrie& trie;
 };
 
+void WriteEscaped(std::FILE* out, std::string_view text) {
+    std::fputc('"', out);
+    for (const char c : text) {
+        if (c == '"' || c == '\\') {
+            std::fputc('\\', out);
+        }
+        std::fputc(c, out);
+    }
+    std::fputc('"', out);
+}
+
+} // Anonymous namespace
+
 std::unique_ptr<Parser> GenerateParser() {
-    std::unique_ptr<ParserImpl> parser = std::make_unique<ParserImpl>();
-    for (u32 opcode = 0; opcode < 0x10000; ++opcode) {
-        u16 o = (u16)opcode;
-        bool expansion = Disassembler::NeedExpansion(o);
-        auto tokens = Disassembler::GetTokenList(o);
+    return std::make_unique<ParserImpl>(GetParserTrie());
+}
 
-        if (std::any_of(tokens.begin(), tokens.end(), [](const auto& token) {
-                return token.find("[ERROR]") != std::string::npos;
-            }))
-            continue;
+bool WriteParserTable(const char* path) {
+    std::FILE* out = std::fopen(path, "w");
+    if (!out) {
+        return false;
+    }
+    const ParserTrieData data = BuildParserTrie();
 
-        ParserImpl::Node* current = &parser->root;
-        for (const auto& token : tokens) {
-            auto& next = current->children[token];
-            if (!next)
-                next = std::make_unique<ParserImpl::Node>();
-            current = next.get();
-        }
+    std::fprintf(out, "// Generated by parser_gen from the disassembler, do not edit\n\n");
+    std::fprintf(out, "constexpr char ParserTableTokenPool[] =\n");
+    for (std::size_t i = 0; i + 1 < data.token_offsets.size(); ++i) {
+        const u32 offset = data.token_offsets[i];
+        std::fprintf(out, "    ");
+        WriteEscaped(out, std::string_view(data.token_pool)
+                              .substr(offset, data.token_offsets[i + 1] - offset));
+        std::fprintf(out, "\n");
+    }
+    std::fprintf(out, "    \"\";\n\n");
 
-        if (current->end) {
-            ASSERT((current->opcode & (u16)(~o)) == 0);
-            continue;
-        }
-        current->end = true;
-        current->opcode = o;
-        current->expansion = expansion;
+    std::fprintf(out, "constexpr u32 ParserTableTokenOffsets[] = {");
+    for (std::size_t i = 0; i < data.token_offsets.size(); ++i) {
+        std::fprintf(out, "%s%u,", i % 16 == 0 ? "\n    " : " ", data.token_offsets[i]);
     }
-    return parser;
+    std::fprintf(out, "\n};\n\n");
+
+    std::fprintf(out, "constexpr ParserNode ParserTableNodes[] = {");
+    for (std::size_t i = 0; i < data.nodes.size(); ++i) {
+        const auto& node = data.nodes[i];
+        std::fprintf(out, "%s{%u, %u, 0x%04X, %u, %u},", i % 4 == 0 ? "\n    " : " ",
+                     node.first_edge, node.edge_count, node.opcode, node.end, node.expansion);
+    }
+    std::fprintf(out, "\n};\n\n");
+
+    std::fprintf(out, "constexpr ParserEdge ParserTableEdges[] = {");
+    for (std::size_t i = 0; i < data.edges.size(); ++i) {
+        const auto& edge = data.edges[i];
+        std::fprintf(out, "%s{%u, %u},", i % 8 == 0 ? "\n    " : " ", edge.token, edge.child);
+    }
+    std::fprintf(out, "\n};\n");
+
+    return std::fclose(out) == 0;
 }
 
 } // namespace Teakra
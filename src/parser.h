@@ -21,6 +21,11 @@ public:
     virtual Opcode Parse(const std::vector<std::string>& tokens) = 0;
 };
 
+// Parsers share one read-only parse trie, built into the library by parser_gen where possible
+// and otherwise built on first use.
 std::unique_ptr<Parser> GenerateParser();
 
+// Writes the parse trie as C++ source for building it into the library
+bool WriteParserTable(const char* path);
+
 } // namespace Teakra
@@ -0,0 +1,14 @@
+#include <cstdio>
+#include "../parser.h"
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::fprintf(stderr, "Usage: %s <output.inc>\n", argv[0]);
+        return -1;
+    }
+    if (!Teakra::WriteParserTable(argv[1])) {
+        std::fprintf(stderr, "Failed to write %s\n", argv[1]);
+        return -1;
+    }
+    return 0;
+}
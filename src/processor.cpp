@@ -1,4 +1,6 @@
+#include <algorithm>
 #include "jit_no_ir.h"
+#include "lockstep.h"
 #include "processor.h"
 #include "register.h"
 
@@ -6,14 +8,63 @@ namespace Teakra {
 
 struct Processor::Impl {
     Impl(CoreTiming& core_timing, MemoryInterface& memory_interface, bool use_jit_)
-        : core_timing(core_timing), interpreter(core_timing, iregs, memory_interface),
-          jit(core_timing, regs, memory_interface), use_jit(use_jit_) {}
+        : core_timing(core_timing), memory_interface(memory_interface),
+          interpreter(core_timing, iregs, memory_interface),
+          jit(core_timing, regs, memory_interface), use_jit(use_jit_),
+          configured_use_jit(use_jit_) {
+        if (!use_jit) {
+            memory_interface.SetWatchPc(&interpreter.inst_pc);
+        }
+    }
+
+    // Runs the block the JIT could not compile on the interpreter, up to and including the
+    // instruction it stopped at, and hands the state back. Returns the cycles left of the run.
+    s64 InterpretBlock(s64 cycles) {
+        LoadRegisterState(iregs, regs);
+        // Interrupts stay latched in the JIT, which takes them between blocks
+        iregs.ip = {};
+        iregs.ipv = 0;
+        const u64 instructions = std::min<s64>(jit.unimplemented_instructions, cycles);
+        memory_interface.SetWatchPc(&interpreter.inst_pc);
+        interpreter.Run(instructions);
+        memory_interface.SetWatchPc(&memory_interface.watch_pc_storage);
+
+        const auto ip = regs.ip;
+        const u16 ipv = regs.ipv;
+        LoadJitRegisters(regs, iregs);
+        regs.ip = ip;
+        regs.ipv = ipv;
+        ++jit.compile_stats.interpreted_blocks;
+        return cycles - instructions;
+    }
+
+    // Continues on the interpreter from the lockstep shadow's state, after a divergence
+    void FallBackToInterpreter() {
+        lockstep->Adopt(iregs, regs);
+        for (u32 i = 0; i < jit.interrupt_pending.size(); ++i) {
+            if (jit.interrupt_pending[i]) {
+                interpreter.SignalInterrupt(i);
+            }
+        }
+        interpreter.vinterrupt_address = jit.vinterrupt_address;
+        interpreter.vinterrupt_context_switch = jit.vinterrupt_context_switch;
+        interpreter.vinterrupt_pending = jit.vinterrupt_pending;
+        memory_interface.SetWatchPc(&interpreter.inst_pc);
+        // The shadow is kept so Reset can verify the JIT again
+        jit.lockstep = nullptr;
+        use_jit = false;
+    }
+
     CoreTiming& core_timing;
+    MemoryInterface& memory_interface;
     JitRegisters regs;
     RegisterState iregs;
     Interpreter interpreter;
     EmitX64 jit;
+    std::unique_ptr<Lockstep> lockstep;
+    // use_jit is cleared by a fall back to the interpreter, until the next Reset
     bool use_jit;
+    bool configured_use_jit;
 };
 
 Processor::Processor(CoreTiming& core_timing, MemoryInterface& memory_interface, bool use_jit)
@@ -22,6 +73,14 @@ Processor::Processor(CoreTiming& core_timing, MemoryInterface& memory_interface,
 Processor::~Processor() = default;
 
 void Processor::Reset() {
+    if (impl->configured_use_jit && !impl->use_jit) {
+        impl->use_jit = true;
+        impl->memory_interface.SetWatchPc(&impl->memory_interface.watch_pc_storage);
+        if (impl->lockstep) {
+            impl->jit.lockstep = impl->lockstep.get();
+            impl->jit.lockstep_countdown = impl->lockstep->NextInterval();
+        }
+    }
     if (impl->use_jit) {
         impl->jit.Reset();
     } else {
@@ -31,7 +90,20 @@ void Processor::Reset() {
 
 u32 Processor::Run(unsigned cycles, Interpreter* debug_interp) {
     if (impl->use_jit) {
-        return impl->jit.Run(cycles);
+        u32 result = impl->jit.Run(cycles);
+        while (impl->jit.unimplemented) {
+            const s64 remaining = impl->InterpretBlock(impl->jit.fallback_cycles);
+            if (remaining <= 0) {
+                result = 0;
+                break;
+            }
+            result = impl->jit.Run(remaining);
+        }
+        if (impl->jit.fallback) {
+            impl->FallBackToInterpreter();
+            return impl->interpreter.Run(impl->jit.fallback_cycles);
+        }
+        return result;
     } else {
         return impl->interpreter.Run(cycles);
     }
@@ -53,6 +125,57 @@ void Processor::SignalVectoredInterrupt(u32 address, bool context_switch) {
     }
 }
 
+void Processor::SetCallProfiler(CallProfiler* profiler) {
+    impl->interpreter.profiler = profiler;
+    impl->jit.profiler = profiler;
+    // Profiling hooks are emitted into the blocks themselves
+    impl->jit.ClearCache();
+}
+
+void Processor::SetInterruptServiceHandler(std::function<void(u32, u64)> handler) {
+    impl->interpreter.interrupt_service_handler = handler;
+    impl->jit.interrupt_service_handler = std::move(handler);
+}
+
+void Processor::SetLockstepConfig(const LockstepConfig& config) {
+    if (!impl->configured_use_jit) {
+        return;
+    }
+    impl->jit.lockstep = nullptr;
+    impl->lockstep.reset();
+    if (config.interval != 0) {
+        impl->lockstep = std::make_unique<Lockstep>(impl->memory_interface, config);
+        if (impl->use_jit) {
+            impl->jit.lockstep = impl->lockstep.get();
+            impl->jit.lockstep_countdown = impl->lockstep->NextInterval();
+        }
+    }
+}
+
+void Processor::SetHotRelayoutConfig(const HotRelayoutConfig& config) {
+    if (!impl->configured_use_jit) {
+        return;
+    }
+    impl->jit.relayout_interval = config.interval;
+    impl->jit.relayout_blocks = config.blocks;
+    impl->jit.relayout_countdown = config.interval;
+}
+
+void Processor::SetJitMaxCpuTier(JitCpuTier tier) {
+    if (!impl->configured_use_jit) {
+        return;
+    }
+    impl->jit.SetMaxCpuTier(tier);
+}
+
+JitStats Processor::GetJitStats() const {
+    return impl->jit.compile_stats;
+}
+
+bool Processor::UsesJit() const {
+    return impl->use_jit;
+}
+
 Interpreter& Processor::Interp() {
     return impl->interpreter;
 }
@@ -1,13 +1,17 @@
 #pragma once
 
+#include <functional>
 #include <memory>
 #include "common_types.h"
 #include "core_timing.h"
+#include "teakra/stats.h"
+#include "teakra/teakra.h"
 
 namespace Teakra {
 
 class MemoryInterface;
 class Interpreter;
+class CallProfiler;
 
 class Processor {
 public:
@@ -17,6 +21,14 @@ public:
     u32 Run(u32 cycles, Interpreter* debug_interp);
     void SignalInterrupt(u32 i);
     void SignalVectoredInterrupt(u32 address, bool context_switch);
+    void SetCallProfiler(CallProfiler* profiler);
+    void SetInterruptServiceHandler(std::function<void(u32 interrupt, u64 offset)> handler);
+    void SetLockstepConfig(const LockstepConfig& config);
+    void SetHotRelayoutConfig(const HotRelayoutConfig& config);
+    void SetJitMaxCpuTier(JitCpuTier tier);
+    JitStats GetJitStats() const;
+    // false for interpreter instances, and once the JIT has fallen back to the interpreter
+    bool UsesJit() const;
     Interpreter& Interp();
 private:
     struct Impl;
@@ -1,25 +1,50 @@
 #pragma once
 
+#include <bit>
+#include <cstring>
+#include <span>
 #include "common_types.h"
+#include "swap.h"
 
 namespace Teakra {
+// DSP memory is an array of little-endian 16-bit words. On little-endian hosts words are
+// copied in and out as is, and only big-endian hosts swap them.
 struct SharedMemory {
     u8* raw;
 
     SharedMemory(u8* mem) : raw{mem} {}
 
     u16 ReadWord(u32 word_address) const {
-        u32 byte_address = word_address * 2;
-        u8 low = raw[byte_address];
-        u8 high = raw[byte_address + 1];
-        return low | ((u16)high << 8);
+        u16 value;
+        std::memcpy(&value, raw + word_address * 2, sizeof(u16));
+        if constexpr (std::endian::native == std::endian::big) {
+            value = Common::swap16(value);
+        }
+        return value;
     }
     void WriteWord(u32 word_address, u16 value) {
-        u8 low = value & 0xFF;
-        u8 high = value >> 8;
-        u32 byte_address = word_address * 2;
-        raw[byte_address] = low;
-        raw[byte_address + 1] = high;
+        if constexpr (std::endian::native == std::endian::big) {
+            value = Common::swap16(value);
+        }
+        std::memcpy(raw + word_address * 2, &value, sizeof(u16));
+    }
+
+    void ReadWords(u32 word_address, std::span<u16> out) const {
+        std::memcpy(out.data(), raw + word_address * 2, out.size_bytes());
+        if constexpr (std::endian::native == std::endian::big) {
+            for (u16& value : out) {
+                value = Common::swap16(value);
+            }
+        }
+    }
+    void WriteWords(u32 word_address, std::span<const u16> in) {
+        if constexpr (std::endian::native == std::endian::big) {
+            for (std::size_t i = 0; i < in.size(); ++i) {
+                WriteWord(word_address + static_cast<u32>(i), in[i]);
+            }
+        } else {
+            std::memcpy(raw + word_address * 2, in.data(), in.size_bytes());
+        }
     }
 };
 } // namespace Teakra
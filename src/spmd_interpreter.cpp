@@ -0,0 +1,83 @@
+#include <algorithm>
+#include <array>
+#include "interpreter.h"
+#include "spmd_interpreter.h"
+
+namespace Teakra {
+
+SpmdInterpreter::SpmdInterpreter(std::span<Interpreter* const> lanes)
+    : lanes(lanes.begin(), lanes.end()) {}
+
+void SpmdInterpreter::Run(u64 cycles) {
+    for (std::size_t first = 0; first < lanes.size(); first += MaxLanes) {
+        const std::size_t count = std::min(MaxLanes, lanes.size() - first);
+        RunGroup(std::span<Interpreter* const>(lanes).subspan(first, count), cycles);
+    }
+}
+
+void SpmdInterpreter::RunGroup(std::span<Interpreter* const> group, u64 cycles) {
+    std::array<u64, MaxLanes> lane_cycles{};
+    for (Interpreter* lane : group) {
+        lane->BeginRun();
+    }
+
+    while (true) {
+        // Each lane follows its own Run loop: lanes that skip idle cycles finish early
+        std::array<Interpreter*, MaxLanes> active;
+        std::array<u64*, MaxLanes> active_cycles;
+        std::size_t count = 0;
+        for (std::size_t i = 0; i < group.size(); ++i) {
+            if (lane_cycles[i] >= cycles) {
+                continue;
+            }
+            group[i]->SkipIdle(lane_cycles[i], cycles);
+            group[i]->PollInterrupts();
+            active[count] = group[i];
+            active_cycles[count] = &lane_cycles[i];
+            ++count;
+        }
+        if (count == 0) {
+            break;
+        }
+
+        std::array<bool, MaxLanes> stepped{};
+        for (std::size_t i = 0; i < count; ++i) {
+            if (stepped[i]) {
+                continue;
+            }
+            Interpreter& leader = *active[i];
+            const u32 address = leader.regs.pc | (leader.regs.prpage << 18);
+            u16 opcode, expand_value;
+            const auto& decoder = leader.Fetch(opcode, expand_value);
+            leader.Execute(decoder, opcode, expand_value);
+
+            // Lanes are separate instances, so the followers' pc are unaffected by the leader.
+            // Their program memory may still differ, hence the opcode check.
+            for (std::size_t j = i + 1; j < count; ++j) {
+                Interpreter& lane = *active[j];
+                if (stepped[j] || (lane.regs.pc | (lane.regs.prpage << 18)) != address ||
+                    lane.mem.ProgramRead(address) != opcode) {
+                    continue;
+                }
+                stepped[j] = true;
+                lane.inst_pc = lane.regs.pc;
+                ++lane.regs.pc;
+                u16 lane_expand_value = 0;
+                if (decoder.NeedExpansion()) {
+                    lane_expand_value = lane.mem.ProgramRead((lane.regs.pc++) |
+                                                             (lane.regs.prpage << 18));
+                }
+                lane.Execute(decoder, opcode, lane_expand_value);
+                ++stats.shared_steps;
+            }
+        }
+
+        for (std::size_t i = 0; i < count; ++i) {
+            active[i]->core_timing.Tick();
+            ++*active_cycles[i];
+        }
+        stats.steps += count;
+    }
+}
+
+} // namespace Teakra
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <span>
+#include <vector>
+#include "common_types.h"
+#include "teakra/teakra.h"
+
+namespace Teakra {
+
+class Interpreter;
+
+/**
+ * Steps several interpreters together, one instruction at a time, for batches of instances
+ * running the same firmware. Lanes at the same pc with the same opcode there run it back to
+ * back through a single decode, so the handler stays hot; lanes that diverge are fetched and
+ * decoded on their own, and share again as soon as they meet at a pc.
+ */
+class SpmdInterpreter {
+public:
+    static constexpr std::size_t MaxLanes = 16;
+
+    explicit SpmdInterpreter(std::span<Interpreter* const> lanes);
+
+    // Runs every lane for the given number of cycles, like Interpreter::Run on each. Lanes are
+    // stepped in groups of up to MaxLanes.
+    void Run(u64 cycles);
+
+    const BatchStats& GetStats() const {
+        return stats;
+    }
+
+private:
+    void RunGroup(std::span<Interpreter* const> group, u64 cycles);
+
+    std::vector<Interpreter*> lanes;
+    BatchStats stats;
+};
+
+} // namespace Teakra
@@ -0,0 +1,54 @@
+#include "teakra/stats.h"
+
+namespace Teakra {
+
+template <std::size_t N>
+static std::array<std::uint64_t, N> Subtract(const std::array<std::uint64_t, N>& lhs,
+                                             const std::array<std::uint64_t, N>& rhs) {
+    std::array<std::uint64_t, N> result;
+    for (std::size_t i = 0; i < N; ++i) {
+        result[i] = lhs[i] - rhs[i];
+    }
+    return result;
+}
+
+Stats operator-(const Stats& lhs, const Stats& rhs) {
+    Stats result;
+    result.cycles = lhs.cycles - rhs.cycles;
+    result.dma.transfers = Subtract(lhs.dma.transfers, rhs.dma.transfers);
+    result.dma.words_from_space = Subtract(lhs.dma.words_from_space, rhs.dma.words_from_space);
+    result.dma.words_to_space = Subtract(lhs.dma.words_to_space, rhs.dma.words_to_space);
+    result.dma.transfer_cycles = Subtract(lhs.dma.transfer_cycles, rhs.dma.transfer_cycles);
+
+    result.ahbm.read_bursts = Subtract(lhs.ahbm.read_bursts, rhs.ahbm.read_bursts);
+    result.ahbm.write_bursts = Subtract(lhs.ahbm.write_bursts, rhs.ahbm.write_bursts);
+    result.ahbm.external_reads = Subtract(lhs.ahbm.external_reads, rhs.ahbm.external_reads);
+    result.ahbm.external_writes = Subtract(lhs.ahbm.external_writes, rhs.ahbm.external_writes);
+
+    for (std::size_t i = 0; i < result.interrupts.latency.size(); ++i) {
+        const auto& l = lhs.interrupts.latency[i];
+        const auto& r = rhs.interrupts.latency[i];
+        auto& out = result.interrupts.latency[i];
+        out.buckets = Subtract(l.buckets, r.buckets);
+        out.count = l.count - r.count;
+        out.total_cycles = l.total_cycles - r.total_cycles;
+        // a maximum can't be differenced, keep the running one
+        out.max_cycles = l.max_cycles;
+    }
+
+    result.jit.blocks_compiled = lhs.jit.blocks_compiled - rhs.jit.blocks_compiled;
+    result.jit.instructions_compiled = lhs.jit.instructions_compiled - rhs.jit.instructions_compiled;
+    result.jit.host_bytes = lhs.jit.host_bytes - rhs.jit.host_bytes;
+    result.jit.compile_ns = lhs.jit.compile_ns - rhs.jit.compile_ns;
+    result.jit.lockstep_samples = lhs.jit.lockstep_samples - rhs.jit.lockstep_samples;
+    result.jit.lockstep_skipped = lhs.jit.lockstep_skipped - rhs.jit.lockstep_skipped;
+    result.jit.lockstep_divergences = lhs.jit.lockstep_divergences - rhs.jit.lockstep_divergences;
+    result.jit.interpreted_blocks = lhs.jit.interpreted_blocks - rhs.jit.interpreted_blocks;
+    result.jit.relayouts = lhs.jit.relayouts - rhs.jit.relayouts;
+    result.jit.relayout_blocks = lhs.jit.relayout_blocks - rhs.jit.relayout_blocks;
+    result.jit.relayout_bytes = lhs.jit.relayout_bytes - rhs.jit.relayout_bytes;
+    result.jit.cpu_tier = lhs.jit.cpu_tier;
+    return result;
+}
+
+} // namespace Teakra
@@ -1,6 +1,6 @@
 #include <cstdio>
-#include <memory>
 #include "../test.h"
+#include "../test_container.h"
 
 int main(int argc, char** argv) {
     if (argc < 2) {
@@ -8,8 +8,9 @@ int main(int argc, char** argv) {
         return -1;
     }
 
-    std::unique_ptr<std::FILE, decltype(&std::fclose)> f{std::fopen(argv[1], "wb"), std::fclose};
-    if (!f) {
+    // The hardware test runner reads raw TestCase arrays
+    Teakra::Test::TestCaseWriter writer(argv[1], Teakra::Test::TestFormat::Raw);
+    if (!writer.IsOpen()) {
         std::fprintf(stderr, "Unable to open file %s. Exiting...\n", argv[1]);
         return -2;
     }
@@ -28,7 +29,7 @@ int main(int argc, char** argv) {
                 test_case.before.cfgi = mod << 7;
                 for (u16 r = 0; r < 0x20; ++r) {
                     test_case.before.r[0] = r + r0base;
-                    if (std::fwrite(&test_case, sizeof(test_case), 1, f.get()) == 0) {
+                    if (!writer.Write(test_case)) {
                         std::fprintf(stderr, "Unable to completely write test case. Exiting...\n");
                         return -3;
                     }
@@ -37,5 +38,10 @@ int main(int argc, char** argv) {
         }
     }
 
+    if (!writer.Finish()) {
+        std::fprintf(stderr, "Unable to completely write test case. Exiting...\n");
+        return -3;
+    }
+
     return 0;
 }
@@ -1,15 +1,21 @@
 #include <array>
 #include <cstring>
+#include <vector>
 #include "ahbm.h"
 #include "apbp.h"
 #include "btdmp.h"
+#include "call_profiler.h"
 #include "core_timing.h"
 #include "dma.h"
+#include "dsp1.h"
+#include "frame_snapshot.h"
 #include "icu.h"
+#include "interrupt_latency.h"
 #include "memory_interface.h"
 #include "mmio.h"
 #include "processor.h"
 #include "shared_memory.h"
+#include "spmd_interpreter.h"
 #include "teakra/teakra.h"
 #include "timer.h"
 
@@ -28,24 +34,38 @@ struct Teakra::Impl {
     MMIORegion mmio{miu, icu, apbp_from_cpu, apbp_from_dsp, timer, dma, ahbm, btdmp};
     MemoryInterface memory_interface{shared_memory, miu, mmio};
     Processor processor;
+    CallProfiler call_profiler{core_timing};
+    InterruptLatency interrupt_latency{icu};
+    FrameSnapshots frame_snapshots{shared_memory};
+    FramePublisher frame_publisher{frame_snapshots, apbp_from_dsp};
+    Stats last_stats;
 
     Impl(bool use_jit, u8* dsp_memory) : shared_memory{dsp_memory}, processor(core_timing, memory_interface, use_jit) {
         using namespace std::placeholders;
         icu.SetInterruptHandler(std::bind(&Processor::SignalInterrupt, &processor, _1),
                                 std::bind(&Processor::SignalVectoredInterrupt, &processor, _1, _2));
 
-        timer[0].SetInterruptHandler([this]() { icu.TriggerSingle(0xA); });
-        timer[1].SetInterruptHandler([this]() { icu.TriggerSingle(0x9); });
+        processor.SetInterruptServiceHandler([this](u32 interrupt, u64 offset) {
+            interrupt_latency.Service(interrupt, core_timing.GetTicks() + offset);
+        });
 
-        apbp_from_cpu.SetDataHandler(0, [this]() { icu.TriggerSingle(0xE); });
-        apbp_from_cpu.SetDataHandler(1, [this]() { icu.TriggerSingle(0xE); });
-        apbp_from_cpu.SetDataHandler(2, [this]() { icu.TriggerSingle(0xE); });
-        apbp_from_cpu.SetSemaphoreHandler([this]() { icu.TriggerSingle(0xE); });
+        timer[0].SetInterruptHandler([this]() { TriggerIrq(0xA); });
+        timer[1].SetInterruptHandler([this]() { TriggerIrq(0x9); });
 
-        btdmp[0].SetInterruptHandler([this]() { icu.TriggerSingle(0xB); });
-        btdmp[1].SetInterruptHandler([this]() { icu.TriggerSingle(0xB); });
+        apbp_from_cpu.SetDataHandler(0, [this]() { TriggerIrq(0xE); });
+        apbp_from_cpu.SetDataHandler(1, [this]() { TriggerIrq(0xE); });
+        apbp_from_cpu.SetDataHandler(2, [this]() { TriggerIrq(0xE); });
+        apbp_from_cpu.SetSemaphoreHandler([this]() { TriggerIrq(0xE); });
 
-        dma.SetInterruptHandler([this]() { icu.TriggerSingle(0xF); });
+        btdmp[0].SetInterruptHandler([this]() { TriggerIrq(0xB); });
+        btdmp[1].SetInterruptHandler([this]() { TriggerIrq(0xB); });
+
+        dma.SetInterruptHandler([this]() { TriggerIrq(0xF); });
+    }
+
+    void TriggerIrq(u32 irq) {
+        interrupt_latency.Trigger(irq, core_timing.GetTicks());
+        icu.TriggerSingle(irq);
     }
 
     void Reset() {
@@ -73,6 +93,11 @@ void Teakra::Reset() {
     impl->Reset();
 }
 
+Dsp1LoadResult Teakra::LoadDsp1(std::span<const std::uint8_t> image, bool verify_hashes,
+                                unsigned threads) {
+    return ::Teakra::LoadDsp1(impl->shared_memory, image, verify_hashes, threads);
+}
+
 Processor& Teakra::GetProcessor() {
     return impl->processor;
 }
@@ -81,6 +106,20 @@ u32 Teakra::Run(unsigned cycle) {
     return impl->processor.Run(cycle, &impl_interp->processor.Interp());
 }
 
+BatchStats Teakra::RunBatch(std::span<Teakra* const> instances, std::uint32_t cycles) {
+    std::vector<Interpreter*> lanes;
+    for (Teakra* instance : instances) {
+        if (instance->impl->processor.UsesJit()) {
+            instance->Run(cycles);
+        } else {
+            lanes.push_back(&instance->impl->processor.Interp());
+        }
+    }
+    SpmdInterpreter spmd(lanes);
+    spmd.Run(cycles);
+    return spmd.GetStats();
+}
+
 bool Teakra::SendDataIsEmpty(std::uint8_t index) const {
     return !impl->apbp_from_cpu.IsDataReady(index);
 }
@@ -149,6 +188,46 @@ void Teakra::SetAudioCallback(std::function<void(std::array<s16, 2>)> callback)
     impl->btdmp[0].SetAudioCallback(callback);
 }
 
+Stats Teakra::GetStats() const {
+    Stats stats;
+    stats.cycles = impl->core_timing.GetTicks();
+    stats.dma = impl->dma.GetStats();
+    stats.ahbm = impl->ahbm.GetStats();
+    stats.interrupts = impl->interrupt_latency.GetStats();
+    stats.jit = impl->processor.GetJitStats();
+    return stats;
+}
+Stats Teakra::GetStatsDelta() {
+    const Stats current = GetStats();
+    const Stats delta = current - impl->last_stats;
+    impl->last_stats = current;
+    return delta;
+}
+
+void Teakra::SetCallProfilingEnabled(bool enabled) {
+    impl->call_profiler.Reset();
+    impl->processor.SetCallProfiler(enabled ? &impl->call_profiler : nullptr);
+}
+void Teakra::ResetCallProfile() {
+    impl->call_profiler.Reset();
+}
+std::string Teakra::ExportCallProfile() {
+    // Frames still open are counted up to now, while the running firmware keeps them
+    return impl->call_profiler.Closed().ExportCallgrind();
+}
+
+void Teakra::SetLockstepConfig(const LockstepConfig& config) {
+    impl->processor.SetLockstepConfig(config);
+}
+
+void Teakra::SetHotRelayoutConfig(const HotRelayoutConfig& config) {
+    impl->processor.SetHotRelayoutConfig(config);
+}
+
+void Teakra::SetJitMaxCpuTier(JitCpuTier tier) {
+    impl->processor.SetJitMaxCpuTier(tier);
+}
+
 std::uint16_t Teakra::ProgramRead(std::uint32_t address) const {
     return impl->memory_interface.ProgramRead(address);
 }
@@ -161,6 +240,14 @@ std::uint16_t Teakra::DataRead(std::uint16_t address, bool bypass_mmio) {
 void Teakra::DataWrite(std::uint16_t address, std::uint16_t value, bool bypass_mmio) {
     impl->memory_interface.DataWrite(address, value, bypass_mmio);
 }
+void Teakra::DataReadWords(std::uint16_t address, std::span<std::uint16_t> out,
+                           bool bypass_mmio) {
+    impl->memory_interface.DataReadWords(address, out, bypass_mmio);
+}
+void Teakra::DataWriteWords(std::uint16_t address, std::span<const std::uint16_t> in,
+                            bool bypass_mmio) {
+    impl->memory_interface.DataWriteWords(address, in, bypass_mmio);
+}
 std::uint16_t Teakra::DataReadA32(std::uint32_t address) const {
     return impl->memory_interface.DataReadA32(address);
 }
@@ -174,6 +261,28 @@ void Teakra::MMIOWrite(std::uint16_t address, std::uint16_t value) {
     impl->memory_interface.MMIOWrite(address, value);
 }
 
+void Teakra::SetFramePublishConfig(const FramePublishConfig& config) {
+    impl->frame_publisher.SetConfig(config);
+}
+std::uint32_t Teakra::AddSnapshotRegion(std::uint16_t address, std::uint16_t words) {
+    return impl->frame_snapshots.AddRegion(address, words);
+}
+void Teakra::RemoveSnapshotRegion(std::uint32_t id) {
+    impl->frame_snapshots.RemoveRegion(id);
+}
+std::uint64_t Teakra::ReadSnapshot(std::uint32_t id, std::span<std::uint16_t> out) const {
+    return impl->frame_snapshots.Read(id, out);
+}
+
+std::uint32_t Teakra::AddWatchpoint(std::uint16_t begin, std::uint16_t end, WatchpointType type,
+                                    WatchpointCallback callback) {
+    return impl->memory_interface.AddWatchpoint(begin, end, static_cast<u8>(type),
+                                                std::move(callback));
+}
+void Teakra::RemoveWatchpoint(std::uint32_t id) {
+    impl->memory_interface.RemoveWatchpoint(id);
+}
+
 std::uint16_t Teakra::DMAChan0GetSrcHigh() {
     u16 active_bak = impl->dma.GetActiveChannel();
     impl->dma.ActivateChannel(0);
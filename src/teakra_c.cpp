@@ -75,6 +75,14 @@ uint16_t Teakra_DataRead(TeakraContext* context, uint16_t address, bool bypass_m
 void Teakra_DataWrite(TeakraContext* context, uint16_t address, uint16_t value, bool bypass_mmio) {
     context->teakra.DataWrite(address, value, bypass_mmio);
 }
+void Teakra_DataReadWords(TeakraContext* context, uint16_t address, uint16_t* out, size_t count,
+                          bool bypass_mmio) {
+    context->teakra.DataReadWords(address, {out, count}, bypass_mmio);
+}
+void Teakra_DataWriteWords(TeakraContext* context, uint16_t address, const uint16_t* in,
+                           size_t count, bool bypass_mmio) {
+    context->teakra.DataWriteWords(address, {in, count}, bypass_mmio);
+}
 uint16_t Teakra_DataReadA32(TeakraContext* context, uint32_t address) {
     return context->teakra.DataReadA32(address);
 }
@@ -88,6 +96,21 @@ void Teakra_MMIOWrite(TeakraContext* context, uint16_t address, uint16_t value)
     context->teakra.MMIOWrite(address, value);
 }
 
+void Teakra_SetFramePublishConfig(TeakraContext* context, uint16_t semaphore_bits,
+                                  uint8_t recv_data_channels) {
+    context->teakra.SetFramePublishConfig({semaphore_bits, recv_data_channels});
+}
+uint32_t Teakra_AddSnapshotRegion(TeakraContext* context, uint16_t address, uint16_t words) {
+    return context->teakra.AddSnapshotRegion(address, words);
+}
+void Teakra_RemoveSnapshotRegion(TeakraContext* context, uint32_t id) {
+    context->teakra.RemoveSnapshotRegion(id);
+}
+uint64_t Teakra_ReadSnapshot(const TeakraContext* context, uint32_t id, uint16_t* out,
+                             size_t count) {
+    return context->teakra.ReadSnapshot(id, {out, count});
+}
+
 uint16_t Teakra_DMAChan0GetSrcHigh(TeakraContext* context) {
     return context->teakra.DMAChan0GetSrcHigh();
 }
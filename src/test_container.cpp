@@ -0,0 +1,291 @@
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include "test_container.h"
+
+#ifdef _WIN32
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Teakra::Test {
+
+namespace {
+
+constexpr char Magic[4] = {'T', 'K', 'T', 'C'};
+constexpr u32 Version = 1;
+constexpr std::size_t FlushThreshold = 1 << 20;
+
+struct Header {
+    char magic[4];
+    u32 version;
+    u64 count;
+    u64 index_offset;
+    u64 reserved;
+};
+static_assert(sizeof(Header) == 32);
+
+// Registers are compared as u16 words, everything in State before the test spaces
+constexpr std::size_t RegisterBytes = offsetof(State, test_space_x);
+constexpr std::size_t RegisterWords = RegisterBytes / 2;
+constexpr std::size_t MemoryWords = TestSpaceSize * 2;
+static_assert(RegisterBytes % 2 == 0 && RegisterWords <= 64);
+static_assert(offsetof(State, test_space_y) == RegisterBytes + TestSpaceSize * 2);
+static_assert(sizeof(State) == RegisterBytes + MemoryWords * 2);
+
+template <typename T>
+void Put(std::vector<u8>& out, const T& value) {
+    const auto* bytes = reinterpret_cast<const u8*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+class Cursor {
+public:
+    Cursor(const u8* begin, const u8* end) : pos(begin), end(end) {}
+
+    template <typename T>
+    bool Take(T& value) {
+        return TakeBytes(&value, sizeof(T));
+    }
+
+    bool TakeBytes(void* out, std::size_t length) {
+        if (static_cast<std::size_t>(end - pos) < length) {
+            return false;
+        }
+        std::memcpy(out, pos, length);
+        pos += length;
+        return true;
+    }
+
+private:
+    const u8* pos;
+    const u8* end;
+};
+
+void EncodeCompact(std::vector<u8>& out, const TestCase& test_case) {
+    Put(out, test_case.opcode);
+    Put(out, test_case.expand);
+    const auto* before = reinterpret_cast<const u8*>(&test_case.before);
+    out.insert(out.end(), before, before + sizeof(State));
+
+    std::array<u16, RegisterWords> before_regs, after_regs;
+    std::memcpy(before_regs.data(), &test_case.before, RegisterBytes);
+    std::memcpy(after_regs.data(), &test_case.after, RegisterBytes);
+    u64 mask = 0;
+    for (std::size_t i = 0; i < RegisterWords; ++i) {
+        if (before_regs[i] != after_regs[i]) {
+            mask |= 1ULL << i;
+        }
+    }
+    Put(out, mask);
+    for (std::size_t i = 0; i < RegisterWords; ++i) {
+        if ((mask >> i) & 1) {
+            Put(out, after_regs[i]);
+        }
+    }
+
+    const std::size_t count_pos = out.size();
+    u16 changed = 0;
+    Put(out, changed);
+    auto diff = [&](const auto& b, const auto& a, u16 base) {
+        for (u16 i = 0; i < TestSpaceSize; ++i) {
+            if (b[i] != a[i]) {
+                Put(out, static_cast<u16>(base + i));
+                Put(out, a[i]);
+                ++changed;
+            }
+        }
+    };
+    diff(test_case.before.test_space_x, test_case.after.test_space_x, 0);
+    diff(test_case.before.test_space_y, test_case.after.test_space_y, TestSpaceSize);
+    std::memcpy(out.data() + count_pos, &changed, sizeof(changed));
+}
+
+bool DecodeCompact(Cursor& in, TestCase& test_case) {
+    if (!in.Take(test_case.opcode) || !in.Take(test_case.expand) ||
+        !in.TakeBytes(&test_case.before, sizeof(State))) {
+        return false;
+    }
+    test_case.after = test_case.before;
+
+    u64 mask;
+    if (!in.Take(mask)) {
+        return false;
+    }
+    std::array<u16, RegisterWords> regs;
+    std::memcpy(regs.data(), &test_case.after, RegisterBytes);
+    for (std::size_t i = 0; i < RegisterWords; ++i) {
+        if (((mask >> i) & 1) && !in.Take(regs[i])) {
+            return false;
+        }
+    }
+    std::memcpy(&test_case.after, regs.data(), RegisterBytes);
+
+    u16 changed;
+    if (!in.Take(changed)) {
+        return false;
+    }
+    for (u16 i = 0; i < changed; ++i) {
+        u16 address, value;
+        if (!in.Take(address) || !in.Take(value) || address >= MemoryWords) {
+            return false;
+        }
+        if (address < TestSpaceSize) {
+            test_case.after.test_space_x[address] = value;
+        } else {
+            test_case.after.test_space_y[address - TestSpaceSize] = value;
+        }
+    }
+    return true;
+}
+
+} // Anonymous namespace
+
+TestCaseWriter::TestCaseWriter(const char* path, TestFormat format) : format(format) {
+    file = std::fopen(path, "wb");
+    if (file && format == TestFormat::Compact) {
+        Header header{};
+        ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+        written = sizeof(header);
+    }
+}
+
+TestCaseWriter::~TestCaseWriter() {
+    Finish();
+}
+
+bool TestCaseWriter::Write(const TestCase& test_case) {
+    if (!file) {
+        return false;
+    }
+    if (format == TestFormat::Raw) {
+        Put(buffer, test_case);
+    } else {
+        offsets.push_back(written + buffer.size());
+        EncodeCompact(buffer, test_case);
+    }
+    if (buffer.size() >= FlushThreshold) {
+        Flush();
+    }
+    return ok;
+}
+
+bool TestCaseWriter::Flush() {
+    if (!buffer.empty()) {
+        if (std::fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size()) {
+            ok = false;
+        }
+        written += buffer.size();
+        buffer.clear();
+    }
+    return ok;
+}
+
+bool TestCaseWriter::Finish() {
+    if (!file) {
+        return false;
+    }
+    Flush();
+    if (format == TestFormat::Compact) {
+        Header header{};
+        std::memcpy(header.magic, Magic, sizeof(Magic));
+        header.version = Version;
+        header.count = offsets.size();
+        header.index_offset = written;
+        if (std::fwrite(offsets.data(), sizeof(u64), offsets.size(), file) != offsets.size() ||
+            std::fseek(file, 0, SEEK_SET) != 0 ||
+            std::fwrite(&header, sizeof(header), 1, file) != 1) {
+            ok = false;
+        }
+    }
+    if (std::fclose(file) != 0) {
+        ok = false;
+    }
+    file = nullptr;
+    return ok;
+}
+
+TestCaseReader::TestCaseReader(const char* path) {
+#ifdef _WIN32
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) {
+        return;
+    }
+    fallback.resize(static_cast<std::size_t>(in.tellg()));
+    in.seekg(0);
+    in.read(reinterpret_cast<char*>(fallback.data()), fallback.size());
+    data = fallback.data();
+    size = fallback.size();
+#else
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return;
+    }
+    size = static_cast<std::size_t>(st.st_size);
+    if (size != 0) {
+        void* ptr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (ptr == MAP_FAILED) {
+            return;
+        }
+        madvise(ptr, size, MADV_SEQUENTIAL);
+        data = static_cast<const u8*>(ptr);
+        mapped = true;
+    } else {
+        close(fd);
+    }
+#endif
+
+    Header header;
+    if (size >= sizeof(Header) && std::memcmp(data, Magic, sizeof(Magic)) == 0) {
+        std::memcpy(&header, data, sizeof(header));
+        if (header.version != Version || header.index_offset > size ||
+            (size - header.index_offset) / sizeof(u64) < header.count) {
+            return;
+        }
+        format = TestFormat::Compact;
+        count = static_cast<std::size_t>(header.count);
+        index = data + header.index_offset;
+    } else {
+        // Anything else is imported as a raw TestCase array; a partial record at the end is ignored
+        format = TestFormat::Raw;
+        count = size / sizeof(TestCase);
+    }
+    valid = true;
+}
+
+TestCaseReader::~TestCaseReader() {
+#ifndef _WIN32
+    if (mapped) {
+        munmap(const_cast<u8*>(data), size);
+    }
+#endif
+}
+
+bool TestCaseReader::Get(std::size_t i, TestCase& test_case) const {
+    if (!valid || i >= count) {
+        return false;
+    }
+    if (format == TestFormat::Raw) {
+        std::memcpy(&test_case, data + i * sizeof(TestCase), sizeof(TestCase));
+        return true;
+    }
+    u64 offset;
+    std::memcpy(&offset, index + i * sizeof(u64), sizeof(offset));
+    if (offset >= size) {
+        return false;
+    }
+    Cursor cursor(data + offset, data + size);
+    return DecodeCompact(cursor, test_case);
+}
+
+} // namespace Teakra::Test
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+#include <vector>
+#include "common_types.h"
+#include "test.h"
+
+namespace Teakra::Test {
+
+// Test case files come in two formats:
+//  - Raw: a plain array of TestCase, as consumed by the hardware test runner.
+//  - Compact: a header, the records and an index of record offsets. A record stores the before
+//    state in full, and for the after state only the register words and test space words that
+//    differ from it.
+enum class TestFormat { Raw, Compact };
+
+class TestCaseWriter {
+public:
+    TestCaseWriter(const char* path, TestFormat format);
+    ~TestCaseWriter();
+
+    TestCaseWriter(const TestCaseWriter&) = delete;
+    TestCaseWriter& operator=(const TestCaseWriter&) = delete;
+
+    bool IsOpen() const {
+        return file != nullptr;
+    }
+
+    bool Write(const TestCase& test_case);
+
+    // Flushes the records and, for the compact format, writes the index and header.
+    // Called by the destructor if not called before.
+    bool Finish();
+
+private:
+    bool Flush();
+
+    std::FILE* file = nullptr;
+    TestFormat format;
+    std::vector<u8> buffer;
+    std::vector<u64> offsets;
+    u64 written = 0;
+    bool ok = true;
+};
+
+// Opens either format. The file is memory-mapped and Get is safe to call from several threads.
+class TestCaseReader {
+public:
+    explicit TestCaseReader(const char* path);
+    ~TestCaseReader();
+
+    TestCaseReader(const TestCaseReader&) = delete;
+    TestCaseReader& operator=(const TestCaseReader&) = delete;
+
+    bool IsOpen() const {
+        return valid;
+    }
+
+    TestFormat GetFormat() const {
+        return format;
+    }
+
+    std::size_t Size() const {
+        return count;
+    }
+
+    bool Get(std::size_t index, TestCase& test_case) const;
+
+private:
+    const u8* data = nullptr;
+    std::size_t size = 0;
+    std::vector<u8> fallback;
+    bool mapped = false;
+    bool valid = false;
+    TestFormat format = TestFormat::Raw;
+    std::size_t count = 0;
+    const u8* index = nullptr;
+};
+
+} // namespace Teakra::Test
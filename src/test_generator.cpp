@@ -1,9 +1,12 @@
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <cstdio>
 #include <memory>
 #include <random>
+#include <thread>
 #include <unordered_set>
+#include <vector>
 #include "common_types.h"
 #include "crash.h"
 #include "decoder.h"
@@ -22,7 +25,8 @@ enum class ExpandConfig {
 
 namespace Random {
 namespace {
-std::mt19937 gen(std::random_device{}());
+// Each generating thread reseeds its engine per opcode, see GenerateTestCasesToFile
+thread_local std::mt19937 gen;
 
 u64 uniform(u64 a, u64 b) {
     std::uniform_int_distribution<u64> dist(a, b);
@@ -30,8 +34,8 @@ u64 uniform(u64 a, u64 b) {
 }
 
 u64 bit40() {
-    static std::uniform_int_distribution<u64> dist(0, 0xFF'FFFF'FFFF);
-    static std::uniform_int_distribution<int> dist2(0, 4);
+    std::uniform_int_distribution<u64> dist(0, 0xFF'FFFF'FFFF);
+    std::uniform_int_distribution<int> dist2(0, 4);
     u64 v = dist(gen);
     switch (dist2(gen)) {
     case 0:
@@ -54,14 +58,19 @@ u64 bit40() {
 }
 
 u32 bit32() {
-    static std::uniform_int_distribution<u32> dist;
+    std::uniform_int_distribution<u32> dist;
     return dist(gen);
 }
 
 u16 bit16() {
-    static std::uniform_int_distribution<u16> dist;
+    std::uniform_int_distribution<u16> dist;
     return dist(gen);
 }
+
+void Seed(u64 seed, u16 opcode) {
+    std::seed_seq seq{static_cast<u32>(seed), static_cast<u32>(seed >> 32), static_cast<u32>(opcode)};
+    gen.seed(seq);
+}
 } // Anonymous namespace
 } // namespace Random
 
@@ -88,7 +97,7 @@ struct Config {
         return copy;
     }
 
-    State GenerateRandomState() {
+    State GenerateRandomState() const {
         State state;
         state.stepi0 = Random::bit16();
         state.stepj0 = Random::bit16();
@@ -1440,44 +1449,103 @@ public:
 };
 } // Anonymous namespace
 
-bool GenerateTestCasesToFile(const char* path) {
-    std::unique_ptr<std::FILE, decltype(&std::fclose)> f{std::fopen(path, "wb"), std::fclose};
-    if (!f) {
-        return false;
-    }
+bool GenerateTestCasesToFile(const char* path, u64 seed, unsigned threads) {
+    constexpr u32 OpcodeCount = 0x10000;
+    constexpr u32 CasesPerOpcode = 4;
+    constexpr u32 OpcodesPerChunk = 0x100;
+    constexpr u32 ChunkCount = OpcodeCount / OpcodesPerChunk;
 
+    // The output layout only depends on which opcodes are enabled, so every chunk knows its file
+    // offset up front and can be written independently.
     TestGenerator generator;
-    for (u32 i = 0; i < 0x10000; ++i) {
+    std::vector<Config> configs(OpcodeCount);
+    std::vector<u64> chunk_offsets(ChunkCount + 1);
+    u64 cases = 0;
+    for (u32 i = 0; i < OpcodeCount; ++i) {
+        if (i % OpcodesPerChunk == 0) {
+            chunk_offsets[i / OpcodesPerChunk] = cases * sizeof(TestCase);
+        }
         u16 opcode = (u16)i;
         auto decoded = Decode<TestGenerator>(opcode);
-        Config config = decoded.call(generator, opcode, 0);
-        if (!config.enable)
-            continue;
-
-        for (int j = 0; j < 4; ++j) {
-            TestCase test_case{};
-            test_case.before = config.GenerateRandomState();
-            test_case.opcode = opcode;
-
-            switch (config.expand) {
-            case ExpandConfig::None:
-                test_case.expand = 0;
-                break;
-            case ExpandConfig::Any:
-                test_case.expand = Random::bit16();
-                break;
-            case ExpandConfig::Memory:
-                test_case.expand = TestSpaceX + (u16)Random::uniform(10, TestSpaceSize - 10);
-                break;
-            }
+        configs[i] = decoded.call(generator, opcode, 0);
+        if (configs[i].enable) {
+            cases += CasesPerOpcode;
+        }
+    }
+    chunk_offsets[ChunkCount] = cases * sizeof(TestCase);
+
+    {
+        std::unique_ptr<std::FILE, decltype(&std::fclose)> f{std::fopen(path, "wb"), std::fclose};
+        if (!f) {
+            return false;
+        }
+    }
 
-            if (std::fwrite(&test_case, sizeof(test_case), 1, f.get()) == 0) {
-                return false;
+    std::atomic<u32> next_chunk{0};
+    std::atomic<bool> ok{true};
+    auto worker = [&] {
+        std::unique_ptr<std::FILE, decltype(&std::fclose)> f{std::fopen(path, "r+b"), std::fclose};
+        if (!f) {
+            ok = false;
+            return;
+        }
+        std::vector<TestCase> buffer;
+        for (u32 chunk = next_chunk++; chunk < ChunkCount && ok; chunk = next_chunk++) {
+            buffer.clear();
+            for (u32 i = chunk * OpcodesPerChunk; i < (chunk + 1) * OpcodesPerChunk; ++i) {
+                const Config& config = configs[i];
+                if (!config.enable)
+                    continue;
+
+                u16 opcode = (u16)i;
+                Random::Seed(seed, opcode);
+                for (u32 j = 0; j < CasesPerOpcode; ++j) {
+                    TestCase& test_case = buffer.emplace_back();
+                    test_case.before = config.GenerateRandomState();
+                    test_case.opcode = opcode;
+
+                    switch (config.expand) {
+                    case ExpandConfig::None:
+                        test_case.expand = 0;
+                        break;
+                    case ExpandConfig::Any:
+                        test_case.expand = Random::bit16();
+                        break;
+                    case ExpandConfig::Memory:
+                        test_case.expand = TestSpaceX + (u16)Random::uniform(10, TestSpaceSize - 10);
+                        break;
+                    }
+                }
+            }
+            if (buffer.empty()) {
+                continue;
             }
+            ASSERT(chunk_offsets[chunk] + buffer.size() * sizeof(TestCase) ==
+                   chunk_offsets[chunk + 1]);
+            if (std::fseek(f.get(), static_cast<long>(chunk_offsets[chunk]), SEEK_SET) != 0 ||
+                std::fwrite(buffer.data(), sizeof(TestCase), buffer.size(), f.get()) !=
+                    buffer.size()) {
+                ok = false;
+            }
+        }
+        if (std::fflush(f.get()) != 0) {
+            ok = false;
         }
+    };
+
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    std::vector<std::thread> pool;
+    for (unsigned i = 1; i < threads; ++i) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : pool) {
+        thread.join();
     }
 
-    return true;
+    return ok;
 }
 
 } // namespace Teakra::Test
@@ -1,5 +1,9 @@
 #pragma once
 
+#include "common_types.h"
+
 namespace Teakra::Test {
-bool GenerateTestCasesToFile(const char* path);
+// Writes four random cases for every testable opcode. The cases of each opcode come from their
+// own stream derived from seed, so the file is the same for any thread count (0 = all cores).
+bool GenerateTestCasesToFile(const char* path, u64 seed, unsigned threads = 0);
 }
@@ -1,12 +1,25 @@
 #include <cstdio>
+#include <cstdlib>
+#include <random>
 #include "../test_generator.h"
 
 int main(int argc, char** argv) {
+    // test_generator <file> [seed] [threads]
     if (argc < 2) {
         return -1;
     }
 
-    if (!Teakra::Test::GenerateTestCasesToFile(argv[1])) {
+    u64 seed;
+    if (argc > 2) {
+        seed = std::strtoull(argv[2], nullptr, 0);
+    } else {
+        std::random_device rd;
+        seed = (u64)rd() << 32 | rd();
+    }
+    const unsigned threads = argc > 3 ? (unsigned)std::strtoul(argv[3], nullptr, 0) : 0;
+    std::printf("Seed: 0x%016llX\n", (unsigned long long)seed);
+
+    if (!Teakra::Test::GenerateTestCasesToFile(argv[1], seed, threads)) {
         std::fprintf(stderr, "Unable to successfully generate all tests.\n");
         return -2;
     }
@@ -0,0 +1,50 @@
+#include <cstdio>
+#include <cstring>
+#include "../test.h"
+#include "../test_container.h"
+
+// Converts test case files between the raw and the compact format.
+// test_pack [--raw] <input> <output>
+
+int main(int argc, char** argv) {
+    Teakra::Test::TestFormat format = Teakra::Test::TestFormat::Compact;
+    int arg = 1;
+    if (arg < argc && std::strcmp(argv[arg], "--raw") == 0) {
+        format = Teakra::Test::TestFormat::Raw;
+        ++arg;
+    }
+    if (argc - arg < 2) {
+        std::fprintf(stderr, "Usage: %s [--raw] <input> <output>\n", argv[0]);
+        return -1;
+    }
+
+    Teakra::Test::TestCaseReader reader(argv[arg]);
+    if (!reader.IsOpen()) {
+        std::fprintf(stderr, "Unable to open file %s. Exiting...\n", argv[arg]);
+        return -2;
+    }
+    Teakra::Test::TestCaseWriter writer(argv[arg + 1], format);
+    if (!writer.IsOpen()) {
+        std::fprintf(stderr, "Unable to open file %s. Exiting...\n", argv[arg + 1]);
+        return -2;
+    }
+
+    TestCase test_case;
+    for (std::size_t i = 0; i < reader.Size(); ++i) {
+        if (!reader.Get(i, test_case)) {
+            std::fprintf(stderr, "Test case %zu is corrupted. Exiting...\n", i);
+            return -3;
+        }
+        if (!writer.Write(test_case)) {
+            std::fprintf(stderr, "Unable to completely write test case. Exiting...\n");
+            return -3;
+        }
+    }
+    if (!writer.Finish()) {
+        std::fprintf(stderr, "Unable to completely write test case. Exiting...\n");
+        return -3;
+    }
+
+    std::printf("%zu test cases\n", reader.Size());
+    return 0;
+}
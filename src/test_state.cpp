@@ -0,0 +1,79 @@
+#include <bit>
+#include "jit_regs.h"
+#include "register.h"
+#include "test_state.h"
+
+namespace Teakra::Test {
+
+void LoadState(RegisterState& regs, const State& state) {
+    regs.Reset();
+    regs.a = state.a;
+    regs.b = state.b;
+    regs.p = state.p;
+    regs.r = state.r;
+    regs.x = state.x;
+    regs.y = state.y;
+    regs.stepi0 = state.stepi0;
+    regs.stepj0 = state.stepj0;
+    regs.mixp = state.mixp;
+    regs.sv = state.sv;
+    regs.repc = state.repc;
+    regs.Lc() = state.lc;
+    regs.Set<cfgi>(state.cfgi);
+    regs.Set<cfgj>(state.cfgj);
+    regs.Set<stt0>(state.stt0);
+    regs.Set<stt1>(state.stt1);
+    regs.Set<stt2>(state.stt2);
+    regs.Set<mod0>(state.mod0);
+    regs.Set<mod1>(state.mod1);
+    regs.Set<mod2>(state.mod2);
+    regs.Set<ar0>(state.ar[0]);
+    regs.Set<ar1>(state.ar[1]);
+    regs.Set<arp0>(state.arp[0]);
+    regs.Set<arp1>(state.arp[1]);
+    regs.Set<arp2>(state.arp[2]);
+    regs.Set<arp3>(state.arp[3]);
+}
+
+void LoadState(JitRegisters& jregs, const State& state) {
+    jregs.Reset();
+    jregs.a = state.a;
+    jregs.b = state.b;
+    jregs.p = state.p;
+    jregs.r = state.r;
+    jregs.x = state.x;
+    jregs.y = state.y;
+    jregs.stepi0 = state.stepi0;
+    jregs.stepj0 = state.stepj0;
+    jregs.mixp = state.mixp;
+    jregs.sv = state.sv;
+    jregs.repc = state.repc;
+    jregs.bkrep_stack[0].lc = state.lc;
+    jregs.cfgi.raw = state.cfgi;
+    jregs.cfgj.raw = state.cfgj;
+    jregs.flags.raw = state.stt0 << 1;
+    // stt1
+    const auto st1 = std::bit_cast<Stt1>(state.stt1);
+    jregs.flags.fr.Assign(st1.fr);
+    jregs.pe[0] = st1.pe0;
+    jregs.pe[1] = st1.pe1;
+    // stt2
+    const auto st2 = std::bit_cast<Stt2>(state.stt2);
+    jregs.pcmhi = st2.pcmhi;
+    if (st2.lp != 0) {
+        jregs.lp = 0;
+        jregs.bcn = 0;
+    }
+    jregs.mod0.raw = state.mod0;
+    jregs.mod0.mod0_unk_const.Assign(1);
+    jregs.mod1.raw = state.mod1;
+    jregs.mod2.raw = state.mod2;
+    jregs.ar[0].raw = state.ar[0];
+    jregs.ar[1].raw = state.ar[1];
+    jregs.arp[0].raw = state.arp[0];
+    jregs.arp[1].raw = state.arp[1];
+    jregs.arp[2].raw = state.arp[2];
+    jregs.arp[3].raw = state.arp[3];
+}
+
+} // namespace Teakra::Test
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "test.h"
+
+namespace Teakra {
+struct JitRegisters;
+struct RegisterState;
+} // namespace Teakra
+
+namespace Teakra::Test {
+
+// Loads the state of a test case into the interpreter or the JIT registers, after resetting them.
+// The program counter is left at 0.
+void LoadState(RegisterState& regs, const State& state);
+void LoadState(JitRegisters& jregs, const State& state);
+
+} // namespace Teakra::Test
@@ -1,14 +1,40 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <cinttypes>
+#include <cstdarg>
 #include <cstdio>
-#include <iomanip>
+#include <cstdlib>
+#include <cstring>
 #include <memory>
+#include <string>
+#include <thread>
+#include <vector>
 #include <teakra/disassembler.h>
+#include "../ahbm.h"
+#include "../apbp.h"
+#include "../btdmp.h"
 #include "../core_timing.h"
+#include "../dma.h"
+#include "../icu.h"
 #include "../interpreter.h"
+#include "../jit_no_ir.h"
 #include "../memory_interface.h"
+#include "../mmio.h"
 #include "../shared_memory.h"
 #include "../test.h"
-#include "../jit_no_ir.h"
+#include "../test_container.h"
+#include "../test_state.h"
+#include "../timer.h"
+
+// Verifies the interpreter and the JIT against the hardware results in a test case file of either
+// format. The file is mapped into memory and split into chunks which worker threads pick up, each
+// with a private core. Reports are collected per chunk and printed in file order, so the output does not depend
+// on the thread count.
+
+namespace {
+
+constexpr std::size_t ChunkSize = 256;
 
 std::string Flag16ToString(u16 value, const char* symbols) {
     std::string result = symbols;
@@ -19,332 +45,368 @@ std::string Flag16ToString(u16 value, const char* symbols) {
     return result;
 }
 
-int main(int argc, char** argv) {
-    if (argc < 2) {
-        std::fprintf(stderr, "A filename argument must be provided. Exiting...\n");
-        return -1;
-    }
-
-    std::unique_ptr<std::FILE, decltype(&std::fclose)> file{std::fopen(argv[1], "rb"), std::fclose};
-    if (!file) {
-        std::fprintf(stderr, "Unable to open file %s. Exiting...\n", argv[1]);
-        return -2;
-    }
+void Append(std::string& out, const char* format, ...) {
+    char buffer[256];
+    va_list args;
+    va_start(args, format);
+    std::vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    out += buffer;
+}
 
-    Teakra::CoreTiming core_timing;
-    Teakra::SharedMemory shared_memory;
+// One emulated core per worker thread, wired up the same way as Teakra::Impl.
+struct Core {
+    std::vector<u8> dsp_memory = std::vector<u8>(0x80000);
+    std::array<Teakra::Timer, 2> timer{};
+    std::array<Teakra::Btdmp, 2> btdmp{};
+    Teakra::CoreTiming core_timing{timer, btdmp};
+    Teakra::SharedMemory shared_memory{dsp_memory.data()};
     Teakra::MemoryInterfaceUnit miu;
-    Teakra::MemoryInterface memory_interface{shared_memory, miu};
+    Teakra::ICU icu;
+    Teakra::Apbp apbp_from_cpu, apbp_from_dsp;
+    Teakra::Ahbm ahbm;
+    Teakra::Dma dma{shared_memory, ahbm};
+    Teakra::MMIORegion mmio{miu, icu, apbp_from_cpu, apbp_from_dsp, timer, dma, ahbm, btdmp};
+    Teakra::MemoryInterface memory_interface{shared_memory, miu, mmio};
     Teakra::RegisterState regs;
-    Teakra::Interpreter interpreter(core_timing, regs, memory_interface);
-
+    Teakra::Interpreter interpreter{core_timing, regs, memory_interface};
     Teakra::JitRegisters jregs;
-    Teakra::EmitX64 jit(core_timing, jregs, memory_interface);
-
-    regs.Reset();
-    printf("ar0 = 0x%x\n", regs.Get<Teakra::ar0>());
-    printf("ar1 = 0x%x\n", regs.Get<Teakra::ar1>());
-    printf("arp0 = 0x%x\n", regs.Get<Teakra::arp0>());
-    printf("arp1 = 0x%x\n", regs.Get<Teakra::arp1>());
-    printf("arp2 = 0x%x\n", regs.Get<Teakra::arp2>());
-    printf("arp3 = 0x%x\n", regs.Get<Teakra::arp3>());
-
-    int i = 0;
-    int passed = 0;
-    int total = 0;
-    int skipped = 0;
-    while (true) {
-        TestCase test_case;
-        if (std::fread(&test_case, sizeof(test_case), 1, file.get()) == 0) {
-            break;
-        }
-        regs.Reset();        
-        regs.a = test_case.before.a;
-        regs.b = test_case.before.b;
-        regs.p = test_case.before.p;
-        regs.r = test_case.before.r;
-        regs.x = test_case.before.x;
-        regs.y = test_case.before.y;
-        regs.stepi0 = test_case.before.stepi0;
-        regs.stepj0 = test_case.before.stepj0;
-        regs.mixp = test_case.before.mixp;
-        regs.sv = test_case.before.sv;
-        regs.repc = test_case.before.repc;
-        regs.Lc() = test_case.before.lc;
-        regs.Set<Teakra::cfgi>(test_case.before.cfgi);
-        regs.Set<Teakra::cfgj>(test_case.before.cfgj);
-        regs.Set<Teakra::stt0>(test_case.before.stt0);
-        regs.Set<Teakra::stt1>(test_case.before.stt1);
-        regs.Set<Teakra::stt2>(test_case.before.stt2);
-        regs.Set<Teakra::mod0>(test_case.before.mod0);
-        regs.Set<Teakra::mod1>(test_case.before.mod1);
-        regs.Set<Teakra::mod2>(test_case.before.mod2);
-        regs.Set<Teakra::ar0>(test_case.before.ar[0]);
-        regs.Set<Teakra::ar1>(test_case.before.ar[1]);
-        regs.Set<Teakra::arp0>(test_case.before.arp[0]);
-        regs.Set<Teakra::arp1>(test_case.before.arp[1]);
-        regs.Set<Teakra::arp2>(test_case.before.arp[2]);
-        regs.Set<Teakra::arp3>(test_case.before.arp[3]);
-
-        jregs.Reset();
-        jregs.a = test_case.before.a;
-        jregs.b = test_case.before.b;
-        jregs.p = test_case.before.p;
-        jregs.r = test_case.before.r;
-        jregs.x = test_case.before.x;
-        jregs.y = test_case.before.y;
-        jregs.stepi0 = test_case.before.stepi0;
-        jregs.stepj0 = test_case.before.stepj0;
-        jregs.mixp = test_case.before.mixp;
-        jregs.sv = test_case.before.sv;
-        jregs.repc = test_case.before.repc;
-        jregs.bkrep_stack[0].lc = test_case.before.lc;
-        jregs.cfgi.raw = test_case.before.cfgi;
-        jregs.cfgj.raw = test_case.before.cfgj;
-        jregs.flags.raw = test_case.before.stt0 << 1;
-        // stt1
-        auto stt1 = std::bit_cast<Teakra::Stt1>(test_case.before.stt1);
-        jregs.flags.fr.Assign(stt1.fr);
-        jregs.pe[0] = stt1.pe0;
-        jregs.pe[1] = stt1.pe1;
-        // stt2
-        auto stt2 = std::bit_cast<Teakra::Stt2>(test_case.before.stt2);
-        jregs.pcmhi = stt2.pcmhi;
-        if (stt2.lp != 0) {
-            jregs.lp = 0;
-            jregs.bcn = 0;
-        }
-        jregs.mod0.raw = test_case.before.mod0;
-        jregs.mod0.mod0_unk_const.Assign(1);
-        jregs.mod1.raw = test_case.before.mod1;
-        jregs.mod2.raw = test_case.before.mod2;
-        jregs.ar[0].raw = test_case.before.ar[0];
-        jregs.ar[1].raw = test_case.before.ar[1];
-        jregs.arp[0].raw = test_case.before.arp[0];
-        jregs.arp[1].raw = test_case.before.arp[1];
-        jregs.arp[2].raw = test_case.before.arp[2];
-        jregs.arp[3].raw = test_case.before.arp[3];
+    Teakra::EmitX64 jit{core_timing, jregs, memory_interface};
 
+    void LoadMemory(const TestCase& test_case) {
         for (u16 offset = 0; offset < TestSpaceSize; ++offset) {
             memory_interface.DataWrite(TestSpaceX + offset, test_case.before.test_space_x[offset]);
             memory_interface.DataWrite(TestSpaceY + offset, test_case.before.test_space_y[offset]);
         }
-
         memory_interface.ProgramWrite(0, test_case.opcode);
         memory_interface.ProgramWrite(1, test_case.expand);
+    }
+
+    void LoadInterpreter(const TestCase& test_case) {
+        Teakra::Test::LoadState(regs, test_case.before);
+    }
+
+    void LoadJit(const TestCase& test_case) {
+        Teakra::Test::LoadState(jregs, test_case.before);
+        // The program at address 0 changed since the last case
+        jit.InvalidateBlocks(0);
+    }
+};
+
+class Checker {
+public:
+    explicit Checker(std::string& log) : log(log) {}
+
+    void Check40(const char* name, u64 expected, u64 actual) {
+        if (expected != actual) {
+            Append(log, "Mismatch: %s: %010" PRIx64 " != %010" PRIx64 "\n", name,
+                   expected & 0xFF'FFFF'FFFF, actual & 0xFF'FFFF'FFFF);
+            pass = false;
+        }
+    }
+
+    void Check32(const char* name, u32 expected, u32 actual) {
+        if (expected != actual) {
+            Append(log, "Mismatch: %s: %08X != %08X\n", name, expected, actual);
+            pass = false;
+        }
+    }
+
+    void Check(const char* name, u16 expected, u16 actual) {
+        if (expected != actual) {
+            Append(log, "Mismatch: %s: %04X != %04X\n", name, expected, actual);
+            pass = false;
+        }
+    }
+
+    void CheckAddress(const char* name, u16 address, u16 expected, u16 actual) {
+        if (expected != actual) {
+            Append(log, "Mismatch: %s%04X: %04X != %04X\n", name, address, expected, actual);
+            pass = false;
+        }
+    }
+
+    void CheckFlag(const char* name, u16 expected, u16 actual, const char* symbols) {
+        if (expected != actual) {
+            Append(log, "Mismatch: %s: %s != %s\n", name,
+                   Flag16ToString(expected, symbols).c_str(),
+                   Flag16ToString(actual, symbols).c_str());
+            pass = false;
+        }
+    }
 
-        bool pass = true;
-        bool skip = false;
+    void CheckMemory(const TestCase& test_case, Teakra::MemoryInterface& memory_interface) {
+        for (u16 offset = 0; offset < TestSpaceSize; ++offset) {
+            CheckAddress("memory_", (TestSpaceX + offset), test_case.after.test_space_x[offset],
+                         memory_interface.DataRead(TestSpaceX + offset));
+            CheckAddress("memory_", (TestSpaceY + offset), test_case.after.test_space_y[offset],
+                         memory_interface.DataRead(TestSpaceY + offset));
+        }
+    }
+
+    bool pass = true;
+
+private:
+    std::string& log;
+};
+
+void CheckInterpreter(Checker& c, const TestCase& test_case, Core& core) {
+    auto& regs = core.regs;
+    c.Check40("a0", SignExtend<40>(test_case.after.a[0]), regs.a[0]);
+    c.Check40("a1", SignExtend<40>(test_case.after.a[1]), regs.a[1]);
+    c.Check40("b0", SignExtend<40>(test_case.after.b[0]), regs.b[0]);
+    c.Check40("b1", SignExtend<40>(test_case.after.b[1]), regs.b[1]);
+    c.Check32("p0", test_case.after.p[0], regs.p[0]);
+    c.Check32("p1", test_case.after.p[1], regs.p[1]);
+    c.Check("r0", test_case.after.r[0], regs.r[0]);
+    c.Check("r1", test_case.after.r[1], regs.r[1]);
+    c.Check("r2", test_case.after.r[2], regs.r[2]);
+    c.Check("r3", test_case.after.r[3], regs.r[3]);
+    c.Check("r4", test_case.after.r[4], regs.r[4]);
+    c.Check("r5", test_case.after.r[5], regs.r[5]);
+    c.Check("r6", test_case.after.r[6], regs.r[6]);
+    c.Check("r7", test_case.after.r[7], regs.r[7]);
+    c.Check("x0", test_case.after.x[0], regs.x[0]);
+    c.Check("x1", test_case.after.x[1], regs.x[1]);
+    c.Check("y0", test_case.after.y[0], regs.y[0]);
+    c.Check("y1", test_case.after.y[1], regs.y[1]);
+    c.Check("stepi0", test_case.after.stepi0, regs.stepi0);
+    c.Check("stepj0", test_case.after.stepj0, regs.stepj0);
+    c.Check("mixp", test_case.after.mixp, regs.mixp);
+    c.Check("sv", test_case.after.sv, regs.sv);
+    c.Check("repc", test_case.after.repc, regs.repc);
+    c.Check("lc", test_case.after.lc, regs.Lc());
+    c.CheckFlag("cfgi", test_case.after.cfgi, regs.Get<Teakra::cfgi>(), "mmmmmmmmmsssssss");
+    c.CheckFlag("cfgj", test_case.after.cfgj, regs.Get<Teakra::cfgj>(), "mmmmmmmmmsssssss");
+    c.CheckFlag("stt0", test_case.after.stt0, regs.Get<Teakra::stt0>(), "####C###ZMNVCELL");
+    c.CheckFlag("stt1", test_case.after.stt1, regs.Get<Teakra::stt1>(), "QP#########R####");
+    c.CheckFlag("stt2", test_case.after.stt2, regs.Get<Teakra::stt2>(), "LBBB####mm##V21I");
+    c.CheckFlag("mod0", test_case.after.mod0, regs.Get<Teakra::mod0>(), "#QQ#PPooSYY###SS");
+    c.CheckFlag("mod1", test_case.after.mod1, regs.Get<Teakra::mod1>(), "???B####pppppppp");
+    c.CheckFlag("mod2", test_case.after.mod2, regs.Get<Teakra::mod2>(), "7654321m7654321M");
+    c.CheckFlag("ar0", test_case.after.ar[0], regs.Get<Teakra::ar0>(), "RRRRRRoosssoosss");
+    c.CheckFlag("ar1", test_case.after.ar[1], regs.Get<Teakra::ar1>(), "RRRRRRoosssoosss");
+    c.CheckFlag("arp0", test_case.after.arp[0], regs.Get<Teakra::arp0>(), "#RR#RRjjjjjiiiii");
+    c.CheckFlag("arp1", test_case.after.arp[1], regs.Get<Teakra::arp1>(), "#RR#RRjjjjjiiiii");
+    c.CheckFlag("arp2", test_case.after.arp[2], regs.Get<Teakra::arp2>(), "#RR#RRjjjjjiiiii");
+    c.CheckFlag("arp3", test_case.after.arp[3], regs.Get<Teakra::arp3>(), "#RR#RRjjjjjiiiii");
+    c.CheckMemory(test_case, core.memory_interface);
+}
+
+void CheckJit(Checker& c, const TestCase& test_case, Core& core) {
+    auto& jregs = core.jregs;
+    c.Check40("a0", SignExtend<40>(test_case.after.a[0]), jregs.a[0]);
+    c.Check40("a1", SignExtend<40>(test_case.after.a[1]), jregs.a[1]);
+    c.Check40("b0", SignExtend<40>(test_case.after.b[0]), jregs.b[0]);
+    c.Check40("b1", SignExtend<40>(test_case.after.b[1]), jregs.b[1]);
+    c.Check32("p0", test_case.after.p[0], jregs.p[0]);
+    c.Check32("p1", test_case.after.p[1], jregs.p[1]);
+    c.Check("r0", test_case.after.r[0], jregs.r[0]);
+    c.Check("r1", test_case.after.r[1], jregs.r[1]);
+    c.Check("r2", test_case.after.r[2], jregs.r[2]);
+    c.Check("r3", test_case.after.r[3], jregs.r[3]);
+    c.Check("r4", test_case.after.r[4], jregs.r[4]);
+    c.Check("r5", test_case.after.r[5], jregs.r[5]);
+    c.Check("r6", test_case.after.r[6], jregs.r[6]);
+    c.Check("r7", test_case.after.r[7], jregs.r[7]);
+    c.Check("x0", test_case.after.x[0], jregs.x[0]);
+    c.Check("x1", test_case.after.x[1], jregs.x[1]);
+    c.Check("y0", test_case.after.y[0], jregs.y[0]);
+    c.Check("y1", test_case.after.y[1], jregs.y[1]);
+    c.Check("stepi0", test_case.after.stepi0, jregs.stepi0);
+    c.Check("stepj0", test_case.after.stepj0, jregs.stepj0);
+    c.Check("mixp", test_case.after.mixp, jregs.mixp);
+    c.Check("sv", test_case.after.sv, jregs.sv);
+    c.Check("repc", test_case.after.repc, jregs.repc);
+    c.Check("lc", test_case.after.lc, jregs.bkrep_stack[0].lc);
+    c.CheckFlag("cfgi", test_case.after.cfgi, jregs.cfgi.raw, "mmmmmmmmmsssssss");
+    c.CheckFlag("cfgj", test_case.after.cfgj, jregs.cfgj.raw, "mmmmmmmmmsssssss");
+    c.CheckMemory(test_case, core.memory_interface);
+}
+
+void DumpCase(std::string& log, std::size_t index, const char* backend, const TestCase& test_case,
+              bool skip) {
+    Teakra::Disassembler::ArArpSettings ar_arp;
+    ar_arp.ar = test_case.before.ar;
+    ar_arp.arp = test_case.before.arp;
+    Append(log, "Test case %zu (%s): %04X %04X %s\n", index, backend, test_case.opcode,
+           test_case.expand,
+           Teakra::Disassembler::Do(test_case.opcode, test_case.expand, ar_arp).c_str());
+    if (skip) {
+        return;
+    }
+    const State& before = test_case.before;
+    Append(log, "before:\n");
+    Append(log, "a0 = %010" PRIx64 "; a1 = %010" PRIx64 "\n", before.a[0] & 0xFF'FFFF'FFFF,
+           before.a[1] & 0xFF'FFFF'FFFF);
+    Append(log, "b0 = %010" PRIx64 "; b1 = %010" PRIx64 "\n", before.b[0] & 0xFF'FFFF'FFFF,
+           before.b[1] & 0xFF'FFFF'FFFF);
+    Append(log, "p0 = %08X; p1 = %08X\n", before.p[0], before.p[1]);
+    Append(log, "x0 = %04X; x1 = %04X\n", before.x[0], before.x[1]);
+    Append(log, "y0 = %04X; y1 = %04X\n", before.y[0], before.y[1]);
+    Append(log, "r0 = %04X; r1 = %04X; r2 = %04X; r3 = %04X\n", before.r[0], before.r[1],
+           before.r[2], before.r[3]);
+    Append(log, "r4 = %04X; r5 = %04X; r6 = %04X; r7 = %04X\n", before.r[4], before.r[5],
+           before.r[6], before.r[7]);
+    Append(log, "stepi0 = %04X\n", before.stepi0);
+    Append(log, "stepj0 = %04X\n", before.stepj0);
+    Append(log, "mixp = %04X\n", before.mixp);
+    Append(log, "sv = %04X\n", before.sv);
+    Append(log, "repc = %04X\n", before.repc);
+    Append(log, "lc = %04X\n", before.lc);
+    Append(log, "cfgi = %s\n", Flag16ToString(before.cfgi, "mmmmmmmmmsssssss").c_str());
+    Append(log, "cfgj = %s\n", Flag16ToString(before.cfgj, "mmmmmmmmmsssssss").c_str());
+    Append(log, "stt0 = %s\n", Flag16ToString(before.stt0, "####C###ZMNVCELL").c_str());
+    Append(log, "stt1 = %s\n", Flag16ToString(before.stt1, "QP#########R####").c_str());
+    Append(log, "stt2 = %s\n", Flag16ToString(before.stt2, "LBBB####mm##V21I").c_str());
+    Append(log, "mod0 = %s\n", Flag16ToString(before.mod0, "#QQ#PPooSYY###SS").c_str());
+    Append(log, "mod1 = %s\n", Flag16ToString(before.mod1, "jicB####pppppppp").c_str());
+    Append(log, "mod2 = %s\n", Flag16ToString(before.mod2, "7654321m7654321M").c_str());
+    Append(log, "ar0 = %s\n", Flag16ToString(before.ar[0], "RRRRRRoosssoosss").c_str());
+    Append(log, "ar1 = %s\n", Flag16ToString(before.ar[1], "RRRRRRoosssoosss").c_str());
+    Append(log, "arp0 = %s\n", Flag16ToString(before.arp[0], "#RR#RRiiiiijjjjj").c_str());
+    Append(log, "arp1 = %s\n", Flag16ToString(before.arp[1], "#RR#RRiiiiijjjjj").c_str());
+    Append(log, "arp2 = %s\n", Flag16ToString(before.arp[2], "#RR#RRiiiiijjjjj").c_str());
+    Append(log, "arp3 = %s\n", Flag16ToString(before.arp[3], "#RR#RRiiiiijjjjj").c_str());
+    Append(log, "FAILED\n~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~\n\n");
+}
+
+struct Tally {
+    std::size_t total = 0;
+    std::size_t skipped = 0;
+    std::size_t jit_skipped = 0;
+    std::size_t interpreter_passed = 0;
+    std::size_t jit_passed = 0;
+    std::size_t corrupted = 0;
+};
+
+struct ChunkReport {
+    Tally tally;
+    std::string log;
+};
+
+void VerifyChunk(Core& core, const Teakra::Test::TestCaseReader& reader, std::size_t begin,
+                 std::size_t end, ChunkReport& report) {
+    TestCase test_case;
+    for (std::size_t i = begin; i < end; ++i) {
+        if (!reader.Get(i, test_case)) {
+            Append(report.log, "Test case %zu is corrupted\n", i);
+            ++report.tally.corrupted;
+            continue;
+        }
+        std::string log;
+
+        // Cases the interpreter cannot run are skipped for both backends. The JIT stops in front of
+        // instructions it cannot compile, which is counted separately.
+        core.LoadInterpreter(test_case);
+        core.LoadMemory(test_case);
         try {
-            /*if (i >= 40064 && i <= 45999) {
-                i++;
-                continue;
-            }*/
-            if (i == 39047) {
-                printf("bad\n");
-            }
-            //interpreter.Run(1);
-            jit.unimplemented = false;
-            jit.Run(1, &interpreter);
-            if (jit.unimplemented) {
-                throw Teakra::UnimplementedException();
-            }
-            auto Check40 = [&](const char* name, u64 expected, u64 actual) {
-                if (expected != actual) {
-                    std::printf("Mismatch: %s: %010" PRIx64 " != %010" PRIx64 "\n", name,
-                                expected & 0xFF'FFFF'FFFF, actual & 0xFF'FFFF'FFFF);
-                    pass = false;
-                }
-            };
-
-            auto Check32 = [&](const char* name, u32 expected, u32 actual) {
-                if (expected != actual) {
-                    std::printf("Mismatch: %s: %08X != %08X\n", name, expected, actual);
-                    pass = false;
-                }
-            };
-
-            auto Check = [&](const char* name, u16 expected, u16 actual) {
-                if (expected != actual) {
-                    std::printf("Mismatch: %s: %04X != %04X\n", name, expected, actual);
-                    pass = false;
-                }
-            };
-
-            auto CheckAddress = [&](const char* name, u16 address, u16 expected, u16 actual) {
-                if (expected != actual) {
-                    std::printf("Mismatch: %s%04X: %04X != %04X\n", name, address, expected,
-                                actual);
-                    pass = false;
-                }
-            };
-
-            auto CheckFlag = [&](const char* name, u16 expected, u16 actual, const char* symbols) {
-                if (expected != actual) {
-                    std::printf("Mismatch: %s: %s != %s\n", name,
-                                Flag16ToString(expected, symbols).c_str(),
-                                Flag16ToString(actual, symbols).c_str());
-                    pass = false;
-                }
-            };
-
-            Check40("a0", SignExtend<40>(test_case.after.a[0]), jregs.a[0]);
-            Check40("a1", SignExtend<40>(test_case.after.a[1]), jregs.a[1]);
-            Check40("b0", SignExtend<40>(test_case.after.b[0]), jregs.b[0]);
-            Check40("b1", SignExtend<40>(test_case.after.b[1]), jregs.b[1]);
-            Check32("p0", test_case.after.p[0], jregs.p[0]);
-            Check32("p1", test_case.after.p[1], jregs.p[1]);
-            Check("r0", test_case.after.r[0], jregs.r[0]);
-            Check("r1", test_case.after.r[1], jregs.r[1]);
-            Check("r2", test_case.after.r[2], jregs.r[2]);
-            Check("r3", test_case.after.r[3], jregs.r[3]);
-            Check("r4", test_case.after.r[4], jregs.r[4]);
-            Check("r5", test_case.after.r[5], jregs.r[5]);
-            Check("r6", test_case.after.r[6], jregs.r[6]);
-            Check("r7", test_case.after.r[7], jregs.r[7]);
-            Check("x0", test_case.after.x[0], jregs.x[0]);
-            Check("x1", test_case.after.x[1], jregs.x[1]);
-            Check("y0", test_case.after.y[0], jregs.y[0]);
-            Check("y1", test_case.after.y[1], jregs.y[1]);
-            Check("stepi0", test_case.after.stepi0, jregs.stepi0);
-            Check("stepj0", test_case.after.stepj0, jregs.stepj0);
-            Check("mixp", test_case.after.mixp, jregs.mixp);
-            Check("sv", test_case.after.sv, jregs.sv);
-            Check("repc", test_case.after.repc, jregs.repc);
-            Check("lc", test_case.after.lc, jregs.bkrep_stack[0].lc);
-            CheckFlag("cfgi", test_case.after.cfgi, jregs.cfgi.raw, "mmmmmmmmmsssssss");
-            CheckFlag("cfgj", test_case.after.cfgj, jregs.cfgj.raw, "mmmmmmmmmsssssss");
-            //CheckFlag("mod0", test_case.after.mod0, jregs.mod0.raw, "#QQ#PPooSYY###SS");
-            //CheckFlag("mod1", test_case.after.mod1, jregs.mod1.raw, "???B####pppppppp");
-            //CheckFlag("mod2", test_case.after.mod2, jregs.mod2.raw, "7654321m7654321M");
-            //CheckFlag("ar0", test_case.after.ar[0], jregs.ar[0].raw, "RRRRRRoosssoosss");
-            //CheckFlag("ar1", test_case.after.ar[1], jregs.ar[1].raw, "RRRRRRoosssoosss");
-            //CheckFlag("arp0", test_case.after.arp[0], jregs.arp[0].raw, "#RR#RRjjjjjiiiii");
-            //CheckFlag("arp1", test_case.after.arp[1], jregs.arp[1].raw, "#RR#RRjjjjjiiiii");
-            //CheckFlag("arp2", test_case.after.arp[2], jregs.arp[2].raw, "#RR#RRjjjjjiiiii");
-            //CheckFlag("arp3", test_case.after.arp[3], jregs.arp[3].raw, "#RR#RRjjjjjiiiii");
-
-            //Check40("a0", SignExtend<40>(test_case.after.a[0]), regs.a[0]);
-            //Check40("a1", SignExtend<40>(test_case.after.a[1]), regs.a[1]);
-            //Check40("b0", SignExtend<40>(test_case.after.b[0]), regs.b[0]);
-            //Check40("b1", SignExtend<40>(test_case.after.b[1]), regs.b[1]);
-            //Check32("p0", test_case.after.p[0], regs.p[0]);
-            //Check32("p1", test_case.after.p[1], regs.p[1]);
-            //Check("r0", test_case.after.r[0], regs.r[0]);
-            //Check("r1", test_case.after.r[1], regs.r[1]);
-            //Check("r2", test_case.after.r[2], regs.r[2]);
-            //Check("r3", test_case.after.r[3], regs.r[3]);
-            //Check("r4", test_case.after.r[4], regs.r[4]);
-            //Check("r5", test_case.after.r[5], regs.r[5]);
-            //Check("r6", test_case.after.r[6], regs.r[6]);
-            //Check("r7", test_case.after.r[7], regs.r[7]);
-            //Check("x0", test_case.after.x[0], regs.x[0]);
-            //Check("x1", test_case.after.x[1], regs.x[1]);
-            //Check("y0", test_case.after.y[0], regs.y[0]);
-            //Check("y1", test_case.after.y[1], regs.y[1]);
-            //Check("stepi0", test_case.after.stepi0, regs.stepi0);
-            //Check("stepj0", test_case.after.stepj0, regs.stepj0);
-            //Check("mixp", test_case.after.mixp, regs.mixp);
-            //Check("sv", test_case.after.sv, regs.sv);
-            //Check("repc", test_case.after.repc, regs.repc);
-            //Check("lc", test_case.after.lc, regs.Lc());
-            //CheckFlag("cfgi", test_case.after.cfgi, regs.Get<Teakra::cfgi>(), "mmmmmmmmmsssssss");
-            //CheckFlag("cfgj", test_case.after.cfgj, regs.Get<Teakra::cfgj>(), "mmmmmmmmmsssssss");
-            //CheckFlag("stt0", test_case.after.stt0, regs.Get<Teakra::stt0>(), "####C###ZMNVCELL");
-            //CheckFlag("stt1", test_case.after.stt1, regs.Get<Teakra::stt1>(), "QP#########R####");
-            //CheckFlag("stt2", test_case.after.stt2, regs.Get<Teakra::stt2>(), "LBBB####mm##V21I");
-            //CheckFlag("mod0", test_case.after.mod0, regs.Get<Teakra::mod0>(), "#QQ#PPooSYY###SS");
-            //CheckFlag("mod1", test_case.after.mod1, regs.Get<Teakra::mod1>(), "???B####pppppppp");
-            //CheckFlag("mod2", test_case.after.mod2, regs.Get<Teakra::mod2>(), "7654321m7654321M");
-            //CheckFlag("ar0", test_case.after.ar[0], regs.Get<Teakra::ar0>(), "RRRRRRoosssoosss");
-            //CheckFlag("ar1", test_case.after.ar[1], regs.Get<Teakra::ar1>(), "RRRRRRoosssoosss");
-            //CheckFlag("arp0", test_case.after.arp[0], regs.Get<Teakra::arp0>(), "#RR#RRjjjjjiiiii");
-            //CheckFlag("arp1", test_case.after.arp[1], regs.Get<Teakra::arp1>(), "#RR#RRjjjjjiiiii");
-            //CheckFlag("arp2", test_case.after.arp[2], regs.Get<Teakra::arp2>(), "#RR#RRjjjjjiiiii");
-            //CheckFlag("arp3", test_case.after.arp[3], regs.Get<Teakra::arp3>(), "#RR#RRjjjjjiiiii");
-
-            for (u16 offset = 0; offset < TestSpaceSize; ++offset) {
-                CheckAddress("memory_", (TestSpaceX + offset), test_case.after.test_space_x[offset],
-                             memory_interface.DataRead(TestSpaceX + offset));
-                CheckAddress("memory_", (TestSpaceY + offset), test_case.after.test_space_y[offset],
-                             memory_interface.DataRead(TestSpaceY + offset));
-            }
-            ++total;
+            core.interpreter.Run(1);
         } catch (const Teakra::UnimplementedException&) {
-            std::printf("Skipped one unimplemented case\n");
-            pass = false;
-            skip = true;
-            ++skipped;
+            Append(report.log, "Skipped one unimplemented case\n");
+            DumpCase(report.log, i, "interpreter", test_case, true);
+            ++report.tally.skipped;
+            continue;
         }
+        ++report.tally.total;
 
-        if (pass) {
-            ++passed;
+        Checker interpreter_check(log);
+        CheckInterpreter(interpreter_check, test_case, core);
+        if (interpreter_check.pass) {
+            ++report.tally.interpreter_passed;
         } else {
-            Teakra::Disassembler::ArArpSettings ar_arp;
-            ar_arp.ar = test_case.before.ar;
-            ar_arp.arp = test_case.before.arp;
-            std::printf(
-                "Test case %d: %04X %04X %s\n", i, test_case.opcode, test_case.expand,
-                Teakra::Disassembler::Do(test_case.opcode, test_case.expand, ar_arp).c_str());
-            if (!skip) {
-                std::printf("before:\n");
-                std::printf("a0 = %010" PRIx64 "; a1 = %010" PRIx64 "\n",
-                            test_case.before.a[0] & 0xFF'FFFF'FFFF,
-                            test_case.before.a[1] & 0xFF'FFFF'FFFF);
-                std::printf("b0 = %010" PRIx64 "; b1 = %010" PRIx64 "\n",
-                            test_case.before.b[0] & 0xFF'FFFF'FFFF,
-                            test_case.before.b[1] & 0xFF'FFFF'FFFF);
-                std::printf("p0 = %08X; p1 = %08X\n", test_case.before.p[0], test_case.before.p[1]);
-                std::printf("x0 = %04X; x1 = %04X\n", test_case.before.x[0], test_case.before.x[1]);
-                std::printf("y0 = %04X; y1 = %04X\n", test_case.before.y[0], test_case.before.y[1]);
-                std::printf("r0 = %04X; r1 = %04X; r2 = %04X; r3 = %04X\n", test_case.before.r[0],
-                            test_case.before.r[1], test_case.before.r[2], test_case.before.r[3]);
-                std::printf("r4 = %04X; r5 = %04X; r6 = %04X; r7 = %04X\n", test_case.before.r[4],
-                            test_case.before.r[5], test_case.before.r[6], test_case.before.r[7]);
-                std::printf("stepi0 = %04X\n", test_case.before.stepi0);
-                std::printf("stepj0 = %04X\n", test_case.before.stepj0);
-                std::printf("mixp = %04X\n", test_case.before.mixp);
-                std::printf("sv = %04X\n", test_case.before.sv);
-                std::printf("repc = %04X\n", test_case.before.repc);
-                std::printf("lc = %04X\n", test_case.before.lc);
-                std::printf("cfgi = %s\n",
-                            Flag16ToString(test_case.before.cfgi, "mmmmmmmmmsssssss").c_str());
-                std::printf("cfgj = %s\n",
-                            Flag16ToString(test_case.before.cfgj, "mmmmmmmmmsssssss").c_str());
-                std::printf("stt0 = %s\n",
-                            Flag16ToString(test_case.before.stt0, "####C###ZMNVCELL").c_str());
-                std::printf("stt1 = %s\n",
-                            Flag16ToString(test_case.before.stt1, "QP#########R####").c_str());
-                std::printf("stt2 = %s\n",
-                            Flag16ToString(test_case.before.stt2, "LBBB####mm##V21I").c_str());
-                std::printf("mod0 = %s\n",
-                            Flag16ToString(test_case.before.mod0, "#QQ#PPooSYY###SS").c_str());
-                std::printf("mod1 = %s\n",
-                            Flag16ToString(test_case.before.mod1, "jicB####pppppppp").c_str());
-                std::printf("mod2 = %s\n",
-                            Flag16ToString(test_case.before.mod2, "7654321m7654321M").c_str());
-                std::printf("ar0 = %s\n",
-                            Flag16ToString(test_case.before.ar[0], "RRRRRRoosssoosss").c_str());
-                std::printf("ar1 = %s\n",
-                            Flag16ToString(test_case.before.ar[1], "RRRRRRoosssoosss").c_str());
-                std::printf("arp0 = %s\n",
-                            Flag16ToString(test_case.before.arp[0], "#RR#RRiiiiijjjjj").c_str());
-                std::printf("arp1 = %s\n",
-                            Flag16ToString(test_case.before.arp[1], "#RR#RRiiiiijjjjj").c_str());
-                std::printf("arp2 = %s\n",
-                            Flag16ToString(test_case.before.arp[2], "#RR#RRiiiiijjjjj").c_str());
-                std::printf("arp3 = %s\n",
-                            Flag16ToString(test_case.before.arp[3], "#RR#RRiiiiijjjjj").c_str());
-                std::printf("FAILED\n~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~\n\n");
-            }
+            report.log += log;
+            DumpCase(report.log, i, "interpreter", test_case, false);
         }
 
-        ++i;
+        log.clear();
+        core.LoadJit(test_case);
+        core.LoadMemory(test_case);
+        core.jit.Run(1);
+        if (core.jit.unimplemented) {
+            Append(report.log, "Skipped one case unimplemented in the JIT\n");
+            DumpCase(report.log, i, "jit", test_case, true);
+            ++report.tally.jit_skipped;
+            continue;
+        }
+        Checker jit_check(log);
+        CheckJit(jit_check, test_case, core);
+        if (jit_check.pass) {
+            ++report.tally.jit_passed;
+        } else {
+            report.log += log;
+            DumpCase(report.log, i, "jit", test_case, false);
+        }
     }
+}
 
-    std::printf("%d / %d passed, %d skipped\n", passed, total, skipped);
+} // Anonymous namespace
+
+int main(int argc, char** argv) {
+    const char* filename = nullptr;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            threads = std::max(1u, static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 0)));
+        } else {
+            filename = argv[i];
+        }
+    }
+    if (!filename) {
+        std::fprintf(stderr, "A filename argument must be provided. Exiting...\n");
+        return -1;
+    }
+
+    Teakra::Test::TestCaseReader reader(filename);
+    if (!reader.IsOpen()) {
+        std::fprintf(stderr, "Unable to open file %s. Exiting...\n", filename);
+        return -2;
+    }
+    const std::size_t count = reader.Size();
+
+    const std::size_t chunks = (count + ChunkSize - 1) / ChunkSize;
+    std::vector<ChunkReport> reports(chunks);
+    std::atomic<std::size_t> next_chunk{0};
+    auto worker = [&] {
+        auto core = std::make_unique<Core>();
+        for (std::size_t chunk = next_chunk++; chunk < chunks; chunk = next_chunk++) {
+            const std::size_t begin = chunk * ChunkSize;
+            VerifyChunk(*core, reader, begin, std::min(begin + ChunkSize, count), reports[chunk]);
+        }
+    };
+
+    threads = static_cast<unsigned>(std::min<std::size_t>(threads, std::max<std::size_t>(chunks, 1)));
+    std::vector<std::thread> pool;
+    for (unsigned i = 1; i < threads; ++i) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : pool) {
+        thread.join();
+    }
+
+    Tally tally;
+    for (const auto& report : reports) {
+        std::fputs(report.log.c_str(), stdout);
+        tally.total += report.tally.total;
+        tally.skipped += report.tally.skipped;
+        tally.jit_skipped += report.tally.jit_skipped;
+        tally.interpreter_passed += report.tally.interpreter_passed;
+        tally.jit_passed += report.tally.jit_passed;
+        tally.corrupted += report.tally.corrupted;
+    }
+
+    std::printf("interpreter: %zu / %zu passed, %zu skipped\n", tally.interpreter_passed,
+                tally.total, tally.skipped);
+    std::printf("jit: %zu / %zu passed, %zu skipped\n", tally.jit_passed,
+                tally.total - tally.jit_skipped, tally.skipped + tally.jit_skipped);
+
+    if (tally.corrupted != 0) {
+        std::printf("%zu corrupted test cases\n", tally.corrupted);
+    }
 
-    if (passed < total) {
+    if (tally.interpreter_passed < tally.total ||
+        tally.jit_passed + tally.jit_skipped < tally.total || tally.corrupted != 0) {
         return 1;
     }
 
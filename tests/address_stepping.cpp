@@ -0,0 +1,143 @@
+#include <functional>
+#include <vector>
+#include <catch.hpp>
+#include "../src/interpreter.h"
+#include "../src/register.h"
+#include "core_environment.h"
+
+namespace {
+
+constexpr u16 ModrR0Increase = 0x0088; // modr [r0++]
+constexpr u16 ModrR0Step = 0x0098;     // modr [r0++s]
+constexpr u16 ModrArp0 = 0x0D80;       // modr [arprni0+arpsi0] [arprnj0+arpsj0]
+
+constexpr u16 Start = 0x0013;
+// modi = 0x13 makes r0 wrap from 0x13 back to 0 with modulo enabled
+constexpr u16 Cfgi = 0x13 << 7;
+constexpr u16 StackTop = 0x0500;
+
+struct SteppingTestEnvironment : CoreEnvironment {
+    Teakra::RegisterState regs;
+    Teakra::Interpreter interpreter{core_timing, regs, memory_interface};
+
+    // Without a write, r0 steps from 0x13 to 0x14
+    SteppingTestEnvironment(const std::vector<u16>& program,
+                            const std::function<void(SteppingTestEnvironment&)>& setup) {
+        for (u16 i = 0; i < program.size(); ++i) {
+            memory_interface.ProgramWrite(i, program[i]);
+        }
+        regs.r[0] = Start;
+        regs.modi = 0x20;
+        regs.stepi = 1;
+        regs.sp = StackTop;
+        setup(*this);
+    }
+};
+
+// Runs the program in one go, so the last instruction, which steps r0, sees the descriptors as
+// left by the writes before it. A second run stops before the last instruction, so starting the
+// next run refreshes them from the registers.
+void CheckStepping(const std::vector<u16>& program, unsigned instructions, u16 expected,
+                   const std::function<void(SteppingTestEnvironment&)>& setup) {
+    SteppingTestEnvironment together(program, setup);
+    together.interpreter.Run(instructions);
+
+    SteppingTestEnvironment split(program, setup);
+    split.interpreter.Run(instructions - 1);
+    split.interpreter.Run(1);
+
+    REQUIRE(split.regs.r[0] == expected);
+    REQUIRE(together.regs.r == split.regs.r);
+}
+
+} // Anonymous namespace
+
+TEST_CASE("Address stepping follows every write to its registers", "[interpreter]") {
+    SECTION("mov register to cfgi") {
+        CheckStepping({0x59C1, ModrR0Increase}, 2, 0, [](SteppingTestEnvironment& env) {
+            env.regs.m[0] = 1;
+            env.regs.r[1] = Cfgi;
+        });
+    }
+
+    SECTION("mov immediate to cfgi") {
+        CheckStepping({0x5E0E, Cfgi, ModrR0Increase}, 2, 0,
+                      [](SteppingTestEnvironment& env) { env.regs.m[0] = 1; });
+    }
+
+    SECTION("load modi") {
+        CheckStepping({0x0213, ModrR0Increase}, 2, 0,
+                      [](SteppingTestEnvironment& env) { env.regs.m[0] = 1; });
+    }
+
+    SECTION("pop cfgi") {
+        CheckStepping({0x5E6E, ModrR0Increase}, 2, 0, [](SteppingTestEnvironment& env) {
+            env.regs.m[0] = 1;
+            env.memory_interface.DataWrite(StackTop, Cfgi);
+        });
+    }
+
+    SECTION("mov immediate to mod2") {
+        CheckStepping({0x0036, 0x0001, ModrR0Increase}, 2, 0,
+                      [](SteppingTestEnvironment& env) { env.regs.modi = 0x13; });
+    }
+
+    SECTION("mov immediate to mod1") {
+        // stp16 with the Teak method steps by stepi0
+        CheckStepping({0x0035, 0x1000, ModrR0Step}, 2, Start + 7,
+                      [](SteppingTestEnvironment& env) {
+                          env.regs.cmd = 0;
+                          env.regs.stepi0 = 7;
+                      });
+    }
+
+    SECTION("load stepi") {
+        CheckStepping({0xDB85, ModrR0Step}, 2, Start + 5, [](SteppingTestEnvironment&) {});
+    }
+
+    SECTION("mov a0h to stepi0") {
+        CheckStepping({0xD49B, ModrR0Step}, 2, Start + 7, [](SteppingTestEnvironment& env) {
+            env.regs.stp16 = 1;
+            env.regs.cmd = 0;
+            env.regs.a[0] = 7 << 16;
+        });
+    }
+
+    SECTION("banke cfgi") {
+        CheckStepping({0x4B81, ModrR0Increase}, 2, 0, [](SteppingTestEnvironment& env) {
+            env.regs.m[0] = 1;
+            env.regs.modib = 0x13;
+        });
+    }
+
+    // mod2 is shadowed, so storing the context swaps the modulo flag back out and restoring
+    // swaps it in again
+    SECTION("cntx s") {
+        CheckStepping({0xD380, ModrR0Increase}, 2, Start + 1, [](SteppingTestEnvironment& env) {
+            env.regs.m[0] = 1;
+            env.regs.modi = 0x13;
+        });
+    }
+
+    SECTION("cntx r") {
+        CheckStepping({0x0036, 0x0001, 0xD380, 0xD390, ModrR0Increase}, 4, 0,
+                      [](SteppingTestEnvironment& env) { env.regs.modi = 0x13; });
+    }
+
+    // arp0 is read on every step rather than cached, but picks which cached step applies: here
+    // r0 with the stepi step instead of an increment
+    SECTION("mov immediate to arp0") {
+        CheckStepping({0x000A, 0x0003, ModrArp0}, 2, Start + 5, [](SteppingTestEnvironment& env) {
+            env.regs.stepi = 5;
+            env.regs.arpstepi[0] = 1;
+        });
+    }
+
+    SECTION("pop arp0") {
+        CheckStepping({0x82C7, ModrArp0}, 2, Start + 5, [](SteppingTestEnvironment& env) {
+            env.regs.stepi = 5;
+            env.regs.arpstepi[0] = 1;
+            env.memory_interface.DataWrite(StackTop, 0x0003);
+        });
+    }
+}
@@ -33,7 +33,7 @@ std::vector<u8> loadDspFirmFromFile() {
     return dspfirm_binary;
 }
 
-AudioState::AudioState(std::vector<u8>&& dspfirm) {
+AudioState::AudioState(std::vector<u8>&& dspfirm, bool use_jit) : lle(use_jit) {
     // interrupt type == 2 (pipe related)
     // pipe channel == 2 (audio pipe)
     // VERIFY(DSP_RegisterInterruptEvents(pipe2_irq, 2, 2));
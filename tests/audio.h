@@ -29,7 +29,7 @@ struct SharedMem {
 };
 
 struct AudioState {
-    explicit AudioState(std::vector<u8>&& dspfirm);
+    explicit AudioState(std::vector<u8>&& dspfirm, bool use_jit = false);
     ~AudioState();
 
     void initSharedMem(bool is_jit = true);
@@ -0,0 +1,291 @@
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "audio.h"
+
+// End-to-end benchmarks driving the DSP1 audio component (dspaudio.cdc in the working directory).
+// Every scenario runs once per backend and prints one JSON object per line.
+
+namespace {
+
+constexpr double DspClockRate = 134'055'928.0;
+
+using Clock = std::chrono::steady_clock;
+
+struct Result {
+    const char* scenario;
+    const char* backend;
+    std::uint64_t wall_ns;
+    std::uint64_t dsp_cycles;
+    std::uint64_t compile_ns;
+    std::uint64_t work_items; // frames or pipe commands
+};
+
+void Print(const Result& r) {
+    const double seconds = r.wall_ns / 1e9;
+    const double cycles_per_second = seconds > 0 ? r.dsp_cycles / seconds : 0;
+    std::printf("{\"scenario\":\"%s\",\"backend\":\"%s\",\"wall_ns\":%llu,\"dsp_cycles\":%llu,"
+                "\"dsp_cycles_per_s\":%.0f,\"realtime_factor\":%.3f,\"compile_ns\":%llu,"
+                "\"items\":%llu}\n",
+                r.scenario, r.backend, (unsigned long long)r.wall_ns,
+                (unsigned long long)r.dsp_cycles, cycles_per_second,
+                cycles_per_second / DspClockRate, (unsigned long long)r.compile_ns,
+                (unsigned long long)r.work_items);
+    std::fflush(stdout);
+}
+
+struct Measurement {
+    explicit Measurement(AudioState& state) : teakra(state.lle.teakra) {
+        teakra.GetStatsDelta();
+        start = Clock::now();
+    }
+
+    Result Finish(const char* scenario, const char* backend, std::uint64_t items) {
+        const auto wall = Clock::now() - start;
+        const auto delta = teakra.GetStatsDelta();
+        return {scenario,
+                backend,
+                static_cast<std::uint64_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(wall).count()),
+                delta.cycles,
+                delta.jit.compile_ns,
+                items};
+    }
+
+    Teakra::Teakra& teakra;
+    Clock::time_point start;
+};
+
+void RunFrames(AudioState& state, unsigned frames) {
+    for (unsigned i = 0; i < frames; ++i) {
+        state.notifyDsp();
+        state.waitForSync();
+    }
+}
+
+void StartVoices(AudioState& state, DSP::HLE::SourceConfiguration::Configuration::Format format) {
+    using Configuration = DSP::HLE::SourceConfiguration::Configuration;
+    constexpr u32 NumSamples = 160 * 200;
+
+    u8* fcram = state.lle.fcram.get();
+    std::srand(0);
+    for (u32 i = 0; i < NumSamples * 2; ++i) {
+        fcram[i] = static_cast<u8>(std::rand());
+    }
+    std::array<s16, 16> coefficients;
+    for (auto& c : coefficients) {
+        c = static_cast<s16>(std::rand() % 0x800);
+    }
+
+    // The tests keep a separate copy of the shared structures per backend; fill both
+    for (const bool is_jit : {true, false}) {
+        const auto& mem = state.write(is_jit);
+        for (std::size_t i = 0; i < AudioCore::num_sources; ++i) {
+            auto& voice = mem.source_configurations->config[i];
+            voice.physical_address = static_cast<u32>(FCRAM_PADDR);
+            voice.length = NumSamples;
+            voice.mono_or_stereo.Assign(Configuration::MonoOrStereo::Mono);
+            voice.format.Assign(format);
+            voice.fade_in.Assign(0);
+            voice.is_looping.Assign(1);
+            voice.buffer_id = 1;
+            voice.play_position = 0;
+            voice.play_position_dirty.Assign(1);
+            voice.partial_reset_flag.Assign(1);
+            voice.embedded_buffer_dirty.Assign(1);
+            voice.format_dirty.Assign(1);
+            voice.gain[0][0] = 1.0f / AudioCore::num_sources;
+            voice.gain[0][1] = 1.0f / AudioCore::num_sources;
+            voice.gain_0_dirty.Assign(1);
+            voice.interpolation_mode = Configuration::InterpolationMode::Polyphase;
+            voice.interpolation_dirty.Assign(1);
+            voice.enable = 1;
+            voice.enable_dirty.Assign(1);
+
+            if (format == Configuration::Format::ADPCM) {
+                for (std::size_t c = 0; c < coefficients.size(); ++c) {
+                    mem.adpcm_coefficients->coeff[i][c] = coefficients[c];
+                }
+                voice.adpcm_coefficients_dirty.Assign(1);
+                voice.adpcm_ps = 0;
+                voice.adpcm_yn[0] = 0;
+                voice.adpcm_yn[1] = 0;
+                voice.adpcm_dirty.Assign(1);
+            }
+        }
+    }
+}
+
+std::vector<u8> firmware;
+
+void Prepare(AudioState& state) {
+    state.initSharedMem(true);
+    state.initSharedMem(false);
+    RunFrames(state, 4);
+}
+
+void BenchBoot(bool use_jit, const char* backend, unsigned) {
+    // AudioState's constructor loads the component and waits for the first sync
+    const auto start = Clock::now();
+    AudioState state(std::vector<u8>(firmware), use_jit);
+    const auto wall = Clock::now() - start;
+    const auto stats = state.lle.teakra.GetStats();
+    Print({"boot", backend,
+           static_cast<std::uint64_t>(
+               std::chrono::duration_cast<std::chrono::nanoseconds>(wall).count()),
+           stats.cycles, stats.jit.compile_ns, 1});
+}
+
+void BenchIdle(bool use_jit, const char* backend, unsigned frames) {
+    AudioState state(std::vector<u8>(firmware), use_jit);
+    Prepare(state);
+    Measurement m(state);
+    RunFrames(state, frames);
+    Print(m.Finish("idle", backend, frames));
+}
+
+void BenchVoices(bool use_jit, const char* backend, unsigned frames,
+                 DSP::HLE::SourceConfiguration::Configuration::Format format, const char* name) {
+    AudioState state(std::vector<u8>(firmware), use_jit);
+    Prepare(state);
+    StartVoices(state, format);
+    Measurement m(state);
+    RunFrames(state, frames);
+    Print(m.Finish(name, backend, frames));
+}
+
+void BenchPcm16(bool use_jit, const char* backend, unsigned frames) {
+    BenchVoices(use_jit, backend, frames,
+                DSP::HLE::SourceConfiguration::Configuration::Format::PCM16, "voices24_pcm16");
+}
+
+void BenchAdpcm(bool use_jit, const char* backend, unsigned frames) {
+    BenchVoices(use_jit, backend, frames,
+                DSP::HLE::SourceConfiguration::Configuration::Format::ADPCM, "voices24_adpcm");
+}
+
+void BenchPipe(bool use_jit, const char* backend, unsigned frames) {
+    AudioState state(std::vector<u8>(firmware), use_jit);
+    Prepare(state);
+    // Each command goes through the pipe status slots and command register 2. Alternate sleep (3)
+    // and wakeup (2) so the component ends up in the same state it started in.
+    const unsigned commands = frames * 2;
+    Measurement m(state);
+    for (unsigned i = 0; i < commands; ++i) {
+        std::vector<u8> buffer(4, 0);
+        buffer[0] = i % 2 == 0 ? 3 : 2;
+        state.lle.PipeWrite(DspPipe::Audio, buffer);
+        while (!state.lle.teakra.SendDataIsEmpty(2)) {
+            state.lle.RunTeakraSlice();
+        }
+    }
+    Print(m.Finish("pipe", backend, commands));
+}
+
+// Several instances of the component playing the same voices, each frame run one instance after
+// another and then through Teakra::RunBatch. Batching only applies to the interpreter; JIT
+// instances run one after another either way.
+void BenchBatch(bool use_jit, const char* backend, unsigned frames) {
+    constexpr std::size_t Instances = 4;
+    std::vector<std::unique_ptr<AudioState>> states;
+    std::vector<Teakra::Teakra*> instances;
+    for (std::size_t i = 0; i < Instances; ++i) {
+        states.push_back(std::make_unique<AudioState>(std::vector<u8>(firmware), use_jit));
+        Prepare(*states.back());
+        StartVoices(*states.back(), DSP::HLE::SourceConfiguration::Configuration::Format::PCM16);
+        instances.push_back(&states.back()->lle.teakra);
+    }
+
+    const auto measure = [&](const char* scenario, auto&& run_frame) {
+        for (auto* teakra : instances) {
+            teakra->GetStatsDelta();
+        }
+        const auto start = Clock::now();
+        for (unsigned frame = 0; frame < frames; ++frame) {
+            for (auto& state : states) {
+                state->notifyDsp();
+            }
+            run_frame();
+        }
+        const auto wall = Clock::now() - start;
+        Result result{scenario, backend,
+                      static_cast<std::uint64_t>(
+                          std::chrono::duration_cast<std::chrono::nanoseconds>(wall).count()),
+                      0, 0, frames * Instances};
+        for (auto* teakra : instances) {
+            const auto delta = teakra->GetStatsDelta();
+            result.dsp_cycles += delta.cycles;
+            result.compile_ns += delta.jit.compile_ns;
+        }
+        Print(result);
+    };
+
+    measure("batch4_sequential", [&] {
+        for (auto& state : states) {
+            state->waitForSync();
+        }
+    });
+
+    std::vector<Teakra::Teakra*> pending;
+    measure("batch4", [&] {
+        while (true) {
+            pending.clear();
+            for (std::size_t i = 0; i < Instances; ++i) {
+                if (!states[i]->irq2) {
+                    pending.push_back(instances[i]);
+                }
+            }
+            if (pending.empty()) {
+                break;
+            }
+            Teakra::Teakra::RunBatch(pending, DspLle::TeakraSlice);
+        }
+        for (auto& state : states) {
+            state->irq2 = false;
+        }
+    });
+}
+
+struct Scenario {
+    const char* name;
+    std::function<void(bool, const char*, unsigned)> run;
+};
+
+} // Anonymous namespace
+
+int main(int argc, char** argv) {
+    // teakra_bench [frames] [scenario...]
+    const unsigned frames = argc > 1 ? static_cast<unsigned>(std::strtoul(argv[1], nullptr, 0)) : 600;
+    firmware = loadDspFirmFromFile();
+    if (firmware.empty()) {
+        return -1;
+    }
+
+    const std::vector<Scenario> scenarios{
+        {"boot", BenchBoot},
+        {"idle", BenchIdle},
+        {"voices24_pcm16", BenchPcm16},
+        {"voices24_adpcm", BenchAdpcm},
+        {"pipe", BenchPipe},
+        {"batch4", BenchBatch},
+    };
+
+    for (const auto& scenario : scenarios) {
+        bool selected = argc <= 2;
+        for (int i = 2; i < argc; ++i) {
+            selected |= std::strcmp(argv[i], scenario.name) == 0;
+        }
+        if (!selected) {
+            continue;
+        }
+        scenario.run(false, "interpreter", frames);
+        scenario.run(true, "jit", frames);
+    }
+    return 0;
+}
@@ -0,0 +1,105 @@
+#include <array>
+#include <string>
+#include <catch.hpp>
+#include "../src/call_profiler.h"
+
+namespace {
+
+using Teakra::CallProfiler;
+
+struct ProfilerTestEnvironment {
+    std::array<Teakra::Timer, 2> timer{};
+    std::array<Teakra::Btdmp, 2> btdmp{};
+    Teakra::CoreTiming core_timing{timer, btdmp};
+    CallProfiler profiler{core_timing};
+};
+
+} // Anonymous namespace
+
+TEST_CASE("Cycles are attributed to the open frames", "[call_profiler]") {
+    ProfilerTestEnvironment env;
+    env.core_timing.Tick(10);
+    env.profiler.Enter(0x100);
+    env.core_timing.Tick(5);
+    env.profiler.Enter(0x200);
+    env.core_timing.Tick(3);
+    env.profiler.Leave();
+    env.core_timing.Tick(2);
+    env.profiler.Leave();
+    env.core_timing.Tick(4);
+
+    const CallProfiler closed = env.profiler.Closed();
+    const auto& functions = closed.GetFunctions();
+    REQUIRE(functions.at(0x100).calls == 1);
+    REQUIRE(functions.at(0x100).inclusive == 10);
+    REQUIRE(functions.at(0x100).exclusive == 7);
+    REQUIRE(functions.at(0x200).calls == 1);
+    REQUIRE(functions.at(0x200).inclusive == 3);
+    REQUIRE(functions.at(0x200).exclusive == 3);
+    // The root frame opens with the first call
+    REQUIRE(functions.at(CallProfiler::RootFunction).inclusive == 14);
+    REQUIRE(functions.at(CallProfiler::RootFunction).exclusive == 4);
+
+    const auto& edges = closed.GetEdges();
+    REQUIRE(edges.size() == 2);
+    REQUIRE(edges.at({CallProfiler::RootFunction, 0x100}).calls == 1);
+    REQUIRE(edges.at({CallProfiler::RootFunction, 0x100}).inclusive == 10);
+    REQUIRE(edges.at({0x100, 0x200}).calls == 1);
+    REQUIRE(edges.at({0x100, 0x200}).inclusive == 3);
+
+    // Offsets place the call and return inside the block being executed
+    env.profiler.Reset();
+    env.profiler.Enter(0x300, 2);
+    env.profiler.Leave(7);
+    REQUIRE(env.profiler.Closed().GetFunctions().at(0x300).inclusive == 5);
+
+    // A return without a call is ignored
+    env.profiler.Leave();
+    REQUIRE(env.profiler.Closed().GetFunctions().at(0x300).calls == 1);
+}
+
+TEST_CASE("Recursive calls count once per active frame", "[call_profiler]") {
+    ProfilerTestEnvironment env;
+    env.profiler.Enter(0x100);
+    env.core_timing.Tick(2);
+    env.profiler.Enter(0x100);
+    env.core_timing.Tick(3);
+    env.profiler.Leave();
+    env.core_timing.Tick(1);
+    env.profiler.Leave();
+
+    const CallProfiler closed = env.profiler.Closed();
+    const auto& stats = closed.GetFunctions().at(0x100);
+    REQUIRE(stats.calls == 2);
+    REQUIRE(stats.inclusive == 3 + 6);
+    REQUIRE(stats.exclusive == 6);
+    REQUIRE(closed.GetEdges().at({0x100, 0x100}).calls == 1);
+    REQUIRE(closed.GetEdges().at({0x100, 0x100}).inclusive == 3);
+}
+
+TEST_CASE("Exporting in the middle of a call keeps the call stack", "[call_profiler]") {
+    ProfilerTestEnvironment env;
+    env.profiler.Enter(0x100);
+    env.core_timing.Tick(5);
+    env.profiler.Enter(0x200);
+    env.core_timing.Tick(2);
+
+    const std::string export_mid_call = env.profiler.Closed().ExportCallgrind();
+    REQUIRE(export_mid_call.find("fn=0x00200\n0x00200 2\n") != std::string::npos);
+    REQUIRE(export_mid_call.find("cfn=0x00200\ncalls=1 0x00200\n0x00100 2\n") !=
+            std::string::npos);
+    REQUIRE(env.profiler.GetFunctions().at(0x200).inclusive == 0);
+
+    env.core_timing.Tick(3);
+    env.profiler.Leave();
+    env.core_timing.Tick(1);
+    env.profiler.Leave();
+
+    // The returns after the export still close the frames they belong to
+    const auto& functions = env.profiler.GetFunctions();
+    REQUIRE(functions.at(0x200).inclusive == 5);
+    REQUIRE(functions.at(0x100).inclusive == 11);
+    REQUIRE(functions.at(0x100).exclusive == 6);
+    REQUIRE(env.profiler.GetEdges().at({0x100, 0x200}).calls == 1);
+    REQUIRE(env.profiler.GetEdges().at({0x100, 0x200}).inclusive == 5);
+}
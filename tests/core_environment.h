@@ -0,0 +1,31 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include "../src/ahbm.h"
+#include "../src/apbp.h"
+#include "../src/btdmp.h"
+#include "../src/core_timing.h"
+#include "../src/dma.h"
+#include "../src/icu.h"
+#include "../src/memory_interface.h"
+#include "../src/mmio.h"
+#include "../src/shared_memory.h"
+#include "../src/timer.h"
+
+// The memory and peripherals of one DSP core, without a processor, for tests driving the
+// backends or the memory interface directly
+struct CoreEnvironment {
+    std::vector<u8> dsp_memory = std::vector<u8>(0x80000);
+    std::array<Teakra::Timer, 2> timer{};
+    std::array<Teakra::Btdmp, 2> btdmp{};
+    Teakra::CoreTiming core_timing{timer, btdmp};
+    Teakra::SharedMemory shared_memory{dsp_memory.data()};
+    Teakra::MemoryInterfaceUnit miu;
+    Teakra::ICU icu;
+    Teakra::Apbp apbp_from_cpu, apbp_from_dsp;
+    Teakra::Ahbm ahbm;
+    Teakra::Dma dma{shared_memory, ahbm};
+    Teakra::MMIORegion mmio{miu, icu, apbp_from_cpu, apbp_from_dsp, timer, dma, ahbm, btdmp};
+    Teakra::MemoryInterface memory_interface{shared_memory, miu, mmio};
+};
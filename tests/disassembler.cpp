@@ -0,0 +1,108 @@
+#include <array>
+#include <cstdio>
+#include <optional>
+#include <string>
+#include <vector>
+#include <catch.hpp>
+#include "teakra/disassembler.h"
+#include "../src/common_types.h"
+
+namespace {
+
+using Teakra::Disassembler::ArArpSettings;
+
+// The text the token path gives, joined the way the templates were built
+std::string FromTokens(u16 opcode, u16 expansion, std::optional<ArArpSettings> ar_arp) {
+    std::string result;
+    for (const auto& token : Teakra::Disassembler::GetTokenList(opcode, expansion, ar_arp)) {
+        result += result.empty() ? token : "    " + token;
+    }
+    return result;
+}
+
+std::string Describe(u16 opcode, u16 expansion, const std::string& expected,
+                     const std::string& actual) {
+    char prefix[32];
+    std::snprintf(prefix, sizeof(prefix), "%04X %04X: ", opcode, expansion);
+    return prefix + expected + " != " + actual;
+}
+
+} // Anonymous namespace
+
+TEST_CASE("Templates match the token path for every opcode", "[disassembler]") {
+    // Includes the sentinels the templates are built with, and values that fill every digit
+    constexpr std::array<u16, 6> Expansions{0x0000, 0xFFFF, 0x1234, 0x8001, 0xA5C3, 0x5A3C};
+    const std::array<std::optional<ArArpSettings>, 3> settings{
+        std::nullopt,
+        ArArpSettings{{0x0000, 0x0000}, {0x0000, 0x0000, 0x0000, 0x0000}},
+        ArArpSettings{{0xB6D5, 0x49BA}, {0x6C1F, 0x2E95, 0x4A73, 0x0BE8}},
+    };
+
+    std::vector<std::string> mismatches;
+    for (const auto& ar_arp : settings) {
+        const ArArpSettings* ar_arp_ptr = ar_arp ? &*ar_arp : nullptr;
+        for (u32 opcode = 0; opcode < 0x10000; ++opcode) {
+            const bool expanded = Teakra::Disassembler::NeedExpansion(static_cast<u16>(opcode));
+            for (u16 expansion : Expansions) {
+                const std::string expected =
+                    FromTokens(static_cast<u16>(opcode), expansion, ar_arp);
+                const std::string actual =
+                    Teakra::Disassembler::Do(static_cast<u16>(opcode), expansion, ar_arp);
+
+                char buffer[128];
+                const std::size_t length = Teakra::Disassembler::Do(
+                    buffer, sizeof(buffer), static_cast<u16>(opcode), expansion, ar_arp_ptr);
+                if (expected != actual || length != expected.size() || expected != buffer) {
+                    mismatches.push_back(
+                        Describe(static_cast<u16>(opcode), expansion, expected, actual));
+                }
+                if (!expanded) {
+                    break;
+                }
+            }
+        }
+    }
+    REQUIRE(mismatches.empty());
+}
+
+TEST_CASE("Template output truncates like snprintf", "[disassembler]") {
+    constexpr u16 Opcode = 0x67D0; // inc a0 always
+    const std::string full = FromTokens(Opcode, 0, std::nullopt);
+
+    char buffer[8];
+    REQUIRE(Teakra::Disassembler::Do(buffer, sizeof(buffer), Opcode) == full.size());
+    REQUIRE(std::string(buffer) == full.substr(0, sizeof(buffer) - 1));
+    REQUIRE(Teakra::Disassembler::Do(nullptr, 0, Opcode) == full.size());
+}
+
+TEST_CASE("Ranges disassemble like single instructions", "[disassembler]") {
+    std::vector<u16> words;
+    std::string expected;
+    for (u32 opcode = 0; opcode < 0x10000; opcode += 0x0101) {
+        const u32 address = 0x1FFF0 + static_cast<u32>(words.size());
+        const bool expanded = Teakra::Disassembler::NeedExpansion(static_cast<u16>(opcode));
+        const u16 expansion = static_cast<u16>(opcode ^ 0x5A5A);
+        char prefix[16];
+        std::snprintf(prefix, sizeof(prefix), "%05X: ", address);
+        expected += prefix + FromTokens(static_cast<u16>(opcode), expansion, std::nullopt) + "\n";
+        words.push_back(static_cast<u16>(opcode));
+        if (expanded) {
+            words.push_back(expansion);
+        }
+    }
+
+    // A small buffer makes the caller continue from where the previous call stopped
+    std::string actual;
+    std::size_t pos = 0;
+    while (pos < words.size()) {
+        char buffer[256];
+        std::size_t written;
+        const std::size_t consumed = Teakra::Disassembler::DoRange(
+            buffer, sizeof(buffer), written, words.data() + pos, words.size() - pos,
+            0x1FFF0 + static_cast<u32>(pos));
+        REQUIRE(consumed > 0);
+        actual.append(buffer, written);
+        pos += consumed;
+    }
+    REQUIRE(actual == expected);
+}
@@ -0,0 +1,130 @@
+#include <array>
+#include <cstring>
+#include <vector>
+#include <catch.hpp>
+#include "../src/dsp1.h"
+#include "../src/shared_memory.h"
+
+namespace {
+
+constexpr std::size_t HeaderSize = 0x300;
+constexpr std::size_t NumSegmentsOffset = 0x10E;
+constexpr std::size_t FlagsOffset = 0x10F;
+constexpr std::size_t SegmentTableOffset = 0x120;
+constexpr std::size_t SegmentEntrySize = 0x30;
+
+void Store32(std::vector<u8>& image, std::size_t offset, u32 value) {
+    for (std::size_t i = 0; i < 4; ++i) {
+        image[offset + i] = static_cast<u8>(value >> (i * 8));
+    }
+}
+
+// A component with a 4-word program segment at 0x0100 and a 2-word data segment at 0x0200
+std::vector<u8> MakeImage() {
+    std::vector<u8> image(HeaderSize);
+    std::memcpy(image.data() + 0x100, "DSP1", 4);
+    image[NumSegmentsOffset] = 2;
+    image[FlagsOffset] = 1;
+    const auto add_segment = [&](std::size_t index, u32 address, u8 memory_type,
+                                 std::vector<u8> data) {
+        const std::size_t entry = SegmentTableOffset + index * SegmentEntrySize;
+        Store32(image, entry, static_cast<u32>(image.size()));
+        Store32(image, entry + 4, address);
+        Store32(image, entry + 8, static_cast<u32>(data.size()));
+        image[entry + 15] = memory_type;
+        image.insert(image.end(), data.begin(), data.end());
+    };
+    add_segment(0, 0x0100, 0, {0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88});
+    add_segment(1, 0x0200, 2, {0xAA, 0xBB, 0xCC, 0xDD});
+    return image;
+}
+
+} // Anonymous namespace
+
+TEST_CASE("DSP1 segments are parsed from the header", "[dsp1]") {
+    const std::vector<u8> image = MakeImage();
+    Teakra::Dsp1Image parsed;
+    REQUIRE(Teakra::ParseDsp1(image, parsed) == Teakra::Dsp1LoadResult::Status::Ok);
+    REQUIRE(parsed.recv_data_on_start);
+    const auto segments = parsed.Segments();
+    REQUIRE(segments.size() == 2);
+    REQUIRE(segments[0].memory == Teakra::Dsp1Segment::Memory::Program);
+    REQUIRE(segments[0].address == 0x0100);
+    REQUIRE(segments[0].data.size() == 8);
+    REQUIRE(segments[0].data.data() == image.data() + HeaderSize);
+    REQUIRE(segments[1].memory == Teakra::Dsp1Segment::Memory::Data);
+    REQUIRE(segments[1].address == 0x0200);
+    REQUIRE(segments[1].data.size() == 4);
+}
+
+TEST_CASE("DSP1 segments are copied into program and data memory", "[dsp1]") {
+    std::vector<u8> memory(0x80000);
+    Teakra::SharedMemory shared_memory{memory.data()};
+    const auto result = Teakra::LoadDsp1(shared_memory, MakeImage(), true, 2);
+    REQUIRE(result.status == Teakra::Dsp1LoadResult::Status::HashMismatch);
+    REQUIRE(shared_memory.ReadWord(0x0100) == 0);
+
+    const auto unverified = Teakra::LoadDsp1(shared_memory, MakeImage(), false, 0);
+    REQUIRE(unverified.status == Teakra::Dsp1LoadResult::Status::Ok);
+    REQUIRE(unverified.recv_data_on_start);
+    REQUIRE(shared_memory.ReadWord(0x0100) == 0x2211);
+    REQUIRE(shared_memory.ReadWord(0x0103) == 0x8877);
+    REQUIRE(shared_memory.ReadWord(0x20000 + 0x0200) == 0xBBAA);
+    REQUIRE(shared_memory.ReadWord(0x20000 + 0x0201) == 0xDDCC);
+}
+
+TEST_CASE("DSP1 with a truncated header is rejected", "[dsp1]") {
+    std::vector<u8> image = MakeImage();
+    image.resize(HeaderSize - 1);
+    Teakra::Dsp1Image parsed;
+    REQUIRE(Teakra::ParseDsp1(image, parsed) == Teakra::Dsp1LoadResult::Status::Malformed);
+    REQUIRE(Teakra::ParseDsp1({}, parsed) == Teakra::Dsp1LoadResult::Status::Malformed);
+}
+
+TEST_CASE("DSP1 with a bad magic is rejected", "[dsp1]") {
+    std::vector<u8> image = MakeImage();
+    image[0x100] = 'X';
+    Teakra::Dsp1Image parsed;
+    REQUIRE(Teakra::ParseDsp1(image, parsed) == Teakra::Dsp1LoadResult::Status::Malformed);
+}
+
+TEST_CASE("DSP1 with a bad segment count is rejected", "[dsp1]") {
+    std::vector<u8> image = MakeImage();
+    image[NumSegmentsOffset] = 11;
+    Teakra::Dsp1Image parsed;
+    REQUIRE(Teakra::ParseDsp1(image, parsed) == Teakra::Dsp1LoadResult::Status::Malformed);
+}
+
+TEST_CASE("DSP1 with a segment outside the image is rejected", "[dsp1]") {
+    std::vector<u8> memory(0x80000);
+    Teakra::SharedMemory shared_memory{memory.data()};
+    Teakra::Dsp1Image parsed;
+
+    std::vector<u8> image = MakeImage();
+    image.pop_back();
+    REQUIRE(Teakra::ParseDsp1(image, parsed) == Teakra::Dsp1LoadResult::Status::Malformed);
+
+    // An offset near 4 GiB must not wrap around the size check
+    image = MakeImage();
+    Store32(image, SegmentTableOffset + SegmentEntrySize + 0, 0xFFFFFFFF);
+    REQUIRE(Teakra::ParseDsp1(image, parsed) == Teakra::Dsp1LoadResult::Status::Malformed);
+    REQUIRE(Teakra::LoadDsp1(shared_memory, image, false, 0).status ==
+            Teakra::Dsp1LoadResult::Status::Malformed);
+    // Nothing is written when a later segment is bad
+    REQUIRE(shared_memory.ReadWord(0x0100) == 0);
+}
+
+TEST_CASE("DSP1 with a segment outside its memory is rejected", "[dsp1]") {
+    Teakra::Dsp1Image parsed;
+
+    // Four words at the last three words of data memory
+    std::vector<u8> image = MakeImage();
+    Store32(image, SegmentTableOffset + 4, 0x1FFFD);
+    image[SegmentTableOffset + 15] = 2;
+    REQUIRE(Teakra::ParseDsp1(image, parsed) == Teakra::Dsp1LoadResult::Status::OutOfRange);
+
+    // Unknown memory type
+    image = MakeImage();
+    image[SegmentTableOffset + 15] = 3;
+    REQUIRE(Teakra::ParseDsp1(image, parsed) == Teakra::Dsp1LoadResult::Status::OutOfRange);
+}
@@ -1,71 +1,8 @@
 #pragma once
 
-#include <span>
-#include <vector>
 #include <cstring>
 #include "../src/common_types.h"
 
-enum class SegmentType : u8 {
-    ProgramA = 0,
-    ProgramB = 1,
-    Data = 2,
-};
-
-class Dsp1 {
-public:
-    explicit Dsp1(std::span<const u8> raw) {
-        Header header;
-        std::memcpy(&header, raw.data(), sizeof(header));
-        recv_data_on_start = header.recv_data_on_start != 0;
-        segments.reserve(header.num_segments);
-        for (u32 i = 0; i < header.num_segments; ++i) {
-            Segment segment;
-            segment.data =
-                std::vector<u8>(raw.begin() + header.segments[i].offset,
-                                raw.begin() + header.segments[i].offset + header.segments[i].size);
-            segment.memory_type = header.segments[i].memory_type;
-            segment.target = header.segments[i].address;
-            segments.push_back(std::move(segment));
-        }
-    }
-
-    struct Header {
-        std::array<u8, 0x100> signature;
-        std::array<u8, 0x4> magic;
-        u32 binary_size;
-        u16 memory_layout;
-        u8 pad[3];
-        SegmentType special_segment_type;
-        u8 num_segments;
-        union {
-            u8 recv_data_on_start : 1;
-            u8 load_special_segment : 1;
-        };
-        u32 special_segment_address;
-        u32 special_segment_size;
-        u64 zero;
-        struct Segment {
-            u32 offset;
-            u32 address;
-            u32 size;
-            u8 pad[3];
-            SegmentType memory_type;
-            std::array<u8, 0x20> sha256;
-        };
-        std::array<Segment, 10> segments;
-    };
-    static_assert(sizeof(Header) == 0x300);
-
-    struct Segment {
-        std::vector<u8> data;
-        SegmentType memory_type;
-        u32 target;
-    };
-
-    std::vector<Segment> segments;
-    bool recv_data_on_start;
-};
-
 struct PipeStatus {
     u16 waddress;
     u16 bsize;
@@ -0,0 +1,147 @@
+#include <algorithm>
+#include <initializer_list>
+#include <vector>
+#include <catch.hpp>
+#include "../src/firmware_analysis.h"
+
+namespace {
+
+using Teakra::FirmwareMap;
+
+constexpr u16 Nop = 0x0000;
+constexpr u16 IncA0 = 0x67D0;      // inc a0 always
+constexpr u16 Br = 0x4180;         // br <expansion> always
+constexpr u16 Call = 0x41C0;       // call <expansion> always
+constexpr u16 Ret = 0x4580;        // ret always
+constexpr u16 Reti = 0x45C0;       // reti always
+constexpr u16 CallaA0 = 0xD381;    // calla a0
+constexpr u16 Rep3 = 0x0C03;       // rep 3
+constexpr u16 Bkrep2 = 0x5C02;     // bkrep 2 <expansion>
+constexpr u16 BrrSkipNeq = 0x5012; // brr over the next instruction, if not equal
+constexpr u16 BrrSelf = 0x57F0;    // brr to itself
+
+constexpr u32 Main = 0x0020;
+constexpr u32 Leaf = 0x0040;
+constexpr u32 Looping = 0x0050;
+constexpr u32 Far = 0x2000;
+
+// The reset vector jumps to main, which calls the leaf twice and the looping function once, and
+// then idles. The looping function calls the leaf, a function pointer and a function outside of
+// the segment.
+std::vector<u16> MakeFirmware() {
+    std::vector<u16> words(0x5A, Nop);
+    auto put = [&](u32 address, std::initializer_list<u16> code) {
+        std::copy(code.begin(), code.end(), words.begin() + address);
+    };
+    put(0x0000, {Br, Main});
+    put(0x0006, {Reti});
+    put(0x000E, {Reti});
+    put(0x0016, {Reti});
+
+    put(Main, {Call, Leaf, Call, Leaf, Call, Looping, Rep3, IncA0, BrrSelf});
+    put(Leaf, {BrrSkipNeq, IncA0, Nop, Ret});
+    put(Looping, {Bkrep2, 0x0053, IncA0, Nop, Call, Leaf, CallaA0, Call, Far, Ret});
+    return words;
+}
+
+const FirmwareMap::Function* FindFunction(const FirmwareMap& map, u32 entry) {
+    for (const auto& function : map.functions) {
+        if (function.entry == entry) {
+            return &function;
+        }
+    }
+    return nullptr;
+}
+
+const FirmwareMap::Block* FindBlock(const FirmwareMap& map, u32 start) {
+    for (const auto& block : map.blocks) {
+        if (block.start == start) {
+            return &block;
+        }
+    }
+    return nullptr;
+}
+
+} // Anonymous namespace
+
+TEST_CASE("Functions and calls are found in a synthetic firmware", "[firmware_analysis]") {
+    const std::vector<Teakra::ProgramSegment> segments{{0x0000, MakeFirmware()}};
+    const FirmwareMap map = AnalyzeFirmware(segments, Teakra::DefaultFirmwareEntries(), 1);
+
+    std::vector<u32> entries;
+    for (const auto& function : map.functions) {
+        entries.push_back(function.entry);
+    }
+    // The far call has no code to start a function at
+    REQUIRE(entries == std::vector<u32>{0x0000, 0x0006, 0x000E, 0x0016, Leaf, Looping});
+    REQUIRE(map.external == std::vector<u32>{Far});
+
+    const auto* reset = FindFunction(map, 0x0000);
+    REQUIRE(reset->name == "reset");
+    REQUIRE(reset->call_sites == 0);
+    REQUIRE(reset->callees == std::vector<u32>{Leaf, Looping});
+    // Main isn't called, so it belongs to the reset function
+    REQUIRE(reset->blocks == std::vector<u32>{0x0000, 0x0020, 0x0022, 0x0024, 0x0026, 0x0027,
+                                              0x0028});
+
+    const auto* leaf = FindFunction(map, Leaf);
+    REQUIRE(leaf->name.empty());
+    REQUIRE(leaf->call_sites == 3);
+    REQUIRE(leaf->callees.empty());
+    REQUIRE(leaf->blocks == std::vector<u32>{0x0040, 0x0041, 0x0042});
+    REQUIRE(FindBlock(map, 0x0040)->successors == std::vector<u32>{0x0042, 0x0041});
+    REQUIRE(FindBlock(map, 0x0042)->successors.empty());
+
+    const auto* looping = FindFunction(map, Looping);
+    REQUIRE(looping->call_sites == 1);
+    REQUIRE(looping->callees == std::vector<u32>{Leaf, Far});
+    REQUIRE(looping->blocks == std::vector<u32>{0x0050, 0x0052, 0x0054, 0x0056, 0x0057, 0x0059});
+
+    REQUIRE(FindFunction(map, 0x0006)->blocks == std::vector<u32>{0x0006});
+    REQUIRE(FindFunction(map, 0x0006)->name == "int0");
+}
+
+TEST_CASE("Loops and indirect flow are found in a synthetic firmware", "[firmware_analysis]") {
+    const std::vector<Teakra::ProgramSegment> segments{{0x0000, MakeFirmware()}};
+    const FirmwareMap map = AnalyzeFirmware(segments, Teakra::DefaultFirmwareEntries(), 1);
+
+    REQUIRE(map.loops.size() == 2);
+    REQUIRE(map.loops[0].instruction == 0x0026);
+    REQUIRE(map.loops[0].start == 0x0027);
+    REQUIRE(map.loops[0].end == 0x0027);
+    REQUIRE_FALSE(map.loops[0].block);
+    REQUIRE(map.loops[1].instruction == 0x0050);
+    REQUIRE(map.loops[1].start == 0x0052);
+    REQUIRE(map.loops[1].end == 0x0053);
+    REQUIRE(map.loops[1].block);
+
+    // The loop bodies branch back to their start
+    REQUIRE(FindBlock(map, 0x0027)->successors == std::vector<u32>{0x0028, 0x0027});
+    REQUIRE(FindBlock(map, 0x0052)->successors == std::vector<u32>{0x0054, 0x0052});
+
+    REQUIRE(map.idle_loops == std::vector<u32>{0x0028});
+    REQUIRE(map.indirect.size() == 1);
+    REQUIRE(map.indirect[0].address == 0x0056);
+    REQUIRE(map.indirect[0].call);
+}
+
+TEST_CASE("Calls into another segment are followed", "[firmware_analysis]") {
+    const std::vector<Teakra::ProgramSegment> segments{
+        {Far, {IncA0, Ret}},
+        {0x0000, MakeFirmware()},
+    };
+    const FirmwareMap map = AnalyzeFirmware(segments, Teakra::DefaultFirmwareEntries(), 4);
+
+    REQUIRE(map.external.empty());
+    REQUIRE(map.segments.size() == 2);
+    REQUIRE(map.segments[0].address == 0x0000);
+    const auto* far = FindFunction(map, Far);
+    REQUIRE(far != nullptr);
+    REQUIRE(far->call_sites == 1);
+    REQUIRE(far->blocks == std::vector<u32>{Far});
+    REQUIRE(FindBlock(map, Far)->instructions == 2);
+
+    // The result doesn't depend on the thread count
+    REQUIRE(map.ExportJson() ==
+            AnalyzeFirmware(segments, Teakra::DefaultFirmwareEntries(), 1).ExportJson());
+}
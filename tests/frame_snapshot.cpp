@@ -0,0 +1,173 @@
+#include <array>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <catch.hpp>
+#include "../src/frame_snapshot.h"
+#include "../src/memory_interface.h"
+#include "../src/shared_memory.h"
+#include "core_environment.h"
+
+namespace {
+
+struct SnapshotTestEnvironment {
+    std::vector<u8> memory = std::vector<u8>(0x80000);
+    Teakra::SharedMemory shared_memory{memory.data()};
+    Teakra::FrameSnapshots snapshots{shared_memory};
+
+    void Fill(u16 address, u16 words, u16 value) {
+        for (u32 i = 0; i < words; ++i) {
+            shared_memory.WriteWord(Teakra::MemoryInterfaceUnit::DataMemoryOffset + address + i,
+                                    value);
+        }
+    }
+};
+
+} // Anonymous namespace
+
+TEST_CASE("Snapshot regions are validated", "[frame_snapshot]") {
+    SnapshotTestEnvironment env;
+    REQUIRE(env.snapshots.AddRegion(0x1000, 0) == 0);
+    REQUIRE(env.snapshots.AddRegion(0xFFFF, 2) == 0);
+    REQUIRE(env.snapshots.AddRegion(0x8000, 0x8001) == 0);
+
+    const u32 last = env.snapshots.AddRegion(0xFFFF, 1);
+    const u32 whole = env.snapshots.AddRegion(0x0000, 0xFFFF);
+    REQUIRE(last != 0);
+    REQUIRE(whole != 0);
+    REQUIRE(last != whole);
+
+    std::array<u16, 1> out{};
+    env.snapshots.Publish();
+    REQUIRE(env.snapshots.Read(last, out) == 1);
+    env.snapshots.RemoveRegion(last);
+    REQUIRE(env.snapshots.Read(last, out) == 0);
+    REQUIRE(env.snapshots.Read(whole, out) == 1);
+    REQUIRE(env.snapshots.Read(12345, out) == 0);
+}
+
+TEST_CASE("Snapshots hold the data of the latest frame", "[frame_snapshot]") {
+    SnapshotTestEnvironment env;
+    const u32 id = env.snapshots.AddRegion(0x0100, 4);
+    std::array<u16, 4> out{};
+    REQUIRE(env.snapshots.Read(id, out) == 0);
+
+    env.Fill(0x0100, 4, 0x1111);
+    env.snapshots.Publish();
+    env.Fill(0x0100, 4, 0x2222);
+    REQUIRE(env.snapshots.Read(id, out) == 1);
+    REQUIRE(out == std::array<u16, 4>{0x1111, 0x1111, 0x1111, 0x1111});
+
+    env.snapshots.Publish();
+    env.Fill(0x0100, 4, 0x3333);
+    env.snapshots.Publish();
+    REQUIRE(env.snapshots.Read(id, out) == 3);
+    REQUIRE(out == std::array<u16, 4>{0x3333, 0x3333, 0x3333, 0x3333});
+
+    // Short and long outputs copy what fits
+    std::array<u16, 2> head{};
+    REQUIRE(env.snapshots.Read(id, head) == 3);
+    REQUIRE(head == std::array<u16, 2>{0x3333, 0x3333});
+    std::array<u16, 6> longer{};
+    REQUIRE(env.snapshots.Read(id, longer) == 3);
+    REQUIRE(longer == std::array<u16, 6>{0x3333, 0x3333, 0x3333, 0x3333, 0, 0});
+
+    // A region added later starts without a frame
+    const u32 late = env.snapshots.AddRegion(0x0100, 4);
+    REQUIRE(env.snapshots.Read(late, out) == 0);
+}
+
+TEST_CASE("Snapshots read during publishing are consistent", "[frame_snapshot]") {
+    SnapshotTestEnvironment env;
+    constexpr u16 Words = 256;
+    constexpr u64 Frames = 20000;
+    const u32 id = env.snapshots.AddRegion(0x0200, Words);
+
+    // Frame n holds n in every word, so a torn copy has two different values
+    std::atomic<bool> done{false};
+    std::thread publisher([&] {
+        for (u64 frame = 1; frame <= Frames; ++frame) {
+            env.Fill(0x0200, Words, static_cast<u16>(frame));
+            env.snapshots.Publish();
+        }
+        done = true;
+    });
+
+    u64 reads = 0;
+    u64 last_frame = 0;
+    bool consistent = true;
+    bool monotonic = true;
+    std::array<u16, Words> out;
+    while (!done || reads == 0) {
+        const u64 frame = env.snapshots.Read(id, out);
+        if (frame == 0) {
+            continue;
+        }
+        ++reads;
+        monotonic &= frame >= last_frame;
+        last_frame = frame;
+        for (const u16 word : out) {
+            consistent &= word == static_cast<u16>(frame);
+        }
+    }
+    publisher.join();
+
+    REQUIRE(consistent);
+    REQUIRE(monotonic);
+    REQUIRE(env.snapshots.Read(id, out) == Frames);
+    REQUIRE(out[0] == static_cast<u16>(Frames));
+}
+
+TEST_CASE("Frames are published on the configured DSP events", "[frame_snapshot]") {
+    CoreEnvironment env;
+    Teakra::FrameSnapshots snapshots{env.shared_memory};
+    Teakra::FramePublisher publisher{snapshots, env.apbp_from_dsp};
+    const u32 id = snapshots.AddRegion(0x0100, 1);
+    std::array<u16, 1> out{};
+
+    // The DSP signals through its MMIO registers, like firmware would
+    auto set_semaphore = [&](u16 bits) { env.memory_interface.DataWrite(0x80CC, bits); };
+    auto send_data = [&](unsigned channel, u16 value) {
+        env.memory_interface.DataWrite(static_cast<u16>(0x80C0 + channel * 4), value);
+    };
+
+    // Nothing is published until configured
+    set_semaphore(0xFFFF);
+    send_data(0, 1);
+    REQUIRE(snapshots.Read(id, out) == 0);
+
+    publisher.SetConfig({.semaphore_bits = 0x0004, .recv_data_channels = 0b010});
+
+    env.memory_interface.DataWrite(0x0100, 0x1111);
+    set_semaphore(0x0001);
+    REQUIRE(snapshots.Read(id, out) == 0);
+    set_semaphore(0x0004);
+    REQUIRE(snapshots.Read(id, out) == 1);
+    REQUIRE(out[0] == 0x1111);
+
+    // Once per event, even with other bits set along, and whatever the mask
+    env.memory_interface.DataWrite(0x0100, 0x2222);
+    env.apbp_from_dsp.MaskSemaphore(0xFFFF);
+    set_semaphore(0x0006);
+    REQUIRE(snapshots.Read(id, out) == 2);
+    REQUIRE(out[0] == 0x2222);
+
+    send_data(0, 1);
+    send_data(2, 1);
+    REQUIRE(snapshots.Read(id, out) == 2);
+    env.memory_interface.DataWrite(0x0100, 0x3333);
+    send_data(1, 1);
+    send_data(1, 2);
+    REQUIRE(snapshots.Read(id, out) == 4);
+    REQUIRE(out[0] == 0x3333);
+
+    // A channel with its interrupt disabled still completes frames
+    env.apbp_from_dsp.SetDisableInterrupt(1, 1);
+    send_data(1, 3);
+    REQUIRE(snapshots.Read(id, out) == 5);
+
+    publisher.SetConfig({});
+    set_semaphore(0x0004);
+    send_data(1, 4);
+    REQUIRE(snapshots.Read(id, out) == 5);
+}
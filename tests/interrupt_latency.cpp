@@ -0,0 +1,90 @@
+#include <catch.hpp>
+#include "../src/icu.h"
+#include "../src/interrupt_latency.h"
+
+namespace {
+
+constexpr u32 Timer0Irq = 0xA;
+constexpr u32 Timer1Irq = 0x9;
+constexpr u32 DmaIrq = 0xF;
+
+struct LatencyTestEnvironment {
+    Teakra::ICU icu;
+    Teakra::InterruptLatency latency{icu};
+
+    LatencyTestEnvironment() {
+        icu.SetInterruptHandler([](u32) {}, [](u32, bool) {});
+    }
+
+    // Raises an IRQ the way Teakra does, timestamp first
+    void Raise(u32 irq, u64 now) {
+        latency.Trigger(irq, now);
+        icu.TriggerSingle(irq);
+    }
+
+    const Teakra::LatencyHistogram& Histogram(Teakra::InterruptSource source) {
+        stats = latency.GetStats();
+        return stats.latency[static_cast<std::size_t>(source)];
+    }
+
+    Teakra::InterruptStats stats;
+};
+
+} // Anonymous namespace
+
+TEST_CASE("Latency runs from the trigger to the service", "[interrupt_latency]") {
+    LatencyTestEnvironment env;
+    env.icu.SetEnable(0, 1 << Timer0Irq);
+    env.Raise(Timer0Irq, 100);
+    // A second trigger before the service doesn't move the start
+    env.Raise(Timer0Irq, 120);
+    env.latency.Service(0, 130);
+
+    const auto& timer0 = env.Histogram(Teakra::InterruptSource::Timer0);
+    REQUIRE(timer0.count == 1);
+    REQUIRE(timer0.total_cycles == 30);
+    REQUIRE(timer0.max_cycles == 30);
+    REQUIRE(timer0.buckets[5] == 1);
+
+    // Serviced IRQs are cleared, so servicing again records nothing
+    env.latency.Service(0, 500);
+    REQUIRE(env.Histogram(Teakra::InterruptSource::Timer0).count == 1);
+
+    env.icu.SetEnableVectored(1 << DmaIrq);
+    env.Raise(DmaIrq, 1000);
+    env.latency.Service(Teakra::InterruptLatency::VectoredInterrupt, 1004);
+    const auto& vectored = env.Histogram(Teakra::InterruptSource::Vectored);
+    REQUIRE(vectored.count == 1);
+    REQUIRE(vectored.total_cycles == 4);
+    REQUIRE(env.Histogram(Teakra::InterruptSource::Dma).count == 0);
+}
+
+TEST_CASE("Acknowledged IRQs are no longer pending", "[interrupt_latency]") {
+    LatencyTestEnvironment env;
+    env.icu.SetEnable(0, 1 << Timer0Irq);
+
+    // The firmware polls the ICU and acknowledges without taking the interrupt
+    env.Raise(Timer0Irq, 200);
+    REQUIRE(env.icu.GetRequest() == 1 << Timer0Irq);
+    env.icu.Acknowledge(1 << Timer0Irq);
+    env.latency.Service(0, 250);
+    REQUIRE(env.Histogram(Teakra::InterruptSource::Timer0).count == 0);
+
+    env.Raise(Timer0Irq, 1000);
+    env.latency.Service(0, 1010);
+    const auto& timer0 = env.Histogram(Teakra::InterruptSource::Timer0);
+    REQUIRE(timer0.count == 1);
+    REQUIRE(timer0.max_cycles == 10);
+}
+
+TEST_CASE("Unrouted IRQs are not kept pending", "[interrupt_latency]") {
+    LatencyTestEnvironment env;
+    env.Raise(Timer1Irq, 50);
+
+    env.icu.SetEnable(1, 1 << Timer1Irq);
+    env.Raise(Timer1Irq, 500);
+    env.latency.Service(1, 520);
+    const auto& timer1 = env.Histogram(Teakra::InterruptSource::Timer1);
+    REQUIRE(timer1.count == 1);
+    REQUIRE(timer1.max_cycles == 20);
+}
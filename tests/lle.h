@@ -11,7 +11,7 @@
 
 class DspLle final {
 public:
-    explicit DspLle() {
+    explicit DspLle(bool use_jit = false) : teakra(use_jit) {
         fcram = std::make_unique<u8[]>(FCRAM_N3DS_SIZE);
         Teakra::AHBMCallback ahbm;
         ahbm.read8 = [this](u32 address) -> u8 {
@@ -136,29 +136,17 @@ public:
 
         teakra.Reset();
 
-        Dsp1 dsp(buffer);
-
-        const auto load_firmware = [&dsp](auto& dsp_memory) {
-            u8* program = dsp_memory.data();
-            u8* data = dsp_memory.data() + DspDataOffset;
-            for (const auto& segment : dsp.segments) {
-                if (segment.memory_type == SegmentType::ProgramA ||
-                    segment.memory_type == SegmentType::ProgramB) {
-                    std::memcpy(program + segment.target * 2, segment.data.data(), segment.data.size());
-                } else if (segment.memory_type == SegmentType::Data) {
-                    std::memcpy(data + segment.target * 2, segment.data.data(), segment.data.size());
-                }
-            }
-        };
-
-        load_firmware(teakra.GetDspMemory());
-        load_firmware(teakra.GetInterpDspMemory());
+        const auto load = teakra.LoadDsp1(buffer);
+        if (load.status != Teakra::Dsp1LoadResult::Status::Ok) {
+            std::printf("Invalid DSP1 component!\n");
+            return;
+        }
 
         // TODO: load special segment
         //core_timing.ScheduleEvent(TeakraSlice, teakra_slice_event, 0);
 
         // Wait for initialization
-        if (dsp.recv_data_on_start) {
+        if (load.recv_data_on_start) {
             for (u8 i = 0; i < 3; ++i) {
                 do {
                     WaitPipe(i);
@@ -0,0 +1,158 @@
+#include <string>
+#include <catch.hpp>
+#include "../src/jit_regs.h"
+#include "../src/lockstep.h"
+#include "../src/register.h"
+#include "core_environment.h"
+
+namespace {
+
+constexpr u16 IncA0 = 0x67D0;      // inc a0 always
+constexpr u16 StoreA0lToR1 = 0x1B41; // mov a0l, [r1]
+constexpr u16 Target = 0x0100;
+
+// Distinct values in every shadow, so a dropped one shows up
+void FillShadows(Teakra::JitRegisters& regs) {
+    regs.flagsb.raw = 0x1055;
+    regs.pcmhib = 2;
+    regs.mod0b.raw = 0x2465;
+    regs.mod1b.raw = 0x5012;
+    regs.mod2b.raw = 0xA5C3;
+    regs.imb = {1, 0, 1};
+    regs.imvb = 1;
+    regs.arb[0].raw = 0x1234;
+    regs.arb[1].raw = 0x4321;
+    regs.arpb[0].raw = 0x0123;
+    regs.arpb[1].raw = 0x2357;
+    regs.arpb[2].raw = 0x2468;
+    regs.arpb[3].raw = 0x4579;
+}
+
+void RequireSameShadows(const Teakra::JitRegisters& expected, const Teakra::JitRegisters& actual) {
+    REQUIRE(expected.flagsb.raw == actual.flagsb.raw);
+    REQUIRE(expected.pcmhib == actual.pcmhib);
+    REQUIRE(expected.mod0b.raw == actual.mod0b.raw);
+    REQUIRE(expected.mod1b.raw == actual.mod1b.raw);
+    REQUIRE(expected.mod2b.raw == actual.mod2b.raw);
+    REQUIRE(expected.imb == actual.imb);
+    REQUIRE(expected.imvb == actual.imvb);
+    for (std::size_t i = 0; i < expected.arb.size(); ++i) {
+        REQUIRE(expected.arb[i].raw == actual.arb[i].raw);
+    }
+    for (std::size_t i = 0; i < expected.arpb.size(); ++i) {
+        REQUIRE(expected.arpb[i].raw == actual.arpb[i].raw);
+    }
+}
+
+struct LockstepTestEnvironment : CoreEnvironment {
+    Teakra::JitRegisters regs;
+    std::string report;
+    int reports = 0;
+
+    LockstepTestEnvironment() {
+        memory_interface.ProgramWrite(0, IncA0);
+        memory_interface.ProgramWrite(1, StoreA0lToR1);
+        regs.a[0] = 5;
+        regs.r[1] = Target;
+        FillShadows(regs);
+    }
+
+    Teakra::LockstepConfig Config() {
+        Teakra::LockstepConfig config;
+        config.interval = 1;
+        config.divergence_handler = [this](const std::string& text) {
+            report = text;
+            ++reports;
+        };
+        return config;
+    }
+
+    // Plays the JIT running the two instructions, incrementing a0 by the given amount
+    void RunBlock(u64 increment) {
+        regs.pc = 2;
+        regs.a[0] += increment;
+        memory_interface.DataWrite(Target, static_cast<u16>(regs.a[0]));
+    }
+};
+
+} // Anonymous namespace
+
+TEST_CASE("Register state conversion keeps the shadows", "[lockstep]") {
+    Teakra::JitRegisters jit_regs;
+    FillShadows(jit_regs);
+    jit_regs.mod0.raw = 0x0C04;
+    jit_regs.ar[0].raw = 0x0ABC;
+    jit_regs.r[3] = 0x7777;
+    jit_regs.flags.raw = 0x0101;
+
+    Teakra::RegisterState regs;
+    regs.Set<Teakra::mod0>(0xFFFF); // stale values must not leak through
+    Teakra::LoadRegisterState(regs, jit_regs);
+    REQUIRE(regs.Get<Teakra::mod0>() == 0x0C04);
+    REQUIRE(regs.Get<Teakra::ar0>() == 0x0ABC);
+    REQUIRE(regs.r[3] == 0x7777);
+
+    Teakra::JitRegisters back;
+    Teakra::LoadJitRegisters(back, regs);
+    RequireSameShadows(jit_regs, back);
+    REQUIRE(back.mod0.raw == 0x0C04);
+    REQUIRE(back.ar[0].raw == 0x0ABC);
+    REQUIRE(back.flags.raw == 0x0101);
+
+    // The shadows are live after a context switch on the interpreter
+    regs.ShadowRestore();
+    regs.ShadowSwap();
+    REQUIRE(regs.pcmhi == 2);
+    REQUIRE(regs.Get<Teakra::mod2>() == 0xA5C3);
+    REQUIRE(regs.Get<Teakra::arp3>() == 0x4579);
+    REQUIRE(regs.fc1 == 1);
+    REQUIRE(regs.Get<Teakra::mod0>() == 0x2465);
+}
+
+TEST_CASE("Lockstep passes a block the JIT got right", "[lockstep]") {
+    LockstepTestEnvironment env;
+    Teakra::Lockstep lockstep(env.memory_interface, env.Config());
+
+    REQUIRE(lockstep.Checkpoint(env.regs, 2));
+    // The shadow's write is rolled back for the JIT to run
+    REQUIRE(env.memory_interface.DataRead(Target) == 0);
+    env.RunBlock(1);
+    REQUIRE(lockstep.Verify(env.regs));
+    REQUIRE(env.reports == 0);
+}
+
+TEST_CASE("Lockstep reports a divergence and hands over the shadow state", "[lockstep]") {
+    LockstepTestEnvironment env;
+    Teakra::Lockstep lockstep(env.memory_interface, env.Config());
+
+    REQUIRE(lockstep.Checkpoint(env.regs, 2));
+    env.RunBlock(2);
+    REQUIRE_FALSE(lockstep.Verify(env.regs));
+    REQUIRE(env.reports == 1);
+    REQUIRE(env.report.find("Lockstep divergence in block at 0x00000") == 0);
+    REQUIRE(env.report.find("inc") != std::string::npos);
+    REQUIRE(env.report.find("a0: interpreter 6, jit 7") != std::string::npos);
+    REQUIRE(env.report.find("interpreter 0006, jit 0007") != std::string::npos);
+
+    Teakra::RegisterState adopted;
+    lockstep.Adopt(adopted, env.regs);
+    REQUIRE(adopted.pc == 2);
+    REQUIRE(adopted.a[0] == 6);
+    REQUIRE(adopted.r[1] == Target);
+    REQUIRE(env.memory_interface.DataRead(Target) == 6);
+
+    Teakra::JitRegisters back;
+    Teakra::LoadJitRegisters(back, adopted);
+    RequireSameShadows(env.regs, back);
+}
+
+TEST_CASE("Lockstep reports a diverged shadow", "[lockstep]") {
+    LockstepTestEnvironment env;
+    Teakra::Lockstep lockstep(env.memory_interface, env.Config());
+
+    REQUIRE(lockstep.Checkpoint(env.regs, 2));
+    env.RunBlock(1);
+    env.regs.arpb[2].raw ^= 0x0001;
+    REQUIRE_FALSE(lockstep.Verify(env.regs));
+    REQUIRE(env.report.find("arpb2: interpreter 2468, jit 2469") != std::string::npos);
+}
@@ -0,0 +1,104 @@
+#include <array>
+#include <vector>
+#include <catch.hpp>
+#include "../src/memory_interface.h"
+#include "core_environment.h"
+
+namespace {
+
+struct Access {
+    u16 address;
+    u16 value;
+    bool is_write;
+
+    bool operator==(const Access&) const = default;
+};
+
+// X and Y pages in different banks, so data addresses stop mapping onto consecutive memory
+// after the end of X at 0x7800. A watchpoint sits in the middle of page 0x0300, and MMIO is at
+// its default 0x8000.
+struct BulkTestEnvironment : CoreEnvironment {
+    static constexpr u16 WatchBegin = 0x0350;
+    static constexpr u16 WatchEnd = 0x0352;
+
+    std::vector<Access> hits;
+
+    BulkTestEnvironment() {
+        miu.page_mode_storage = 1;
+        miu.x_page = 0;
+        miu.y_page = 1;
+        for (std::size_t i = 0; i < dsp_memory.size(); ++i) {
+            dsp_memory[i] = static_cast<u8>(i * 7 + (i >> 9));
+        }
+        memory_interface.AddWatchpoint(
+            WatchBegin, WatchEnd,
+            Teakra::MemoryInterface::WatchRead | Teakra::MemoryInterface::WatchWrite,
+            [this](u32, u16 address, u16 value, bool is_write) {
+                hits.push_back({address, value, is_write});
+            });
+    }
+};
+
+struct Range {
+    u16 address;
+    u16 count;
+};
+
+constexpr std::array<Range, 5> Ranges{{
+    {0x02F0, 0x0120}, // into the watched page, across the watchpoint and out again
+    {0x77F0, 0x0020}, // across the end of X
+    {0x7FFA, 0x0008}, // into MMIO
+    {0x87FC, 0x0008}, // out of MMIO
+    {0xFFF8, 0x0010}, // wrapping at the end of the data space
+}};
+
+} // Anonymous namespace
+
+TEST_CASE("Bulk data reads match word by word reads", "[memory_interface]") {
+    for (bool bypass_mmio : {false, true}) {
+        for (const Range& range : Ranges) {
+            BulkTestEnvironment bulk, single;
+            std::vector<u16> expected(range.count), actual(range.count);
+            for (u16 i = 0; i < range.count; ++i) {
+                expected[i] =
+                    single.memory_interface.DataRead(static_cast<u16>(range.address + i),
+                                                     bypass_mmio);
+            }
+            bulk.memory_interface.DataReadWords(range.address, actual, bypass_mmio);
+
+            REQUIRE(actual == expected);
+            REQUIRE(bulk.hits == single.hits);
+        }
+    }
+}
+
+TEST_CASE("Bulk data writes match word by word writes", "[memory_interface]") {
+    for (bool bypass_mmio : {false, true}) {
+        for (const Range& range : Ranges) {
+            BulkTestEnvironment bulk, single;
+            std::vector<u16> values(range.count);
+            for (u16 i = 0; i < range.count; ++i) {
+                values[i] = static_cast<u16>(0xC000 + range.address + i);
+                single.memory_interface.DataWrite(static_cast<u16>(range.address + i), values[i],
+                                                  bypass_mmio);
+            }
+            bulk.memory_interface.DataWriteWords(range.address, values, bypass_mmio);
+
+            REQUIRE(bulk.dsp_memory == single.dsp_memory);
+            REQUIRE(bulk.hits == single.hits);
+            for (u16 i = 0; i < range.count; ++i) {
+                const u16 address = static_cast<u16>(range.address + i);
+                if (!bypass_mmio && bulk.miu.InMMIO(address)) {
+                    REQUIRE(bulk.memory_interface.MMIORead(address) ==
+                            single.memory_interface.MMIORead(address));
+                }
+            }
+        }
+    }
+
+    // The watchpoint saw every write to it, once
+    BulkTestEnvironment env;
+    std::vector<u16> values(0x0100, 0x1234);
+    env.memory_interface.DataWriteWords(0x0300, values);
+    REQUIRE(env.hits.size() == BulkTestEnvironment::WatchEnd - BulkTestEnvironment::WatchBegin + 1);
+}
@@ -0,0 +1,86 @@
+#include <memory>
+#include <vector>
+#include <catch.hpp>
+#include "../src/interpreter.h"
+#include "../src/register.h"
+#include "../src/spmd_interpreter.h"
+#include "core_environment.h"
+
+namespace {
+
+constexpr u16 Target = 0x0100;
+
+// Counts a0 down, then keeps incrementing a1 and storing it. Lanes starting with different
+// a0 leave the countdown at different times and meet again in the outer loop.
+constexpr std::array<u16, 5> Program{
+    0x67E0, // dec a0 always
+    0x57E3, // brr 0xfffe gt
+    0x77D0, // inc a1 always
+    0x1B61, // mov a1l, [r1]
+    0x57B0, // brr 0xfffb always
+};
+
+struct Lane : CoreEnvironment {
+    Teakra::RegisterState regs;
+    Teakra::Interpreter interpreter{core_timing, regs, memory_interface};
+
+    explicit Lane(u64 countdown) {
+        for (u16 i = 0; i < Program.size(); ++i) {
+            memory_interface.ProgramWrite(i, Program[i]);
+        }
+        regs.a[0] = countdown;
+        regs.r[1] = Target;
+    }
+};
+
+std::vector<std::unique_ptr<Lane>> MakeLanes(std::size_t count) {
+    std::vector<std::unique_ptr<Lane>> lanes;
+    for (std::size_t i = 0; i < count; ++i) {
+        // Some lanes share a countdown, so they also run in step from the start
+        lanes.push_back(std::make_unique<Lane>(i % 7 * 3));
+    }
+    return lanes;
+}
+
+} // Anonymous namespace
+
+TEST_CASE("Batched stepping matches sequential stepping", "[spmd]") {
+    // More lanes than one group, so the group split is covered too
+    constexpr std::size_t LaneCount = Teakra::SpmdInterpreter::MaxLanes + 4;
+    auto sequential = MakeLanes(LaneCount);
+    auto batched = MakeLanes(LaneCount);
+
+    std::vector<Teakra::Interpreter*> interpreters;
+    for (auto& lane : batched) {
+        interpreters.push_back(&lane->interpreter);
+    }
+    Teakra::SpmdInterpreter spmd{interpreters};
+
+    // Several runs, so lanes also resume mid-divergence
+    for (u64 cycles : {1, 10, 37, 100}) {
+        for (auto& lane : sequential) {
+            lane->interpreter.Run(cycles);
+        }
+        spmd.Run(cycles);
+
+        for (std::size_t i = 0; i < LaneCount; ++i) {
+            const Lane& expected = *sequential[i];
+            const Lane& actual = *batched[i];
+            REQUIRE(expected.regs.pc == actual.regs.pc);
+            REQUIRE(expected.interpreter.inst_pc == actual.interpreter.inst_pc);
+            REQUIRE(expected.regs.a == actual.regs.a);
+            REQUIRE(expected.regs.r == actual.regs.r);
+            REQUIRE(expected.regs.fz == actual.regs.fz);
+            REQUIRE(expected.regs.fm == actual.regs.fm);
+            REQUIRE(expected.regs.fn == actual.regs.fn);
+            REQUIRE(expected.core_timing.GetTicks() == actual.core_timing.GetTicks());
+            REQUIRE(expected.dsp_memory == actual.dsp_memory);
+        }
+    }
+
+    // Every lane stepped once per cycle, and the lanes at a shared pc were batched
+    const Teakra::BatchStats& stats = spmd.GetStats();
+    REQUIRE(stats.steps == LaneCount * (1 + 10 + 37 + 100));
+    REQUIRE(stats.shared_steps > 0);
+    REQUIRE(stats.shared_steps < stats.steps);
+}
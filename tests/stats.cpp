@@ -0,0 +1,173 @@
+#include <limits>
+#include <vector>
+#include <catch.hpp>
+#include "teakra/stats.h"
+#include "core_environment.h"
+
+namespace {
+
+constexpr u16 DataSpace = 0;
+constexpr u16 AhbmSpace = 7;
+constexpr u16 UnitU16 = 1;
+constexpr u16 BurstX4 = 1;
+constexpr u16 BurstX8 = 2;
+
+// DMA channel 0 reads through AHBM channel 0, DMA channel 1 writes through AHBM channel 1
+struct StatsTestEnvironment : CoreEnvironment {
+    std::vector<u8> fcram = std::vector<u8>(0x100);
+    int interrupts = 0;
+
+    StatsTestEnvironment() {
+        dma.SetInterruptHandler([this] { ++interrupts; });
+        ahbm.SetExternalMemoryCallback(
+            [this](u32 address) -> u8 { return fcram[address & 0xFF]; },
+            [this](u32 address, u8 value) { fcram[address & 0xFF] = value; },
+            [this](u32 address) -> u16 {
+                return fcram[address & 0xFF] | (fcram[(address + 1) & 0xFF] << 8);
+            },
+            [this](u32 address, u16 value) {
+                fcram[address & 0xFF] = static_cast<u8>(value);
+                fcram[(address + 1) & 0xFF] = static_cast<u8>(value >> 8);
+            },
+            [this](u32 address) -> u32 {
+                u32 value = 0;
+                for (u32 i = 0; i < 4; ++i) {
+                    value |= fcram[(address + i) & 0xFF] << (i * 8);
+                }
+                return value;
+            },
+            [this](u32 address, u32 value) {
+                for (u32 i = 0; i < 4; ++i) {
+                    fcram[(address + i) & 0xFF] = static_cast<u8>(value >> (i * 8));
+                }
+            });
+
+        ahbm.SetDmaChannel(0, 1 << 0);
+        ahbm.SetDirection(0, 0);
+        ahbm.SetUnitSize(0, UnitU16);
+        ahbm.SetBurstSize(0, BurstX4);
+
+        ahbm.SetDmaChannel(1, 1 << 1);
+        ahbm.SetDirection(1, 1);
+        ahbm.SetUnitSize(1, UnitU16);
+        ahbm.SetBurstSize(1, BurstX8);
+    }
+
+    void Transfer(u16 channel, u16 src_space, u16 dst_space, u16 words, bool dword_mode) {
+        dma.ActivateChannel(channel);
+        dma.SetAddrSrcHigh(src_space == AhbmSpace ? 0x2000 : 0);
+        dma.SetAddrSrcLow(src_space == AhbmSpace ? 0 : 0x0100);
+        dma.SetAddrDstHigh(dst_space == AhbmSpace ? 0x2000 : 0);
+        dma.SetAddrDstLow(dst_space == AhbmSpace ? 0x0080 : 0x0100);
+        dma.SetSize0(words);
+        dma.SetSize1(1);
+        dma.SetSize2(1);
+        dma.SetSrcStep0(dword_mode ? 2 : 1);
+        dma.SetDstStep0(dword_mode ? 2 : 1);
+        dma.SetSrcSpace(src_space);
+        dma.SetDstSpace(dst_space);
+        dma.SetDwordMode(dword_mode);
+        dma.DoDma(channel);
+    }
+
+    Teakra::Stats Snapshot() const {
+        Teakra::Stats stats;
+        stats.dma = dma.GetStats();
+        stats.ahbm = ahbm.GetStats();
+        return stats;
+    }
+};
+
+} // Anonymous namespace
+
+TEST_CASE("DMA and AHBM count their transfers", "[stats]") {
+    StatsTestEnvironment env;
+
+    env.Transfer(0, AhbmSpace, DataSpace, 8, false);
+    const auto& dma = env.dma.GetStats();
+    const auto& ahbm = env.ahbm.GetStats();
+    REQUIRE(env.interrupts == 1);
+    REQUIRE(dma.transfers[0] == 1);
+    REQUIRE(dma.words_from_space[AhbmSpace] == 8);
+    REQUIRE(dma.words_to_space[DataSpace] == 8);
+    REQUIRE(dma.transfer_cycles[0] == 8);
+    REQUIRE(ahbm.read_bursts[BurstX4] == 2);
+    REQUIRE(ahbm.external_reads[UnitU16] == 8);
+
+    env.Transfer(1, DataSpace, AhbmSpace, 8, false);
+    REQUIRE(dma.transfers[1] == 1);
+    REQUIRE(dma.words_from_space[DataSpace] == 8);
+    REQUIRE(dma.words_to_space[AhbmSpace] == 8);
+    REQUIRE(dma.transfer_cycles[1] == 8);
+    REQUIRE(ahbm.write_bursts[BurstX8] == 1);
+    REQUIRE(ahbm.external_writes[UnitU16] == 8);
+
+    // Two words per cycle, one AHBM unit per word pair
+    env.Transfer(0, AhbmSpace, DataSpace, 8, true);
+    REQUIRE(dma.transfers[0] == 2);
+    REQUIRE(dma.words_from_space[AhbmSpace] == 16);
+    REQUIRE(dma.transfer_cycles[0] == 8 + 4);
+    REQUIRE(ahbm.read_bursts[BurstX4] == 3);
+    REQUIRE(ahbm.external_reads[UnitU16] == 12);
+
+    REQUIRE(ahbm.read_bursts[BurstX8] == 0);
+    REQUIRE(ahbm.write_bursts[BurstX4] == 0);
+    REQUIRE(ahbm.external_reads[0] == 0);
+    REQUIRE(ahbm.external_writes[2] == 0);
+}
+
+TEST_CASE("Stats deltas cover only the interval", "[stats]") {
+    StatsTestEnvironment env;
+    env.Transfer(0, AhbmSpace, DataSpace, 8, false);
+    const Teakra::Stats first = env.Snapshot();
+
+    env.Transfer(1, DataSpace, AhbmSpace, 8, false);
+    const Teakra::Stats second = env.Snapshot();
+    const Teakra::Stats delta = second - first;
+    REQUIRE(delta.dma.transfers[0] == 0);
+    REQUIRE(delta.dma.transfers[1] == 1);
+    REQUIRE(delta.dma.words_from_space[AhbmSpace] == 0);
+    REQUIRE(delta.dma.words_to_space[AhbmSpace] == 8);
+    REQUIRE(delta.ahbm.read_bursts[BurstX4] == 0);
+    REQUIRE(delta.ahbm.write_bursts[BurstX8] == 1);
+
+    // The counters are monotonic and survive a reset, so a delta across one stays valid
+    env.dma.Reset();
+    env.ahbm.Reset();
+    const Teakra::Stats after_reset = env.Snapshot();
+    REQUIRE((after_reset - second).dma.transfers[1] == 0);
+    REQUIRE(after_reset.dma.transfers[1] == 1);
+    REQUIRE(after_reset.ahbm.write_bursts[BurstX8] == 1);
+}
+
+TEST_CASE("Stats deltas survive counter rollover", "[stats]") {
+    constexpr auto Max = std::numeric_limits<std::uint64_t>::max();
+
+    Teakra::Stats before;
+    before.cycles = Max - 9;
+    before.dma.transfers[2] = Max;
+    before.ahbm.external_writes[0] = Max - 1;
+    before.interrupts.latency[0].count = Max;
+    before.interrupts.latency[0].max_cycles = 300;
+    before.jit.blocks_compiled = Max - 4;
+
+    Teakra::Stats after;
+    after.cycles = 10;
+    after.dma.transfers[2] = 2;
+    after.ahbm.external_writes[0] = 0;
+    after.interrupts.latency[0].count = 0;
+    after.interrupts.latency[0].max_cycles = 500;
+    after.jit.blocks_compiled = 5;
+    after.jit.cpu_tier = Teakra::JitCpuTier::Avx2;
+
+    const Teakra::Stats delta = after - before;
+    REQUIRE(delta.cycles == 20);
+    REQUIRE(delta.dma.transfers[2] == 3);
+    REQUIRE(delta.ahbm.external_writes[0] == 2);
+    REQUIRE(delta.interrupts.latency[0].count == 1);
+    REQUIRE(delta.jit.blocks_compiled == 10);
+
+    // Neither a maximum nor the tier can be differenced, the newer snapshot's are kept
+    REQUIRE(delta.interrupts.latency[0].max_cycles == 500);
+    REQUIRE(delta.jit.cpu_tier == Teakra::JitCpuTier::Avx2);
+}
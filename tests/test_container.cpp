@@ -0,0 +1,160 @@
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+#include <catch.hpp>
+#include "../src/test_container.h"
+
+namespace {
+
+using Teakra::Test::TestCaseReader;
+using Teakra::Test::TestCaseWriter;
+using Teakra::Test::TestFormat;
+
+// Random before states, with the few registers and memory words an instruction would change
+std::vector<TestCase> MakeTestCases(std::size_t count) {
+    std::mt19937 random(0x7E57);
+    std::vector<TestCase> test_cases(count);
+    for (auto& test_case : test_cases) {
+        auto* before = reinterpret_cast<u8*>(&test_case.before);
+        for (std::size_t i = 0; i < sizeof(State); ++i) {
+            before[i] = static_cast<u8>(random());
+        }
+        test_case.after = test_case.before;
+        test_case.after.a[0] += random();
+        test_case.after.r[random() % 8] ^= 0x8000;
+        test_case.after.arp[3] = static_cast<u16>(random());
+        test_case.after.test_space_x[random() % TestSpaceSize] ^= 1;
+        test_case.after.test_space_y[TestSpaceSize - 1] ^= 0xFFFF;
+        test_case.opcode = static_cast<u16>(random());
+        test_case.expand = static_cast<u16>(random());
+    }
+    return test_cases;
+}
+
+bool SameTestCase(const TestCase& expected, const TestCase& actual) {
+    return std::memcmp(&expected.before, &actual.before, sizeof(State)) == 0 &&
+           std::memcmp(&expected.after, &actual.after, sizeof(State)) == 0 &&
+           expected.opcode == actual.opcode && expected.expand == actual.expand;
+}
+
+// A file in the temporary directory, removed when the test is done with it
+struct TempFile {
+    std::string path;
+
+    explicit TempFile(const char* name)
+        : path((std::filesystem::temp_directory_path() / name).string()) {}
+
+    ~TempFile() {
+        std::filesystem::remove(path);
+    }
+
+    std::vector<char> Load() const {
+        std::ifstream in(path, std::ios::binary);
+        return std::vector<char>(std::istreambuf_iterator<char>(in), {});
+    }
+
+    void Store(const std::vector<char>& bytes) const {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    }
+};
+
+void WriteTestCases(const TempFile& file, TestFormat format,
+                    const std::vector<TestCase>& test_cases) {
+    TestCaseWriter writer(file.path.c_str(), format);
+    REQUIRE(writer.IsOpen());
+    for (const auto& test_case : test_cases) {
+        REQUIRE(writer.Write(test_case));
+    }
+    REQUIRE(writer.Finish());
+}
+
+} // Anonymous namespace
+
+TEST_CASE("Test cases round-trip through both formats", "[test_container]") {
+    const auto test_cases = MakeTestCases(50);
+    for (TestFormat format : {TestFormat::Raw, TestFormat::Compact}) {
+        TempFile file("teakra_test_container_round_trip.bin");
+        WriteTestCases(file, format, test_cases);
+
+        TestCaseReader reader(file.path.c_str());
+        REQUIRE(reader.IsOpen());
+        REQUIRE(reader.GetFormat() == format);
+        REQUIRE(reader.Size() == test_cases.size());
+        for (std::size_t i = 0; i < test_cases.size(); ++i) {
+            TestCase test_case{};
+            REQUIRE(reader.Get(i, test_case));
+            REQUIRE(SameTestCase(test_cases[i], test_case));
+        }
+        TestCase test_case{};
+        REQUIRE_FALSE(reader.Get(test_cases.size(), test_case));
+    }
+
+    // Only the changed words are stored for the after state
+    TempFile raw("teakra_test_container_raw.bin");
+    TempFile compact("teakra_test_container_compact.bin");
+    WriteTestCases(raw, TestFormat::Raw, test_cases);
+    WriteTestCases(compact, TestFormat::Compact, test_cases);
+    REQUIRE(compact.Load().size() < raw.Load().size() * 2 / 3);
+}
+
+TEST_CASE("Damaged compact headers are rejected or read as raw", "[test_container]") {
+    const auto test_cases = MakeTestCases(3);
+    TempFile file("teakra_test_container_damaged.bin");
+    WriteTestCases(file, TestFormat::Compact, test_cases);
+    const std::vector<char> bytes = file.Load();
+
+    SECTION("unknown version") {
+        auto damaged = bytes;
+        damaged[4] = 2;
+        file.Store(damaged);
+        REQUIRE_FALSE(TestCaseReader(file.path.c_str()).IsOpen());
+    }
+
+    SECTION("index cut off") {
+        file.Store(std::vector<char>(bytes.begin(), bytes.end() - 1));
+        REQUIRE_FALSE(TestCaseReader(file.path.c_str()).IsOpen());
+    }
+
+    SECTION("index pointing past the records") {
+        auto damaged = bytes;
+        const u64 bad_offset = damaged.size() - 2;
+        std::memcpy(damaged.data() + damaged.size() - sizeof(u64), &bad_offset, sizeof(u64));
+        file.Store(damaged);
+        TestCaseReader reader(file.path.c_str());
+        REQUIRE(reader.IsOpen());
+        TestCase test_case{};
+        REQUIRE(reader.Get(0, test_case));
+        REQUIRE(SameTestCase(test_cases[0], test_case));
+        REQUIRE_FALSE(reader.Get(test_cases.size() - 1, test_case));
+    }
+
+    // Without the magic there is no header to check, so the bytes are taken as a raw array,
+    // with the partial record at the end ignored. The records come out as garbage.
+    SECTION("bad magic") {
+        auto damaged = bytes;
+        damaged[0] = 'X';
+        file.Store(damaged);
+        TestCaseReader reader(file.path.c_str());
+        REQUIRE(reader.IsOpen());
+        REQUIRE(reader.GetFormat() == TestFormat::Raw);
+        REQUIRE(reader.Size() == damaged.size() / sizeof(TestCase));
+    }
+
+    SECTION("header cut off") {
+        file.Store(std::vector<char>(bytes.begin(), bytes.begin() + 16));
+        TestCaseReader reader(file.path.c_str());
+        REQUIRE(reader.IsOpen());
+        REQUIRE(reader.GetFormat() == TestFormat::Raw);
+        REQUIRE(reader.Size() == 0);
+    }
+
+    SECTION("missing file") {
+        std::filesystem::remove(file.path);
+        REQUIRE_FALSE(TestCaseReader(file.path.c_str()).IsOpen());
+    }
+}
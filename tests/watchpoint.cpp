@@ -0,0 +1,165 @@
+#include <vector>
+#include <catch.hpp>
+#include "../src/interpreter.h"
+#include "../src/jit_no_ir.h"
+#include "../src/register.h"
+#include "core_environment.h"
+
+namespace {
+
+constexpr u16 LoadR1ToA0l = 0x1F41;  // mov [r1], a0l
+constexpr u16 StoreA0lToR2 = 0x1B42; // mov a0l, [r2]
+constexpr u16 StoreA0lToR3 = 0x1B43; // mov a0l, [r3]
+
+constexpr u16 Source = 0x0120;
+constexpr u16 Target = 0x0130;
+constexpr u16 OtherPage = 0x0200;
+constexpr u16 Value = 0x1111;
+
+struct Hit {
+    u32 pc;
+    u16 address;
+    u16 value;
+    bool is_write;
+
+    bool operator==(const Hit&) const = default;
+};
+
+// Loads Source, then stores it to Target and to the next watch page
+struct WatchpointTestEnvironment : CoreEnvironment {
+    std::vector<Hit> hits;
+
+    WatchpointTestEnvironment() {
+        memory_interface.ProgramWrite(0, LoadR1ToA0l);
+        memory_interface.ProgramWrite(1, StoreA0lToR2);
+        memory_interface.ProgramWrite(2, StoreA0lToR3);
+        memory_interface.DataWrite(Source, Value);
+    }
+
+    u32 Watch(u16 begin, u16 end, u8 type) {
+        return memory_interface.AddWatchpoint(begin, end, type,
+                                              [this](u32 pc, u16 address, u16 value, bool is_write) {
+                                                  hits.push_back({pc, address, value, is_write});
+                                              });
+    }
+
+    template <typename Registers>
+    static void Reset(Registers& regs) {
+        regs.pc = 0;
+        regs.a[0] = 0;
+        regs.r[1] = Source;
+        regs.r[2] = Target;
+        regs.r[3] = OtherPage;
+    }
+};
+
+struct InterpreterTestEnvironment : WatchpointTestEnvironment {
+    Teakra::RegisterState regs;
+    Teakra::Interpreter interpreter{core_timing, regs, memory_interface};
+
+    InterpreterTestEnvironment() {
+        memory_interface.SetWatchPc(&interpreter.inst_pc);
+    }
+
+    ~InterpreterTestEnvironment() {
+        memory_interface.SetWatchPc(&memory_interface.watch_pc_storage);
+    }
+
+    void RunProgram() {
+        Reset(regs);
+        interpreter.Run(3);
+    }
+};
+
+struct JitTestEnvironment : WatchpointTestEnvironment {
+    Teakra::JitRegisters regs;
+    Teakra::EmitX64 jit{core_timing, regs, memory_interface};
+
+    void RunProgram() {
+        Reset(regs);
+        jit.Run(3);
+    }
+};
+
+constexpr Hit SourceRead{0, Source, Value, false};
+constexpr Hit TargetWrite{1, Target, Value, true};
+constexpr Hit OtherPageWrite{2, OtherPage, Value, true};
+
+template <typename Environment>
+void CheckWatchpoints() {
+    SECTION("read") {
+        Environment env;
+        env.Watch(Source, Source, Teakra::MemoryInterface::WatchRead);
+        env.Watch(Target, Target, Teakra::MemoryInterface::WatchRead);
+        env.RunProgram();
+        REQUIRE(env.hits == std::vector<Hit>{SourceRead});
+    }
+
+    SECTION("write") {
+        Environment env;
+        env.Watch(Source, Source, Teakra::MemoryInterface::WatchWrite);
+        env.Watch(Target, Target, Teakra::MemoryInterface::WatchWrite);
+        env.RunProgram();
+        REQUIRE(env.hits == std::vector<Hit>{TargetWrite});
+        REQUIRE(env.memory_interface.DataRead(Target) == Value);
+    }
+
+    SECTION("range") {
+        Environment env;
+        // Shares the watch page with OtherPage, which must still be filtered out
+        env.Watch(0x0100, OtherPage - 1,
+                  Teakra::MemoryInterface::WatchRead | Teakra::MemoryInterface::WatchWrite);
+        env.RunProgram();
+        REQUIRE(env.hits == std::vector<Hit>{SourceRead, TargetWrite});
+
+        env.hits.clear();
+        env.Watch(OtherPage, 0x02FF, Teakra::MemoryInterface::WatchWrite);
+        env.RunProgram();
+        REQUIRE(env.hits == std::vector<Hit>{SourceRead, TargetWrite, OtherPageWrite});
+    }
+
+    SECTION("removed") {
+        Environment env;
+        const u32 id = env.Watch(Source, Target,
+                                 Teakra::MemoryInterface::WatchRead |
+                                     Teakra::MemoryInterface::WatchWrite);
+        env.memory_interface.RemoveWatchpoint(id);
+        env.RunProgram();
+        REQUIRE(env.hits.empty());
+        REQUIRE(env.memory_interface.DataRead(OtherPage) == Value);
+    }
+}
+
+} // Anonymous namespace
+
+TEST_CASE("Watchpoints hit on the interpreter", "[watchpoint]") {
+    CheckWatchpoints<InterpreterTestEnvironment>();
+}
+
+TEST_CASE("Watchpoints hit on the JIT", "[watchpoint]") {
+    CheckWatchpoints<JitTestEnvironment>();
+}
+
+TEST_CASE("Changing a watchpoint recompiles the JIT blocks", "[watchpoint]") {
+    JitTestEnvironment env;
+    env.RunProgram();
+    const u64 compiled = env.jit.compile_stats.blocks_compiled;
+    REQUIRE(compiled > 0);
+
+    // Same pc and state, so only the watch generation tells the cached block apart
+    env.RunProgram();
+    REQUIRE(env.jit.compile_stats.blocks_compiled == compiled);
+    REQUIRE(env.hits.empty());
+
+    const u32 id = env.Watch(Target, Target, Teakra::MemoryInterface::WatchWrite);
+    env.RunProgram();
+    REQUIRE(env.jit.compile_stats.blocks_compiled > compiled);
+    REQUIRE(env.hits == std::vector<Hit>{TargetWrite});
+
+    const u64 watched = env.jit.compile_stats.blocks_compiled;
+    env.hits.clear();
+    env.memory_interface.RemoveWatchpoint(id);
+    env.RunProgram();
+    REQUIRE(env.jit.compile_stats.blocks_compiled > watched);
+    REQUIRE(env.hits.empty());
+}